@@ -12,6 +12,44 @@
 
 #endif
 
+//! If COLLISHI_PROFILE is defined, every collision routine passes a sample of its calls to the profiler in CollisionsProfile.h
+//! This needs C++17 and __builtin_is_constant_evaluated (GCC 9, Clang 9, MSVC 19.25), since the routines stay constexpr
+//! Without COLLISHI_PROFILE, the hooks expand to nothing
+
+#ifdef COLLISHI_PROFILE
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define COLLISHI_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+
+#if !defined(COLLISHI_CONSTANT_EVALUATED) && ((defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+#define COLLISHI_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+
+#if __cplusplus < 201703L && !defined(_MSVC_LANG)
+#error "COLLISHI_PROFILE needs C++17"
+#endif
+
+#ifndef COLLISHI_CONSTANT_EVALUATED
+#error "COLLISHI_PROFILE needs __builtin_is_constant_evaluated (GCC 9, Clang 9, MSVC 19.25 or newer)"
+#endif
+
+namespace Collishi::Profile {
+
+	template <auto routine, class... T> void sample(T... args);
+
+}
+
+#define COLLISHI_PROFILE_SAMPLE(routine, ...) (COLLISHI_CONSTANT_EVALUATED() ? ((void) 0) : ::Collishi::Profile::sample<&routine>(__VA_ARGS__))
+
+#else
+
+#define COLLISHI_PROFILE_SAMPLE(routine, ...) ((void) 0)
+
+#endif
+
 namespace Collishi {
 
 	//! Collishi version 0.2.0
@@ -80,6 +118,8 @@ namespace Collishi {
 
 	constexpr bool collision_point_point(float x1, float y1, float x2, float y2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_point_point, x1, y1, x2, y2);
+
 		//! Usually, this routine will yield false
 
 		return (x1 == x2 && y1 == y2);
@@ -90,6 +130,8 @@ namespace Collishi {
 
 	constexpr bool collision_point_line(float x1, float y1, float x2, float y2, float dx2, float dy2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_point_line, x1, y1, x2, y2, dx2, dy2);
+
 		//! The most useful check is to check whether the point has a normal component to the line
 		//! If so, it is impossible for the point to intersect the line
 		//! This case is also the most common one, so it is wise to check it first
@@ -116,6 +158,8 @@ namespace Collishi {
 
 	constexpr bool collision_point_circle(float x1, float y1, float x2, float y2, float r2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_point_circle, x1, y1, x2, y2, r2);
+
 		//! Simple check whether the point is inside the circle radius
 
 		auto dx = x1 - x2;
@@ -129,6 +173,8 @@ namespace Collishi {
 
 	constexpr bool collision_point_box(float x1, float y1, float x2, float y2, float w2, float h2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_point_box, x1, y1, x2, y2, w2, h2);
+
 		//! Literally the definition of an AABB
 
 		if (x1 < x2) return false;
@@ -141,6 +187,8 @@ namespace Collishi {
 
 	constexpr bool collision_point_triangle(float x1, float y1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_point_triangle, x1, y1, x2, y2, sxa2, sya2, sxb2, syb2);
+
 		//! Point coordinates relative to the first triangle point
 
 		auto dx12 = x1 - x2;
@@ -175,6 +223,8 @@ namespace Collishi {
 
 	constexpr bool collision_line_line(float x1, float y1, float dx1, float dy1, float x2, float y2, float dx2, float dy2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_line_line, x1, y1, dx1, dy1, x2, y2, dx2, dy2);
+
 		//! This algorithm is an extension of point/line collisions
 		//! First, the cross product of the two lines will be calculated
 		//! If it is vanishing, the lines are both on their respective infinite extensions
@@ -212,6 +262,8 @@ namespace Collishi {
 
 	constexpr bool collision_line_circle(float x1, float y1, float dx1, float dy1, float x2, float y2, float r2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_line_circle, x1, y1, dx1, dy1, x2, y2, r2);
+
 		//! This algorithm is a direct implementation of the separating axis theorem
 		//! If there is axis at which the projections of both objects do not overlap, they don't intersect
 
@@ -275,6 +327,8 @@ namespace Collishi {
 
 	constexpr bool collision_line_box(float x1, float y1, float dx1, float dy1, float x2, float y2, float w2, float h2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_line_box, x1, y1, dx1, dy1, x2, y2, w2, h2);
+
 		//! First check whether any end point lies inside the box
 
 		if (collision_point_box(x1, y1, x2, y2, w2, h2)) return true;
@@ -302,8 +356,9 @@ namespace Collishi {
 
 		//! Check whether the y coordinate of the intersection point with the left AABB side is actually inside the AABB
 		//! The following checks will repeat this procedure for the other sides
+		//! Since the terms were multiplied by dx1 (or dy1), the order of the interval borders depends on its sign
 
-		if ((nom_x_neg_dy >= nom_y_neg_dx) && (nom_x_neg_dy <= nom_y_pos_dx)) {
+		if (between(nom_x_neg_dy, nom_y_neg_dx, nom_y_pos_dx)) {
 
 			//! The case of a vanishing dx1 should not occur, but even then, the next check will rule it out definitely
 			//! Here, the line parameter of the intersection point will be checked for its sign
@@ -317,7 +372,7 @@ namespace Collishi {
 
 		//! Check right side
 
-		if ((nom_x_pos_dy >= nom_y_neg_dx) && (nom_x_pos_dy <= nom_y_pos_dx)) {
+		if (between(nom_x_pos_dy, nom_y_neg_dx, nom_y_pos_dx)) {
 
 			//! The line got shifted in its coordinates, so a new line parameter check is necessary
 
@@ -327,7 +382,7 @@ namespace Collishi {
 
 		//! Check bottom side
 
-		if ((nom_y_neg_dx >= nom_x_neg_dy) && (nom_y_neg_dx <= nom_x_pos_dy)) {
+		if (between(nom_y_neg_dx, nom_x_neg_dy, nom_x_pos_dy)) {
 
 			if (fraction_between_zero_and_one(nominator_y_neg, dy1)) return true;
 
@@ -335,7 +390,7 @@ namespace Collishi {
 
 		//! Check top side
 
-		if ((nom_y_pos_dx >= nom_x_neg_dy) && (nom_y_pos_dx <= nom_x_pos_dy)) {
+		if (between(nom_y_pos_dx, nom_x_neg_dy, nom_x_pos_dy)) {
 
 			if (fraction_between_zero_and_one(nominator_y_pos, dy1)) return true;
 
@@ -347,6 +402,8 @@ namespace Collishi {
 
 	constexpr bool collision_line_triangle(float x1, float y1, float dx1, float dy1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_line_triangle, x1, y1, dx1, dy1, x2, y2, sxa2, sya2, sxb2, syb2);
+
 		//! This function is another application of the separating axis theorem
 		//! First, the distances between the line starting point and the three triangle vertices will be calculated
 
@@ -373,6 +430,10 @@ namespace Collishi {
 
 		if (p2_n1_negative + pa_n1_negative + pb_n1_negative == 3) return false;
 
+		//! The same holds if all projections are positive (a vanishing projection means the triangle touches the line)
+
+		if (projection_2_on_n1 > 0.0f && projection_a_on_n1 > 0.0f && projection_b_on_n1 > 0.0f) return false;
+
 		//! Now, the line needs to be projected on each triangle side
 		//! This time, if both line points are outside of the interval between 0 and the opposite vertex, no intersection happens
 
@@ -407,6 +468,8 @@ namespace Collishi {
 
 	constexpr bool collision_circle_circle(float x1, float y1, float r1, float x2, float y2, float r2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_circle_circle, x1, y1, r1, x2, y2, r2);
+
 		//! Simple generalization of point/circle
 
 		auto dx = x1 - x2;
@@ -422,6 +485,8 @@ namespace Collishi {
 
 	constexpr bool collision_circle_box(float x1, float y1, float r1, float x2, float y2, float w2, float h2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_circle_box, x1, y1, r1, x2, y2, w2, h2);
+
 		//! This algorithm makes use of the separating axis theorem (SAT)
 		//! Essentially, the circle is projected onto both cardinal axes
 
@@ -496,6 +561,8 @@ namespace Collishi {
 
 	constexpr bool collision_circle_triangle(float x1, float y1, float r1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_circle_triangle, x1, y1, r1, x2, y2, sxa2, sya2, sxb2, syb2);
+
 		//! This test is similar to circle/box, but the checked axes are different
 		//! The first three axes are the normals of the triangle edges
 		//! The procedure here is fully according to the separating axis theorem again
@@ -578,6 +645,8 @@ namespace Collishi {
 
 	constexpr bool collision_box_box(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_box_box, x1, y1, w1, h1, x2, y2, w2, h2);
+
 		//! Simple generalization of point/box
 
 		if (x1 + w1 < x2) return false;
@@ -591,6 +660,8 @@ namespace Collishi {
 
 	constexpr bool collision_box_triangle(float x1, float y1, float w1, float h1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_box_triangle, x1, y1, w1, h1, x2, y2, sxa2, sya2, sxb2, syb2);
+
 		//! Get the difference vector
 
 		auto x21 = x2 - x1;
@@ -650,6 +721,8 @@ namespace Collishi {
 
 	constexpr bool collision_triangle_triangle(float x1, float y1, float sxa1, float sya1, float sxb1, float syb1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
 
+		COLLISHI_PROFILE_SAMPLE(collision_triangle_triangle, x1, y1, sxa1, sya1, sxb1, syb1, x2, y2, sxa2, sya2, sxb2, syb2);
+
 		//! This routine uses the SAT (you guessed it)
 		//! The normals to be tested are the three normals of each triangle
 		//! There is nothing more to explain in more detail, as this is straightforward, but tedious
@@ -804,11 +877,13 @@ static_assert(true == Collishi::collision_line_circle(1.0f, 1.0f, 8.0f, 8.0f,
 static_assert(true == Collishi::collision_line_box(3.0f, 2.0f, 8.0f, 11.0f,     0.0f, 1.0f, 10.0f, 10.0f));
 static_assert(false == Collishi::collision_line_box(11.0f, 0.0f, 11.0f, 13.0f,     0.0f, 1.0f, 10.0f, 10.0f));
 static_assert(true == Collishi::collision_line_box(1.0f, 1.0f, 7.0f, 7.0f,     2.0f, 2.0f, 4.0f, 4.0f));
+static_assert(true == Collishi::collision_line_box(54.0f, 52.0f, 12.0f, -40.0f,     28.0f, 16.0f, 44.0f, 8.0f));
 
 static_assert(true == Collishi::collision_line_triangle(3.0f, 0.0f, 0.0f, 2.0f,     2.0f, 1.0f, -1.0f, 3.0f, 2.0f, 1.0f));
 static_assert(false == Collishi::collision_line_triangle(2.0f, 4.0f, 2.0f, 0.0f,     2.0f, 1.0f, -1.0f, 3.0f, 2.0f, 1.0f));
 static_assert(true == Collishi::collision_line_triangle(2.0f, 1.0f, -1.0f, 3.0f,     2.0f, 1.0f, -1.0f, 3.0f, 2.0f, 1.0f));
 static_assert(true == Collishi::collision_line_triangle(2.0f, 1.0f, 2.0f, 1.0f,     2.0f, 1.0f, -1.0f, 3.0f, 2.0f, 1.0f));
+static_assert(false == Collishi::collision_line_triangle(41.0f, 68.0f, -12.0f, 4.0f,     8.0f, 45.0f, 23.0f, 19.0f, 22.0f, 25.0f));
 
 static_assert(true == Collishi::collision_circle_box(1.0f, -3.0f, 4.0f,     -5.0f, -4.0f, 10.0f, 8.0f));
 static_assert(true == Collishi::collision_circle_box(1.0f, -3.0f, 1.0f,     -5.0f, -2.0f, 10.0f, 4.0f));
@@ -841,4 +916,10 @@ static_assert(false == Collishi::collision_triangle_triangle(4.0f, 4.0f, 1.0f, 0
 static_assert(false == Collishi::collision_triangle_triangle(4.0f, 4.0f, 1.0f, 0.0f, 1.0f, 1.0f,     4.0f, 2.0f, 2.0f, 2.0f, 3.0f, 3.0f));
 static_assert(true == Collishi::collision_triangle_triangle(3.0f, 1.0f, 0.0f, 2.0f, 4.0f, 2.0f,     4.0f, 2.0f, 2.0f, 2.0f, 3.0f, 3.0f));
 
-#endif
\ No newline at end of file
+#endif
+
+//! The profiler needs the routine ids, CollisionsRoutines.h includes CollisionsProfile.h at its end
+
+#ifdef COLLISHI_PROFILE
+#include "CollisionsRoutines.h"
+#endif
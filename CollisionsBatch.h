@@ -0,0 +1,732 @@
+#pragma once
+
+//! Many-vs-many kernels for groups of shapes stored as separate arrays per coordinate (structure of arrays)
+//! For two groups of a few hundred or thousand shapes, e.g. all enemy hitboxes against all attack boxes of the player,
+//! testing all pairs is often cheaper than building a broadphase structure every frame
+//!
+//! collision_box_box_all_pairs tests every box of one group against every box of another group
+//! with the semantics of collision_box_box and appends the indices of all colliding pairs to a pair list
+//! The work is split into tiles of 8 x 8 boxes: the 8 boxes of the second group stay in SIMD registers
+//! while the 8 boxes of the first group are tested against them one after another, so every tile
+//! needs only 4 loads and the hits of a row are found with one movemask
+//! Tile rows are distributed over multiple threads, the resulting pair list is the same for any number of threads
+//!
+//! collision_line_circles and collision_lines_circle test one segment against many circles or many segments against one circle
+//! with the semantics of collision_line_circle, e.g. for the movement of projectiles during one tick
+//! The terms which only depend on the single shape are computed once, 8 tests run in parallel SIMD lanes,
+//! and besides the results, the parametric time at which the segment enters each circle is returned
+//!
+//! collision_circles_triangles tests many small circles (e.g. particles) against a set of triangles (e.g. static level geometry)
+//! with the semantics of collision_circle_triangle, 8 circles against one triangle at a time
+//! All terms which only depend on a triangle are computed once per triangle
+//!
+//! The results of the kernels are identical to the single pair routines, unless the compiler contracts multiplications and additions
+//! into FMA instructions differently (e.g. with -march=native), which can only change touching configurations
+
+#include "Collisions.h"
+#include "CollisionsRoutines.h"
+#include "CollisionsSimd.h"
+#include "CollisionsTags.h"
+#include "CollisionsTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace Collishi {
+
+	//! Boxes as separate arrays, the box i is (x[i]|y[i]) with the size w[i] x h[i]
+
+	struct BoxArrays {
+
+		const float* x;
+		const float* y;
+		const float* w;
+		const float* h;
+		std::size_t count;
+
+	};
+
+	//! Positions as separate arrays, for shapes whose dimensions are known at compile time (see CollisionsFixed.h)
+
+	struct PointArrays {
+
+		const float* x;
+		const float* y;
+		std::size_t count;
+
+	};
+
+	//! Circles as separate arrays, the circle i has the midpoint (x[i]|y[i]) and the radius r[i]
+
+	struct CircleArrays {
+
+		const float* x;
+		const float* y;
+		const float* r;
+		std::size_t count;
+
+	};
+
+	//! Line segments as separate arrays, the segment i goes from (x[i]|y[i]) to (x[i] + dx[i]|y[i] + dy[i])
+
+	struct LineArrays {
+
+		const float* x;
+		const float* y;
+		const float* dx;
+		const float* dy;
+		std::size_t count;
+
+	};
+
+	//! Triangles as separate arrays, the triangle i has the vertices (x[i]|y[i]), (x[i] + sxa[i]|y[i] + sya[i]) and (x[i] + sxb[i]|y[i] + syb[i])
+
+	struct TriangleArrays {
+
+		const float* x;
+		const float* y;
+		const float* sxa;
+		const float* sya;
+		const float* sxb;
+		const float* syb;
+		std::size_t count;
+
+	};
+
+	//! Indices of two colliding shapes, first refers to the first group
+
+	struct Pair {
+
+		std::uint32_t first;
+		std::uint32_t second;
+
+		constexpr bool operator==(const Pair& other) const { return first == other.first && second == other.second; }
+		constexpr bool operator!=(const Pair& other) const { return !(*this == other); }
+
+	};
+
+	namespace Batch {
+
+		constexpr std::size_t tile_size = 8;
+
+		//! Number of tile rows each thread takes at once
+		//! The chunks are written into separate pair lists and joined in order, so the result does not depend on the threads
+
+		constexpr std::size_t rows_per_chunk = 4;
+
+		//! Below this number of pairs, starting threads costs more than it saves
+
+		constexpr std::size_t pairs_per_thread = 1 << 16;
+
+		//! Bounds (left, top, right, bottom) of a group, padded to whole tiles
+		//! Right and bottom are computed as x + w and y + h like in collision_box_box, so the results are identical
+
+		struct TileBounds {
+
+			std::vector<float> left;
+			std::vector<float> top;
+			std::vector<float> right;
+			std::vector<float> bottom;
+
+			explicit TileBounds(const BoxArrays& boxes) {
+
+				pad(boxes.count);
+
+				for (std::size_t i = 0; i < boxes.count; i++) {
+
+					left[i] = boxes.x[i];
+					top[i] = boxes.y[i];
+					right[i] = boxes.x[i] + boxes.w[i];
+					bottom[i] = boxes.y[i] + boxes.h[i];
+
+				}
+
+			}
+
+			//! Boxes which all have the same size
+
+			TileBounds(const PointArrays& positions, float w, float h) {
+
+				pad(positions.count);
+
+				for (std::size_t i = 0; i < positions.count; i++) {
+
+					left[i] = positions.x[i];
+					top[i] = positions.y[i];
+					right[i] = positions.x[i] + w;
+					bottom[i] = positions.y[i] + h;
+
+				}
+
+			}
+
+		private:
+
+			void pad(std::size_t count) {
+
+				auto padded = (count + tile_size - 1) / tile_size * tile_size;
+				auto infinity = std::numeric_limits<float>::infinity();
+
+				left.assign(padded, infinity);
+				top.assign(padded, infinity);
+				right.assign(padded, -infinity);
+				bottom.assign(padded, -infinity);
+
+			}
+
+		};
+
+		//! Appends the pairs of the boxes first_begin to first_end against all boxes of the second group
+		//! If only_above is set, both groups are the same and only pairs with first < second are reported
+
+		inline void box_box_tile_rows(const TileBounds& first, std::size_t first_begin, std::size_t first_end, const TileBounds& second, std::size_t second_count, bool only_above, std::vector<Pair>& pairs) {
+
+			for (std::size_t column = (only_above ? first_begin / tile_size * tile_size : 0); column < second_count; column += tile_size) {
+
+				//! The padding lanes of the last tile are masked out, so they cannot report a pair even for NaN boxes
+
+				auto valid = (column + tile_size <= second_count ? 0xffu : (1u << (second_count - column)) - 1u);
+
+#if defined(COLLISHI_SIMD_AVX) || defined(COLLISHI_SIMD_SSE)
+
+				auto left_2 = Simd::load(second.left.data() + column);
+				auto top_2 = Simd::load(second.top.data() + column);
+				auto right_2 = Simd::load(second.right.data() + column);
+				auto bottom_2 = Simd::load(second.bottom.data() + column);
+
+#endif
+
+				for (auto i = first_begin; i < first_end; i++) {
+
+#if defined(COLLISHI_SIMD_AVX) || defined(COLLISHI_SIMD_SSE)
+
+					auto separated = Simd::less(Simd::broadcast(first.right[i]), left_2) | Simd::less(Simd::broadcast(first.bottom[i]), top_2)
+						| Simd::less(right_2, Simd::broadcast(first.left[i])) | Simd::less(bottom_2, Simd::broadcast(first.top[i]));
+
+					auto hits = static_cast<unsigned>(~Simd::movemask(separated)) & 0xffu;
+
+#else
+
+					unsigned hits = 0;
+
+					for (std::size_t lane = 0; lane < tile_size; lane++) {
+
+						auto j = column + lane;
+
+						auto separated = (first.right[i] < second.left[j]) | (first.bottom[i] < second.top[j]) | (second.right[j] < first.left[i]) | (second.bottom[j] < first.top[i]);
+
+						hits |= static_cast<unsigned>(!separated) << lane;
+
+					}
+
+#endif
+
+					hits &= valid;
+
+					//! On the diagonal tile, only the lanes above the diagonal count
+
+					if (only_above && column <= i) hits &= ~0u << std::min(i - column + 1, tile_size);
+
+					if (!hits) continue;
+
+					for (std::size_t lane = 0; lane < tile_size; lane++) {
+
+						if (hits & (1u << lane)) pairs.push_back({ static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(column + lane) });
+
+					}
+
+				}
+
+			}
+
+		}
+
+		inline void box_box_all_pairs(const TileBounds& first, std::size_t first_count, const TileBounds& second, std::size_t second_count, bool only_above, std::vector<Pair>& pairs, unsigned threads) {
+
+			auto tile_rows = (first_count + tile_size - 1) / tile_size;
+			auto chunk_count = (tile_rows + rows_per_chunk - 1) / rows_per_chunk;
+
+			auto total = first_count * second_count / (only_above ? 2 : 1);
+
+			if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+			threads = static_cast<unsigned>(std::min<std::size_t>({ threads, chunk_count, total / pairs_per_thread + 1 }));
+
+			auto process_chunk = [&](std::size_t chunk, std::vector<Pair>& output) {
+
+				auto begin = chunk * rows_per_chunk * tile_size;
+				auto end = std::min(first_count, begin + rows_per_chunk * tile_size);
+
+				box_box_tile_rows(first, begin, end, second, second_count, only_above, output);
+
+			};
+
+			if (threads <= 1) {
+
+				for (std::size_t chunk = 0; chunk < chunk_count; chunk++) process_chunk(chunk, pairs);
+				return;
+
+			}
+
+			//! Chunks are taken from a shared counter, which balances the uneven rows of the triangular case
+
+			std::vector<std::vector<Pair>> chunk_pairs(chunk_count);
+			std::atomic<std::size_t> next_chunk{ 0 };
+
+			auto worker = [&]() {
+
+				COLLISHI_TRACE_SCOPE("batch", "collision_box_box_all_pairs worker");
+
+				for (auto chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++) process_chunk(chunk, chunk_pairs[chunk]);
+
+			};
+
+			std::vector<std::thread> workers;
+
+			for (unsigned t = 1; t < threads; t++) workers.emplace_back(worker);
+
+			worker();
+
+			for (auto& thread : workers) thread.join();
+
+			std::size_t pair_count = 0;
+			for (auto& chunk : chunk_pairs) pair_count += chunk.size();
+
+			pairs.reserve(pairs.size() + pair_count);
+
+			for (auto& chunk : chunk_pairs) pairs.insert(pairs.end(), chunk.begin(), chunk.end());
+
+		}
+
+		//! Time t in [0, 1] at which the point (x1 + t * dx1|y1 + t * dy1) enters the circle, 0 if the segment starts inside
+		//! This is only meaningful if the segment collides with the circle; for touching segments, the closest point is used
+
+		inline float line_circle_entry_time(float x1, float y1, float dx1, float dy1, float x2, float y2, float r2) {
+
+			auto x21 = x2 - x1;
+			auto y21 = y2 - y1;
+
+			auto length_squared = dx1 * dx1 + dy1 * dy1;
+			auto along = dx1 * x21 + dy1 * y21;
+
+			auto discriminant = std::max(along * along - length_squared * ((x21 * x21 + y21 * y21) - r2 * r2), 0.0f);
+			auto time = (along - std::sqrt(discriminant)) / length_squared;
+
+			//! A segment of length zero gives NaN here, it can only collide at its start
+
+			if (!(time > 0.0f)) return 0.0f;
+
+			return std::min(time, 1.0f);
+
+		}
+
+#if defined(COLLISHI_SIMD_AVX) || defined(COLLISHI_SIMD_SSE)
+
+		//! collision_line_circle for 8 lanes, with the same operations in the same order, so the results are identical
+		//! The terms which only depend on the segment (length_squared) and the circle (r2_squared) are passed in,
+		//! so they can be computed once if they are the same for all lanes
+		//! Returns the lanes which are separated and stores the entry times of all lanes
+
+		inline Simd::Lanes line_circle_separated(Simd::Lanes x1, Simd::Lanes y1, Simd::Lanes dx1, Simd::Lanes dy1, Simd::Lanes length_squared, Simd::Lanes x2, Simd::Lanes y2, Simd::Lanes r2_squared, Simd::Lanes& entry_time) {
+
+			auto zero = Simd::broadcast(0.0f);
+
+			auto x21 = x2 - x1;
+			auto y21 = y2 - y1;
+
+			//! Projection on the normal of the line
+
+			auto proj_circle_normal = Simd::sign_square(y21 * dx1 - x21 * dy1);
+			auto proj_circle_normal_max = r2_squared * length_squared;
+
+			auto separated = Simd::less(proj_circle_normal, zero - proj_circle_normal_max) | Simd::less(proj_circle_normal_max, proj_circle_normal);
+
+			//! Projection on the axis to the closer end point, the minimum selects it like the branch in the scalar routine
+
+			auto x2d1 = x21 - dx1;
+			auto y2d1 = y21 - dy1;
+
+			auto distance_1_2 = x21 * x21 + y21 * y21;
+			auto distance_d_2 = x2d1 * x2d1 + y2d1 * y2d1;
+
+			auto closest = Simd::min(distance_1_2, distance_d_2);
+
+			auto p1 = closest * closest;
+			auto p2 = Simd::sign_square(distance_1_2 - dx1 * x21 - dy1 * y21);
+
+			auto proj_r2_squared = r2_squared * closest;
+
+			separated = separated | Simd::less(proj_r2_squared, Simd::min(p1, p2)) | Simd::less(Simd::max(p1, p2), zero - proj_r2_squared);
+
+			//! Entry time as in line_circle_entry_time
+			//! Simd::max returns its second argument if the first one is NaN, which handles segments of length zero
+
+			auto along = dx1 * x21 + dy1 * y21;
+			auto discriminant = Simd::max(along * along - length_squared * (distance_1_2 - r2_squared), zero);
+			auto time = (along - Simd::sqrt(discriminant)) / length_squared;
+
+			entry_time = Simd::min(Simd::max(time, zero), Simd::broadcast(1.0f));
+
+			return separated;
+
+		}
+
+		//! Writes the results and entry times of 8 lanes and returns the number of hits
+
+		inline std::size_t store_line_circle_lanes(Simd::Lanes separated, Simd::Lanes entry_time, bool* results, float* entry_times) {
+
+			auto hits = static_cast<unsigned>(~Simd::movemask(separated)) & 0xffu;
+
+			for (std::size_t lane = 0; lane < Simd::lane_count; lane++) results[lane] = (hits >> lane) & 1u;
+
+			if (entry_times) Simd::store(entry_times, Simd::select(separated, Simd::broadcast(std::numeric_limits<float>::infinity()), entry_time));
+
+			std::size_t count = 0;
+			for (; hits; hits &= hits - 1) count++;
+
+			return count;
+
+		}
+
+#endif
+
+		//! Number of particles which are tested against all triangles before moving on to the next particles
+		//! Their coordinates (3 KiB) stay in the L1 cache while the triangles are streamed past them
+
+		constexpr std::size_t particles_per_tile = 256;
+
+		//! All terms of collision_circle_triangle which only depend on the triangle
+
+		struct TriangleTerms {
+
+			float x, y;
+			float sxa, sya, sxb, syb, sxc, syc;
+			float cross_term;
+			float length_a, length_b, length_c;
+
+		};
+
+		inline TriangleTerms triangle_terms(float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+			auto sxc2 = sxb2 - sxa2;
+			auto syc2 = syb2 - sya2;
+
+			return { x2, y2, sxa2, sya2, sxb2, syb2, sxc2, syc2, sxa2 * syb2 - sxb2 * sya2, sxa2 * sxa2 + sya2 * sya2, sxb2 * sxb2 + syb2 * syb2, sxc2 * sxc2 + syc2 * syc2 };
+
+		}
+
+#if defined(COLLISHI_SIMD_AVX) || defined(COLLISHI_SIMD_SSE)
+
+		//! collision_circle_triangle for 8 circles against one triangle, with the same operations in the same order
+		//! Returns the lanes which are separated
+
+		inline Simd::Lanes circle_triangle_separated(Simd::Lanes x1, Simd::Lanes y1, Simd::Lanes r1_squared, const TriangleTerms& triangle) {
+
+			auto zero = Simd::broadcast(0.0f);
+
+			auto dx = x1 - Simd::broadcast(triangle.x);
+			auto dy = y1 - Simd::broadcast(triangle.y);
+
+			auto sxa2 = Simd::broadcast(triangle.sxa);
+			auto sya2 = Simd::broadcast(triangle.sya);
+			auto sxb2 = Simd::broadcast(triangle.sxb);
+			auto syb2 = Simd::broadcast(triangle.syb);
+			auto sxc2 = Simd::broadcast(triangle.sxc);
+			auto syc2 = Simd::broadcast(triangle.syc);
+
+			auto cross_term = Simd::broadcast(triangle.cross_term);
+			auto negative_cross_term = Simd::broadcast(-triangle.cross_term);
+
+			//! Edge normals
+
+			auto proj_x1_a = dy * sxa2 - dx * sya2;
+			auto proj_r1_a_squared = r1_squared * Simd::broadcast(triangle.length_a);
+
+			auto a_1 = Simd::sign_square(zero - proj_x1_a);
+			auto a_2 = Simd::sign_square(cross_term - proj_x1_a);
+
+			auto separated = Simd::less(proj_r1_a_squared, Simd::min(a_1, a_2)) | Simd::less(Simd::max(a_1, a_2), zero - proj_r1_a_squared);
+
+			auto proj_x1_b = dy * sxb2 - dx * syb2;
+			auto proj_r1_b_squared = r1_squared * Simd::broadcast(triangle.length_b);
+
+			auto b_1 = Simd::sign_square(zero - proj_x1_b);
+			auto b_2 = Simd::sign_square(negative_cross_term - proj_x1_b);
+
+			separated = separated | Simd::less(proj_r1_b_squared, Simd::min(b_1, b_2)) | Simd::less(Simd::max(b_1, b_2), zero - proj_r1_b_squared);
+
+			auto proj_x1_c = dy * sxc2 - dx * syc2;
+			auto proj_r1_c_squared = r1_squared * Simd::broadcast(triangle.length_c);
+
+			auto c_1 = Simd::sign_square(zero - proj_x1_c);
+			auto c_2 = Simd::sign_square(negative_cross_term - proj_x1_c);
+
+			separated = separated | Simd::less(proj_r1_c_squared, Simd::min(c_1, c_2)) | Simd::less(Simd::max(c_1, c_2), zero - proj_r1_c_squared);
+
+			//! Most particles are far away from most triangles, so the vertex axis is skipped if all lanes are already separated
+
+			if (Simd::movemask(separated) == 0xff) return separated;
+
+			//! Axis to the closest vertex, the selections replace the branches of the scalar routine
+
+			auto dxa = dx - sxa2;
+			auto dya = dy - sya2;
+
+			auto dxb = dx - sxb2;
+			auto dyb = dy - syb2;
+
+			auto min_dist = dx * dx + dy * dy;
+			auto vx = zero - dx;
+			auto vy = zero - dy;
+
+			auto da_norm = dxa * dxa + dya * dya;
+			auto db_norm = dxb * dxb + dyb * dyb;
+
+			auto a_closer = Simd::less(da_norm, min_dist);
+
+			min_dist = Simd::select(a_closer, da_norm, min_dist);
+			vx = Simd::select(a_closer, zero - dxa, vx);
+			vy = Simd::select(a_closer, zero - dya, vy);
+
+			auto b_closer = Simd::less(db_norm, min_dist);
+
+			min_dist = Simd::select(b_closer, db_norm, min_dist);
+			vx = Simd::select(b_closer, zero - dxb, vx);
+			vy = Simd::select(b_closer, zero - dyb, vy);
+
+			auto proj_2_0_v = Simd::sign_square((zero - dx) * vx - dy * vy);
+			auto proj_2_a_v = Simd::sign_square((zero - dxa) * vx - dya * vy);
+			auto proj_2_b_v = Simd::sign_square((zero - dxb) * vx - dyb * vy);
+
+			auto proj_r_v_squared = r1_squared * min_dist;
+
+			auto v_min = Simd::min(proj_2_0_v, Simd::min(proj_2_a_v, proj_2_b_v));
+			auto v_max = Simd::max(proj_2_0_v, Simd::max(proj_2_a_v, proj_2_b_v));
+
+			return separated | Simd::less(proj_r_v_squared, v_min) | Simd::less(v_max, zero - proj_r_v_squared);
+
+		}
+
+#endif
+
+		//! Appends the pairs of the circles begin to end against one triangle
+
+		inline void circles_triangle_pairs(const CircleArrays& circles, const float* r_squared, std::size_t begin, std::size_t end, const TriangleTerms& triangle, std::uint32_t triangle_index, std::vector<Pair>& pairs) {
+
+			auto i = begin;
+
+#if defined(COLLISHI_SIMD_AVX) || defined(COLLISHI_SIMD_SSE)
+
+			for (; i + Simd::lane_count <= end; i += Simd::lane_count) {
+
+				auto separated = circle_triangle_separated(Simd::load(circles.x + i), Simd::load(circles.y + i), Simd::load(r_squared + i), triangle);
+				auto hits = static_cast<unsigned>(~Simd::movemask(separated)) & 0xffu;
+
+				if (!hits) continue;
+
+				for (std::size_t lane = 0; lane < Simd::lane_count; lane++) {
+
+					if (hits & (1u << lane)) pairs.push_back({ static_cast<std::uint32_t>(i + lane), triangle_index });
+
+				}
+
+			}
+
+#endif
+
+			for (; i < end; i++) {
+
+				if (collision_circle_triangle(circles.x[i], circles.y[i], circles.r[i], triangle.x, triangle.y, triangle.sxa, triangle.sya, triangle.sxb, triangle.syb)) {
+
+					pairs.push_back({ static_cast<std::uint32_t>(i), triangle_index });
+
+				}
+
+			}
+
+		}
+
+	}
+
+	//! Tests the segment from (x1|y1) to (x1 + dx1|y1 + dy1) against all circles and writes results[i] = collision_line_circle(segment, circle i)
+	//! If entry_times is given, it receives the entry time (see Batch::line_circle_entry_time) of every colliding circle
+	//! and infinity for all others
+	//! Returns the number of colliding circles
+
+	inline std::size_t collision_line_circles(float x1, float y1, float dx1, float dy1, const CircleArrays& circles, bool* results, float* entry_times = nullptr, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_line_circles");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(circles.count);
+
+		std::size_t hits = 0;
+		std::size_t i = 0;
+
+#if defined(COLLISHI_SIMD_AVX) || defined(COLLISHI_SIMD_SSE)
+
+		auto x1_lanes = Simd::broadcast(x1);
+		auto y1_lanes = Simd::broadcast(y1);
+		auto dx1_lanes = Simd::broadcast(dx1);
+		auto dy1_lanes = Simd::broadcast(dy1);
+		auto length_squared = Simd::broadcast(dx1 * dx1 + dy1 * dy1);
+
+		for (; i + Simd::lane_count <= circles.count; i += Simd::lane_count) {
+
+			auto r2 = Simd::load(circles.r + i);
+
+			Simd::Lanes entry_time;
+			auto separated = Batch::line_circle_separated(x1_lanes, y1_lanes, dx1_lanes, dy1_lanes, length_squared, Simd::load(circles.x + i), Simd::load(circles.y + i), r2 * r2, entry_time);
+
+			hits += Batch::store_line_circle_lanes(separated, entry_time, results + i, (entry_times ? entry_times + i : nullptr));
+
+		}
+
+#endif
+
+		for (; i < circles.count; i++) {
+
+			results[i] = collision_line_circle(x1, y1, dx1, dy1, circles.x[i], circles.y[i], circles.r[i]);
+			hits += results[i];
+
+			if (entry_times) entry_times[i] = (results[i] ? Batch::line_circle_entry_time(x1, y1, dx1, dy1, circles.x[i], circles.y[i], circles.r[i]) : std::numeric_limits<float>::infinity());
+
+		}
+
+		COLLISHI_METRICS_COUNT(Routine::line_circle, circles.count, hits);
+
+		return hits;
+
+	}
+
+	//! Tests all segments against the circle with the midpoint (x2|y2) and the radius r2 and writes results[i] = collision_line_circle(segment i, circle)
+	//! Entry times and the returned number of hits are the same as for collision_line_circles
+
+	inline std::size_t collision_lines_circle(const LineArrays& lines, float x2, float y2, float r2, bool* results, float* entry_times = nullptr, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_lines_circle");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(lines.count);
+
+		std::size_t hits = 0;
+		std::size_t i = 0;
+
+#if defined(COLLISHI_SIMD_AVX) || defined(COLLISHI_SIMD_SSE)
+
+		auto x2_lanes = Simd::broadcast(x2);
+		auto y2_lanes = Simd::broadcast(y2);
+		auto r2_squared = Simd::broadcast(r2 * r2);
+
+		for (; i + Simd::lane_count <= lines.count; i += Simd::lane_count) {
+
+			auto dx1 = Simd::load(lines.dx + i);
+			auto dy1 = Simd::load(lines.dy + i);
+
+			Simd::Lanes entry_time;
+			auto separated = Batch::line_circle_separated(Simd::load(lines.x + i), Simd::load(lines.y + i), dx1, dy1, dx1 * dx1 + dy1 * dy1, x2_lanes, y2_lanes, r2_squared, entry_time);
+
+			hits += Batch::store_line_circle_lanes(separated, entry_time, results + i, (entry_times ? entry_times + i : nullptr));
+
+		}
+
+#endif
+
+		for (; i < lines.count; i++) {
+
+			results[i] = collision_line_circle(lines.x[i], lines.y[i], lines.dx[i], lines.dy[i], x2, y2, r2);
+			hits += results[i];
+
+			if (entry_times) entry_times[i] = (results[i] ? Batch::line_circle_entry_time(lines.x[i], lines.y[i], lines.dx[i], lines.dy[i], x2, y2, r2) : std::numeric_limits<float>::infinity());
+
+		}
+
+		COLLISHI_METRICS_COUNT(Routine::line_circle, lines.count, hits);
+
+		return hits;
+
+	}
+
+	//! Appends all pairs (i|j) with collision_box_box(first i, second j) to pairs
+	//! The order of the pairs does not depend on the number of threads, but they are not sorted
+	//! threads = 0 uses all hardware threads, small groups are always processed on the calling thread
+
+	inline void collision_box_box_all_pairs(const BoxArrays& first, const BoxArrays& second, std::vector<Pair>& pairs, unsigned threads = 0, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_box_box_all_pairs");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(first.count * second.count);
+
+		[[maybe_unused]] auto pairs_before = pairs.size();
+
+		Batch::TileBounds first_bounds(first);
+		Batch::TileBounds second_bounds(second);
+
+		Batch::box_box_all_pairs(first_bounds, first.count, second_bounds, second.count, false, pairs, threads);
+
+		COLLISHI_METRICS_COUNT(Routine::box_box, first.count * second.count, pairs.size() - pairs_before);
+
+	}
+
+	//! Appends all pairs (i|j) with i < j and collision_box_box(i, j) within one group to pairs
+
+	inline void collision_box_box_all_pairs(const BoxArrays& boxes, std::vector<Pair>& pairs, unsigned threads = 0, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_box_box_all_pairs");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(boxes.count * (boxes.count > 0 ? boxes.count - 1 : 0) / 2);
+
+		[[maybe_unused]] auto pairs_before = pairs.size();
+
+		Batch::TileBounds bounds(boxes);
+
+		Batch::box_box_all_pairs(bounds, boxes.count, bounds, boxes.count, true, pairs, threads);
+
+		COLLISHI_METRICS_COUNT(Routine::box_box, boxes.count * (boxes.count > 0 ? boxes.count - 1 : 0) / 2, pairs.size() - pairs_before);
+
+	}
+
+	//! Appends all pairs (i|j) with collision_circle_triangle(circle i, triangle j) to pairs, e.g. for particles against static level geometry
+	//! The circles are processed in tiles of Batch::particles_per_tile, each tile is tested against all triangles in order,
+	//! so the pairs are ordered by tile, then by triangle and then by circle
+
+	inline void collision_circles_triangles(const CircleArrays& circles, const TriangleArrays& triangles, std::vector<Pair>& pairs, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_circles_triangles");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(circles.count * triangles.count);
+
+		[[maybe_unused]] auto pairs_before = pairs.size();
+
+		std::vector<Batch::TriangleTerms> terms(triangles.count);
+
+		for (std::size_t j = 0; j < triangles.count; j++) {
+
+			terms[j] = Batch::triangle_terms(triangles.x[j], triangles.y[j], triangles.sxa[j], triangles.sya[j], triangles.sxb[j], triangles.syb[j]);
+
+		}
+
+		std::vector<float> r_squared(circles.count);
+
+		for (std::size_t i = 0; i < circles.count; i++) r_squared[i] = circles.r[i] * circles.r[i];
+
+		for (std::size_t begin = 0; begin < circles.count; begin += Batch::particles_per_tile) {
+
+			auto end = std::min(circles.count, begin + Batch::particles_per_tile);
+
+			for (std::size_t j = 0; j < triangles.count; j++) Batch::circles_triangle_pairs(circles, r_squared.data(), begin, end, terms[j], static_cast<std::uint32_t>(j), pairs);
+
+		}
+
+		COLLISHI_METRICS_COUNT(Routine::circle_triangle, circles.count * triangles.count, pairs.size() - pairs_before);
+
+	}
+
+}
@@ -0,0 +1,1060 @@
+#pragma once
+
+//! Broadphases for scenes of Shape values (see CollisionsShapes.h), which find the candidate pairs for the narrowphase
+//! Three strategies are provided, each of them fits other scenes:
+//! - grid: uniform grid, best for many shapes of similar size, the cell size needs to fit the shape sizes
+//! - tree: bounding volume hierarchy rebuilt every frame (see CollisionsBvh.h), robust for very different shape sizes
+//! - sweep: sweep and prune along one axis, best for few shapes or shapes spread along one axis, the order of the previous
+//!   frame is kept, so moving shapes only need a few swaps to be sorted again
+//!
+//! All strategies test their candidates with collision(a, b), so they find exactly the same colliding pairs
+//!
+//! scene_statistics summarizes a scene (number and sizes of the shapes, extent of the scene, motion since the previous frame)
+//! and recommend_broadphase estimates the cost of each strategy from these statistics
+//! AdaptiveBroadphase does this every frame and switches the strategy or the cell size only if another choice
+//! is estimated to be clearly cheaper for several frames in a row, so scenes close to a threshold do not switch back and forth
+//!
+//! collide_all_parallel finds all colliding pairs of a large static scene once on all cores, for offline checks of level data
+
+#include "CollisionsBatch.h"
+#include "CollisionsBvh.h"
+#include "CollisionsMemory.h"
+#include "CollisionsShapes.h"
+#include "CollisionsTags.h"
+#include "CollisionsTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace Collishi {
+
+	enum class BroadphaseStrategy : std::uint8_t {
+
+		grid,
+		tree,
+		sweep
+
+	};
+
+	constexpr std::size_t broadphase_strategy_count = 3;
+
+	constexpr const char* broadphase_name(BroadphaseStrategy strategy) {
+
+		switch (strategy) {
+
+			case BroadphaseStrategy::grid: return "grid";
+			case BroadphaseStrategy::tree: return "tree";
+			case BroadphaseStrategy::sweep: return "sweep";
+
+		}
+
+		return "unknown";
+
+	}
+
+	struct SceneStatistics {
+
+		std::size_t count = 0;
+
+		//! Union of all bounds
+
+		Bounds world = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		float mean_width = 0.0f;
+		float mean_height = 0.0f;
+		float mean_area = 0.0f;
+		float max_extent = 0.0f;
+
+		//! Mean movement of the shape centers since the previous frame, relative to the mean shape extent
+
+		float motion = 0.0f;
+
+	};
+
+	//! Statistics of count bounds; previous holds the bounds of the previous frame (same shapes in the same order) or is nullptr
+
+	constexpr SceneStatistics scene_statistics(const Bounds* bounds, std::size_t count, const Bounds* previous = nullptr) {
+
+		SceneStatistics statistics;
+
+		statistics.count = count;
+
+		if (count == 0) return statistics;
+
+		statistics.world = bounds[0];
+
+		double width_sum = 0.0;
+		double height_sum = 0.0;
+		double area_sum = 0.0;
+		double motion_sum = 0.0;
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			auto width = bounds[i].max_x - bounds[i].min_x;
+			auto height = bounds[i].max_y - bounds[i].min_y;
+
+			statistics.world = statistics.world.merged(bounds[i]);
+
+			width_sum += width;
+			height_sum += height;
+			area_sum += static_cast<double>(width) * height;
+
+			statistics.max_extent = std::max({ statistics.max_extent, width, height });
+
+			if (previous) motion_sum += constexpr_abs(bounds[i].center_x() - previous[i].center_x()) + constexpr_abs(bounds[i].center_y() - previous[i].center_y());
+
+		}
+
+		statistics.mean_width = static_cast<float>(width_sum / count);
+		statistics.mean_height = static_cast<float>(height_sum / count);
+		statistics.mean_area = static_cast<float>(area_sum / count);
+
+		auto mean_extent = 0.5 * (width_sum + height_sum) / count;
+
+		if (mean_extent > 0.0) statistics.motion = static_cast<float>(motion_sum / count / mean_extent);
+
+		return statistics;
+
+	}
+
+	//! Relative costs of the basic operations of the broadphases, measured with benchmarks/broadphase.cpp
+	//! Only their ratios matter
+
+	namespace BroadphaseCosts {
+
+		constexpr double bounds_test = 1.0;
+		constexpr double sort_step = 1.5;
+		constexpr double coherent_sort_step = 0.3;
+		constexpr double grid_entry = 2.0;
+		constexpr double tree_build_step = 4.5;
+		constexpr double tree_query_step = 3.0;
+
+	}
+
+	struct BroadphaseEstimate {
+
+		BroadphaseStrategy strategy;
+		float cell_size;
+		double cost;
+
+	};
+
+	namespace Broadphase {
+
+		constexpr double log2_estimate(double value) {
+
+			double result = 0.0;
+
+			while (value >= 2.0) {
+
+				value *= 0.5;
+				result += 1.0;
+
+			}
+
+			return result + (value - 1.0);
+
+		}
+
+		//! Shapes moving less than this fraction of their extent per frame keep the sweep order mostly intact
+
+		constexpr float coherent_motion = 0.5f;
+
+		//! Cell sizes tried by recommend_broadphase, relative to the mean shape extent
+
+		constexpr float cell_size_factors[] = { 0.5f, 1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f };
+
+		//! Shapes covering more cells are not inserted into the grid, but tested against all shapes
+
+		constexpr std::size_t max_cells_per_shape = 64;
+
+		//! Average number of moves per shape after which the insertion sort of the sweep order gives up
+
+		constexpr std::size_t max_sweep_moves_per_shape = 8;
+
+		//! Sweeps along y if the shapes overlap less on y than on x
+
+		constexpr bool sweep_along_y(const SceneStatistics& statistics) {
+
+			auto world_width = statistics.world.max_x - statistics.world.min_x;
+			auto world_height = statistics.world.max_y - statistics.world.min_y;
+
+			return statistics.mean_height * world_width < statistics.mean_width * world_height;
+
+		}
+
+		constexpr BroadphaseEstimate estimate(BroadphaseStrategy strategy, const SceneStatistics& statistics, float cell_size = 0.0f) {
+
+			auto n = static_cast<double>(statistics.count);
+
+			if (statistics.count < 2) return { strategy, cell_size, 0.0 };
+
+			auto world_width = std::max(static_cast<double>(statistics.world.max_x - statistics.world.min_x), 1e-6);
+			auto world_height = std::max(static_cast<double>(statistics.world.max_y - statistics.world.min_y), 1e-6);
+			auto world_area = world_width * world_height;
+
+			auto pairs = 0.5 * n * n;
+			auto log_n = log2_estimate(n);
+
+			//! Pairs whose bounds overlap (the sum of both bounds has to contain the distance of their centers)
+
+			auto overlapping = std::min(pairs, pairs * (2.0 * statistics.mean_area + 2.0 * statistics.mean_width * statistics.mean_height) / world_area);
+
+			switch (strategy) {
+
+				case BroadphaseStrategy::grid: {
+
+					//! Average number of cells covered by a shape (exact for bounds at random positions)
+
+					double c = cell_size;
+					auto cells = statistics.mean_area / (c * c) + (statistics.mean_width + statistics.mean_height) / c + 1.0;
+					auto entries = n * cells;
+
+					//! Pairs sharing a cell, if the entries are evenly distributed over the cells
+
+					auto candidates = std::min(pairs * cells, pairs * cells * cells * c * c / world_area);
+
+					return { strategy, cell_size, entries * (BroadphaseCosts::grid_entry + log2_estimate(entries) * BroadphaseCosts::sort_step) + candidates * BroadphaseCosts::bounds_test };
+
+				}
+
+				case BroadphaseStrategy::tree:
+					return { strategy, cell_size, n * log_n * (BroadphaseCosts::tree_build_step + BroadphaseCosts::tree_query_step) + 2.0 * overlapping * BroadphaseCosts::bounds_test };
+
+				case BroadphaseStrategy::sweep: {
+
+					auto overlap = (sweep_along_y(statistics) ? 2.0 * statistics.mean_height / world_height : 2.0 * statistics.mean_width / world_width);
+					auto sort_step = (statistics.motion < coherent_motion ? BroadphaseCosts::coherent_sort_step : BroadphaseCosts::sort_step);
+
+					return { strategy, cell_size, n * log_n * sort_step + std::min(pairs, pairs * overlap) * BroadphaseCosts::bounds_test };
+
+				}
+
+			}
+
+			return { strategy, cell_size, 0.0 };
+
+		}
+
+		//! Cheapest estimate of the grid over the cell sizes in cell_size_factors
+
+		constexpr BroadphaseEstimate estimate_grid(const SceneStatistics& statistics) {
+
+			auto mean_extent = std::max(0.5f * (statistics.mean_width + statistics.mean_height), 1e-6f);
+
+			BroadphaseEstimate best = { BroadphaseStrategy::grid, 0.0f, 0.0 };
+
+			for (auto factor : cell_size_factors) {
+
+				auto candidate = estimate(BroadphaseStrategy::grid, statistics, factor * mean_extent);
+
+				if (best.cell_size == 0.0f || candidate.cost < best.cost) best = candidate;
+
+			}
+
+			return best;
+
+		}
+
+	}
+
+	//! Cheapest strategy for a scene with the given statistics, with the best cell size if it is the grid
+
+	constexpr BroadphaseEstimate recommend_broadphase(const SceneStatistics& statistics) {
+
+		auto best = Broadphase::estimate_grid(statistics);
+
+		for (auto strategy : { BroadphaseStrategy::tree, BroadphaseStrategy::sweep }) {
+
+			auto candidate = Broadphase::estimate(strategy, statistics);
+
+			if (candidate.cost < best.cost) best = { strategy, best.cell_size, candidate.cost };
+
+		}
+
+		return best;
+
+	}
+
+	//! Runs the strategies on a vector of shapes and appends the colliding pairs (first < second) to a pair list
+	//! The order of the pairs depends on the strategy
+	//! The buffers are kept between frames, so a scene of constant size does not allocate
+	//! The buffers of the strategies which were not used in the last call count as wasted memory
+
+	class BroadphaseRunner {
+
+	public:
+
+		const std::vector<Bounds>& update_bounds(const std::vector<Shape>& shapes) {
+
+			shape_bounds.resize(shapes.size());
+
+			for (std::size_t i = 0; i < shapes.size(); i++) shape_bounds[i] = bounds(shapes[i]);
+
+			return shape_bounds;
+
+		}
+
+		//! Uses the bounds of the last update_bounds call, which have to belong to the same shapes
+
+		void collide(BroadphaseStrategy strategy, float cell_size, bool along_y, const std::vector<Shape>& shapes, std::vector<Pair>& pairs, CostTag tag = {}) {
+
+			switch (strategy) {
+
+				case BroadphaseStrategy::grid: grid(cell_size, shapes, pairs, tag); break;
+				case BroadphaseStrategy::tree: tree(shapes, pairs, tag); break;
+				case BroadphaseStrategy::sweep: sweep(along_y, shapes, pairs, tag); break;
+
+			}
+
+		}
+
+		void grid(float cell_size, const std::vector<Shape>& shapes, std::vector<Pair>& pairs, CostTag tag = {}) {
+
+			COLLISHI_TRACE_SCOPE("broadphase", "grid");
+
+			Tags::Measurement measurement(tag);
+			NarrowphaseCount count_tests(narrowphase_tests);
+
+			last_strategy = BroadphaseStrategy::grid;
+
+			auto inverse_cell_size = 1.0f / cell_size;
+			auto count = shape_bounds.size();
+
+			auto cell_of = [inverse_cell_size](float coordinate) {
+
+				auto cell = std::floor(coordinate * inverse_cell_size);
+				return static_cast<std::int32_t>(std::min(std::max(cell, -2147483520.0f), 2147483520.0f));
+
+			};
+
+			grid_entries.clear();
+			first_cells.resize(count);
+			oversized.clear();
+
+			for (std::size_t i = 0; i < count; i++) {
+
+				auto& b = shape_bounds[i];
+
+				auto min_x = cell_of(b.min_x);
+				auto min_y = cell_of(b.min_y);
+				auto max_x = cell_of(b.max_x);
+				auto max_y = cell_of(b.max_y);
+
+				first_cells[i] = { min_x, min_y };
+
+				auto cells_x = static_cast<std::int64_t>(max_x) - min_x + 1;
+				auto cells_y = static_cast<std::int64_t>(max_y) - min_y + 1;
+
+				if (cells_x * cells_y > static_cast<std::int64_t>(Broadphase::max_cells_per_shape)) {
+
+					oversized.push_back(static_cast<std::uint32_t>(i));
+					continue;
+
+				}
+
+				for (auto y = min_y; y <= max_y; y++) {
+
+					for (auto x = min_x; x <= max_x; x++) grid_entries.push_back({ cell_key(x, y), static_cast<std::uint32_t>(i) });
+
+				}
+
+			}
+
+			std::sort(grid_entries.begin(), grid_entries.end(), [](const GridEntry& a, const GridEntry& b) { return a.cell < b.cell || (a.cell == b.cell && a.index < b.index); });
+
+			for (std::size_t begin = 0; begin < grid_entries.size(); ) {
+
+				auto end = begin + 1;
+				while (end < grid_entries.size() && grid_entries[end].cell == grid_entries[begin].cell) end++;
+
+				for (auto a = begin; a < end; a++) {
+
+					for (auto b = a + 1; b < end; b++) {
+
+						auto i = grid_entries[a].index;
+						auto j = grid_entries[b].index;
+
+						//! Shapes sharing several cells are only tested in the first shared cell
+
+						auto shared_x = std::max(first_cells[i].x, first_cells[j].x);
+						auto shared_y = std::max(first_cells[i].y, first_cells[j].y);
+
+						if (cell_key(shared_x, shared_y) != grid_entries[a].cell) continue;
+
+						test(i, j, shapes, pairs);
+
+					}
+
+				}
+
+				begin = end;
+
+			}
+
+			//! Shapes covering too many cells are tested against all others
+
+			for (std::size_t o = 0; o < oversized.size(); o++) {
+
+				auto i = oversized[o];
+
+				for (std::uint32_t j = 0; j < count; j++) {
+
+					if (j == i) continue;
+
+					//! Pairs of two oversized shapes are only tested once
+
+					if (std::binary_search(oversized.begin(), oversized.end(), j) && j < i) continue;
+
+					test(std::min(i, j), std::max(i, j), shapes, pairs);
+
+				}
+
+			}
+
+		}
+
+		void tree(const std::vector<Shape>& shapes, std::vector<Pair>& pairs, CostTag tag = {}) {
+
+			COLLISHI_TRACE_SCOPE("broadphase", "tree");
+
+			Tags::Measurement measurement(tag);
+			NarrowphaseCount count_tests(narrowphase_tests);
+
+			last_strategy = BroadphaseStrategy::tree;
+
+			auto count = shape_bounds.size();
+
+			tree_nodes.resize(bvh_node_capacity(count));
+			tree_indices.resize(count > 0 ? count : 1);
+
+			build_bvh(shape_bounds.data(), count, tree_nodes.data(), tree_indices.data());
+
+			BvhQueryStats query_stats = {};
+
+			for (std::uint32_t i = 0; i < count; i++) {
+
+				query_bvh(tree_nodes.data(), tree_indices.data(), shape_bounds.data(), shape_bounds[i], query_stats, [&](std::uint32_t j) {
+
+					if (j > i) test(i, j, shapes, pairs);
+
+				});
+
+			}
+
+			Tags::Measurement::add_nodes(query_stats.nodes_visited);
+
+		}
+
+		void sweep(bool along_y, const std::vector<Shape>& shapes, std::vector<Pair>& pairs, CostTag tag = {}) {
+
+			COLLISHI_TRACE_SCOPE("broadphase", "sweep");
+
+			Tags::Measurement measurement(tag);
+			NarrowphaseCount count_tests(narrowphase_tests);
+
+			last_strategy = BroadphaseStrategy::sweep;
+
+			auto count = shape_bounds.size();
+
+			auto low = [&](std::uint32_t i) { return (along_y ? shape_bounds[i].min_y : shape_bounds[i].min_x); };
+			auto high = [&](std::uint32_t i) { return (along_y ? shape_bounds[i].max_y : shape_bounds[i].max_x); };
+
+			//! The order of the previous frame is kept if the shapes are the same, then insertion sort only needs a few moves
+			//! If the shapes moved too much, the insertion sort gives up and the order is sorted from scratch
+
+			auto sorted = (sweep_order.size() == count && sweep_along_y == along_y);
+
+			if (sorted) {
+
+				std::size_t moves = 0;
+
+				for (std::size_t i = 1; i < count && sorted; i++) {
+
+					auto index = sweep_order[i];
+					auto value = low(index);
+					auto j = i;
+
+					for (; j > 0 && low(sweep_order[j - 1]) > value; j--) sweep_order[j] = sweep_order[j - 1];
+
+					sweep_order[j] = index;
+
+					moves += i - j;
+					sorted = (moves <= Broadphase::max_sweep_moves_per_shape * count);
+
+				}
+
+			}
+			else {
+
+				sweep_order.resize(count);
+
+				for (std::uint32_t i = 0; i < count; i++) sweep_order[i] = i;
+
+				sweep_along_y = along_y;
+
+			}
+
+			if (!sorted) std::sort(sweep_order.begin(), sweep_order.end(), [&](std::uint32_t a, std::uint32_t b) { return low(a) < low(b); });
+
+			for (std::size_t a = 0; a < count; a++) {
+
+				auto i = sweep_order[a];
+				auto end = high(i);
+
+				for (auto b = a + 1; b < count && low(sweep_order[b]) <= end; b++) {
+
+					auto j = sweep_order[b];
+
+					if (shape_bounds[i].overlaps(shape_bounds[j])) test(std::min(i, j), std::max(i, j), shapes, pairs);
+
+				}
+
+			}
+
+		}
+
+		//! Narrowphase tests of all calls since the runner was created
+
+		std::size_t tests() const {
+
+			return narrowphase_tests;
+
+		}
+
+		MemoryStats memory_stats() const {
+
+			auto grid_needed = (last_strategy == BroadphaseStrategy::grid);
+			auto tree_needed = (last_strategy == BroadphaseStrategy::tree);
+			auto sweep_needed = (last_strategy == BroadphaseStrategy::sweep);
+
+			return Collishi::memory_stats(shape_bounds)
+				+ Collishi::memory_stats(grid_entries, grid_needed) + Collishi::memory_stats(first_cells, grid_needed) + Collishi::memory_stats(oversized, grid_needed)
+				+ Collishi::memory_stats(tree_nodes, tree_needed) + Collishi::memory_stats(tree_indices, tree_needed)
+				+ Collishi::memory_stats(sweep_order, sweep_needed);
+
+		}
+
+		//! Frees the buffers of the strategies which were not used in the last call
+		//! Switching back to such a strategy allocates them again
+
+		void release_unused() {
+
+			if (last_strategy != BroadphaseStrategy::grid) {
+
+				release_memory(grid_entries);
+				release_memory(first_cells);
+				release_memory(oversized);
+
+			}
+
+			if (last_strategy != BroadphaseStrategy::tree) {
+
+				release_memory(tree_nodes);
+				release_memory(tree_indices);
+
+			}
+
+			if (last_strategy != BroadphaseStrategy::sweep) release_memory(sweep_order);
+
+		}
+
+	private:
+
+		struct Cell {
+
+			std::int32_t x;
+			std::int32_t y;
+
+		};
+
+		struct GridEntry {
+
+			std::uint64_t cell;
+			std::uint32_t index;
+
+		};
+
+		//! Adds the narrowphase tests of one call to the measured call, when it goes out of scope (before the measurement)
+
+		class NarrowphaseCount {
+
+		public:
+
+			explicit NarrowphaseCount(std::size_t& tests) : tests(tests), begin(tests) {}
+
+			~NarrowphaseCount() {
+
+				Tags::Measurement::add_tests(tests - begin);
+
+			}
+
+		private:
+
+			const std::size_t& tests;
+			std::size_t begin;
+
+		};
+
+		static std::uint64_t cell_key(std::int32_t x, std::int32_t y) {
+
+			return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+
+		}
+
+		void test(std::uint32_t i, std::uint32_t j, const std::vector<Shape>& shapes, std::vector<Pair>& pairs) {
+
+			if (!shape_bounds[i].overlaps(shape_bounds[j])) return;
+
+			narrowphase_tests++;
+
+			auto hit = collision(shapes[i], shapes[j]);
+
+			COLLISHI_METRICS_COUNT(select_routine(shapes[i].type, shapes[j].type).routine, 1, hit);
+
+			if (hit) pairs.push_back({ i, j });
+
+		}
+
+		std::vector<Bounds> shape_bounds;
+
+		std::vector<GridEntry> grid_entries;
+		std::vector<Cell> first_cells;
+		std::vector<std::uint32_t> oversized;
+
+		std::vector<BvhNode> tree_nodes;
+		std::vector<std::uint32_t> tree_indices;
+
+		std::vector<std::uint32_t> sweep_order;
+		bool sweep_along_y = false;
+
+		BroadphaseStrategy last_strategy = BroadphaseStrategy::sweep;
+		std::size_t narrowphase_tests = 0;
+
+	};
+
+	//! Broadphase which follows the recommendation for the current scene, with hysteresis
+
+	class AdaptiveBroadphase {
+
+	public:
+
+		struct Settings {
+
+			//! Another choice has to be estimated this much cheaper than the current one ...
+
+			double switch_margin = 0.25;
+
+			//! ... for this many frames in a row
+
+			std::size_t switch_frames = 8;
+
+		};
+
+		AdaptiveBroadphase() = default;
+		explicit AdaptiveBroadphase(const Settings& settings) : settings(settings) {}
+
+		//! Appends all colliding pairs (first < second) of the shapes to pairs
+		//! The shapes are expected to be the same objects in the same order every frame, otherwise the motion is not measured
+
+		void collide(const std::vector<Shape>& shapes, std::vector<Pair>& pairs, CostTag tag = {}) {
+
+			COLLISHI_TRACE_SCOPE("broadphase", "AdaptiveBroadphase::collide");
+
+			Tags::Measurement measurement(tag);
+
+			auto& shape_bounds = runner.update_bounds(shapes);
+			auto same_shapes = (previous_bounds.size() == shape_bounds.size());
+
+			statistics = scene_statistics(shape_bounds.data(), shape_bounds.size(), same_shapes ? previous_bounds.data() : nullptr);
+			previous_bounds = shape_bounds;
+
+			update_choice();
+
+			runner.collide(current.strategy, current.cell_size, Broadphase::sweep_along_y(statistics), shapes, pairs);
+
+		}
+
+		BroadphaseStrategy strategy() const {
+
+			return current.strategy;
+
+		}
+
+		//! Cell size of the grid, also kept while another strategy is used
+
+		float cell_size() const {
+
+			return current.cell_size;
+
+		}
+
+		const SceneStatistics& scene() const {
+
+			return statistics;
+
+		}
+
+		//! Number of changes of the strategy or the cell size since the start
+
+		std::size_t switches() const {
+
+			return switch_count;
+
+		}
+
+		//! Narrowphase tests of all frames since the start
+
+		std::size_t tests() const {
+
+			return runner.tests();
+
+		}
+
+		MemoryStats memory_stats() const {
+
+			return runner.memory_stats() + Collishi::memory_stats(previous_bounds);
+
+		}
+
+		//! Frees the buffers of the strategies which are not used anymore, e.g. after a switch
+
+		void release_unused() {
+
+			runner.release_unused();
+
+		}
+
+	private:
+
+		void update_choice() {
+
+			auto recommended = recommend_broadphase(statistics);
+
+			//! The first frame takes the recommendation directly
+
+			if (!initialized) {
+
+				current = recommended;
+				initialized = true;
+				return;
+
+			}
+
+			auto current_cost = (current.strategy == BroadphaseStrategy::grid ? Broadphase::estimate(BroadphaseStrategy::grid, statistics, current.cell_size) : Broadphase::estimate(current.strategy, statistics)).cost;
+
+			auto different = (recommended.strategy != current.strategy || (recommended.strategy == BroadphaseStrategy::grid && recommended.cell_size != current.cell_size));
+
+			if (!different || recommended.cost >= current_cost * (1.0 - settings.switch_margin)) {
+
+				streak = 0;
+				return;
+
+			}
+
+			if (++streak < settings.switch_frames) return;
+
+			current = recommended;
+			streak = 0;
+			switch_count++;
+
+		}
+
+		Settings settings;
+		BroadphaseRunner runner;
+
+		SceneStatistics statistics;
+		std::vector<Bounds> previous_bounds;
+
+		BroadphaseEstimate current = { BroadphaseStrategy::sweep, 0.0f, 0.0 };
+		bool initialized = false;
+		std::size_t streak = 0;
+		std::size_t switch_count = 0;
+
+	};
+
+	namespace Broadphase {
+
+		//! Shapes which a thread of collide_all_parallel takes at once, small enough to balance dense and empty parts of a level
+
+		constexpr std::size_t parallel_chunk_size = 4096;
+
+		//! Calls function(chunk) for every chunk, the chunks are taken from a shared counter by all threads
+
+		template <class F> void for_each_chunk_parallel(std::size_t chunk_count, unsigned threads, F&& function) {
+
+			std::atomic<std::size_t> next_chunk{ 0 };
+
+			auto worker = [&]() {
+
+				COLLISHI_TRACE_SCOPE("broadphase", "collide_all_parallel worker");
+
+				for (auto chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++) function(chunk);
+
+			};
+
+			std::vector<std::thread> workers;
+
+			for (unsigned t = 1; t < threads; t++) workers.emplace_back(worker);
+
+			worker();
+
+			for (auto& thread : workers) thread.join();
+
+		}
+
+		//! Builds the same hierarchy as build_bvh (with other node numbers) on multiple threads, returns the number of nodes used
+		//! The upper levels are split on the calling thread until there are a few ranges per thread, then the subtrees of the ranges
+		//! are built in parallel and appended to the upper nodes
+
+		inline std::size_t build_bvh_parallel(const Bounds* bounds, std::size_t count, BvhNode* nodes, std::uint32_t* indices, unsigned threads) {
+
+			if (threads <= 1 || count < 4 * parallel_chunk_size) return build_bvh(bounds, count, nodes, indices);
+
+			for (std::size_t i = 0; i < count; i++) indices[i] = static_cast<std::uint32_t>(i);
+
+			struct Range {
+
+				std::size_t node;
+				std::size_t begin;
+				std::size_t end;
+
+			};
+
+			auto max_range = std::max<std::size_t>(count / (4 * threads), parallel_chunk_size);
+
+			std::vector<Range> stack = { { 0, 0, count } };
+			std::vector<Range> ranges;
+			std::size_t node_count = 1;
+
+			//! The same splits as build_bvh
+
+			while (!stack.empty()) {
+
+				auto range = stack.back();
+				stack.pop_back();
+
+				if (range.end - range.begin <= max_range) {
+
+					ranges.push_back(range);
+					continue;
+
+				}
+
+				auto node_bounds = bounds[indices[range.begin]];
+				auto center_bounds = Bounds{ node_bounds.center_x(), node_bounds.center_y(), node_bounds.center_x(), node_bounds.center_y() };
+
+				for (auto i = range.begin + 1; i < range.end; i++) {
+
+					auto& shape_bounds = bounds[indices[i]];
+
+					node_bounds = node_bounds.merged(shape_bounds);
+					center_bounds = center_bounds.merged({ shape_bounds.center_x(), shape_bounds.center_y(), shape_bounds.center_x(), shape_bounds.center_y() });
+
+				}
+
+				auto axis = (center_bounds.max_x - center_bounds.min_x >= center_bounds.max_y - center_bounds.min_y ? 0 : 1);
+				auto middle = (range.begin + range.end) / 2;
+
+				Bvh::select_median(bounds, indices, range.begin, middle, range.end, axis);
+
+				auto left = node_count;
+				node_count += 2;
+
+				nodes[range.node] = { node_bounds, static_cast<std::uint32_t>(left), 0 };
+
+				stack.push_back({ left + 1, middle, range.end });
+				stack.push_back({ left, range.begin, middle });
+
+			}
+
+			//! Every subtree is built over a copy of its bounds, so its leaves and indices refer to positions within its range
+
+			std::vector<std::vector<BvhNode>> subtree_nodes(ranges.size());
+
+			for_each_chunk_parallel(ranges.size(), threads, [&](std::size_t r) {
+
+				auto& range = ranges[r];
+				auto size = range.end - range.begin;
+
+				std::vector<Bounds> range_bounds(size);
+				std::vector<std::uint32_t> range_shapes(indices + range.begin, indices + range.end);
+				std::vector<std::uint32_t> range_indices(size);
+
+				for (std::size_t i = 0; i < size; i++) range_bounds[i] = bounds[range_shapes[i]];
+
+				subtree_nodes[r].resize(bvh_node_capacity(size));
+				subtree_nodes[r].resize(build_bvh(range_bounds.data(), size, subtree_nodes[r].data(), range_indices.data()));
+
+				for (std::size_t i = 0; i < size; i++) indices[range.begin + i] = range_shapes[range_indices[i]];
+
+			});
+
+			//! The root of a subtree takes the place of the range node, its other nodes are appended
+
+			for (std::size_t r = 0; r < ranges.size(); r++) {
+
+				auto offset = node_count - 1;
+
+				for (std::size_t n = 0; n < subtree_nodes[r].size(); n++) {
+
+					auto node = subtree_nodes[r][n];
+
+					if (node.leaf()) node.first += static_cast<std::uint32_t>(ranges[r].begin);
+					else node.first += static_cast<std::uint32_t>(offset);
+
+					nodes[n == 0 ? ranges[r].node : offset + n] = node;
+
+				}
+
+				node_count += subtree_nodes[r].size() - 1;
+
+			}
+
+			return node_count;
+
+		}
+
+	}
+
+	//! Appends all colliding pairs (first < second) of a large static scene, for offline checks of level data
+	//! The bounds are computed, the hierarchy over all shapes is built and queried on multiple threads: every shape queries
+	//! the hierarchy and tests the candidates with a higher index with collision(a, b), so the pairs are exactly those of the other strategies
+	//! The shapes query in the order of the leaves, so consecutive queries visit mostly the same nodes
+	//! The pairs are sorted by first and then second, independent of the number of threads (threads = 0 uses all hardware threads)
+	//! Returns the number of threads which were used: at most one per chunk of Broadphase::parallel_chunk_size shapes
+	//! (the hierarchy is only built on several threads from 4 chunks on)
+
+	inline unsigned collide_all_parallel(const Shape* shapes, std::size_t count, std::vector<Pair>& pairs, unsigned threads = 0, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("broadphase", "collide_all_parallel");
+
+		Tags::Measurement measurement(tag);
+
+		if (count < 2) return 1;
+
+		auto chunk_count = (count + Broadphase::parallel_chunk_size - 1) / Broadphase::parallel_chunk_size;
+
+		if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+		threads = static_cast<unsigned>(std::min<std::size_t>(threads, chunk_count));
+
+		auto chunk_begin = [&](std::size_t chunk) { return chunk * Broadphase::parallel_chunk_size; };
+		auto chunk_end = [&](std::size_t chunk) { return std::min(count, (chunk + 1) * Broadphase::parallel_chunk_size); };
+
+		std::vector<Bounds> shape_bounds(count);
+
+		Broadphase::for_each_chunk_parallel(chunk_count, threads, [&](std::size_t chunk) {
+
+			for (auto i = chunk_begin(chunk); i < chunk_end(chunk); i++) shape_bounds[i] = bounds(shapes[i]);
+
+		});
+
+		std::vector<BvhNode> nodes(bvh_node_capacity(count));
+		std::vector<std::uint32_t> indices(count);
+
+		Broadphase::build_bvh_parallel(shape_bounds.data(), count, nodes.data(), indices.data(), threads);
+
+		//! Every chunk writes its own pair list and statistics
+
+		std::vector<std::vector<Pair>> chunk_pairs(chunk_count);
+		std::vector<BvhQueryStats> chunk_stats(chunk_count);
+		std::vector<std::uint64_t> chunk_tests(chunk_count);
+
+		Broadphase::for_each_chunk_parallel(chunk_count, threads, [&](std::size_t chunk) {
+
+			auto& output = chunk_pairs[chunk];
+			auto& stats = chunk_stats[chunk];
+			std::uint64_t tests = 0;
+
+			for (auto position = chunk_begin(chunk); position < chunk_end(chunk); position++) {
+
+				auto i = indices[position];
+
+				query_bvh(nodes.data(), indices.data(), shape_bounds.data(), shape_bounds[i], stats, [&](std::uint32_t j) {
+
+					if (j <= i) return;
+
+					tests++;
+
+					auto hit = collision(shapes[i], shapes[j]);
+
+					COLLISHI_METRICS_COUNT(select_routine(shapes[i].type, shapes[j].type).routine, 1, hit);
+
+					if (hit) output.push_back({ i, j });
+
+				});
+
+			}
+
+			chunk_tests[chunk] = tests;
+
+		});
+
+		std::size_t pair_count = 0;
+		for (auto& chunk : chunk_pairs) pair_count += chunk.size();
+
+		auto first_pair = pairs.size();
+		pairs.reserve(first_pair + pair_count);
+
+		for (std::size_t chunk = 0; chunk < chunk_count; chunk++) {
+
+			pairs.insert(pairs.end(), chunk_pairs[chunk].begin(), chunk_pairs[chunk].end());
+
+			Tags::Measurement::add_tests(chunk_tests[chunk]);
+			Tags::Measurement::add_nodes(chunk_stats[chunk].nodes_visited);
+
+		}
+
+		std::sort(pairs.begin() + static_cast<std::ptrdiff_t>(first_pair), pairs.end(), [](const Pair& a, const Pair& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); });
+
+		return threads;
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::BroadphaseAssertions {
+
+	constexpr SceneStatistics scene(std::size_t count, float width, float height, float size, float motion) {
+
+		SceneStatistics statistics;
+
+		statistics.count = count;
+		statistics.world = { 0.0f, 0.0f, width, height };
+		statistics.mean_width = size;
+		statistics.mean_height = size;
+		statistics.mean_area = size * size;
+		statistics.max_extent = size;
+		statistics.motion = motion;
+
+		return statistics;
+
+	}
+
+	constexpr Bounds moving_bounds[2] = { { 0.0f, 0.0f, 2.0f, 2.0f }, { 10.0f, 0.0f, 14.0f, 4.0f } };
+	constexpr Bounds moved_bounds[2] = { { 1.0f, 0.0f, 3.0f, 2.0f }, { 10.0f, 2.0f, 14.0f, 6.0f } };
+
+}
+
+static_assert(Collishi::scene_statistics(Collishi::BroadphaseAssertions::moved_bounds, 2).world.max_x == 14.0f);
+static_assert(Collishi::scene_statistics(Collishi::BroadphaseAssertions::moved_bounds, 2).mean_area == 10.0f);
+static_assert(Collishi::scene_statistics(Collishi::BroadphaseAssertions::moved_bounds, 2, Collishi::BroadphaseAssertions::moving_bounds).motion == 0.5f);
+
+//! Many small shapes need a grid with cells of a few shape sizes, a few shapes or a long level only need a sweep
+
+static_assert(Collishi::recommend_broadphase(Collishi::BroadphaseAssertions::scene(16000, 2048.0f, 2048.0f, 6.0f, 0.3f)).strategy == Collishi::BroadphaseStrategy::grid);
+static_assert(Collishi::recommend_broadphase(Collishi::BroadphaseAssertions::scene(16000, 2048.0f, 2048.0f, 6.0f, 0.3f)).cell_size >= 6.0f);
+static_assert(Collishi::recommend_broadphase(Collishi::BroadphaseAssertions::scene(16000, 2048.0f, 2048.0f, 6.0f, 0.3f)).cell_size <= 48.0f);
+static_assert(Collishi::recommend_broadphase(Collishi::BroadphaseAssertions::scene(64, 1024.0f, 1024.0f, 25.0f, 0.1f)).strategy == Collishi::BroadphaseStrategy::sweep);
+static_assert(Collishi::recommend_broadphase(Collishi::BroadphaseAssertions::scene(8000, 65536.0f, 64.0f, 16.0f, 0.1f)).strategy == Collishi::BroadphaseStrategy::sweep);
+
+static_assert(!Collishi::Broadphase::sweep_along_y(Collishi::BroadphaseAssertions::scene(8000, 65536.0f, 64.0f, 16.0f, 0.1f)));
+static_assert(Collishi::Broadphase::sweep_along_y(Collishi::BroadphaseAssertions::scene(8000, 64.0f, 65536.0f, 16.0f, 0.1f)));
+
+#endif
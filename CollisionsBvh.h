@@ -0,0 +1,545 @@
+#pragma once
+
+//! Bounding volume hierarchy over the bounds of shapes
+//! The hierarchy is built top-down: the shapes of a node are split at the median of their centers along the longer axis
+//! of the centers, until at most bvh_leaf_size shapes are left
+//!
+//! The functions only work on plain arrays and are constexpr, so the same code builds a hierarchy
+//! at compile time (see CollisionsStatic.h) or at runtime into any storage
+//!
+//! refit_bvh updates the bounds of the nodes after the shapes moved, without changing the structure
+//! The structure then fits the shapes less and less, which bvh_quality and the query statistics measure
+//! (see DynamicBvh in CollisionsDynamicBvh.h for a hierarchy which is rebuilt when its quality gets too bad)
+
+#include "CollisionsShapes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace Collishi {
+
+	constexpr std::size_t bvh_leaf_size = 2;
+
+	//! Depth limit of the build and query stacks, the median split keeps the depth at log2 of the number of shapes
+
+	constexpr std::size_t bvh_max_depth = 64;
+
+	//! A leaf refers to count shapes in the index array starting at first
+	//! An inner node has count = 0, its children are the nodes first and first + 1
+
+	struct BvhNode {
+
+		Bounds bounds;
+		std::uint32_t first;
+		std::uint32_t count;
+
+		constexpr bool leaf() const {
+
+			return count > 0;
+
+		}
+
+	};
+
+	//! Quality of a hierarchy, as computed by bvh_quality
+
+	struct BvhQuality {
+
+		//! Surface area heuristic: expected cost of a query with a random line, relative to testing one node,
+		//! where the probability to visit a node is its perimeter relative to the perimeter of the root
+
+		double sah_cost;
+
+		//! Area in which the two children of a node overlap, relative to the area of the node, summed over all inner nodes
+		//! and divided by the number of inner nodes (0 for disjoint siblings)
+
+		double overlap_ratio;
+
+		std::size_t node_count;
+		std::size_t leaf_count;
+
+		//! Depth of the leaves, the root has depth 0
+
+		std::size_t min_depth;
+		std::size_t max_depth;
+		double mean_depth;
+
+	};
+
+	//! Work of queries, counted by the query_bvh overload with statistics
+
+	struct BvhQueryStats {
+
+		std::size_t queries;
+		std::size_t nodes_visited;
+		std::size_t leaves_visited;
+		std::size_t shapes_tested;
+
+		constexpr double leaves_per_query() const {
+
+			return (queries > 0 ? static_cast<double>(leaves_visited) / static_cast<double>(queries) : 0.0);
+
+		}
+
+		constexpr double nodes_per_query() const {
+
+			return (queries > 0 ? static_cast<double>(nodes_visited) / static_cast<double>(queries) : 0.0);
+
+		}
+
+	};
+
+	//! Maximum number of nodes for a hierarchy of count shapes
+
+	constexpr std::size_t bvh_node_capacity(std::size_t count) {
+
+		return (count > 0 ? 2 * count - 1 : 1);
+
+	}
+
+	namespace Bvh {
+
+		//! Costs of the surface area heuristic: visiting a node and testing the bounds of a shape in a leaf
+
+		constexpr double sah_node_cost = 1.0;
+		constexpr double sah_shape_cost = 1.0;
+
+		constexpr double perimeter(const Bounds& bounds) {
+
+			return 2.0 * (static_cast<double>(bounds.max_x) - bounds.min_x + static_cast<double>(bounds.max_y) - bounds.min_y);
+
+		}
+
+		constexpr double area(const Bounds& bounds) {
+
+			return (static_cast<double>(bounds.max_x) - bounds.min_x) * (static_cast<double>(bounds.max_y) - bounds.min_y);
+
+		}
+
+		constexpr double overlap_area(const Bounds& a, const Bounds& b) {
+
+			auto width = static_cast<double>(a.max_x < b.max_x ? a.max_x : b.max_x) - (a.min_x > b.min_x ? a.min_x : b.min_x);
+			auto height = static_cast<double>(a.max_y < b.max_y ? a.max_y : b.max_y) - (a.min_y > b.min_y ? a.min_y : b.min_y);
+
+			return (width > 0.0 && height > 0.0 ? width * height : 0.0);
+
+		}
+
+		constexpr float center(const Bounds& bounds, int axis) {
+
+			return (axis == 0 ? bounds.center_x() : bounds.center_y());
+
+		}
+
+		//! Reorders indices[begin, end) so the element at middle is the one which would be there if they were sorted by their centers
+		//! (like std::nth_element, which is not constexpr in C++17)
+
+		constexpr void select_median(const Bounds* bounds, std::uint32_t* indices, std::size_t begin, std::size_t middle, std::size_t end, int axis) {
+
+			while (end - begin > 1) {
+
+				//! Median of three as pivot
+
+				auto a = center(bounds[indices[begin]], axis);
+				auto b = center(bounds[indices[(begin + end) / 2]], axis);
+				auto c = center(bounds[indices[end - 1]], axis);
+
+				auto pivot = (a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b)));
+
+				//! Three-way partition, so many equal centers cannot slow it down
+
+				auto less_end = begin;
+				auto greater_begin = end;
+
+				for (auto i = begin; i < greater_begin; ) {
+
+					auto value = center(bounds[indices[i]], axis);
+
+					if (value < pivot) {
+
+						auto swap = indices[i];
+						indices[i] = indices[less_end];
+						indices[less_end] = swap;
+
+						less_end++;
+						i++;
+
+					}
+					else if (pivot < value) {
+
+						greater_begin--;
+
+						auto swap = indices[i];
+						indices[i] = indices[greater_begin];
+						indices[greater_begin] = swap;
+
+					}
+					else {
+
+						i++;
+
+					}
+
+				}
+
+				if (middle < less_end) end = less_end;
+				else if (middle >= greater_begin) begin = greater_begin;
+				else return;
+
+			}
+
+		}
+
+	}
+
+	//! Builds the hierarchy over count bounds into nodes (bvh_node_capacity(count) elements) and indices (count elements)
+	//! Returns the number of nodes used, the root is nodes[0]
+
+	constexpr std::size_t build_bvh(const Bounds* bounds, std::size_t count, BvhNode* nodes, std::uint32_t* indices) {
+
+		for (std::size_t i = 0; i < count; i++) indices[i] = static_cast<std::uint32_t>(i);
+
+		if (count == 0) {
+
+			//! Empty bounds, which no query overlaps
+
+			auto infinity = std::numeric_limits<float>::infinity();
+
+			nodes[0] = { { infinity, infinity, -infinity, -infinity }, 0, 0 };
+			return 1;
+
+		}
+
+		struct Task {
+
+			std::size_t node;
+			std::size_t begin;
+			std::size_t end;
+
+		};
+
+		Task stack[bvh_max_depth] = {};
+		std::size_t stack_size = 0;
+
+		std::size_t node_count = 1;
+		stack[stack_size++] = { 0, 0, count };
+
+		while (stack_size > 0) {
+
+			auto task = stack[--stack_size];
+
+			auto node_bounds = bounds[indices[task.begin]];
+			auto center_bounds = Bounds{ node_bounds.center_x(), node_bounds.center_y(), node_bounds.center_x(), node_bounds.center_y() };
+
+			for (auto i = task.begin + 1; i < task.end; i++) {
+
+				auto& shape_bounds = bounds[indices[i]];
+
+				node_bounds = node_bounds.merged(shape_bounds);
+				center_bounds = center_bounds.merged({ shape_bounds.center_x(), shape_bounds.center_y(), shape_bounds.center_x(), shape_bounds.center_y() });
+
+			}
+
+			//! Leaves also stop the recursion if the stack is full, which only happens for degenerate inputs
+
+			if (task.end - task.begin <= bvh_leaf_size || stack_size + 2 > bvh_max_depth) {
+
+				nodes[task.node] = { node_bounds, static_cast<std::uint32_t>(task.begin), static_cast<std::uint32_t>(task.end - task.begin) };
+				continue;
+
+			}
+
+			auto axis = (center_bounds.max_x - center_bounds.min_x >= center_bounds.max_y - center_bounds.min_y ? 0 : 1);
+			auto middle = (task.begin + task.end) / 2;
+
+			Bvh::select_median(bounds, indices, task.begin, middle, task.end, axis);
+
+			auto left = node_count;
+			node_count += 2;
+
+			nodes[task.node] = { node_bounds, static_cast<std::uint32_t>(left), 0 };
+
+			stack[stack_size++] = { left + 1, middle, task.end };
+			stack[stack_size++] = { left, task.begin, middle };
+
+		}
+
+		return node_count;
+
+	}
+
+	//! Updates the bounds of all nodes to the current bounds of the shapes, the structure stays the same
+	//! The children of a node always come after it, so one backwards pass sees the children before their parents
+
+	constexpr void refit_bvh(const Bounds* bounds, BvhNode* nodes, std::size_t node_count, const std::uint32_t* indices) {
+
+		if (node_count == 0 || (node_count == 1 && !nodes[0].leaf())) return;
+
+		for (auto n = node_count; n-- > 0; ) {
+
+			auto& node = nodes[n];
+
+			if (node.leaf()) {
+
+				auto node_bounds = bounds[indices[node.first]];
+
+				for (auto i = node.first + 1; i < node.first + node.count; i++) node_bounds = node_bounds.merged(bounds[indices[i]]);
+
+				node.bounds = node_bounds;
+
+			}
+			else {
+
+				node.bounds = nodes[node.first].bounds.merged(nodes[node.first + 1].bounds);
+
+			}
+
+		}
+
+	}
+
+	//! Quality metrics of a hierarchy built by build_bvh, all zero for an empty hierarchy
+
+	constexpr BvhQuality bvh_quality(const BvhNode* nodes) {
+
+		BvhQuality quality = { 0.0, 0.0, 0, 0, 0, 0, 0.0 };
+
+		//! An empty hierarchy is a single node with empty bounds
+
+		if (!nodes[0].leaf() && nodes[0].bounds.min_x > nodes[0].bounds.max_x) return quality;
+
+		auto root_perimeter = Bvh::perimeter(nodes[0].bounds);
+
+		struct Entry {
+
+			std::uint32_t node;
+			std::size_t depth;
+
+		};
+
+		Entry stack[bvh_max_depth + 1] = {};
+		std::size_t stack_size = 0;
+
+		std::size_t depth_sum = 0;
+		std::size_t inner_count = 0;
+
+		stack[stack_size++] = { 0, 0 };
+
+		while (stack_size > 0) {
+
+			auto entry = stack[--stack_size];
+			auto& node = nodes[entry.node];
+
+			//! All shapes at one position: every node is visited by every query
+
+			auto probability = (root_perimeter > 0.0 ? Bvh::perimeter(node.bounds) / root_perimeter : 1.0);
+
+			quality.node_count++;
+
+			if (node.leaf()) {
+
+				quality.sah_cost += probability * (Bvh::sah_node_cost + Bvh::sah_shape_cost * node.count);
+
+				if (quality.leaf_count == 0 || entry.depth < quality.min_depth) quality.min_depth = entry.depth;
+				if (entry.depth > quality.max_depth) quality.max_depth = entry.depth;
+
+				quality.leaf_count++;
+				depth_sum += entry.depth;
+
+				continue;
+
+			}
+
+			quality.sah_cost += probability * Bvh::sah_node_cost;
+
+			auto node_area = Bvh::area(node.bounds);
+			if (node_area > 0.0) quality.overlap_ratio += Bvh::overlap_area(nodes[node.first].bounds, nodes[node.first + 1].bounds) / node_area;
+
+			inner_count++;
+
+			stack[stack_size++] = { node.first + 1, entry.depth + 1 };
+			stack[stack_size++] = { node.first, entry.depth + 1 };
+
+		}
+
+		if (inner_count > 0) quality.overlap_ratio /= static_cast<double>(inner_count);
+		quality.mean_depth = static_cast<double>(depth_sum) / static_cast<double>(quality.leaf_count);
+
+		return quality;
+
+	}
+
+	namespace Bvh {
+
+		//! Query of the hierarchy, which counts its work into stats unless it is a null pointer
+
+		template <class F> constexpr void query(const BvhNode* nodes, const std::uint32_t* indices, const Bounds* bounds, const Bounds& query, F&& function, BvhQueryStats* stats) {
+
+			std::uint32_t stack[bvh_max_depth] = {};
+			std::size_t stack_size = 0;
+
+			stack[stack_size++] = 0;
+
+			if (stats) stats->queries++;
+
+			while (stack_size > 0) {
+
+				auto& node = nodes[stack[--stack_size]];
+
+				if (stats) stats->nodes_visited++;
+
+				if (!node.bounds.overlaps(query)) continue;
+
+				if (node.leaf()) {
+
+					if (stats) {
+
+						stats->leaves_visited++;
+						stats->shapes_tested += node.count;
+
+					}
+
+					for (auto i = node.first; i < node.first + node.count; i++) {
+
+						if (bounds[indices[i]].overlaps(query)) function(indices[i]);
+
+					}
+
+				}
+				else {
+
+					//! Only a corrupt hierarchy (from a damaged file, say) is deeper than the stack, its deeper subtrees are skipped
+
+					if (stack_size + 2 > bvh_max_depth) continue;
+
+					stack[stack_size++] = node.first + 1;
+					stack[stack_size++] = node.first;
+
+				}
+
+			}
+
+		}
+
+	}
+
+	//! Calls function(index) for every shape whose bounds overlap query
+
+	template <class F> constexpr void query_bvh(const BvhNode* nodes, const std::uint32_t* indices, const Bounds* bounds, const Bounds& query, F&& function) {
+
+		Bvh::query(nodes, indices, bounds, query, function, static_cast<BvhQueryStats*>(nullptr));
+
+	}
+
+	//! Same as above, additionally counts the visited nodes and leaves into stats
+
+	template <class F> constexpr void query_bvh(const BvhNode* nodes, const std::uint32_t* indices, const Bounds* bounds, const Bounds& query, BvhQueryStats& stats, F&& function) {
+
+		Bvh::query(nodes, indices, bounds, query, function, &stats);
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::BvhAssertions {
+
+	//! Four unit boxes in a row, afterwards the last one moves onto the first one
+
+	constexpr BvhQuality row_quality(bool moved) {
+
+		Bounds bounds[4] = { { 0.0f, 0.0f, 1.0f, 1.0f }, { 2.0f, 0.0f, 3.0f, 1.0f }, { 4.0f, 0.0f, 5.0f, 1.0f }, { 6.0f, 0.0f, 7.0f, 1.0f } };
+		BvhNode nodes[bvh_node_capacity(4)] = {};
+		std::uint32_t indices[4] = {};
+
+		auto node_count = build_bvh(bounds, 4, nodes, indices);
+
+		if (moved) {
+
+			bounds[3] = bounds[0];
+			refit_bvh(bounds, nodes, node_count, indices);
+
+		}
+
+		return bvh_quality(nodes);
+
+	}
+
+	constexpr std::size_t leaves_visited(float x) {
+
+		Bounds bounds[4] = { { 0.0f, 0.0f, 1.0f, 1.0f }, { 2.0f, 0.0f, 3.0f, 1.0f }, { 4.0f, 0.0f, 5.0f, 1.0f }, { 6.0f, 0.0f, 7.0f, 1.0f } };
+		BvhNode nodes[bvh_node_capacity(4)] = {};
+		std::uint32_t indices[4] = {};
+
+		build_bvh(bounds, 4, nodes, indices);
+
+		BvhQueryStats stats = {};
+		query_bvh(nodes, indices, bounds, { x, 0.5f, x, 0.5f }, stats, [](std::uint32_t) {});
+
+		return stats.leaves_visited;
+
+	}
+
+	//! A chain of inner nodes twice as deep as the query stack, as a corrupt file could contain, every inner node defers a leaf
+
+	constexpr std::size_t chain_leaves_visited() {
+
+		constexpr std::size_t depth = 2 * bvh_max_depth;
+
+		Bounds bounds[1] = { { 0.0f, 0.0f, 1.0f, 1.0f } };
+		BvhNode nodes[2 * depth + 2] = {};
+		std::uint32_t indices[1] = {};
+
+		for (std::size_t k = 0; k < depth; k++) {
+
+			nodes[2 * k] = { bounds[0], static_cast<std::uint32_t>(2 * k + 2), 0 };
+			nodes[2 * k + 3] = { bounds[0], 0, 1 };
+
+		}
+
+		nodes[2 * depth] = { bounds[0], 0, 1 };
+
+		BvhQueryStats stats = {};
+		query_bvh(nodes, indices, bounds, bounds[0], stats, [](std::uint32_t) {});
+
+		return stats.leaves_visited;
+
+	}
+
+	constexpr BvhQuality empty_quality() {
+
+		BvhNode nodes[1] = {};
+		std::uint32_t indices[1] = {};
+
+		build_bvh(nullptr, 0, nodes, indices);
+
+		return bvh_quality(nodes);
+
+	}
+
+	static_assert(row_quality(false).node_count == 3);
+	static_assert(row_quality(false).leaf_count == 2);
+	static_assert(row_quality(false).min_depth == 1 && row_quality(false).max_depth == 1);
+	static_assert(row_quality(false).overlap_ratio == 0.0);
+	static_assert(row_quality(false).sah_cost == 4.0);
+
+	//! The right leaf now spans [0, 5] and overlaps the left leaf [0, 3], the root shrinks to [0, 5]
+
+	static_assert(row_quality(true).overlap_ratio == 0.6);
+	static_assert(row_quality(true).sah_cost > row_quality(false).sah_cost);
+
+	static_assert(leaves_visited(0.5f) == 1);
+	static_assert(leaves_visited(3.5f) == 0);
+	static_assert(leaves_visited(-1.0f) == 0);
+
+	//! The query stops descending when its stack is full instead of writing past it
+
+	static_assert(chain_leaves_visited() > 0 && chain_leaves_visited() < bvh_max_depth);
+
+	static_assert(empty_quality().node_count == 0);
+
+}
+
+#endif
@@ -0,0 +1,500 @@
+#pragma once
+
+//! Optional capture mode for Collishi
+//! Every call made through the wrappers in Collishi::Capture (or through Capture::collision_batch)
+//! is recorded into a compact binary log while a log is active
+//! The log can be replayed with tools/replay.cpp against any build of Collisions.h
+//!
+//! To capture calls, use the wrappers instead of the plain routines, e.g. via a namespace alias:
+//! namespace col = Collishi::Capture;
+//! Collishi::Capture::start("frame.clog");
+//! ... col::collision_circle_box(...) ...
+//! Collishi::Capture::stop();
+//!
+//! If no log is active, the wrappers only cost one relaxed atomic load per call
+//! stop() returns false if the log could not be written completely (e.g. the disk is full)
+
+#include "CollisionsMemory.h"
+#include "CollisionsRoutines.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace Collishi::Capture {
+
+	//! Layout of a log file (native byte order, which is little endian on all supported platforms):
+	//! Header: 8 byte magic "CLSHCAPT", uint32 format version, uint32 reserved
+	//! Single call: uint8 kind (0), uint8 routine id, uint8 result, float arguments[arity]
+	//! Batch call: uint8 kind (1), uint8 routine id, uint32 count, float arguments[arity * count], uint8 results[count]
+
+	constexpr char log_magic[8] = { 'C', 'L', 'S', 'H', 'C', 'A', 'P', 'T' };
+	constexpr std::uint32_t log_version = 1;
+
+	//! Larger batches are recorded as several batch records
+
+	constexpr std::size_t max_batch_count = std::numeric_limits<std::uint32_t>::max();
+
+	enum class RecordKind : std::uint8_t {
+
+		call = 0,
+		batch = 1
+
+	};
+
+	class Log {
+
+	public:
+
+		Log() = default;
+		Log(const Log& other) = delete;
+		Log& operator=(const Log& other) = delete;
+
+		~Log() {
+
+			close();
+
+		}
+
+		bool open(const char* filename) {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (file) return false;
+
+			file = std::fopen(filename, "wb");
+			if (!file) return false;
+
+			std::uint32_t header[2] = { log_version, 0 };
+
+			buffer.clear();
+			append(log_magic, sizeof(log_magic));
+			append(header, sizeof(header));
+
+			record_count = 0;
+			write_failed = false;
+
+			return true;
+
+		}
+
+		//! Writes the remaining records, returns false if any part of the log could not be written
+
+		bool close() {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (!file) return false;
+
+			flush_buffer();
+
+			if (std::fclose(file) != 0) write_failed = true;
+			file = nullptr;
+
+			return !write_failed;
+
+		}
+
+		bool is_open() const {
+
+			return file != nullptr;
+
+		}
+
+		std::size_t records() const {
+
+			return record_count;
+
+		}
+
+		//! Whether a write failed, the records after the failure are dropped, so the log ends with the last written record
+
+		bool failed() const {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			return write_failed;
+
+		}
+
+		//! The buffer is written to the file at flush_threshold bytes, but keeps its capacity
+
+		MemoryStats memory_stats() const {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			return Collishi::memory_stats(buffer);
+
+		}
+
+		void record_call(Routine routine, const float* args, bool result) {
+
+			std::uint8_t prefix[3] = { static_cast<std::uint8_t>(RecordKind::call), static_cast<std::uint8_t>(routine), static_cast<std::uint8_t>(result) };
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (!file) return;
+
+			append(prefix, sizeof(prefix));
+			append(args, routine_arity(routine) * sizeof(float));
+
+			finish_record();
+
+		}
+
+		//! Batches of more than max_batch_count calls are split into several records
+
+		void record_batch(Routine routine, const float* args, std::size_t count, const bool* results) {
+
+			std::uint8_t prefix[2] = { static_cast<std::uint8_t>(RecordKind::batch), static_cast<std::uint8_t>(routine) };
+			auto arity = routine_arity(routine);
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (!file) return;
+
+			for (std::size_t first = 0; first == 0 || first < count; first += max_batch_count) {
+
+				auto part = std::min(count - first, max_batch_count);
+				auto count_32 = static_cast<std::uint32_t>(part);
+
+				append(prefix, sizeof(prefix));
+				append(&count_32, sizeof(count_32));
+				append(args + first * arity, arity * part * sizeof(float));
+
+				for (std::size_t i = first; i < first + part; i++) buffer.push_back(static_cast<unsigned char>(results[i]));
+
+				finish_record();
+
+			}
+
+		}
+
+	private:
+
+		//! The buffer is written to the file once it exceeds this size
+
+		static constexpr std::size_t flush_threshold = 1 << 16;
+
+		void append(const void* data, std::size_t size) {
+
+			auto bytes = static_cast<const unsigned char*>(data);
+			buffer.insert(buffer.end(), bytes, bytes + size);
+
+		}
+
+		void finish_record() {
+
+			record_count++;
+
+			if (buffer.size() >= flush_threshold) flush_buffer();
+
+		}
+
+		void flush_buffer() {
+
+			if (!buffer.empty() && !write_failed && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) write_failed = true;
+			buffer.clear();
+
+		}
+
+		std::FILE* file = nullptr;
+		mutable std::mutex mutex;
+		std::vector<unsigned char> buffer;
+		std::size_t record_count = 0;
+		bool write_failed = false;
+
+	};
+
+	//! One decoded record
+	//! For single calls, count is 1
+
+	struct Record {
+
+		RecordKind kind = RecordKind::call;
+		Routine routine = Routine::point_point;
+		std::size_t count = 0;
+
+		std::vector<float> args;
+		std::vector<bool> results;
+
+	};
+
+	//! Result of Reader::next, a log which ends within a record or contains an unknown record is an error
+
+	enum class ReadResult {
+
+		record,
+		end,
+		error
+
+	};
+
+	class Reader {
+
+	public:
+
+		Reader() = default;
+		Reader(const Reader& other) = delete;
+		Reader& operator=(const Reader& other) = delete;
+
+		~Reader() {
+
+			if (file) std::fclose(file);
+
+		}
+
+		//! Returns false if the file does not exist or is not a capture log of a known version
+
+		bool open(const char* filename) {
+
+			file = std::fopen(filename, "rb");
+			if (!file) return false;
+
+			if (std::fseek(file, 0, SEEK_END) != 0) return false;
+
+			auto size = std::ftell(file);
+
+			if (size < 0 || std::fseek(file, 0, SEEK_SET) != 0) return false;
+
+			file_size = static_cast<std::uint64_t>(size);
+
+			char magic[8];
+			std::uint32_t header[2];
+
+			if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic)) return false;
+			if (std::memcmp(magic, log_magic, sizeof(magic)) != 0) return false;
+			if (std::fread(header, 1, sizeof(header), file) != sizeof(header)) return false;
+			if (header[0] != log_version) return false;
+
+			return true;
+
+		}
+
+		//! Reads the next record into record, returns ReadResult::end only if the log ends after a complete record
+
+		ReadResult next(Record& record) {
+
+			if (!file) return ReadResult::error;
+
+			std::uint8_t prefix[2];
+
+			auto prefix_size = std::fread(prefix, 1, sizeof(prefix), file);
+
+			if (prefix_size == 0 && std::feof(file)) return ReadResult::end;
+			if (prefix_size != sizeof(prefix)) return ReadResult::error;
+			if (prefix[0] > static_cast<std::uint8_t>(RecordKind::batch)) return ReadResult::error;
+			if (prefix[1] >= routine_count) return ReadResult::error;
+
+			record.kind = static_cast<RecordKind>(prefix[0]);
+			record.routine = static_cast<Routine>(prefix[1]);
+
+			std::uint8_t single_result = 0;
+
+			if (record.kind == RecordKind::call) {
+
+				if (std::fread(&single_result, 1, 1, file) != 1) return ReadResult::error;
+				record.count = 1;
+
+			}
+			else {
+
+				std::uint32_t count_32;
+				if (std::fread(&count_32, 1, sizeof(count_32), file) != sizeof(count_32)) return ReadResult::error;
+				record.count = count_32;
+
+				//! A corrupt count could ask for gigabytes, so it is checked against the rest of the file before anything is allocated
+
+				auto position = std::ftell(file);
+				auto record_bytes = std::uint64_t(count_32) * (routine_arity(record.routine) * sizeof(float) + 1);
+
+				if (position < 0 || record_bytes > file_size - std::min(file_size, static_cast<std::uint64_t>(position))) return ReadResult::error;
+
+			}
+
+			auto arg_count = routine_arity(record.routine) * record.count;
+
+			record.args.resize(arg_count);
+			if (std::fread(record.args.data(), sizeof(float), arg_count, file) != arg_count) return ReadResult::error;
+
+			record.results.resize(record.count);
+
+			if (record.kind == RecordKind::call) {
+
+				record.results[0] = (single_result != 0);
+
+			}
+			else {
+
+				std::vector<std::uint8_t> raw_results(record.count);
+				if (std::fread(raw_results.data(), 1, record.count, file) != record.count) return ReadResult::error;
+
+				for (std::size_t i = 0; i < record.count; i++) record.results[i] = (raw_results[i] != 0);
+
+			}
+
+			return ReadResult::record;
+
+		}
+
+	private:
+
+		std::FILE* file = nullptr;
+		std::uint64_t file_size = 0;
+
+	};
+
+	//! The log all wrappers record into, or nullptr if capturing is disabled
+
+	inline std::atomic<Log*> active_log{ nullptr };
+
+	//! Opens a log file and routes all wrapper calls into it
+
+	inline bool start(const char* filename) {
+
+		static Log log;
+
+		if (active_log.load() || !log.open(filename)) return false;
+
+		active_log.store(&log);
+
+		return true;
+
+	}
+
+	//! Stops capturing and writes the remaining records to the file, returns false if no log was active or it could not be written
+
+	inline bool stop() {
+
+		auto log = active_log.exchange(nullptr);
+
+		return log && log->close();
+
+	}
+
+	inline bool record(Routine routine, bool result, std::initializer_list<float> args) {
+
+		auto log = active_log.load(std::memory_order_relaxed);
+
+		if (log) log->record_call(routine, args.begin(), result);
+
+		return result;
+
+	}
+
+	//! Batch evaluation of one routine with consecutively stored argument sets, recorded as one entry
+
+	inline void collision_batch(Routine routine, const float* args, std::size_t count, bool* results) {
+
+		invoke_routine_batch(routine, args, count, results);
+
+		auto log = active_log.load(std::memory_order_relaxed);
+
+		if (log) {
+
+			COLLISHI_TRACE_SCOPE("capture", "record_batch");
+			log->record_batch(routine, args, count, results);
+
+		}
+
+	}
+
+	//! Wrappers with the exact signatures of the routines in Collisions.h
+
+	inline bool collision_point_point(float x1, float y1, float x2, float y2) {
+
+		return record(Routine::point_point, Collishi::collision_point_point(x1, y1, x2, y2), { x1, y1, x2, y2 });
+
+	}
+
+	inline bool collision_point_line(float x1, float y1, float x2, float y2, float dx2, float dy2) {
+
+		return record(Routine::point_line, Collishi::collision_point_line(x1, y1, x2, y2, dx2, dy2), { x1, y1, x2, y2, dx2, dy2 });
+
+	}
+
+	inline bool collision_point_circle(float x1, float y1, float x2, float y2, float r2) {
+
+		return record(Routine::point_circle, Collishi::collision_point_circle(x1, y1, x2, y2, r2), { x1, y1, x2, y2, r2 });
+
+	}
+
+	inline bool collision_point_box(float x1, float y1, float x2, float y2, float w2, float h2) {
+
+		return record(Routine::point_box, Collishi::collision_point_box(x1, y1, x2, y2, w2, h2), { x1, y1, x2, y2, w2, h2 });
+
+	}
+
+	inline bool collision_point_triangle(float x1, float y1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		return record(Routine::point_triangle, Collishi::collision_point_triangle(x1, y1, x2, y2, sxa2, sya2, sxb2, syb2), { x1, y1, x2, y2, sxa2, sya2, sxb2, syb2 });
+
+	}
+
+	inline bool collision_line_line(float x1, float y1, float dx1, float dy1, float x2, float y2, float dx2, float dy2) {
+
+		return record(Routine::line_line, Collishi::collision_line_line(x1, y1, dx1, dy1, x2, y2, dx2, dy2), { x1, y1, dx1, dy1, x2, y2, dx2, dy2 });
+
+	}
+
+	inline bool collision_line_circle(float x1, float y1, float dx1, float dy1, float x2, float y2, float r2) {
+
+		return record(Routine::line_circle, Collishi::collision_line_circle(x1, y1, dx1, dy1, x2, y2, r2), { x1, y1, dx1, dy1, x2, y2, r2 });
+
+	}
+
+	inline bool collision_line_box(float x1, float y1, float dx1, float dy1, float x2, float y2, float w2, float h2) {
+
+		return record(Routine::line_box, Collishi::collision_line_box(x1, y1, dx1, dy1, x2, y2, w2, h2), { x1, y1, dx1, dy1, x2, y2, w2, h2 });
+
+	}
+
+	inline bool collision_line_triangle(float x1, float y1, float dx1, float dy1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		return record(Routine::line_triangle, Collishi::collision_line_triangle(x1, y1, dx1, dy1, x2, y2, sxa2, sya2, sxb2, syb2), { x1, y1, dx1, dy1, x2, y2, sxa2, sya2, sxb2, syb2 });
+
+	}
+
+	inline bool collision_circle_circle(float x1, float y1, float r1, float x2, float y2, float r2) {
+
+		return record(Routine::circle_circle, Collishi::collision_circle_circle(x1, y1, r1, x2, y2, r2), { x1, y1, r1, x2, y2, r2 });
+
+	}
+
+	inline bool collision_circle_box(float x1, float y1, float r1, float x2, float y2, float w2, float h2) {
+
+		return record(Routine::circle_box, Collishi::collision_circle_box(x1, y1, r1, x2, y2, w2, h2), { x1, y1, r1, x2, y2, w2, h2 });
+
+	}
+
+	inline bool collision_circle_triangle(float x1, float y1, float r1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		return record(Routine::circle_triangle, Collishi::collision_circle_triangle(x1, y1, r1, x2, y2, sxa2, sya2, sxb2, syb2), { x1, y1, r1, x2, y2, sxa2, sya2, sxb2, syb2 });
+
+	}
+
+	inline bool collision_box_box(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2) {
+
+		return record(Routine::box_box, Collishi::collision_box_box(x1, y1, w1, h1, x2, y2, w2, h2), { x1, y1, w1, h1, x2, y2, w2, h2 });
+
+	}
+
+	inline bool collision_box_triangle(float x1, float y1, float w1, float h1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		return record(Routine::box_triangle, Collishi::collision_box_triangle(x1, y1, w1, h1, x2, y2, sxa2, sya2, sxb2, syb2), { x1, y1, w1, h1, x2, y2, sxa2, sya2, sxb2, syb2 });
+
+	}
+
+	inline bool collision_triangle_triangle(float x1, float y1, float sxa1, float sya1, float sxb1, float syb1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		return record(Routine::triangle_triangle, Collishi::collision_triangle_triangle(x1, y1, sxa1, sya1, sxb1, syb1, x2, y2, sxa2, sya2, sxb2, syb2), { x1, y1, sxa1, sya1, sxb1, syb1, x2, y2, sxa2, sya2, sxb2, syb2 });
+
+	}
+
+}
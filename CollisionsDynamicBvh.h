@@ -0,0 +1,219 @@
+#pragma once
+
+//! Bounding volume hierarchy over moving shapes, which is refitted every frame and only rebuilt when its quality got too bad
+//! Refitting keeps the structure of the hierarchy and only updates the bounds of the nodes, which is much cheaper than
+//! a rebuild, but shapes which moved apart keep sharing nodes, so the nodes grow, overlap and queries visit more leaves
+//!
+//! The rebuild policy compares the quality (see BvhQuality in CollisionsBvh.h) with the quality right after the last build
+//! and rebuilds once the SAH cost grew too much or the siblings overlap too much:
+//!
+//! Collishi::DynamicBvh tree;
+//! tree.update(shapes); // every frame, builds the first time and whenever the number of shapes changes
+//! tree.for_each_collision(player, [&](std::uint32_t index) { ... });
+
+#include "CollisionsBvh.h"
+#include "CollisionsMemory.h"
+#include "CollisionsShapes.h"
+#include "CollisionsTags.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Collishi {
+
+	class DynamicBvh {
+
+	public:
+
+		//! A limit of 0 disables the check
+
+		struct Policy {
+
+			//! Rebuild when the SAH cost is this factor higher than right after the last build ...
+
+			double max_sah_growth = 1.5;
+
+			//! ... or when the overlap ratio of the siblings exceeds this value
+
+			double max_overlap_ratio = 0.0;
+
+			//! The quality is computed every this many updates (a pass over all nodes), 0 never rebuilds automatically
+
+			std::size_t check_interval = 1;
+
+		};
+
+		DynamicBvh() = default;
+		explicit DynamicBvh(const Policy& policy) : policy(policy) {}
+
+		void build(const std::vector<Shape>& shapes) {
+
+			update_shapes(shapes);
+
+			nodes.resize(bvh_node_capacity(shapes.size()));
+			indices.resize(shapes.size() > 0 ? shapes.size() : 1);
+
+			node_count = build_bvh(shape_bounds.data(), shape_bounds.size(), nodes.data(), indices.data());
+
+			built = bvh_quality(nodes.data());
+			current = built;
+
+			updates_since_check = 0;
+			rebuild_count++;
+
+		}
+
+		//! Refits the hierarchy to the moved shapes and rebuilds it if the policy asks for it
+		//! The shapes have to be the same objects in the same order, a different number of shapes is always rebuilt
+		//! Returns true if the hierarchy was rebuilt
+
+		bool update(const std::vector<Shape>& shapes) {
+
+			if (shapes.size() != shape_bounds.size() || node_count == 0) {
+
+				build(shapes);
+				return true;
+
+			}
+
+			update_shapes(shapes);
+			refit_bvh(shape_bounds.data(), nodes.data(), node_count, indices.data());
+
+			if (policy.check_interval == 0 || ++updates_since_check < policy.check_interval) return false;
+
+			updates_since_check = 0;
+			current = bvh_quality(nodes.data());
+
+			if (!rebuild_needed()) return false;
+
+			build(shapes);
+			return true;
+
+		}
+
+		//! Whether the quality of the last check crossed a limit of the policy
+
+		bool rebuild_needed() const {
+
+			if (policy.max_sah_growth > 0.0 && current.sah_cost > built.sah_cost * policy.max_sah_growth) return true;
+			if (policy.max_overlap_ratio > 0.0 && current.overlap_ratio > policy.max_overlap_ratio) return true;
+
+			return false;
+
+		}
+
+		//! Calls function(index) for every shape whose bounds overlap query and counts the work into query_stats()
+
+		template <class F> void for_each_candidate(const Bounds& query, F&& function, CostTag tag = {}) {
+
+			Tags::Measurement measurement(tag);
+
+			auto nodes_before = stats.nodes_visited;
+
+			query_bvh(nodes.data(), indices.data(), shape_bounds.data(), query, stats, function);
+
+			Tags::Measurement::add_nodes(stats.nodes_visited - nodes_before);
+
+		}
+
+		template <class F> void for_each_collision(const Shape& shape, F&& function, CostTag tag = {}) {
+
+			Tags::Measurement measurement(tag);
+
+			std::size_t tests = 0;
+
+			for_each_candidate(bounds(shape), [&](std::uint32_t index) {
+
+				tests++;
+
+				auto hit = collision(shape_values[index], shape);
+
+				COLLISHI_METRICS_COUNT(select_routine(shape_values[index].type, shape.type).routine, 1, hit);
+
+				if (hit) function(index);
+
+			});
+
+			Tags::Measurement::add_tests(tests);
+
+		}
+
+		//! Quality at the last check (or build)
+
+		const BvhQuality& quality() const {
+
+			return current;
+
+		}
+
+		//! Quality right after the last build, the reference of the policy
+
+		const BvhQuality& built_quality() const {
+
+			return built;
+
+		}
+
+		//! Computes the quality now, independent of the check interval
+
+		const BvhQuality& measure_quality() {
+
+			current = (node_count > 0 ? bvh_quality(nodes.data()) : BvhQuality{});
+			return current;
+
+		}
+
+		const BvhQueryStats& query_stats() const {
+
+			return stats;
+
+		}
+
+		void reset_query_stats() {
+
+			stats = {};
+
+		}
+
+		std::size_t rebuilds() const {
+
+			return rebuild_count;
+
+		}
+
+		MemoryStats memory_stats() const {
+
+			return Collishi::memory_stats(shape_values) + Collishi::memory_stats(shape_bounds) + Collishi::memory_stats(nodes) + Collishi::memory_stats(indices);
+
+		}
+
+	private:
+
+		void update_shapes(const std::vector<Shape>& shapes) {
+
+			shape_values = shapes;
+			shape_bounds.resize(shapes.size());
+
+			for (std::size_t i = 0; i < shapes.size(); i++) shape_bounds[i] = bounds(shapes[i]);
+
+		}
+
+		Policy policy;
+
+		std::vector<Shape> shape_values;
+		std::vector<Bounds> shape_bounds;
+		std::vector<BvhNode> nodes;
+		std::vector<std::uint32_t> indices;
+		std::size_t node_count = 0;
+
+		BvhQuality built = {};
+		BvhQuality current = {};
+		BvhQueryStats stats = {};
+
+		std::size_t updates_since_check = 0;
+		std::size_t rebuild_count = 0;
+
+	};
+
+}
@@ -0,0 +1,893 @@
+#pragma once
+
+//! Bounding volume hierarchy over static geometry which is edited while it is used, e.g. by a level editor
+//! Inserting, removing or moving a shape only touches the path from its leaf to the root and rebuilds a small subtree around it,
+//! instead of rebuilding the whole hierarchy:
+//!
+//! - insert descends to the sibling which makes the new parent cheapest (by the perimeter of the nodes), then rebuilds
+//!   the subtree a few levels above the new leaf with median splits, which repairs the local structure
+//! - remove replaces the parent of the leaf by its sibling and refits the path to the root
+//! - modify only refits the path if the shape stays within the bounds of the parent of its leaf, otherwise it removes and
+//!   inserts the shape again
+//!
+//! Many edits in different places still degrade the upper levels, so after a number of edits (Policy::optimize_after_edits)
+//! the whole hierarchy is rebuilt, by default on a background thread. The edits made in the meantime are applied to the
+//! new hierarchy before it replaces the current one, so queries always see all edits:
+//!
+//! Collishi::EditableBvh level;
+//! level.build(shapes);                      // indices of the shapes are their ids
+//! level.modify(wall_id, moved_wall);        // while dragging
+//! auto id = level.insert(new_prop);
+//! level.remove(deleted_id);
+//! level.for_each_collision(player, [&](std::uint32_t id) { ... });
+//!
+//! Leaves hold a single shape, and both children of a node are stored next to each other, so the nodes have the layout of
+//! BvhNode arrays and bvh_quality and query_bvh work on them
+
+#include "CollisionsBvh.h"
+#include "CollisionsMemory.h"
+#include "CollisionsShapes.h"
+#include "CollisionsTags.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Collishi {
+
+	//! Counters of the edits and of the work they caused
+
+	struct EditStats {
+
+		std::size_t inserts = 0;
+		std::size_t removes = 0;
+		std::size_t modifies = 0;
+
+		//! Modifies which only refitted the path to the root
+
+		std::size_t refits = 0;
+
+		//! Local rebuilds after inserts and the shapes in the rebuilt subtrees
+
+		std::size_t local_rebuilds = 0;
+		std::size_t rebuilt_shapes = 0;
+
+		//! Rebuilds of the whole hierarchy, on the calling thread and in the background
+
+		std::size_t full_rebuilds = 0;
+		std::size_t background_rebuilds = 0;
+
+	};
+
+	namespace EditableTree {
+
+		constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+		//! Leaves deeper than this trigger a full rebuild, so queries (limited to bvh_max_depth) never overflow their stack
+
+		constexpr std::size_t max_depth = bvh_max_depth - 16;
+
+		//! The root is node 0, the children of every inner node are a pair of nodes (1|2), (3|4), ...
+
+		constexpr std::uint32_t sibling(std::uint32_t node) {
+
+			return (node % 2 == 1 ? node + 1 : node - 1);
+
+		}
+
+		//! Nodes, parents and the leaf of every id, the bounds of the shapes are passed to every function,
+		//! so a background rebuild can work on a copy of them
+
+		struct Tree {
+
+			std::vector<BvhNode> nodes;
+			std::vector<std::uint32_t> parents;
+			std::vector<std::uint32_t> leaf_of;
+			std::vector<std::uint32_t> free_pairs;
+			std::size_t leaf_count = 0;
+
+			//! Builds the hierarchy over the ids with median splits (the same splits as build_bvh with one shape per leaf)
+
+			void build(const Bounds* bounds, std::vector<std::uint32_t> ids, std::size_t id_count) {
+
+				auto infinity = std::numeric_limits<float>::infinity();
+
+				nodes.assign(1, { { infinity, infinity, -infinity, -infinity }, 0, 0 });
+				parents.assign(1, none);
+				leaf_of.assign(id_count, none);
+				free_pairs.clear();
+
+				nodes.reserve(2 * ids.size());
+				parents.reserve(2 * ids.size());
+
+				leaf_count = ids.size();
+
+				if (!ids.empty()) build_subtree(bounds, ids.data(), ids.size(), 0);
+
+			}
+
+			bool contains(std::uint32_t id) const {
+
+				return id < leaf_of.size() && leaf_of[id] != none;
+
+			}
+
+			//! Inserts the leaf of the id, rebuilds the subtree local_levels above it and returns the depth of the leaf
+
+			std::size_t insert(const Bounds* bounds, std::uint32_t id, std::size_t local_levels, EditStats& stats) {
+
+				if (id >= leaf_of.size()) leaf_of.resize(id + 1, none);
+
+				auto& leaf_bounds = bounds[id];
+
+				leaf_count++;
+
+				if (leaf_count == 1) {
+
+					nodes[0] = { leaf_bounds, id, 1 };
+					leaf_of[id] = 0;
+					return 0;
+
+				}
+
+				//! Descends while a child is cheaper than a new parent at this node (the cost of the parent node and
+				//! the growth it causes in all its ancestors, measured by the perimeter like the surface area heuristic)
+
+				std::uint32_t node = 0;
+				std::size_t depth = 0;
+
+				while (!nodes[node].leaf()) {
+
+					auto perimeter = Bvh::perimeter(nodes[node].bounds);
+					auto combined = Bvh::perimeter(nodes[node].bounds.merged(leaf_bounds));
+
+					auto cost = 2.0 * combined;
+					auto inheritance = 2.0 * (combined - perimeter);
+
+					auto child_cost = [&](std::uint32_t child) {
+
+						auto grown = Bvh::perimeter(nodes[child].bounds.merged(leaf_bounds));
+
+						return (nodes[child].leaf() ? grown : grown - Bvh::perimeter(nodes[child].bounds)) + inheritance;
+
+					};
+
+					auto first = nodes[node].first;
+					auto first_cost = child_cost(first);
+					auto second_cost = child_cost(first + 1);
+
+					if (cost < first_cost && cost < second_cost) break;
+
+					node = (first_cost <= second_cost ? first : first + 1);
+					depth++;
+
+				}
+
+				//! The sibling moves into a new pair together with the new leaf, a new parent takes its place
+
+				auto pair = allocate_pair();
+
+				move_node(node, pair);
+
+				nodes[pair + 1] = { leaf_bounds, id, 1 };
+				leaf_of[id] = pair + 1;
+
+				nodes[node] = { nodes[pair].bounds.merged(leaf_bounds), pair, 0 };
+				parents[pair] = node;
+				parents[pair + 1] = node;
+
+				refit(parents[node]);
+
+				auto leaf_depth = depth + 1;
+
+				//! The subtree up to local_levels above the leaf is rebuilt, which only shortens its paths
+				//! It stops below larger subtrees, since the leaf can be inserted high up in the tree
+
+				if (local_levels == 0) return leaf_depth;
+
+				auto root = none;
+				auto limit = std::size_t{ 1 } << local_levels;
+
+				for (auto candidate = node, level = std::uint32_t{ 0 }; candidate != none && level < local_levels && subtree_size(candidate, limit) <= limit; candidate = parents[candidate], level++) root = candidate;
+
+				if (root == none) return leaf_depth;
+
+				stats.local_rebuilds++;
+				stats.rebuilt_shapes += rebuild(bounds, root);
+
+				return leaf_depth;
+
+			}
+
+			void remove(std::uint32_t id) {
+
+				auto leaf = leaf_of[id];
+
+				leaf_of[id] = none;
+				leaf_count--;
+
+				if (leaf == 0) {
+
+					auto infinity = std::numeric_limits<float>::infinity();
+
+					nodes[0] = { { infinity, infinity, -infinity, -infinity }, 0, 0 };
+					return;
+
+				}
+
+				//! The sibling takes the place of the parent, the pair of the leaf and the sibling is free afterwards
+
+				auto parent = parents[leaf];
+				auto pair = std::min(leaf, sibling(leaf));
+
+				move_node(sibling(leaf), parent);
+				free_pairs.push_back(pair);
+
+				refit(parents[parent]);
+
+			}
+
+			//! Updates the bounds of a leaf and its ancestors after its shape moved within its parent
+
+			void update_leaf(const Bounds* bounds, std::uint32_t id) {
+
+				auto leaf = leaf_of[id];
+
+				nodes[leaf].bounds = bounds[id];
+				refit(parents[leaf]);
+
+			}
+
+			//! Bounds of the parent of the leaf of the id, or of the leaf if it is the root
+
+			const Bounds& parent_bounds(std::uint32_t id) const {
+
+				auto leaf = leaf_of[id];
+
+				return nodes[leaf == 0 ? 0 : parents[leaf]].bounds;
+
+			}
+
+			//! Rebuilds the subtree of a node from scratch, returns the number of its shapes
+
+			std::size_t rebuild(const Bounds* bounds, std::uint32_t root) {
+
+				scratch_ids.clear();
+				scratch_nodes.assign(1, root);
+
+				while (!scratch_nodes.empty()) {
+
+					auto node = scratch_nodes.back();
+					scratch_nodes.pop_back();
+
+					if (nodes[node].leaf()) {
+
+						scratch_ids.push_back(nodes[node].first);
+						continue;
+
+					}
+
+					auto pair = nodes[node].first;
+
+					free_pairs.push_back(pair);
+
+					scratch_nodes.push_back(pair);
+					scratch_nodes.push_back(pair + 1);
+
+				}
+
+				build_subtree(bounds, scratch_ids.data(), scratch_ids.size(), root);
+
+				return scratch_ids.size();
+
+			}
+
+			MemoryStats memory_stats() const {
+
+				return Collishi::memory_stats(nodes) + Collishi::memory_stats(parents) + Collishi::memory_stats(leaf_of) + Collishi::memory_stats(free_pairs)
+					+ Collishi::memory_stats(scratch_ids, false) + Collishi::memory_stats(scratch_nodes, false);
+
+			}
+
+		private:
+
+			//! Number of shapes in the subtree of a node, counting stops above limit
+
+			std::size_t subtree_size(std::uint32_t root, std::size_t limit) {
+
+				std::size_t size = 0;
+
+				scratch_nodes.assign(1, root);
+
+				while (!scratch_nodes.empty() && size <= limit) {
+
+					auto node = scratch_nodes.back();
+					scratch_nodes.pop_back();
+
+					if (nodes[node].leaf()) {
+
+						size++;
+						continue;
+
+					}
+
+					scratch_nodes.push_back(nodes[node].first);
+					scratch_nodes.push_back(nodes[node].first + 1);
+
+				}
+
+				return size;
+
+			}
+
+			std::uint32_t allocate_pair() {
+
+				if (!free_pairs.empty()) {
+
+					auto pair = free_pairs.back();
+					free_pairs.pop_back();
+					return pair;
+
+				}
+
+				auto pair = static_cast<std::uint32_t>(nodes.size());
+
+				nodes.resize(nodes.size() + 2);
+				parents.resize(parents.size() + 2, none);
+
+				return pair;
+
+			}
+
+			//! Moves a node to another slot, its children or its shape refer to the new slot afterwards
+
+			void move_node(std::uint32_t from, std::uint32_t to) {
+
+				nodes[to] = nodes[from];
+
+				if (nodes[to].leaf()) {
+
+					leaf_of[nodes[to].first] = to;
+
+				}
+				else {
+
+					parents[nodes[to].first] = to;
+					parents[nodes[to].first + 1] = to;
+
+				}
+
+			}
+
+			void refit(std::uint32_t node) {
+
+				for (; node != none; node = parents[node]) {
+
+					auto first = nodes[node].first;
+					nodes[node].bounds = nodes[first].bounds.merged(nodes[first + 1].bounds);
+
+				}
+
+			}
+
+			void build_subtree(const Bounds* bounds, std::uint32_t* ids, std::size_t count, std::uint32_t root) {
+
+				struct Task {
+
+					std::uint32_t node;
+					std::size_t begin;
+					std::size_t end;
+
+				};
+
+				std::vector<Task> stack = { { root, 0, count } };
+
+				while (!stack.empty()) {
+
+					auto task = stack.back();
+					stack.pop_back();
+
+					if (task.end - task.begin == 1) {
+
+						auto id = ids[task.begin];
+
+						nodes[task.node] = { bounds[id], id, 1 };
+						leaf_of[id] = task.node;
+
+						continue;
+
+					}
+
+					auto node_bounds = bounds[ids[task.begin]];
+					auto center_bounds = Bounds{ node_bounds.center_x(), node_bounds.center_y(), node_bounds.center_x(), node_bounds.center_y() };
+
+					for (auto i = task.begin + 1; i < task.end; i++) {
+
+						auto& shape_bounds = bounds[ids[i]];
+
+						node_bounds = node_bounds.merged(shape_bounds);
+						center_bounds = center_bounds.merged({ shape_bounds.center_x(), shape_bounds.center_y(), shape_bounds.center_x(), shape_bounds.center_y() });
+
+					}
+
+					auto axis = (center_bounds.max_x - center_bounds.min_x >= center_bounds.max_y - center_bounds.min_y ? 0 : 1);
+					auto middle = (task.begin + task.end) / 2;
+
+					Bvh::select_median(bounds, ids, task.begin, middle, task.end, axis);
+
+					auto pair = allocate_pair();
+
+					nodes[task.node] = { node_bounds, pair, 0 };
+					parents[pair] = task.node;
+					parents[pair + 1] = task.node;
+
+					stack.push_back({ pair + 1, middle, task.end });
+					stack.push_back({ pair, task.begin, middle });
+
+				}
+
+			}
+
+			std::vector<std::uint32_t> scratch_ids;
+			std::vector<std::uint32_t> scratch_nodes;
+
+		};
+
+	}
+
+	class EditableBvh {
+
+	public:
+
+		struct Policy {
+
+			//! Levels above a new leaf whose subtree is rebuilt after an insert (a subtree of about 2^levels shapes), 0 disables the rebuilds
+
+			std::size_t local_levels = 4;
+
+			//! Edits relative to the number of shapes after which the whole hierarchy is rebuilt, 0 never rebuilds automatically
+
+			double optimize_after_edits = 0.05;
+
+			//! Rebuilds the whole hierarchy on a background thread instead of during the edit which triggered it
+
+			bool background = true;
+
+		};
+
+		EditableBvh() = default;
+		explicit EditableBvh(const Policy& policy) : policy(policy) {}
+
+		EditableBvh(const EditableBvh& other) = delete;
+		EditableBvh& operator=(const EditableBvh& other) = delete;
+
+		~EditableBvh() {
+
+			if (optimization) optimization->thread.join();
+
+		}
+
+		//! Builds the hierarchy over the shapes, the index of every shape is its id
+
+		void build(const std::vector<Shape>& shapes) {
+
+			cancel_optimization();
+
+			shape_values = shapes;
+			shape_bounds.resize(shapes.size());
+			alive.assign(shapes.size(), 1);
+			free_ids.clear();
+
+			for (std::size_t i = 0; i < shapes.size(); i++) shape_bounds[i] = bounds(shapes[i]);
+
+			update_identity();
+
+			tree.build(shape_bounds.data(), alive_ids(), shape_bounds.size());
+
+			built = bvh_quality(tree.nodes.data());
+			edits_since_build = 0;
+			edit_stats.full_rebuilds++;
+
+		}
+
+		//! Adds a shape and returns its id, ids of removed shapes are reused
+
+		std::uint32_t insert(const Shape& shape) {
+
+			finish_optimization();
+
+			std::uint32_t id;
+
+			if (!free_ids.empty()) {
+
+				id = free_ids.back();
+				free_ids.pop_back();
+
+			}
+			else {
+
+				id = static_cast<std::uint32_t>(shape_values.size());
+
+				shape_values.emplace_back();
+				shape_bounds.emplace_back();
+				alive.push_back(0);
+
+				update_identity();
+
+			}
+
+			shape_values[id] = shape;
+			shape_bounds[id] = bounds(shape);
+			alive[id] = 1;
+
+			insert_leaf(id);
+
+			edit_stats.inserts++;
+			edited(id);
+
+			return id;
+
+		}
+
+		//! Removes a shape, returns false if there is no shape with this id
+
+		bool remove(std::uint32_t id) {
+
+			finish_optimization();
+
+			if (!contains(id)) return false;
+
+			tree.remove(id);
+
+			alive[id] = 0;
+			free_ids.push_back(id);
+
+			edit_stats.removes++;
+			edited(id);
+
+			return true;
+
+		}
+
+		//! Replaces a shape, returns false if there is no shape with this id
+
+		bool modify(std::uint32_t id, const Shape& shape) {
+
+			finish_optimization();
+
+			if (!contains(id)) return false;
+
+			shape_values[id] = shape;
+			shape_bounds[id] = bounds(shape);
+
+			auto& parent = tree.parent_bounds(id);
+			auto& moved = shape_bounds[id];
+
+			if (moved.min_x >= parent.min_x && moved.min_y >= parent.min_y && moved.max_x <= parent.max_x && moved.max_y <= parent.max_y) {
+
+				tree.update_leaf(shape_bounds.data(), id);
+				edit_stats.refits++;
+
+			}
+			else {
+
+				tree.remove(id);
+				insert_leaf(id);
+
+			}
+
+			edit_stats.modifies++;
+			edited(id);
+
+			return true;
+
+		}
+
+		bool contains(std::uint32_t id) const {
+
+			return id < alive.size() && alive[id] != 0;
+
+		}
+
+		const Shape& shape(std::uint32_t id) const {
+
+			return shape_values[id];
+
+		}
+
+		//! Number of shapes
+
+		std::size_t size() const {
+
+			return tree.leaf_count;
+
+		}
+
+		//! Calls function(id) for every shape whose bounds overlap query and counts the work into query_stats()
+
+		template <class F> void for_each_candidate(const Bounds& query, F&& function, CostTag tag = {}) {
+
+			Tags::Measurement measurement(tag);
+
+			auto nodes_before = stats.nodes_visited;
+
+			query_bvh(tree.nodes.data(), identity.data(), shape_bounds.data(), query, stats, function);
+
+			Tags::Measurement::add_nodes(stats.nodes_visited - nodes_before);
+
+		}
+
+		template <class F> void for_each_collision(const Shape& shape, F&& function, CostTag tag = {}) {
+
+			Tags::Measurement measurement(tag);
+
+			std::size_t tests = 0;
+
+			for_each_candidate(bounds(shape), [&](std::uint32_t id) {
+
+				tests++;
+
+				auto hit = collision(shape_values[id], shape);
+
+				COLLISHI_METRICS_COUNT(select_routine(shape_values[id].type, shape.type).routine, 1, hit);
+
+				if (hit) function(id);
+
+			});
+
+			Tags::Measurement::add_tests(tests);
+
+		}
+
+		//! Rebuilds the whole hierarchy on the calling thread
+
+		void optimize() {
+
+			cancel_optimization();
+
+			tree.build(shape_bounds.data(), alive_ids(), shape_bounds.size());
+
+			built = bvh_quality(tree.nodes.data());
+			edits_since_build = 0;
+			edit_stats.full_rebuilds++;
+
+		}
+
+		//! Starts rebuilding the whole hierarchy on a background thread, returns false if a rebuild is already running
+
+		bool start_optimization() {
+
+			if (optimization) return false;
+
+			optimization = std::make_unique<Optimization>();
+
+			auto job = optimization.get();
+
+			job->bounds = shape_bounds;
+			job->ids = alive_ids();
+
+			job->thread = std::thread([job]() {
+
+				job->tree.build(job->bounds.data(), job->ids, job->bounds.size());
+				job->quality = bvh_quality(job->tree.nodes.data());
+				job->done.store(true, std::memory_order_release);
+
+			});
+
+			return true;
+
+		}
+
+		//! Replaces the hierarchy by the one of the background rebuild if it is finished (or waits for it)
+		//! The edits made since the rebuild started are applied to the new hierarchy first, returns true if it was replaced
+
+		bool finish_optimization(bool wait = false) {
+
+			if (!optimization || (!wait && !optimization->done.load(std::memory_order_acquire))) return false;
+
+			optimization->thread.join();
+
+			auto replaced = std::move(optimization->tree);
+			auto edits = std::move(optimization->edits);
+			auto quality = optimization->quality;
+
+			optimization.reset();
+
+			std::sort(edits.begin(), edits.end());
+			edits.erase(std::unique(edits.begin(), edits.end()), edits.end());
+
+			EditStats replay_stats;
+			std::size_t depth = 0;
+
+			//! All edited shapes are removed before any is inserted, since local rebuilds read the current bounds of every shape in their subtree
+
+			for (auto id : edits) {
+
+				if (replaced.contains(id)) replaced.remove(id);
+
+			}
+
+			for (auto id : edits) {
+
+				if (contains(id)) depth = std::max(depth, replaced.insert(shape_bounds.data(), id, policy.local_levels, replay_stats));
+
+			}
+
+			tree = std::move(replaced);
+
+			if (depth > EditableTree::max_depth) {
+
+				optimize();
+				return true;
+
+			}
+
+			built = quality;
+			edits_since_build = edits.size();
+			edit_stats.background_rebuilds++;
+
+			return true;
+
+		}
+
+		bool optimizing() const {
+
+			return optimization != nullptr;
+
+		}
+
+		//! Quality right after the last full rebuild (for a background rebuild, before the edits made meanwhile were applied)
+
+		const BvhQuality& built_quality() const {
+
+			return built;
+
+		}
+
+		//! Computes the quality now (a pass over all nodes)
+
+		BvhQuality measure_quality() const {
+
+			return bvh_quality(tree.nodes.data());
+
+		}
+
+		const EditStats& edits() const {
+
+			return edit_stats;
+
+		}
+
+		const BvhQueryStats& query_stats() const {
+
+			return stats;
+
+		}
+
+		void reset_query_stats() {
+
+			stats = {};
+
+		}
+
+		MemoryStats memory_stats() const {
+
+			auto result = Collishi::memory_stats(shape_values) + Collishi::memory_stats(shape_bounds) + Collishi::memory_stats(alive) + Collishi::memory_stats(free_ids)
+				+ Collishi::memory_stats(identity) + tree.memory_stats();
+
+			if (optimization) result += Collishi::memory_stats(optimization->bounds) + Collishi::memory_stats(optimization->ids) + optimization->tree.memory_stats() + Collishi::memory_stats(optimization->edits);
+
+			return result;
+
+		}
+
+	private:
+
+		//! Full rebuild on a background thread, which only reads its own copy of the bounds
+
+		struct Optimization {
+
+			std::thread thread;
+			std::atomic<bool> done{ false };
+
+			std::vector<Bounds> bounds;
+			std::vector<std::uint32_t> ids;
+			EditableTree::Tree tree;
+			BvhQuality quality = {};
+
+			//! Ids edited since the copy was made
+
+			std::vector<std::uint32_t> edits;
+
+		};
+
+		void insert_leaf(std::uint32_t id) {
+
+			auto depth = tree.insert(shape_bounds.data(), id, policy.local_levels, edit_stats);
+
+			if (depth > EditableTree::max_depth) optimize();
+
+		}
+
+		//! Counts an edit, records it for a running background rebuild and starts a rebuild when the policy asks for it
+
+		void edited(std::uint32_t id) {
+
+			if (optimization) optimization->edits.push_back(id);
+
+			edits_since_build++;
+
+			if (policy.optimize_after_edits <= 0.0 || optimization) return;
+			if (static_cast<double>(edits_since_build) < std::max(1.0, policy.optimize_after_edits * static_cast<double>(size()))) return;
+
+			if (policy.background) start_optimization();
+			else optimize();
+
+		}
+
+		void cancel_optimization() {
+
+			if (!optimization) return;
+
+			optimization->thread.join();
+			optimization.reset();
+
+		}
+
+		std::vector<std::uint32_t> alive_ids() const {
+
+			std::vector<std::uint32_t> ids;
+			ids.reserve(size());
+
+			for (std::uint32_t id = 0; id < alive.size(); id++) {
+
+				if (alive[id]) ids.push_back(id);
+
+			}
+
+			return ids;
+
+		}
+
+		//! Leaves refer to their id directly, query_bvh needs an index array for that
+
+		void update_identity() {
+
+			for (auto id = static_cast<std::uint32_t>(identity.size()); id < shape_values.size(); id++) identity.push_back(id);
+
+			identity.resize(shape_values.size());
+
+		}
+
+		Policy policy;
+
+		std::vector<Shape> shape_values;
+		std::vector<Bounds> shape_bounds;
+		std::vector<std::uint8_t> alive;
+		std::vector<std::uint32_t> free_ids;
+		std::vector<std::uint32_t> identity;
+
+		EditableTree::Tree tree;
+		std::unique_ptr<Optimization> optimization;
+
+		BvhQuality built = {};
+		BvhQueryStats stats = {};
+		EditStats edit_stats;
+
+		std::size_t edits_since_build = 0;
+
+	};
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+static_assert(Collishi::EditableTree::sibling(1) == 2 && Collishi::EditableTree::sibling(2) == 1 && Collishi::EditableTree::sibling(5) == 6);
+static_assert(Collishi::EditableTree::max_depth + 1 < Collishi::bvh_max_depth);
+
+#endif
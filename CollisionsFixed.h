@@ -0,0 +1,184 @@
+#pragma once
+
+//! Overloads for shapes whose dimensions are known at compile time, e.g. 16 x 16 tiles or bullets with radius 8
+//! The dimensions are given by shape descriptor types, since C++17 does not allow float template parameters
+//! A descriptor is any type with static constexpr float members w and h (boxes) or r (circles):
+//!
+//! struct PlayerHitbox { static constexpr float w = 12.5f; static constexpr float h = 30.0f; };
+//!
+//! FixedBox and FixedCircle describe sizes given as fractions of integers
+//! The overloads call the regular routines with the constant dimensions, so the results are identical,
+//! but the compiler can fold the constants into the tests (e.g. r1 + r2 of two fixed circles)
+//! and the batch kernels do not need to load the dimensions from memory
+//! Like the regular batch kernels, the batch and all_pairs overloads take a CostTag and count into the live metrics
+
+#include "Collisions.h"
+#include "CollisionsBatch.h"
+#include "CollisionsRoutines.h"
+#include "CollisionsTags.h"
+#include "CollisionsTrace.h"
+
+namespace Collishi {
+
+	//! Box with the size W / Denominator x H / Denominator
+
+	template <int W, int H = W, int Denominator = 1> struct FixedBox {
+
+		static constexpr float w = static_cast<float>(W) / static_cast<float>(Denominator);
+		static constexpr float h = static_cast<float>(H) / static_cast<float>(Denominator);
+
+	};
+
+	//! Circle with the radius R / Denominator
+
+	template <int R, int Denominator = 1> struct FixedCircle {
+
+		static constexpr float r = static_cast<float>(R) / static_cast<float>(Denominator);
+
+	};
+
+	//! Both boxes with fixed sizes, e.g. collision_box_box<Tile, Tile>(x1, y1, x2, y2)
+
+	template <class Box1, class Box2> constexpr bool collision_box_box(float x1, float y1, float x2, float y2) {
+
+		return collision_box_box(x1, y1, Box1::w, Box1::h, x2, y2, Box2::w, Box2::h);
+
+	}
+
+	//! Only the first box with a fixed size
+
+	template <class Box1> constexpr bool collision_box_box(float x1, float y1, float x2, float y2, float w2, float h2) {
+
+		return collision_box_box(x1, y1, Box1::w, Box1::h, x2, y2, w2, h2);
+
+	}
+
+	template <class Circle1, class Circle2> constexpr bool collision_circle_circle(float x1, float y1, float x2, float y2) {
+
+		return collision_circle_circle(x1, y1, Circle1::r, x2, y2, Circle2::r);
+
+	}
+
+	template <class Circle1> constexpr bool collision_circle_circle(float x1, float y1, float x2, float y2, float r2) {
+
+		return collision_circle_circle(x1, y1, Circle1::r, x2, y2, r2);
+
+	}
+
+	//! Batch versions in the layout of invoke_routine_batch without the fixed dimensions,
+	//! so positions holds x1, y1, x2, y2 of every pair consecutively
+	//! The tests are the ones of the regular routines, but without early returns, so the compiler can vectorize the loops
+
+	template <class Box1, class Box2> inline void collision_box_box_batch(const float* positions, std::size_t count, bool* results, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_box_box (fixed)");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(count);
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			auto x1 = positions[4 * i];
+			auto y1 = positions[4 * i + 1];
+			auto x2 = positions[4 * i + 2];
+			auto y2 = positions[4 * i + 3];
+
+			results[i] = !((x1 + Box1::w < x2) | (y1 + Box1::h < y2) | (x2 + Box2::w < x1) | (y2 + Box2::h < y1));
+
+		}
+
+		COLLISHI_METRICS_COUNT_RESULTS(Routine::box_box, results, count);
+
+	}
+
+	template <class Circle1, class Circle2> inline void collision_circle_circle_batch(const float* positions, std::size_t count, bool* results, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_circle_circle (fixed)");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(count);
+
+		constexpr auto combined_radius = Circle1::r + Circle2::r;
+		constexpr auto combined_radius_squared = combined_radius * combined_radius;
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			auto dx = positions[4 * i] - positions[4 * i + 2];
+			auto dy = positions[4 * i + 1] - positions[4 * i + 3];
+
+			results[i] = !(dx * dx + dy * dy > combined_radius_squared);
+
+		}
+
+		COLLISHI_METRICS_COUNT_RESULTS(Routine::circle_circle, results, count);
+
+	}
+
+	//! collision_box_box_all_pairs for two groups of boxes with fixed sizes, of which only the positions are stored
+
+	template <class Box1, class Box2> inline void collision_box_box_all_pairs(const PointArrays& first, const PointArrays& second, std::vector<Pair>& pairs, unsigned threads = 0, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_box_box_all_pairs (fixed)");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(first.count * second.count);
+
+		[[maybe_unused]] auto pairs_before = pairs.size();
+
+		Batch::TileBounds first_bounds(first, Box1::w, Box1::h);
+		Batch::TileBounds second_bounds(second, Box2::w, Box2::h);
+
+		Batch::box_box_all_pairs(first_bounds, first.count, second_bounds, second.count, false, pairs, threads);
+
+		COLLISHI_METRICS_COUNT(Routine::box_box, first.count * second.count, pairs.size() - pairs_before);
+
+	}
+
+	template <class Box> inline void collision_box_box_all_pairs(const PointArrays& positions, std::vector<Pair>& pairs, unsigned threads = 0, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", "collision_box_box_all_pairs (fixed)");
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(positions.count * (positions.count > 0 ? positions.count - 1 : 0) / 2);
+
+		[[maybe_unused]] auto pairs_before = pairs.size();
+
+		Batch::TileBounds bounds(positions, Box::w, Box::h);
+
+		Batch::box_box_all_pairs(bounds, positions.count, bounds, positions.count, true, pairs, threads);
+
+		COLLISHI_METRICS_COUNT(Routine::box_box, positions.count * (positions.count > 0 ? positions.count - 1 : 0) / 2, pairs.size() - pairs_before);
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::FixedAssertions {
+
+	struct Player {
+
+		static constexpr float w = 6.0f;
+		static constexpr float h = 8.0f;
+
+	};
+
+	using Tile = FixedBox<4>;
+	using Pixel = FixedBox<1, 1, 2>;
+	using Bullet = FixedCircle<3, 2>;
+
+}
+
+static_assert(Collishi::FixedAssertions::Pixel::w == 0.5f);
+static_assert(Collishi::FixedAssertions::Bullet::r == 1.5f);
+
+static_assert(true == Collishi::collision_box_box<Collishi::FixedAssertions::Player, Collishi::FixedAssertions::Tile>(-2.0f, -2.0f, 2.5f, 5.5f));
+static_assert(false == Collishi::collision_box_box<Collishi::FixedAssertions::Player, Collishi::FixedAssertions::Pixel>(-2.0f, -2.0f, 4.1f, 6.1f));
+static_assert(true == Collishi::collision_box_box<Collishi::FixedAssertions::Player>(-2.0f, -2.0f, 2.5f, 5.5f, 4.0f, 4.0f));
+
+static_assert(true == Collishi::collision_circle_circle<Collishi::FixedAssertions::Bullet, Collishi::FixedAssertions::Bullet>(0.0f, 0.0f, 3.0f, 0.0f));
+static_assert(false == Collishi::collision_circle_circle<Collishi::FixedAssertions::Bullet, Collishi::FixedAssertions::Bullet>(0.0f, 0.0f, 2.2f, 2.2f));
+static_assert(true == Collishi::collision_circle_circle<Collishi::FixedAssertions::Bullet>(0.0f, 0.0f, 2.2f, 2.2f, 2.0f));
+
+#endif
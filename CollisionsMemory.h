@@ -0,0 +1,164 @@
+#pragma once
+
+//! Memory accounting of the Collishi data structures
+//! Every container with heap memory (broadphase buffers, capture logs, trace buffers, profiles, variant registries)
+//! reports a MemoryStats through memory_stats(), and MemoryReport sums named entries, e.g. for all rooms of a server:
+//!
+//! Collishi::MemoryReport report;
+//! for (auto& room : rooms) report.add(room.name.c_str(), room.broadphase.memory_stats());
+//! report.write_text(stdout);
+//!
+//! Only heap memory is counted, not the size of the objects themselves and not the overhead of the allocator
+//! Mapped files and shared memory segments report their mapped bytes as used and reserved, although they are no heap memory
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Collishi {
+
+	struct MemoryStats {
+
+		//! Bytes of the elements which are currently stored
+
+		std::size_t used = 0;
+
+		//! Bytes allocated, including the used bytes and the spare capacity
+
+		std::size_t reserved = 0;
+
+		//! Part of the reserved bytes which the container keeps, but does not need in its current state
+		//! (e.g. the buffers of a broadphase strategy which is not used anymore), release_unused() frees them where available
+
+		std::size_t wasted = 0;
+
+		constexpr MemoryStats& operator+=(const MemoryStats& other) {
+
+			used += other.used;
+			reserved += other.reserved;
+			wasted += other.wasted;
+
+			return *this;
+
+		}
+
+		constexpr std::size_t spare() const {
+
+			return reserved - used;
+
+		}
+
+	};
+
+	constexpr MemoryStats operator+(MemoryStats a, const MemoryStats& b) {
+
+		return a += b;
+
+	}
+
+	template <class T> MemoryStats memory_stats(const std::vector<T>& elements) {
+
+		return { elements.size() * sizeof(T), elements.capacity() * sizeof(T), 0 };
+
+	}
+
+	//! The whole allocation of a buffer which is not needed in the current state counts as wasted
+
+	template <class T> MemoryStats memory_stats(const std::vector<T>& elements, bool needed) {
+
+		auto stats = memory_stats(elements);
+		if (!needed) stats.wasted = stats.reserved;
+
+		return stats;
+
+	}
+
+	//! Frees the allocation of the vector, clear() alone keeps the capacity
+
+	template <class T> void release_memory(std::vector<T>& elements) {
+
+		std::vector<T>().swap(elements);
+
+	}
+
+	//! Named memory statistics and their sum
+
+	class MemoryReport {
+
+	public:
+
+		struct Entry {
+
+			std::string name;
+			MemoryStats stats;
+
+		};
+
+		void add(const char* name, const MemoryStats& stats) {
+
+			entries_list.push_back({ name, stats });
+			sum += stats;
+
+		}
+
+		const std::vector<Entry>& entries() const {
+
+			return entries_list;
+
+		}
+
+		const MemoryStats& total() const {
+
+			return sum;
+
+		}
+
+		void clear() {
+
+			entries_list.clear();
+			sum = {};
+
+		}
+
+		//! One line "<name> <used> <reserved> <wasted>" per entry and a line for the total
+
+		void write_text(std::FILE* file) const {
+
+			std::fprintf(file, "%-40s %14s %14s %14s\n", "Entry", "Used bytes", "Reserved bytes", "Wasted bytes");
+
+			for (auto& entry : entries_list) print(file, entry.name.c_str(), entry.stats);
+
+			print(file, "total", sum);
+
+		}
+
+	private:
+
+		static void print(std::FILE* file, const char* name, const MemoryStats& stats) {
+
+			std::fprintf(file, "%-40s %14zu %14zu %14zu\n", name, stats.used, stats.reserved, stats.wasted);
+
+		}
+
+		std::vector<Entry> entries_list;
+		MemoryStats sum;
+
+	};
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::MemoryAssertions {
+
+	constexpr MemoryStats sum = MemoryStats{ 10, 16, 0 } + MemoryStats{ 0, 64, 64 };
+
+	static_assert(sum.used == 10);
+	static_assert(sum.reserved == 80);
+	static_assert(sum.wasted == 64);
+	static_assert(sum.spare() == 70);
+
+}
+
+#endif
@@ -0,0 +1,509 @@
+#pragma once
+
+//! Live metrics of a running program in a POSIX shared memory segment, so they can be watched without attaching a profiler
+//! If COLLISHI_METRICS is defined before including any Collishi header, the batch calls, the broadphases and the DynamicBvh
+//! queries count the tests and hits per routine into counters per thread
+//! The counters of a thread which exits are added to a total, and its slot is reused by the next thread (see CollisionsThreadSlots.h)
+//! Once per frame, MetricsExporter::publish_frame writes these totals, the costs per tag of the frame (see CollisionsTags.h)
+//! and a memory total into a ring of samples in shared memory:
+//!
+//! Collishi::MetricsExporter exporter;
+//! if (!exporter.open("/collishi-metrics")) std::fprintf(stderr, "No metrics\n");
+//! exporter.publish_frame(report.total()); // at the end of every frame
+//!
+//! tools/metrics_reader.cpp reads the segment from another process and prints the rates
+//! The exporter takes no locks, a reader detects samples which were overwritten while it copied them (sequence lock)
+//! Only one exporter may write to a segment, the segment is removed when the exporter is closed
+//!
+//! Without COLLISHI_METRICS, the counting hooks expand to nothing and the samples only contain the tag costs and the memory
+
+#include "CollisionsMemory.h"
+#include "CollisionsRoutines.h"
+#include "CollisionsSharedMemory.h"
+#include "CollisionsTags.h"
+#include "CollisionsThreadSlots.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace Collishi {
+
+	struct RoutineMetrics {
+
+		std::uint64_t tests;
+		std::uint64_t hits;
+
+	};
+
+	struct PhaseMetrics {
+
+		char name[32];
+		TagCosts costs;
+
+	};
+
+	constexpr std::size_t max_metrics_phases = 32;
+
+	//! One sample of the segment, the routine counters are totals since the start of the program, the phases are the costs of one frame
+
+	struct MetricsSample {
+
+		std::uint64_t frame;
+		std::uint64_t steady_nanoseconds;
+
+		RoutineMetrics routines[routine_count];
+
+		std::uint32_t phase_count;
+		PhaseMetrics phases[max_metrics_phases];
+
+		std::uint64_t memory_used;
+		std::uint64_t memory_reserved;
+		std::uint64_t memory_wasted;
+
+	};
+
+	namespace Metrics {
+
+		//! Counters of one thread, only the owning thread writes
+
+		class ThreadCounters {
+
+		public:
+
+			void add(Routine routine, std::uint64_t tests, std::uint64_t hits) {
+
+				auto& routine_counters = counters[static_cast<std::size_t>(routine)];
+
+				routine_counters[0].store(routine_counters[0].load(std::memory_order_relaxed) + tests, std::memory_order_relaxed);
+				routine_counters[1].store(routine_counters[1].load(std::memory_order_relaxed) + hits, std::memory_order_relaxed);
+
+			}
+
+			RoutineMetrics get(Routine routine) const {
+
+				auto& routine_counters = counters[static_cast<std::size_t>(routine)];
+
+				return { routine_counters[0].load(std::memory_order_relaxed), routine_counters[1].load(std::memory_order_relaxed) };
+
+			}
+
+			void clear() {
+
+				for (auto& routine_counters : counters) {
+
+					for (auto& counter : routine_counters) counter.store(0, std::memory_order_relaxed);
+
+				}
+
+			}
+
+		private:
+
+			std::array<std::array<std::atomic<std::uint64_t>, 2>, routine_count> counters{};
+
+		};
+
+		class Registry {
+
+		public:
+
+			//! Counters of the threads which exited are added to the retired totals, so their slots can be reused
+
+			ThreadSlots<ThreadCounters> counters{ [this](ThreadCounters& exited) {
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				for (std::size_t r = 0; r < routine_count; r++) {
+
+					auto values = exited.get(static_cast<Routine>(r));
+
+					retired[r].tests += values.tests;
+					retired[r].hits += values.hits;
+
+				}
+
+				exited.clear();
+
+			} };
+
+			std::array<RoutineMetrics, routine_count> totals() {
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				auto result = retired;
+
+				counters.for_each([&](const ThreadCounters& thread_counters) {
+
+					for (std::size_t r = 0; r < routine_count; r++) {
+
+						auto values = thread_counters.get(static_cast<Routine>(r));
+
+						result[r].tests += values.tests;
+						result[r].hits += values.hits;
+
+					}
+
+				});
+
+				return result;
+
+			}
+
+			MemoryStats memory_stats() {
+
+				auto size = counters.size() * sizeof(ThreadCounters);
+
+				return counters.memory_stats() + MemoryStats{ size, size, 0 };
+
+			}
+
+		private:
+
+			std::mutex mutex;
+			std::array<RoutineMetrics, routine_count> retired{};
+
+		};
+
+		inline Registry& registry() {
+
+			static Registry instance;
+			return instance;
+
+		}
+
+		inline ThreadCounters& thread_counters() {
+
+			thread_local ThreadSlot<ThreadCounters> counters(registry().counters);
+			return *counters;
+
+		}
+
+		inline void count(Routine routine, std::uint64_t tests, std::uint64_t hits) {
+
+			thread_counters().add(routine, tests, hits);
+
+		}
+
+		inline void count_results(Routine routine, const bool* results, std::size_t count) {
+
+			std::uint64_t hits = 0;
+
+			for (std::size_t i = 0; i < count; i++) hits += results[i];
+
+			thread_counters().add(routine, count, hits);
+
+		}
+
+		//! Tests and hits per routine since the start of the program, summed over all threads
+
+		inline std::array<RoutineMetrics, routine_count> totals() {
+
+			return registry().totals();
+
+		}
+
+		inline MemoryStats memory_stats() {
+
+			return registry().memory_stats();
+
+		}
+
+		//! Layout of the shared memory segment: the header, followed by slot_count slots
+		//! A slot is written while its sequence is odd, a reader copies the sample and accepts it if the sequence
+		//! was 2 * (index + 1) before and after the copy
+
+		constexpr std::uint32_t segment_magic = 0x4d534c43; // "CLSM"
+		constexpr std::uint32_t segment_version = 1;
+
+		struct SegmentHeader {
+
+			std::atomic<std::uint32_t> magic;
+			std::uint32_t version;
+			std::uint32_t slot_count;
+			std::uint32_t sample_size;
+
+			//! Number of samples published so far, the last one is in slot (published - 1) % slot_count
+
+			std::atomic<std::uint64_t> published;
+
+		};
+
+		struct Slot {
+
+			std::atomic<std::uint64_t> sequence;
+			MetricsSample sample;
+
+		};
+
+		inline std::size_t segment_size(std::uint32_t slot_count) {
+
+			return sizeof(SegmentHeader) + slot_count * sizeof(Slot);
+
+		}
+
+		inline Slot* slots(SegmentHeader* header) {
+
+			return reinterpret_cast<Slot*>(header + 1);
+
+		}
+
+		inline std::uint64_t steady_nanoseconds() {
+
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+
+		}
+
+	}
+
+	constexpr const char* default_metrics_name = "/collishi-metrics";
+
+	//! Writes samples into a shared memory segment, all functions have to be called from the same thread
+
+	class MetricsExporter {
+
+	public:
+
+		MetricsExporter() = default;
+		MetricsExporter(const MetricsExporter& other) = delete;
+		MetricsExporter& operator=(const MetricsExporter& other) = delete;
+
+		~MetricsExporter() {
+
+			close();
+
+		}
+
+		//! Creates (or replaces) the segment with room for slot_count samples, returns false if it could not be created
+
+		bool open(const char* name = default_metrics_name, std::uint32_t slot_count = 64) {
+
+			close();
+
+			if (slot_count == 0 || !segment.create(name, Metrics::segment_size(slot_count))) return false;
+
+			//! The new segment is zero filled, so all sequences are 0 and the magic is written last
+
+			header = static_cast<Metrics::SegmentHeader*>(segment.data());
+			header->version = Metrics::segment_version;
+			header->slot_count = slot_count;
+			header->sample_size = sizeof(MetricsSample);
+			header->magic.store(Metrics::segment_magic, std::memory_order_release);
+
+			published = 0;
+
+			return true;
+
+		}
+
+		//! Unmaps and removes the segment, readers which still map it keep the last samples
+
+		void close() {
+
+			segment.close();
+			header = nullptr;
+
+		}
+
+		bool is_open() const {
+
+			return header != nullptr;
+
+		}
+
+		void publish(const MetricsSample& sample) {
+
+			if (!header) return;
+
+			auto& slot = Metrics::slots(header)[published % header->slot_count];
+
+			slot.sequence.store(2 * published + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			std::memcpy(&slot.sample, &sample, sizeof(MetricsSample));
+
+			slot.sequence.store(2 * published + 2, std::memory_order_release);
+			header->published.store(++published, std::memory_order_release);
+
+		}
+
+		//! Publishes the routine totals, the tag costs of the frame, which ends it (see end_cost_frame), and the memory total
+
+		void publish_frame(const MemoryStats& memory = {}) {
+
+			publish(make_sample(end_cost_frame(), memory));
+
+		}
+
+		MetricsSample make_sample(const std::vector<TagFrameCosts>& phases, const MemoryStats& memory) {
+
+			MetricsSample sample = {};
+
+			sample.frame = frames++;
+			sample.steady_nanoseconds = Metrics::steady_nanoseconds();
+
+			auto totals = Metrics::totals();
+
+			for (std::size_t r = 0; r < routine_count; r++) sample.routines[r] = totals[r];
+
+			//! The phases beyond max_metrics_phases are dropped, the tags with the most calls are usually registered first
+
+			for (auto& phase : phases) {
+
+				if (sample.phase_count == max_metrics_phases) break;
+
+				auto& entry = sample.phases[sample.phase_count++];
+
+				std::strncpy(entry.name, phase.name, sizeof(entry.name) - 1);
+				entry.costs = phase.costs;
+
+			}
+
+			sample.memory_used = memory.used;
+			sample.memory_reserved = memory.reserved;
+			sample.memory_wasted = memory.wasted;
+
+			return sample;
+
+		}
+
+	private:
+
+		SharedMemory segment;
+		Metrics::SegmentHeader* header = nullptr;
+
+		std::uint64_t published = 0;
+		std::uint64_t frames = 0;
+
+	};
+
+	//! Reads the samples of a segment written by a MetricsExporter, usually in another process
+
+	class MetricsReader {
+
+	public:
+
+		MetricsReader() = default;
+		MetricsReader(const MetricsReader& other) = delete;
+		MetricsReader& operator=(const MetricsReader& other) = delete;
+
+		~MetricsReader() {
+
+			close();
+
+		}
+
+		//! Returns false if the segment does not exist (yet) or was written by an incompatible version
+
+		bool open(const char* name = default_metrics_name) {
+
+			close();
+
+			if (!segment.open(name, false)) return false;
+
+			auto mapped = static_cast<const Metrics::SegmentHeader*>(segment.data());
+
+			if (segment.size() < sizeof(Metrics::SegmentHeader) || mapped->magic.load(std::memory_order_acquire) != Metrics::segment_magic || mapped->version != Metrics::segment_version
+				|| mapped->sample_size != sizeof(MetricsSample) || mapped->slot_count == 0 || Metrics::segment_size(mapped->slot_count) > segment.size()) {
+
+				segment.close();
+				return false;
+
+			}
+
+			header = mapped;
+
+			return true;
+
+		}
+
+		void close() {
+
+			segment.close();
+			header = nullptr;
+
+		}
+
+		bool is_open() const {
+
+			return header != nullptr;
+
+		}
+
+		//! Number of samples published so far
+
+		std::uint64_t published() const {
+
+			return (header ? header->published.load(std::memory_order_acquire) : 0);
+
+		}
+
+		std::uint32_t slot_count() const {
+
+			return (header ? header->slot_count : 0);
+
+		}
+
+		//! Copies sample number index, returns false if it was not published yet, was overwritten or is being written
+
+		bool read(std::uint64_t index, MetricsSample& sample) const {
+
+			if (!header) return false;
+
+			auto& slot = Metrics::slots(const_cast<Metrics::SegmentHeader*>(header))[index % header->slot_count];
+			auto expected = 2 * index + 2;
+
+			if (slot.sequence.load(std::memory_order_acquire) != expected) return false;
+
+			std::memcpy(&sample, &slot.sample, sizeof(MetricsSample));
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			return slot.sequence.load(std::memory_order_relaxed) == expected;
+
+		}
+
+		//! Copies the newest sample, returns false if there is none
+
+		bool latest(MetricsSample& sample) const {
+
+			//! A failed read means the exporter overwrote the slot meanwhile, so a newer sample exists
+
+			for (int attempt = 0; attempt < 16; attempt++) {
+
+				auto count = published();
+				if (count == 0) return false;
+
+				if (read(count - 1, sample)) return true;
+
+			}
+
+			return false;
+
+		}
+
+	private:
+
+		SharedMemory segment;
+		const Metrics::SegmentHeader* header = nullptr;
+
+	};
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::MetricsAssertions {
+
+	static_assert(std::is_trivially_copyable_v<MetricsSample>);
+	static_assert(std::is_standard_layout_v<Metrics::Slot>);
+	static_assert(sizeof(Metrics::SegmentHeader) % alignof(Metrics::Slot) == 0);
+
+}
+
+#endif
@@ -0,0 +1,711 @@
+#pragma once
+
+//! Partitioning of a large world into regions, which are simulated by different workers (threads or processes)
+//! Every shape is owned by the region containing the center of its bounds. Each tick, the workers exchange ghost copies
+//! of the shapes near the borders, so every worker sees all shapes within ghost_margin around its region:
+//!
+//! Collishi::PartitionLayout layout(world_bounds, 4, 4, 32.0f);     // same layout in every worker
+//! Collishi::RegionWorker worker(layout, region);
+//! worker.set_shape(id, shape);                                       // shapes of this region, moved every tick
+//! worker.exchange(transport);                                        // sends migrating shapes and ghosts, receives the ghosts of the neighbours
+//! worker.for_each_collision(query, [&](std::uint32_t id, const Collishi::Shape& shape, bool owned) { ... });
+//! worker.collide(pairs);                                             // pairs of this tick, every pair is reported by exactly one region
+//!
+//! The results are exact as long as the queries lie within the region expanded by ghost_margin (see RegionWorker::covers)
+//! Shapes larger than the margin are sent to all regions, so they should be rare (e.g. terrain is better kept static in every worker)
+//!
+//! The transport is a template parameter with one function, which delivers the messages of one tick and waits for all regions:
+//! bool exchange(std::uint32_t region, const std::vector<PartitionMessage>& outgoing, std::vector<PartitionMessage>& incoming)
+//! SharedMemoryTransport connects workers on the same machine, a network transport only has to provide the same function
+
+#include "CollisionsBatch.h"
+#include "CollisionsDynamicBvh.h"
+#include "CollisionsMemory.h"
+#include "CollisionsShapes.h"
+#include "CollisionsTrace.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Collishi {
+
+	//! Grid of columns x rows regions, whose borders are given by the split positions along each axis
+
+	class PartitionLayout {
+
+	public:
+
+		//! Regions of equal size
+
+		PartitionLayout(const Bounds& world, std::uint32_t columns, std::uint32_t rows, float ghost_margin) : margin(ghost_margin) {
+
+			for (std::uint32_t c = 1; c < columns; c++) x_splits.push_back(world.min_x + (world.max_x - world.min_x) * c / columns);
+			for (std::uint32_t r = 1; r < rows; r++) y_splits.push_back(world.min_y + (world.max_y - world.min_y) * r / rows);
+
+		}
+
+		//! Regions with the given borders (ascending, columns - 1 and rows - 1 positions), the outer regions are unbounded
+
+		PartitionLayout(std::vector<float> x_splits, std::vector<float> y_splits, float ghost_margin) : x_splits(std::move(x_splits)), y_splits(std::move(y_splits)), margin(ghost_margin) {}
+
+		//! Borders at the quantiles of the shape centers, so every column and every row holds about the same number of shapes
+		//! All workers have to use the same layout, so it should be computed once and sent to them
+
+		static PartitionLayout balanced(const std::vector<Shape>& shapes, std::uint32_t columns, std::uint32_t rows, float ghost_margin) {
+
+			std::vector<float> xs, ys;
+
+			for (auto& shape : shapes) {
+
+				auto shape_bounds = bounds(shape);
+
+				xs.push_back(shape_bounds.center_x());
+				ys.push_back(shape_bounds.center_y());
+
+			}
+
+			return { quantiles(xs, columns), quantiles(ys, rows), ghost_margin };
+
+		}
+
+		std::uint32_t columns() const {
+
+			return static_cast<std::uint32_t>(x_splits.size() + 1);
+
+		}
+
+		std::uint32_t rows() const {
+
+			return static_cast<std::uint32_t>(y_splits.size() + 1);
+
+		}
+
+		std::uint32_t region_count() const {
+
+			return columns() * rows();
+
+		}
+
+		float ghost_margin() const {
+
+			return margin;
+
+		}
+
+		std::uint32_t region_of(float x, float y) const {
+
+			return row_of(y) * columns() + column_of(x);
+
+		}
+
+		std::uint32_t owner(const Shape& shape) const {
+
+			auto shape_bounds = bounds(shape);
+
+			return region_of(shape_bounds.center_x(), shape_bounds.center_y());
+
+		}
+
+		//! Area of the region, the outer regions extend to infinity
+
+		Bounds region_bounds(std::uint32_t region) const {
+
+			auto column = region % columns();
+			auto row = region / columns();
+
+			constexpr auto infinity = std::numeric_limits<float>::infinity();
+
+			return { (column > 0 ? x_splits[column - 1] : -infinity), (row > 0 ? y_splits[row - 1] : -infinity),
+				(column < x_splits.size() ? x_splits[column] : infinity), (row < y_splits.size() ? y_splits[row] : infinity) };
+
+		}
+
+		//! Area in which a worker sees all shapes
+
+		Bounds expanded_bounds(std::uint32_t region) const {
+
+			auto area = region_bounds(region);
+
+			return { area.min_x - margin, area.min_y - margin, area.max_x + margin, area.max_y + margin };
+
+		}
+
+		//! Shapes larger than the margin can collide with shapes outside the expanded area of their region, so they are sent everywhere
+
+		bool oversized(const Bounds& shape_bounds) const {
+
+			return shape_bounds.max_x - shape_bounds.min_x > 2.0f * margin || shape_bounds.max_y - shape_bounds.min_y > 2.0f * margin;
+
+		}
+
+		//! Calls function(region) for every region whose expanded area overlaps the bounds
+
+		template <class F> void for_each_region(const Bounds& area, F&& function) const {
+
+			auto first_column = column_of(area.min_x - margin);
+			auto last_column = column_of(area.max_x + margin);
+			auto first_row = row_of(area.min_y - margin);
+			auto last_row = row_of(area.max_y + margin);
+
+			for (auto row = first_row; row <= last_row; row++) {
+
+				for (auto column = first_column; column <= last_column; column++) {
+
+					auto region = row * columns() + column;
+
+					if (expanded_bounds(region).overlaps(area)) function(region);
+
+				}
+
+			}
+
+		}
+
+	private:
+
+		static std::uint32_t index_of(const std::vector<float>& splits, float value) {
+
+			return static_cast<std::uint32_t>(std::upper_bound(splits.begin(), splits.end(), value) - splits.begin());
+
+		}
+
+		std::uint32_t column_of(float x) const {
+
+			return index_of(x_splits, x);
+
+		}
+
+		std::uint32_t row_of(float y) const {
+
+			return index_of(y_splits, y);
+
+		}
+
+		static std::vector<float> quantiles(std::vector<float>& values, std::uint32_t count) {
+
+			std::vector<float> splits;
+
+			std::sort(values.begin(), values.end());
+
+			for (std::uint32_t i = 1; i < count; i++) splits.push_back(values.empty() ? 0.0f : values[values.size() * i / count]);
+
+			return splits;
+
+		}
+
+		std::vector<float> x_splits;
+		std::vector<float> y_splits;
+		float margin;
+
+	};
+
+	//! A shape sent to another region, either as ghost for this tick or because its owner changes
+
+	struct PartitionMessage {
+
+		enum class Kind : std::uint32_t {
+
+			ghost,
+			migrate
+
+		};
+
+		std::uint32_t region;
+		Kind kind;
+		std::uint32_t id;
+		Shape shape;
+
+	};
+
+	static_assert(std::is_trivially_copyable_v<PartitionMessage>, "Messages are copied into shared memory and network buffers");
+
+	//! The shapes of one region and the ghosts of its neighbours, all functions have to be called from the same thread
+
+	class RegionWorker {
+
+	public:
+
+		RegionWorker(const PartitionLayout& layout, std::uint32_t region) : layout(layout), own_region(region) {}
+
+		std::uint32_t region() const {
+
+			return own_region;
+
+		}
+
+		//! Adds or moves an owned shape, a shape which left the region is sent to its new owner by the next exchange
+		//! The ids have to be unique in the whole world
+
+		void set_shape(std::uint32_t id, const Shape& shape) {
+
+			auto found = owned_index.find(id);
+
+			if (found != owned_index.end()) {
+
+				owned_shapes[found->second] = shape;
+				return;
+
+			}
+
+			owned_index.emplace(id, owned_ids.size());
+			owned_ids.push_back(id);
+			owned_shapes.push_back(shape);
+
+		}
+
+		bool remove_shape(std::uint32_t id) {
+
+			auto found = owned_index.find(id);
+			if (found == owned_index.end()) return false;
+
+			auto index = found->second;
+
+			owned_index.erase(found);
+
+			if (index + 1 < owned_ids.size()) {
+
+				owned_ids[index] = owned_ids.back();
+				owned_shapes[index] = owned_shapes.back();
+				owned_index[owned_ids[index]] = index;
+
+			}
+
+			owned_ids.pop_back();
+			owned_shapes.pop_back();
+
+			return true;
+
+		}
+
+		std::size_t owned_count() const {
+
+			return owned_ids.size();
+
+		}
+
+		std::size_t ghost_count() const {
+
+			return visible_ids.size() - owned_ids.size();
+
+		}
+
+		template <class F> void for_each_owned(F&& function) const {
+
+			for (std::size_t i = 0; i < owned_ids.size(); i++) function(owned_ids[i], owned_shapes[i]);
+
+		}
+
+		//! Sends the shapes which left the region to their new owners and the ghosts to the neighbours, receives
+		//! the shapes of this tick from the other regions and rebuilds the hierarchy over the owned shapes and the ghosts
+		//! Returns false if the transport failed, then the ghosts of the last tick are kept
+		//! Migrations may then have been applied by some regions only, see the transport for which failures are fatal
+
+		template <class Transport> bool exchange(Transport& transport) {
+
+			COLLISHI_TRACE_SCOPE("partition", "exchange");
+
+			outgoing.clear();
+			local_ghosts.clear();
+
+			for (std::size_t i = 0; i < owned_ids.size(); i++) {
+
+				auto& shape = owned_shapes[i];
+				auto shape_bounds = bounds(shape);
+				auto owner = layout.region_of(shape_bounds.center_x(), shape_bounds.center_y());
+
+				if (owner != own_region) outgoing.push_back({ owner, PartitionMessage::Kind::migrate, owned_ids[i], shape });
+
+				//! The ghosts of a migrating shape are still sent by this region, since the new owner only receives it now
+
+				auto send_ghost = [&](std::uint32_t region) {
+
+					if (region == owner) return;
+
+					if (region == own_region) local_ghosts.push_back({ region, PartitionMessage::Kind::ghost, owned_ids[i], shape });
+					else outgoing.push_back({ region, PartitionMessage::Kind::ghost, owned_ids[i], shape });
+
+				};
+
+				if (layout.oversized(shape_bounds)) {
+
+					for (std::uint32_t region = 0; region < layout.region_count(); region++) send_ghost(region);
+
+				}
+				else layout.for_each_region(shape_bounds, send_ghost);
+
+			}
+
+			if (!transport.exchange(own_region, outgoing, incoming)) return false;
+
+			for (auto& message : outgoing) {
+
+				if (message.kind == PartitionMessage::Kind::migrate) remove_shape(message.id);
+
+			}
+
+			for (auto& message : incoming) {
+
+				if (message.kind == PartitionMessage::Kind::migrate) set_shape(message.id, message.shape);
+
+			}
+
+			rebuild();
+
+			return true;
+
+		}
+
+		//! Whether queries within the area find all shapes, i.e. it lies within the region expanded by the ghost margin
+
+		bool covers(const Bounds& area) const {
+
+			auto expanded = layout.expanded_bounds(own_region);
+
+			return area.min_x >= expanded.min_x && area.min_y >= expanded.min_y && area.max_x <= expanded.max_x && area.max_y <= expanded.max_y;
+
+		}
+
+		//! Calls function(id, shape, owned) for every owned shape and ghost colliding with the query, as of the last exchange
+		//! Returns false if the query is not covered by this region, then shapes of other regions may be missing
+
+		template <class F> bool for_each_collision(const Shape& query, F&& function) {
+
+			if (!visible_shapes.empty()) {
+
+				tree.for_each_collision(query, [&](std::uint32_t index) {
+
+					function(visible_ids[index], visible_shapes[index], index < visible_owned);
+
+				});
+
+			}
+
+			return covers(bounds(query));
+
+		}
+
+		//! Appends the colliding pairs (id|id) of the last exchange, for which this region is responsible
+		//! A pair is reported by the owner of the shape with the smaller id, unless only the other shape fits into the margin,
+		//! the owner of a shape fitting into the margin always sees every shape colliding with it
+
+		void collide(std::vector<Pair>& pairs) {
+
+			COLLISHI_TRACE_SCOPE("partition", "collide");
+
+			if (visible_shapes.empty()) return;
+
+			for (std::uint32_t i = 0; i < visible_owned; i++) {
+
+				tree.for_each_collision(visible_shapes[i], [&](std::uint32_t j) {
+
+					if (j != i && reports(i, j)) pairs.push_back({ visible_ids[i], visible_ids[j] });
+
+				});
+
+			}
+
+		}
+
+		MemoryStats memory_stats() const {
+
+			auto index_size = owned_index.size() * (sizeof(std::uint32_t) + sizeof(std::size_t));
+
+			return Collishi::memory_stats(owned_ids) + Collishi::memory_stats(owned_shapes) + Collishi::memory_stats(visible_ids) + Collishi::memory_stats(visible_shapes)
+				+ Collishi::memory_stats(visible_oversized) + Collishi::memory_stats(outgoing) + Collishi::memory_stats(incoming) + Collishi::memory_stats(local_ghosts)
+				+ MemoryStats{ index_size, index_size, 0 } + tree.memory_stats();
+
+		}
+
+	private:
+
+		//! Whether shape i (owned) is the shape whose owner reports the pair with shape j
+
+		bool reports(std::uint32_t i, std::uint32_t j) const {
+
+			if (visible_oversized[i] != visible_oversized[j]) return !visible_oversized[i];
+
+			return visible_ids[i] < visible_ids[j];
+
+		}
+
+		void rebuild() {
+
+			visible_ids = owned_ids;
+			visible_shapes = owned_shapes;
+			visible_owned = static_cast<std::uint32_t>(owned_ids.size());
+
+			for (auto& messages : { &local_ghosts, &incoming }) {
+
+				for (auto& message : *messages) {
+
+					if (message.kind != PartitionMessage::Kind::ghost) continue;
+
+					visible_ids.push_back(message.id);
+					visible_shapes.push_back(message.shape);
+
+				}
+
+			}
+
+			visible_oversized.resize(visible_shapes.size());
+
+			for (std::size_t i = 0; i < visible_shapes.size(); i++) visible_oversized[i] = layout.oversized(bounds(visible_shapes[i]));
+
+			//! The shapes change every tick, so the hierarchy is built from scratch
+
+			tree.build(visible_shapes);
+
+		}
+
+		PartitionLayout layout;
+		std::uint32_t own_region;
+
+		std::vector<std::uint32_t> owned_ids;
+		std::vector<Shape> owned_shapes;
+		std::unordered_map<std::uint32_t, std::size_t> owned_index;
+
+		//! Owned shapes first, then the ghosts
+
+		std::vector<std::uint32_t> visible_ids;
+		std::vector<Shape> visible_shapes;
+		std::vector<std::uint8_t> visible_oversized;
+		std::uint32_t visible_owned = 0;
+
+		std::vector<PartitionMessage> outgoing;
+		std::vector<PartitionMessage> incoming;
+		std::vector<PartitionMessage> local_ghosts;
+
+		DynamicBvh tree;
+
+	};
+
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "CollisionsSharedMemory.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace Collishi {
+
+	namespace Partition {
+
+		constexpr std::uint32_t segment_magic = 0x5450434c; // "CLPT"
+		constexpr std::uint32_t segment_version = 2;
+
+		struct SegmentHeader {
+
+			std::atomic<std::uint32_t> magic;
+			std::uint32_t version;
+			std::uint32_t region_count;
+			std::uint32_t max_messages;
+			std::uint64_t outbox_stride;
+
+			//! Set by the first region whose exchange timed out, the exchanges of all regions fail from then on
+
+			std::atomic<std::uint32_t> failed;
+
+		};
+
+		//! Followed by two message buffers of max_messages, the buffer of a tick is tick % 2
+		//! A region writes the buffer of the next tick only after it read the messages of all regions for the current tick,
+		//! which they only wrote after reading the previous tick, so nobody reads a buffer while it is written
+
+		struct Outbox {
+
+			alignas(64) std::atomic<std::uint64_t> written_tick;
+			std::uint32_t count[2];
+			std::uint32_t truncated[2];
+
+		};
+
+		constexpr std::size_t outbox_header_size = (sizeof(Outbox) + 63) / 64 * 64;
+
+	}
+
+	//! Transport between workers on the same machine through a shared memory segment, each worker uses its own object
+	//! exchange waits (spinning and yielding) until all regions sent their messages of the tick
+	//!
+	//! A timeout is fatal for the whole partition: the region which timed out had already sent its messages, so the regions which
+	//! completed the tick applied its migrations while it did not, and ticking on would overwrite a buffer the slower regions may
+	//! still read. The region marks the segment as failed and closes its transport, every other region fails its current or next
+	//! exchange and closes its transport as well. The workers then have to start over from a common state with a new segment
+	//! Messages which did not fit make the exchange fail at all regions alike, which is not fatal
+
+	class SharedMemoryTransport {
+
+	public:
+
+		//! Creates the segment, which has room for max_messages outgoing messages per region and tick
+
+		bool create(const char* name, std::uint32_t region_count, std::uint32_t max_messages) {
+
+			auto stride = Partition::outbox_header_size + 2 * std::size_t(max_messages) * sizeof(PartitionMessage);
+
+			if (region_count == 0 || !segment.create(name, sizeof(Partition::SegmentHeader) + region_count * stride + 64)) return false;
+
+			auto header = static_cast<Partition::SegmentHeader*>(segment.data());
+
+			header->version = Partition::segment_version;
+			header->region_count = region_count;
+			header->max_messages = max_messages;
+			header->outbox_stride = stride;
+			header->failed.store(0, std::memory_order_relaxed);
+			header->magic.store(Partition::segment_magic, std::memory_order_release);
+
+			return attach();
+
+		}
+
+		bool open(const char* name) {
+
+			return segment.open(name, true) && attach();
+
+		}
+
+		void close() {
+
+			segment.close();
+			header = nullptr;
+
+		}
+
+		bool is_open() const {
+
+			return header != nullptr;
+
+		}
+
+		//! Time exchange waits for the other regions before it fails
+
+		void set_timeout(std::chrono::milliseconds milliseconds) {
+
+			timeout = milliseconds;
+
+		}
+
+		//! Returns false if the messages did not fit (at any region) or another region did not send within the timeout
+		//! After a timeout, here or at any other region, the transport is closed (see above)
+
+		bool exchange(std::uint32_t region, const std::vector<PartitionMessage>& outgoing, std::vector<PartitionMessage>& incoming) {
+
+			incoming.clear();
+
+			if (!header || region >= header->region_count) return false;
+
+			if (header->failed.load(std::memory_order_acquire) != 0) {
+
+				close();
+				return false;
+
+			}
+
+			auto& own = outbox(region);
+			auto tick = own.written_tick.load(std::memory_order_relaxed) + 1;
+			auto buffer = tick % 2;
+			auto count = std::min<std::size_t>(outgoing.size(), header->max_messages);
+
+			std::memcpy(messages(own, buffer), outgoing.data(), count * sizeof(PartitionMessage));
+			own.count[buffer] = static_cast<std::uint32_t>(count);
+			own.truncated[buffer] = (count < outgoing.size());
+			own.written_tick.store(tick, std::memory_order_release);
+
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			bool complete = true;
+
+			for (std::uint32_t other = 0; other < header->region_count; other++) {
+
+				auto& box = outbox(other);
+
+				while (box.written_tick.load(std::memory_order_acquire) < tick) {
+
+					if (header->failed.load(std::memory_order_acquire) != 0 || std::chrono::steady_clock::now() > deadline) {
+
+						header->failed.store(1, std::memory_order_release);
+						close();
+
+						return false;
+
+					}
+
+					std::this_thread::yield();
+
+				}
+
+				if (box.truncated[buffer]) complete = false;
+
+				auto sent = messages(box, buffer);
+
+				for (std::uint32_t m = 0; m < box.count[buffer]; m++) {
+
+					if (sent[m].region == region) incoming.push_back(sent[m]);
+
+				}
+
+			}
+
+			return complete;
+
+		}
+
+		//! The mapping of the segment, which all regions share
+
+		MemoryStats memory_stats() const {
+
+			return segment.memory_stats();
+
+		}
+
+	private:
+
+		bool attach() {
+
+			auto mapped = static_cast<Partition::SegmentHeader*>(segment.data());
+
+			if (segment.size() < sizeof(Partition::SegmentHeader) || mapped->magic.load(std::memory_order_acquire) != Partition::segment_magic || mapped->version != Partition::segment_version
+				|| sizeof(Partition::SegmentHeader) + mapped->region_count * mapped->outbox_stride > segment.size()) {
+
+				segment.close();
+				return false;
+
+			}
+
+			header = mapped;
+
+			return true;
+
+		}
+
+		Partition::Outbox& outbox(std::uint32_t region) {
+
+			auto first = (reinterpret_cast<std::uintptr_t>(header + 1) + 63) / 64 * 64;
+
+			return *reinterpret_cast<Partition::Outbox*>(first + region * header->outbox_stride);
+
+		}
+
+		PartitionMessage* messages(Partition::Outbox& box, std::uint32_t buffer) {
+
+			return reinterpret_cast<PartitionMessage*>(reinterpret_cast<char*>(&box) + Partition::outbox_header_size) + buffer * header->max_messages;
+
+		}
+
+		SharedMemory segment;
+		Partition::SegmentHeader* header = nullptr;
+		std::chrono::milliseconds timeout = std::chrono::milliseconds(10000);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,491 @@
+#pragma once
+
+//! Optional sampling profiler of the arguments passed to the collision routines
+//! If COLLISHI_PROFILE is defined before including any Collishi header, one in COLLISHI_PROFILE_INTERVAL calls
+//! of each routine (per thread, with some jitter) is sampled into histograms of the shape sizes, the aspect ratios
+//! of boxes and triangles, the distance of the shapes relative to their sizes and the hit rate
+//! This shows which early outs are worth it on real data, e.g. how often the bounding circles are already separated
+//!
+//! Each thread writes only into its own histograms, so sampling needs no locks or atomic read-modify-write operations
+//! When a thread exits, its histograms are added to a total and handed to the next thread (see CollisionsThreadSlots.h)
+//! Profile::snapshot sums the histograms of all threads and Profile::write_text writes them into a file
+//!
+//! Without COLLISHI_PROFILE, the hooks in Collisions.h expand to nothing, so profiling has no cost at all
+
+#ifdef COLLISHI_PROFILE
+
+#include "CollisionsMemory.h"
+#include "CollisionsRoutines.h"
+#include "CollisionsThreadSlots.h"
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! Mean number of calls of a routine between two samples
+
+#ifndef COLLISHI_PROFILE_INTERVAL
+#define COLLISHI_PROFILE_INTERVAL 1024
+#endif
+
+namespace Collishi::Profile {
+
+	//! Bucket i counts values in [2^(i - 16), 2^(i - 15)), the first and the last bucket also count all smaller and larger values
+
+	constexpr std::size_t bucket_count = 32;
+	constexpr int bucket_exponent_offset = 16;
+
+	constexpr std::size_t bucket(float value) {
+
+		value = (value < 0.0f ? -value : value);
+
+		if (!(value >= 1.0f / (1 << (bucket_exponent_offset - 1)))) return 0;
+
+		std::size_t index = 1;
+		float upper = 2.0f / (1 << (bucket_exponent_offset - 1));
+
+		while (index + 1 < bucket_count && value >= upper) {
+
+			index++;
+			upper *= 2.0f;
+
+		}
+
+		return index;
+
+	}
+
+	//! Lower bound of the values counted in the bucket, 0 for the first bucket
+
+	inline float bucket_lower_bound(std::size_t index) {
+
+		return (index == 0 ? 0.0f : std::ldexp(1.0f, static_cast<int>(index) - bucket_exponent_offset));
+
+	}
+
+	using Histogram = std::array<std::uint64_t, bucket_count>;
+
+	//! The size of a shape is the radius of its bounding circle around its center (0 for points)
+	//! The aspect ratio is width / height of boxes and of the bounding boxes of triangles
+
+	struct ShapeHistograms {
+
+		Histogram size;
+		Histogram aspect;
+
+	};
+
+	struct RoutineHistograms {
+
+		std::uint64_t samples;
+		std::uint64_t hits;
+
+		ShapeHistograms first;
+		ShapeHistograms second;
+
+		//! Distance of the shape centers divided by the sum of the sizes, below 1 the bounding circles overlap
+
+		Histogram distance;
+
+	};
+
+	struct Summary {
+
+		std::array<RoutineHistograms, routine_count> routines;
+
+	};
+
+	struct ShapeGeometry {
+
+		float center_x;
+		float center_y;
+		float size;
+		float aspect;
+
+	};
+
+	//! Aspect is 0 for shapes without a meaningful aspect ratio
+
+	inline ShapeGeometry shape_geometry(ShapeType type, const float* v) {
+
+		switch (type) {
+
+			case ShapeType::point:
+				return { v[0], v[1], 0.0f, 0.0f };
+
+			case ShapeType::line:
+				return { v[0] + 0.5f * v[2], v[1] + 0.5f * v[3], 0.5f * std::sqrt(v[2] * v[2] + v[3] * v[3]), 0.0f };
+
+			case ShapeType::circle:
+				return { v[0], v[1], v[2], 0.0f };
+
+			case ShapeType::box:
+				return { v[0] + 0.5f * v[2], v[1] + 0.5f * v[3], 0.5f * std::sqrt(v[2] * v[2] + v[3] * v[3]), (v[3] != 0.0f ? v[2] / v[3] : 0.0f) };
+
+			case ShapeType::triangle: {
+
+				auto cx = (v[2] + v[4]) / 3.0f;
+				auto cy = (v[3] + v[5]) / 3.0f;
+
+				float size_squared = cx * cx + cy * cy;
+
+				for (int i = 2; i < 6; i += 2) {
+
+					auto dx = v[i] - cx;
+					auto dy = v[i + 1] - cy;
+
+					size_squared = std::fmax(size_squared, dx * dx + dy * dy);
+
+				}
+
+				auto width = std::fmax(std::fmax(v[2], v[4]), 0.0f) - std::fmin(std::fmin(v[2], v[4]), 0.0f);
+				auto height = std::fmax(std::fmax(v[3], v[5]), 0.0f) - std::fmin(std::fmin(v[3], v[5]), 0.0f);
+
+				return { v[0] + cx, v[1] + cy, std::sqrt(size_squared), (height != 0.0f ? width / height : 0.0f) };
+
+			}
+
+		}
+
+		return { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	}
+
+	class ThreadHistograms {
+
+	public:
+
+		//! Only the owning thread writes, so a relaxed load and store is enough and snapshot can read concurrently
+
+		void record(Routine routine, const float* args, bool hit) {
+
+			auto& histograms = routines[static_cast<std::size_t>(routine)];
+
+			auto first = shape_geometry(routine_first_shape(routine), args);
+			auto second = shape_geometry(routine_second_shape(routine), args + shape_arity(routine_first_shape(routine)));
+
+			increment(histograms.samples);
+			if (hit) increment(histograms.hits);
+
+			increment(histograms.first.size[bucket(first.size)]);
+			increment(histograms.second.size[bucket(second.size)]);
+
+			if (first.aspect != 0.0f) increment(histograms.first.aspect[bucket(first.aspect)]);
+			if (second.aspect != 0.0f) increment(histograms.second.aspect[bucket(second.aspect)]);
+
+			auto dx = second.center_x - first.center_x;
+			auto dy = second.center_y - first.center_y;
+			auto sizes = first.size + second.size;
+
+			//! Two points at a distance are counted in the last bucket
+
+			auto distance = std::sqrt(dx * dx + dy * dy);
+			increment(histograms.distance[sizes > 0.0f ? bucket(distance / sizes) : (distance > 0.0f ? bucket_count - 1 : 0)]);
+
+		}
+
+		void add_to(Summary& summary) const {
+
+			for (std::size_t r = 0; r < routine_count; r++) {
+
+				auto& source = routines[r];
+				auto& target = summary.routines[r];
+
+				target.samples += source.samples.load(std::memory_order_relaxed);
+				target.hits += source.hits.load(std::memory_order_relaxed);
+
+				add(target.first.size, source.first.size);
+				add(target.first.aspect, source.first.aspect);
+				add(target.second.size, source.second.size);
+				add(target.second.aspect, source.second.aspect);
+				add(target.distance, source.distance);
+
+			}
+
+		}
+
+		void clear() {
+
+			for (auto& histograms : routines) {
+
+				histograms.samples.store(0, std::memory_order_relaxed);
+				histograms.hits.store(0, std::memory_order_relaxed);
+
+				for (auto* histogram : { &histograms.first.size, &histograms.first.aspect, &histograms.second.size, &histograms.second.aspect, &histograms.distance }) {
+
+					for (auto& count : *histogram) count.store(0, std::memory_order_relaxed);
+
+				}
+
+			}
+
+		}
+
+	private:
+
+		using Counter = std::atomic<std::uint64_t>;
+		using AtomicHistogram = std::array<Counter, bucket_count>;
+
+		struct AtomicShapeHistograms {
+
+			AtomicHistogram size{};
+			AtomicHistogram aspect{};
+
+		};
+
+		struct AtomicRoutineHistograms {
+
+			Counter samples{ 0 };
+			Counter hits{ 0 };
+
+			AtomicShapeHistograms first;
+			AtomicShapeHistograms second;
+
+			AtomicHistogram distance{};
+
+		};
+
+		static void increment(Counter& counter) {
+
+			counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		}
+
+		static void add(Histogram& target, const AtomicHistogram& source) {
+
+			for (std::size_t i = 0; i < bucket_count; i++) target[i] += source[i].load(std::memory_order_relaxed);
+
+		}
+
+		std::array<AtomicRoutineHistograms, routine_count> routines;
+
+	};
+
+	class Registry {
+
+	public:
+
+		//! Histograms of the threads which exited are summed here, so their slots can be reused
+
+		ThreadSlots<ThreadHistograms> histograms{ [this](ThreadHistograms& exited) {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			exited.add_to(retired);
+			exited.clear();
+
+		} };
+
+		Summary snapshot() {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto summary = retired;
+
+			histograms.for_each([&](const ThreadHistograms& thread_histograms) { thread_histograms.add_to(summary); });
+
+			return summary;
+
+		}
+
+		void clear() {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			retired = {};
+
+			histograms.for_each([](ThreadHistograms& thread_histograms) { thread_histograms.clear(); });
+
+		}
+
+	private:
+
+		std::mutex mutex;
+		Summary retired = {};
+
+	};
+
+	inline Registry& registry() {
+
+		static Registry instance;
+		return instance;
+
+	}
+
+	inline ThreadHistograms& thread_histograms() {
+
+		thread_local ThreadSlot<ThreadHistograms> histograms(registry().histograms);
+		return *histograms;
+
+	}
+
+	template <class F, class G> constexpr bool same_function(F f, G g) {
+
+		if constexpr (std::is_same_v<F, G>) return f == g;
+		else return false;
+
+	}
+
+	//! Id of the routine in Collisions.h with the address F
+
+	template <auto F> constexpr Routine routine_of() {
+
+#define COLLISHI_PROFILE_ROUTINE_OF(name, arity, first, second) if (same_function(F, &collision_##name)) return Routine::name;
+		COLLISHI_ROUTINE_LIST(COLLISHI_PROFILE_ROUTINE_OF)
+#undef COLLISHI_PROFILE_ROUTINE_OF
+
+		return Routine::point_point;
+
+	}
+
+	//! The countdowns are trivial thread locals, so the common path (no sample) is a decrement and a branch
+
+	inline thread_local std::uint32_t countdown[routine_count];
+	inline thread_local std::uint32_t jitter_state;
+
+	//! Next distance between two samples, uniform in [interval / 2, 3 * interval / 2), so the samples do not lock
+	//! onto periodic call patterns
+
+	inline std::uint32_t next_countdown() {
+
+		auto x = jitter_state + 0x9E3779B9u;
+
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+
+		jitter_state = x;
+
+		constexpr std::uint32_t interval = COLLISHI_PROFILE_INTERVAL;
+
+		return interval / 2 + x % (interval > 0 ? interval : 1);
+
+	}
+
+	template <auto routine, class... T> void sample(T... args) {
+
+		constexpr auto id = routine_of<routine>();
+
+		auto& remaining = countdown[static_cast<std::size_t>(id)];
+
+		if (remaining-- != 0) return;
+
+		//! The call below passes this hook once more, which the next countdown includes
+
+		remaining = next_countdown() + 1;
+
+		const float values[] = { static_cast<float>(args)... };
+
+		thread_histograms().record(id, values, routine(args...));
+
+	}
+
+	//! Sum of the histograms of all threads, which may still be sampling, and of the threads which exited
+
+	inline Summary snapshot() {
+
+		return registry().snapshot();
+
+	}
+
+	//! Resets the histograms of all threads
+	//! This should be called while no profiled code is running, otherwise a few samples may survive
+
+	inline void clear() {
+
+		registry().clear();
+
+	}
+
+	//! The histograms of each slot have a fixed size, there are as many slots as threads sampled at the same time
+
+	inline MemoryStats memory_stats() {
+
+		auto stats = registry().histograms.memory_stats();
+		auto size = registry().histograms.size() * sizeof(ThreadHistograms);
+
+		return stats + MemoryStats{ size, size, 0 };
+
+	}
+
+	//! Writes one line "<routine name> <histogram> <bucket lower bound> <count>" per non-empty bucket, and the lines
+	//! "<routine name> samples - <count>" and "<routine name> hits - <count>" for every sampled routine
+
+	inline bool write_text(const char* filename, const Summary& summary = snapshot()) {
+
+		auto file = std::fopen(filename, "w");
+		if (!file) return false;
+
+		std::fprintf(file, "# Collishi argument profile, one in %d calls sampled\n", COLLISHI_PROFILE_INTERVAL);
+		std::fprintf(file, "# routine histogram lower_bound count\n");
+
+		for (std::size_t r = 0; r < routine_count; r++) {
+
+			auto& histograms = summary.routines[r];
+			auto name = routine_name(static_cast<Routine>(r));
+
+			if (histograms.samples == 0) continue;
+
+			std::fprintf(file, "%s samples - %llu\n", name, static_cast<unsigned long long>(histograms.samples));
+			std::fprintf(file, "%s hits - %llu\n", name, static_cast<unsigned long long>(histograms.hits));
+
+			const std::pair<const char*, const Histogram*> named[] = {
+				{ "first_size", &histograms.first.size },
+				{ "first_aspect", &histograms.first.aspect },
+				{ "second_size", &histograms.second.size },
+				{ "second_aspect", &histograms.second.aspect },
+				{ "distance", &histograms.distance }
+			};
+
+			for (auto& [histogram_name, histogram] : named) {
+
+				for (std::size_t i = 0; i < bucket_count; i++) {
+
+					if ((*histogram)[i] == 0) continue;
+
+					std::fprintf(file, "%s %s %g %llu\n", name, histogram_name, bucket_lower_bound(i), static_cast<unsigned long long>((*histogram)[i]));
+
+				}
+
+			}
+
+		}
+
+		return std::fclose(file) == 0;
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::ProfileAssertions {
+
+	static_assert(Profile::bucket(0.0f) == 0);
+	static_assert(Profile::bucket(1e-9f) == 0);
+	static_assert(Profile::bucket(1.0f) == Profile::bucket_exponent_offset);
+	static_assert(Profile::bucket(1.5f) == Profile::bucket_exponent_offset);
+	static_assert(Profile::bucket(-2.0f) == Profile::bucket_exponent_offset + 1);
+	static_assert(Profile::bucket(0.25f) == Profile::bucket_exponent_offset - 2);
+	static_assert(Profile::bucket(1e9f) == Profile::bucket_count - 1);
+
+	static_assert(Profile::routine_of<&collision_point_point>() == Routine::point_point);
+	static_assert(Profile::routine_of<&collision_point_box>() == Routine::point_box);
+	static_assert(Profile::routine_of<&collision_point_line>() == Routine::point_line);
+	static_assert(Profile::routine_of<&collision_triangle_triangle>() == Routine::triangle_triangle);
+
+	//! The routines stay usable in constant expressions with profiling
+
+	static_assert(collision_circle_box(0.0f, 0.0f, 1.0f, 0.5f, 0.5f, 2.0f, 2.0f));
+
+}
+
+#endif
+
+#endif
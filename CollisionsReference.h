@@ -0,0 +1,430 @@
+#pragma once
+
+//! Reference implementations of all collision routines
+//! These are deliberately written with different, textbook algorithms (orientation tests, clamping and
+//! point/segment distances) in double precision, so they can serve as an independent oracle for the
+//! optimized routines in Collisions.h
+//! Products of two float values are exact in double precision, so most of the tests here are exact
+//! They are not meant to be fast
+
+#include "CollisionsRoutines.h"
+
+namespace Collishi::Reference {
+
+	struct Vector {
+
+		double x;
+		double y;
+
+	};
+
+	constexpr Vector operator+(Vector a, Vector b) {
+
+		return { a.x + b.x, a.y + b.y };
+
+	}
+
+	constexpr Vector operator-(Vector a, Vector b) {
+
+		return { a.x - b.x, a.y - b.y };
+
+	}
+
+	constexpr double dot(Vector a, Vector b) {
+
+		return a.x * b.x + a.y * b.y;
+
+	}
+
+	constexpr double cross(Vector a, Vector b) {
+
+		return a.x * b.y - a.y * b.x;
+
+	}
+
+	//! Positive if c is left of the line from a to b, negative if right and zero if collinear
+
+	constexpr double orientation(Vector a, Vector b, Vector c) {
+
+		return cross(b - a, c - a);
+
+	}
+
+	constexpr double minimum(double a, double b) {
+
+		return (a < b ? a : b);
+
+	}
+
+	constexpr double maximum(double a, double b) {
+
+		return (a < b ? b : a);
+
+	}
+
+	constexpr bool on_segment(Vector p, Vector a, Vector b) {
+
+		if (orientation(a, b, p) != 0.0) return false;
+
+		return minimum(a.x, b.x) <= p.x && p.x <= maximum(a.x, b.x) && minimum(a.y, b.y) <= p.y && p.y <= maximum(a.y, b.y);
+
+	}
+
+	constexpr bool segments_intersect(Vector a, Vector b, Vector c, Vector d) {
+
+		auto o1 = orientation(a, b, c);
+		auto o2 = orientation(a, b, d);
+		auto o3 = orientation(c, d, a);
+		auto o4 = orientation(c, d, b);
+
+		if (((o1 > 0.0 && o2 < 0.0) || (o1 < 0.0 && o2 > 0.0)) && ((o3 > 0.0 && o4 < 0.0) || (o3 < 0.0 && o4 > 0.0))) return true;
+
+		//! Touching and collinear configurations
+
+		if (on_segment(c, a, b)) return true;
+		if (on_segment(d, a, b)) return true;
+		if (on_segment(a, c, d)) return true;
+		if (on_segment(b, c, d)) return true;
+
+		return false;
+
+	}
+
+	constexpr double distance_squared(Vector a, Vector b) {
+
+		return dot(a - b, a - b);
+
+	}
+
+	constexpr double distance_squared_to_segment(Vector p, Vector a, Vector b) {
+
+		auto ab = b - a;
+		auto length_squared = dot(ab, ab);
+
+		if (length_squared == 0.0) return distance_squared(p, a);
+
+		auto t = dot(p - a, ab) / length_squared;
+
+		if (t < 0.0) t = 0.0;
+		if (t > 1.0) t = 1.0;
+
+		return distance_squared(p, { a.x + t * ab.x, a.y + t * ab.y });
+
+	}
+
+	constexpr bool point_in_triangle(Vector p, Vector a, Vector b, Vector c) {
+
+		//! Degenerate triangles are treated as the union of their edges
+
+		if (orientation(a, b, c) == 0.0) return on_segment(p, a, b) || on_segment(p, b, c) || on_segment(p, c, a);
+
+		auto d1 = orientation(a, b, p);
+		auto d2 = orientation(b, c, p);
+		auto d3 = orientation(c, a, p);
+
+		auto has_negative = (d1 < 0.0) || (d2 < 0.0) || (d3 < 0.0);
+		auto has_positive = (d1 > 0.0) || (d2 > 0.0) || (d3 > 0.0);
+
+		return !(has_negative && has_positive);
+
+	}
+
+	//! Axis aligned box given by its minimum and maximum corner
+
+	struct Box {
+
+		Vector min;
+		Vector max;
+
+	};
+
+	constexpr Box make_box(double x, double y, double w, double h) {
+
+		return { { minimum(x, x + w), minimum(y, y + h) }, { maximum(x, x + w), maximum(y, y + h) } };
+
+	}
+
+	constexpr bool point_in_box(Vector p, const Box& box) {
+
+		return box.min.x <= p.x && p.x <= box.max.x && box.min.y <= p.y && p.y <= box.max.y;
+
+	}
+
+	constexpr bool segment_intersects_box(Vector a, Vector b, const Box& box) {
+
+		if (point_in_box(a, box) || point_in_box(b, box)) return true;
+
+		Vector corners[4] = { box.min, { box.max.x, box.min.y }, box.max, { box.min.x, box.max.y } };
+
+		for (int i = 0; i < 4; i++) {
+
+			if (segments_intersect(a, b, corners[i], corners[(i + 1) % 4])) return true;
+
+		}
+
+		return false;
+
+	}
+
+	constexpr bool segment_intersects_triangle(Vector a, Vector b, Vector t0, Vector t1, Vector t2) {
+
+		if (point_in_triangle(a, t0, t1, t2) || point_in_triangle(b, t0, t1, t2)) return true;
+
+		if (segments_intersect(a, b, t0, t1)) return true;
+		if (segments_intersect(a, b, t1, t2)) return true;
+		if (segments_intersect(a, b, t2, t0)) return true;
+
+		return false;
+
+	}
+
+	//! The reference routines take the same arguments as the ones in Collisions.h
+
+	constexpr bool collision_point_point(double x1, double y1, double x2, double y2) {
+
+		return x1 == x2 && y1 == y2;
+
+	}
+
+	constexpr bool collision_point_line(double x1, double y1, double x2, double y2, double dx2, double dy2) {
+
+		return on_segment({ x1, y1 }, { x2, y2 }, { x2 + dx2, y2 + dy2 });
+
+	}
+
+	constexpr bool collision_point_circle(double x1, double y1, double x2, double y2, double r2) {
+
+		return distance_squared({ x1, y1 }, { x2, y2 }) <= r2 * r2;
+
+	}
+
+	constexpr bool collision_point_box(double x1, double y1, double x2, double y2, double w2, double h2) {
+
+		return point_in_box({ x1, y1 }, make_box(x2, y2, w2, h2));
+
+	}
+
+	constexpr bool collision_point_triangle(double x1, double y1, double x2, double y2, double sxa2, double sya2, double sxb2, double syb2) {
+
+		return point_in_triangle({ x1, y1 }, { x2, y2 }, { x2 + sxa2, y2 + sya2 }, { x2 + sxb2, y2 + syb2 });
+
+	}
+
+	constexpr bool collision_line_line(double x1, double y1, double dx1, double dy1, double x2, double y2, double dx2, double dy2) {
+
+		return segments_intersect({ x1, y1 }, { x1 + dx1, y1 + dy1 }, { x2, y2 }, { x2 + dx2, y2 + dy2 });
+
+	}
+
+	constexpr bool collision_line_circle(double x1, double y1, double dx1, double dy1, double x2, double y2, double r2) {
+
+		return distance_squared_to_segment({ x2, y2 }, { x1, y1 }, { x1 + dx1, y1 + dy1 }) <= r2 * r2;
+
+	}
+
+	constexpr bool collision_line_box(double x1, double y1, double dx1, double dy1, double x2, double y2, double w2, double h2) {
+
+		return segment_intersects_box({ x1, y1 }, { x1 + dx1, y1 + dy1 }, make_box(x2, y2, w2, h2));
+
+	}
+
+	constexpr bool collision_line_triangle(double x1, double y1, double dx1, double dy1, double x2, double y2, double sxa2, double sya2, double sxb2, double syb2) {
+
+		return segment_intersects_triangle({ x1, y1 }, { x1 + dx1, y1 + dy1 }, { x2, y2 }, { x2 + sxa2, y2 + sya2 }, { x2 + sxb2, y2 + syb2 });
+
+	}
+
+	constexpr bool collision_circle_circle(double x1, double y1, double r1, double x2, double y2, double r2) {
+
+		return distance_squared({ x1, y1 }, { x2, y2 }) <= (r1 + r2) * (r1 + r2);
+
+	}
+
+	constexpr bool collision_circle_box(double x1, double y1, double r1, double x2, double y2, double w2, double h2) {
+
+		//! Distance to the closest point of the box, found by clamping the midpoint
+
+		auto box = make_box(x2, y2, w2, h2);
+
+		Vector closest = { maximum(box.min.x, minimum(x1, box.max.x)), maximum(box.min.y, minimum(y1, box.max.y)) };
+
+		return distance_squared({ x1, y1 }, closest) <= r1 * r1;
+
+	}
+
+	constexpr bool collision_circle_triangle(double x1, double y1, double r1, double x2, double y2, double sxa2, double sya2, double sxb2, double syb2) {
+
+		Vector c = { x1, y1 };
+		Vector a = { x2, y2 };
+		Vector b = { x2 + sxa2, y2 + sya2 };
+		Vector d = { x2 + sxb2, y2 + syb2 };
+
+		if (point_in_triangle(c, a, b, d)) return true;
+
+		auto r_squared = r1 * r1;
+
+		if (distance_squared_to_segment(c, a, b) <= r_squared) return true;
+		if (distance_squared_to_segment(c, b, d) <= r_squared) return true;
+		if (distance_squared_to_segment(c, d, a) <= r_squared) return true;
+
+		return false;
+
+	}
+
+	constexpr bool collision_box_box(double x1, double y1, double w1, double h1, double x2, double y2, double w2, double h2) {
+
+		auto box_1 = make_box(x1, y1, w1, h1);
+		auto box_2 = make_box(x2, y2, w2, h2);
+
+		return box_1.min.x <= box_2.max.x && box_2.min.x <= box_1.max.x && box_1.min.y <= box_2.max.y && box_2.min.y <= box_1.max.y;
+
+	}
+
+	constexpr bool collision_box_triangle(double x1, double y1, double w1, double h1, double x2, double y2, double sxa2, double sya2, double sxb2, double syb2) {
+
+		auto box = make_box(x1, y1, w1, h1);
+
+		Vector t[3] = { { x2, y2 }, { x2 + sxa2, y2 + sya2 }, { x2 + sxb2, y2 + syb2 } };
+
+		//! Either an edge of the triangle touches the box (this includes triangle vertices inside the box),
+		//! or the box lies completely inside the triangle
+
+		for (int i = 0; i < 3; i++) {
+
+			if (segment_intersects_box(t[i], t[(i + 1) % 3], box)) return true;
+
+		}
+
+		return point_in_triangle(box.min, t[0], t[1], t[2]);
+
+	}
+
+	constexpr bool collision_triangle_triangle(double x1, double y1, double sxa1, double sya1, double sxb1, double syb1, double x2, double y2, double sxa2, double sya2, double sxb2, double syb2) {
+
+		Vector t1[3] = { { x1, y1 }, { x1 + sxa1, y1 + sya1 }, { x1 + sxb1, y1 + syb1 } };
+		Vector t2[3] = { { x2, y2 }, { x2 + sxa2, y2 + sya2 }, { x2 + sxb2, y2 + syb2 } };
+
+		for (int i = 0; i < 3; i++) {
+
+			for (int j = 0; j < 3; j++) {
+
+				if (segments_intersect(t1[i], t1[(i + 1) % 3], t2[j], t2[(j + 1) % 3])) return true;
+
+			}
+
+		}
+
+		//! No edges intersect, so either one triangle contains the other or they are disjoint
+
+		if (point_in_triangle(t1[0], t2[0], t2[1], t2[2])) return true;
+		if (point_in_triangle(t2[0], t1[0], t1[1], t1[2])) return true;
+
+		return false;
+
+	}
+
+	//! Calls the reference routine with its arguments taken from a flat array, like Collishi::invoke_routine
+
+	template <class T> constexpr bool invoke_routine(Routine routine, const T* a) {
+
+		switch (routine) {
+
+			case Routine::point_point: return collision_point_point(a[0], a[1], a[2], a[3]);
+			case Routine::point_line: return collision_point_line(a[0], a[1], a[2], a[3], a[4], a[5]);
+			case Routine::point_circle: return collision_point_circle(a[0], a[1], a[2], a[3], a[4]);
+			case Routine::point_box: return collision_point_box(a[0], a[1], a[2], a[3], a[4], a[5]);
+			case Routine::point_triangle: return collision_point_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case Routine::line_line: return collision_line_line(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case Routine::line_circle: return collision_line_circle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+			case Routine::line_box: return collision_line_box(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case Routine::line_triangle: return collision_line_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+			case Routine::circle_circle: return collision_circle_circle(a[0], a[1], a[2], a[3], a[4], a[5]);
+			case Routine::circle_box: return collision_circle_box(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+			case Routine::circle_triangle: return collision_circle_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+			case Routine::box_box: return collision_box_box(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case Routine::box_triangle: return collision_box_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+			case Routine::triangle_triangle: return collision_triangle_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]);
+
+		}
+
+		return false;
+
+	}
+
+	//! Relative size of the perturbation which decides whether a case is too close to call
+
+	constexpr double ambiguity_tolerance = 1.0 / 8192.0;
+
+	//! Calls the reference routine with the second shape moved by (shift_x|shift_y)
+
+	constexpr bool invoke_shifted(Routine routine, const float* args, double shift_x, double shift_y) {
+
+		double shifted[max_routine_arity] = {};
+
+		for (std::size_t i = 0; i < routine_arity(routine); i++) shifted[i] = args[i];
+
+		auto offset = shape_arity(routine_first_shape(routine));
+
+		shifted[offset] += shift_x;
+		shifted[offset + 1] += shift_y;
+
+		return invoke_routine(routine, shifted);
+
+	}
+
+	//! A case is ambiguous if moving the second shape by a tiny amount changes the reference result,
+	//! so any result is within the rounding error of single precision
+
+	constexpr bool ambiguous(Routine routine, const float* args) {
+
+		double magnitude = 1.0;
+
+		for (std::size_t i = 0; i < routine_arity(routine); i++) {
+
+			auto value = static_cast<double>(args[i] < 0.0f ? -args[i] : args[i]);
+			if (value > magnitude) magnitude = value;
+
+		}
+
+		auto tolerance = magnitude * ambiguity_tolerance;
+		auto expected = invoke_shifted(routine, args, 0.0, 0.0);
+
+		for (int dx = -1; dx <= 1; dx++) {
+
+			for (int dy = -1; dy <= 1; dy++) {
+
+				if (invoke_shifted(routine, args, dx * tolerance, dy * tolerance) != expected) return true;
+
+			}
+
+		}
+
+		return false;
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+//! The reference routines need to agree with the test cases of Collisions.h
+
+static_assert(true == Collishi::Reference::collision_point_line(1.0, 0.0,     0.0, 0.0, 1.0, 0.0));
+static_assert(false == Collishi::Reference::collision_point_line(1.0, 0.0,     1.1, 0.0, 1.0, 0.0));
+static_assert(false == Collishi::Reference::collision_point_triangle(0.0, 0.0,     0.0, 0.2, 3.0, 1.0, -3.0, 1.0));
+static_assert(true == Collishi::Reference::collision_line_line(0.0, 0.0, 1.0, 0.0,     1.0, 0.0, 1.0, 0.0));
+static_assert(false == Collishi::Reference::collision_line_circle(1.0, 1.0, 8.0, 8.0,      10.0, 10.0, 1.4));
+static_assert(true == Collishi::Reference::collision_line_circle(1.0, 1.0, 8.0, 8.0,      10.0, 10.0, 1.5));
+static_assert(false == Collishi::Reference::collision_line_box(11.0, 0.0, 11.0, 13.0,     0.0, 1.0, 10.0, 10.0));
+static_assert(true == Collishi::Reference::collision_line_box(1.0, 1.0, 7.0, 7.0,     2.0, 2.0, 4.0, 4.0));
+static_assert(true == Collishi::Reference::collision_line_triangle(2.0, 1.0, 2.0, 1.0,     2.0, 1.0, -1.0, 3.0, 2.0, 1.0));
+static_assert(false == Collishi::Reference::collision_circle_box(3.0, 3.0, 1.0,     -2.0, -2.0, 4.0, 4.0));
+static_assert(true == Collishi::Reference::collision_circle_box(3.0, 3.0, 1.5,     -2.0, -2.0, 4.0, 4.0));
+static_assert(false == Collishi::Reference::collision_circle_triangle(5.0, 5.0, 3.0,     3.0, 2.0, -1.0, -5.0, -5.0, -1.0));
+static_assert(true == Collishi::Reference::collision_circle_triangle(5.0, 5.0, 4.0,     3.0, 2.0, -1.0, -5.0, -5.0, -1.0));
+static_assert(false == Collishi::Reference::collision_box_triangle(-5.0, 2.0, 3.0, 2.0,     1.0, 5.0, 0.0, -4.0, -3.0, -4.0));
+static_assert(true == Collishi::Reference::collision_box_triangle(-1.0, -1.0, 1.0, 2.5,     1.0, 5.0, 0.0, -4.0, -3.0, -4.0));
+static_assert(false == Collishi::Reference::collision_triangle_triangle(0.0, 3.0, 1.0, 2.0, 3.0, 2.0,     4.0, 2.0, 2.0, 2.0, 3.0, 3.0));
+static_assert(true == Collishi::Reference::collision_triangle_triangle(3.0, 1.0, 0.0, 2.0, 4.0, 2.0,     4.0, 2.0, 2.0, 2.0, 3.0, 3.0));
+
+#endif
@@ -0,0 +1,232 @@
+#pragma once
+
+//! Enumeration of all collision routines in Collisions.h
+//! This allows tools (capture, replay, benchmarks) to refer to a routine by a small id
+//! and to call it with a flat array of float arguments
+
+#include "Collisions.h"
+#include "CollisionsTags.h"
+#include "CollisionsTrace.h"
+
+#include <cstddef>
+#include <cstdint>
+
+//! Counting hooks of the live metrics (see CollisionsMetrics.h), without COLLISHI_METRICS their arguments are not even evaluated
+
+#ifdef COLLISHI_METRICS
+#define COLLISHI_METRICS_COUNT(routine, tests, hits) ::Collishi::Metrics::count(routine, tests, hits)
+#define COLLISHI_METRICS_COUNT_RESULTS(routine, results, count) ::Collishi::Metrics::count_results(routine, results, count)
+#else
+#define COLLISHI_METRICS_COUNT(routine, tests, hits) ((void) 0)
+#define COLLISHI_METRICS_COUNT_RESULTS(routine, results, count) ((void) 0)
+#endif
+
+//! X-macro with all routines, their name suffix, their number of float arguments and their two shape types
+//! The order must never change, since the ids are stored in binary capture logs
+
+#define COLLISHI_ROUTINE_LIST(X) \
+	X(point_point, 4, point, point) \
+	X(point_line, 6, point, line) \
+	X(point_circle, 5, point, circle) \
+	X(point_box, 6, point, box) \
+	X(point_triangle, 8, point, triangle) \
+	X(line_line, 8, line, line) \
+	X(line_circle, 7, line, circle) \
+	X(line_box, 8, line, box) \
+	X(line_triangle, 10, line, triangle) \
+	X(circle_circle, 6, circle, circle) \
+	X(circle_box, 7, circle, box) \
+	X(circle_triangle, 9, circle, triangle) \
+	X(box_box, 8, box, box) \
+	X(box_triangle, 10, box, triangle) \
+	X(triangle_triangle, 12, triangle, triangle)
+
+namespace Collishi {
+
+	//! Shape types, ordered like the shapes in the routine names
+
+	enum class ShapeType : std::uint8_t {
+
+		point,
+		line,
+		circle,
+		box,
+		triangle
+
+	};
+
+	//! Number of float arguments describing a shape
+
+	constexpr std::size_t shape_arity(ShapeType type) {
+
+		switch (type) {
+
+			case ShapeType::point: return 2;
+			case ShapeType::line: return 4;
+			case ShapeType::circle: return 3;
+			case ShapeType::box: return 4;
+			case ShapeType::triangle: return 6;
+
+		}
+
+		return 0;
+
+	}
+
+	//! Id of a collision routine, e.g. Routine::circle_box for collision_circle_box
+
+	enum class Routine : std::uint8_t {
+
+#define COLLISHI_ROUTINE_ENUM(name, arity, first, second) name,
+		COLLISHI_ROUTINE_LIST(COLLISHI_ROUTINE_ENUM)
+#undef COLLISHI_ROUTINE_ENUM
+
+	};
+
+	constexpr std::size_t routine_count = 15;
+
+	//! The largest number of float arguments of any routine (triangle/triangle)
+
+	constexpr std::size_t max_routine_arity = 12;
+
+	constexpr std::size_t routine_arity(Routine routine) {
+
+		switch (routine) {
+
+#define COLLISHI_ROUTINE_ARITY(name, arity, first, second) case Routine::name: return arity;
+			COLLISHI_ROUTINE_LIST(COLLISHI_ROUTINE_ARITY)
+#undef COLLISHI_ROUTINE_ARITY
+
+		}
+
+		return 0;
+
+	}
+
+	constexpr ShapeType routine_first_shape(Routine routine) {
+
+		switch (routine) {
+
+#define COLLISHI_ROUTINE_FIRST(name, arity, first, second) case Routine::name: return ShapeType::first;
+			COLLISHI_ROUTINE_LIST(COLLISHI_ROUTINE_FIRST)
+#undef COLLISHI_ROUTINE_FIRST
+
+		}
+
+		return ShapeType::point;
+
+	}
+
+	constexpr ShapeType routine_second_shape(Routine routine) {
+
+		switch (routine) {
+
+#define COLLISHI_ROUTINE_SECOND(name, arity, first, second) case Routine::name: return ShapeType::second;
+			COLLISHI_ROUTINE_LIST(COLLISHI_ROUTINE_SECOND)
+#undef COLLISHI_ROUTINE_SECOND
+
+		}
+
+		return ShapeType::point;
+
+	}
+
+	constexpr const char* routine_name(Routine routine) {
+
+		switch (routine) {
+
+#define COLLISHI_ROUTINE_NAME(name, arity, first, second) case Routine::name: return "collision_" #name;
+			COLLISHI_ROUTINE_LIST(COLLISHI_ROUTINE_NAME)
+#undef COLLISHI_ROUTINE_NAME
+
+		}
+
+		return "unknown";
+
+	}
+
+	//! Calls the routine with its arguments taken from a flat array
+	//! The array needs to contain at least routine_arity(routine) values
+
+	constexpr bool invoke_routine(Routine routine, const float* a) {
+
+		switch (routine) {
+
+			case Routine::point_point: return collision_point_point(a[0], a[1], a[2], a[3]);
+			case Routine::point_line: return collision_point_line(a[0], a[1], a[2], a[3], a[4], a[5]);
+			case Routine::point_circle: return collision_point_circle(a[0], a[1], a[2], a[3], a[4]);
+			case Routine::point_box: return collision_point_box(a[0], a[1], a[2], a[3], a[4], a[5]);
+			case Routine::point_triangle: return collision_point_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case Routine::line_line: return collision_line_line(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case Routine::line_circle: return collision_line_circle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+			case Routine::line_box: return collision_line_box(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case Routine::line_triangle: return collision_line_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+			case Routine::circle_circle: return collision_circle_circle(a[0], a[1], a[2], a[3], a[4], a[5]);
+			case Routine::circle_box: return collision_circle_box(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+			case Routine::circle_triangle: return collision_circle_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+			case Routine::box_box: return collision_box_box(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+			case Routine::box_triangle: return collision_box_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+			case Routine::triangle_triangle: return collision_triangle_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]);
+
+		}
+
+		return false;
+
+	}
+
+#ifdef COLLISHI_METRICS
+
+	namespace Metrics {
+
+		inline void count(Routine routine, std::uint64_t tests, std::uint64_t hits);
+		inline void count_results(Routine routine, const bool* results, std::size_t count);
+
+	}
+
+#endif
+
+	//! Evaluates the routine for count argument sets, which are stored consecutively in args
+
+	inline void invoke_routine_batch(Routine routine, const float* args, std::size_t count, bool* results, CostTag tag = {}) {
+
+		COLLISHI_TRACE_SCOPE("batch", routine_name(routine));
+
+		Tags::Measurement measurement(tag);
+		Tags::Measurement::add_tests(count);
+
+		auto arity = routine_arity(routine);
+
+		for (std::size_t i = 0; i < count; i++) results[i] = invoke_routine(routine, args + i * arity);
+
+		COLLISHI_METRICS_COUNT_RESULTS(routine, results, count);
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::RoutineAssertions {
+
+	constexpr float circle_box_args[] = { 3.0f, 3.0f, 1.5f,     -2.0f, -2.0f, 4.0f, 4.0f };
+	constexpr float triangle_triangle_args[] = { 0.0f, 3.0f, 1.0f, 2.0f, 3.0f, 2.0f,     4.0f, 4.0f, 1.0f, 0.0f, 1.0f, 1.0f };
+
+}
+
+static_assert(Collishi::routine_arity(Collishi::Routine::triangle_triangle) == Collishi::max_routine_arity);
+static_assert(static_cast<std::size_t>(Collishi::Routine::triangle_triangle) + 1 == Collishi::routine_count);
+
+static_assert(Collishi::shape_arity(Collishi::routine_first_shape(Collishi::Routine::line_triangle)) + Collishi::shape_arity(Collishi::routine_second_shape(Collishi::Routine::line_triangle)) == Collishi::routine_arity(Collishi::Routine::line_triangle));
+
+static_assert(true == Collishi::invoke_routine(Collishi::Routine::circle_box, Collishi::RoutineAssertions::circle_box_args));
+static_assert(false == Collishi::invoke_routine(Collishi::Routine::triangle_triangle, Collishi::RoutineAssertions::triangle_triangle_args));
+
+#endif
+
+#ifdef COLLISHI_PROFILE
+#include "CollisionsProfile.h"
+#endif
+
+#ifdef COLLISHI_METRICS
+#include "CollisionsMetrics.h"
+#endif
@@ -0,0 +1,247 @@
+#pragma once
+
+//! Generic separating axis test for pairs of convex polygons
+//! The routines in Collisions.h are hand-expanded SAT tests for each pair of shapes; this header generates
+//! the same kind of test at compile time from a description of both shapes, so new polygon pairs need no derivation
+//!
+//! A shape description is a type with:
+//! - the members x and y, the origin of the shape
+//! - axis_count and axis<I>(), the axes to test (AxisX, AxisY or a Direction, which does not need to be normalized)
+//! - axis_aligned, which is true if the axes are exactly AxisX and AxisY
+//! - project(axis), the interval of the shape projected on an axis, relative to the projection of the origin
+//! - project_own<I>(), the same for its own axis I, where two vertices project to the same value
+//!
+//! Box and Polygon<N> are provided; Polygon<3> describes the same triangles as the routines in Collisions.h
+//! All axes are tested one after another in unrolled code and the test stops at the first separating axis
+//! Only multiplications, additions and comparisons are used, products shared between axes are computed only once
+//! if the compiler sees them as common subexpressions (the projections on the own edges are reduced explicitly)
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+
+namespace Collishi::Sat {
+
+	struct Interval {
+
+		float min;
+		float max;
+
+	};
+
+	template <class... T> constexpr Interval interval(float first, T... values) {
+
+		Interval result = { first, first };
+
+		for (float value : { values... }) {
+
+			if (value < result.min) result.min = value;
+			if (value > result.max) result.max = value;
+
+		}
+
+		return result;
+
+	}
+
+	//! Axes of the coordinate system, on which projections need no multiplications
+
+	struct AxisX {};
+	struct AxisY {};
+
+	struct Direction {
+
+		float x;
+		float y;
+
+	};
+
+	constexpr float dot(AxisX, float x, float) { return x; }
+	constexpr float dot(AxisY, float, float y) { return y; }
+	constexpr float dot(const Direction& direction, float x, float y) { return direction.x * x + direction.y * y; }
+
+	//! Axis-aligned box from (x|y) to (x + w|y + h), w and h are not negative like in Collisions.h
+
+	struct Box {
+
+		static constexpr std::size_t axis_count = 2;
+		static constexpr bool axis_aligned = true;
+
+		float x;
+		float y;
+		float w;
+		float h;
+
+		template <std::size_t I> constexpr auto axis() const {
+
+			if constexpr (I == 0) return AxisX{};
+			else return AxisY{};
+
+		}
+
+		constexpr Interval project(AxisX) const { return { 0.0f, w }; }
+		constexpr Interval project(AxisY) const { return { 0.0f, h }; }
+
+		constexpr Interval project(const Direction& direction) const {
+
+			auto projection_w = direction.x * w;
+			auto projection_h = direction.y * h;
+
+			return interval(0.0f, projection_w, projection_h, projection_w + projection_h);
+
+		}
+
+		template <std::size_t I> constexpr Interval project_own() const {
+
+			return project(axis<I>());
+
+		}
+
+	};
+
+	//! Convex polygon with N vertices in either winding order
+	//! The first vertex is (x|y), offsets holds the other vertices relative to it (x and y alternating)
+
+	template <std::size_t N> struct Polygon {
+
+		static_assert(N >= 3, "Polygons need at least three vertices");
+
+		static constexpr std::size_t axis_count = N;
+		static constexpr bool axis_aligned = false;
+
+		float x;
+		float y;
+		std::array<float, 2 * (N - 1)> offsets;
+
+		template <std::size_t K> constexpr float vertex_x() const {
+
+			if constexpr (K == 0) return 0.0f;
+			else return offsets[2 * (K - 1)];
+
+		}
+
+		template <std::size_t K> constexpr float vertex_y() const {
+
+			if constexpr (K == 0) return 0.0f;
+			else return offsets[2 * (K - 1) + 1];
+
+		}
+
+		//! Normal of the edge from vertex I to vertex I + 1 (or back to vertex 0)
+		//! The direction of the normal does not matter, so the edges to and from vertex 0 need no subtraction
+
+		template <std::size_t I> constexpr Direction axis() const {
+
+			if constexpr (I == 0) return { -vertex_y<1>(), vertex_x<1>() };
+			else if constexpr (I == N - 1) return { -vertex_y<N - 1>(), vertex_x<N - 1>() };
+			else return { -(vertex_y<I + 1>() - vertex_y<I>()), vertex_x<I + 1>() - vertex_x<I>() };
+
+		}
+
+		template <class Axis> constexpr Interval project(const Axis& axis) const {
+
+			return project_vertices(axis, std::make_index_sequence<N - 1>());
+
+		}
+
+		template <std::size_t I> constexpr Interval project_own() const {
+
+			return project_own_vertices<I>(axis<I>(), std::make_index_sequence<N - 1>());
+
+		}
+
+	private:
+
+		template <class Axis, std::size_t... K> constexpr Interval project_vertices(const Axis& axis, std::index_sequence<K...>) const {
+
+			return interval(0.0f, dot(axis, vertex_x<K + 1>(), vertex_y<K + 1>())...);
+
+		}
+
+		template <std::size_t I, std::size_t... K> constexpr Interval project_own_vertices(const Direction& axis, std::index_sequence<K...>) const {
+
+			return interval(0.0f, project_own_vertex<I, K + 1>(axis)...);
+
+		}
+
+		//! On the normal of edge I, vertex I + 1 projects like vertex I, which is vertex 0 (projecting to 0) for the first and the last edge
+
+		template <std::size_t I, std::size_t K> constexpr float project_own_vertex(const Direction& axis) const {
+
+			if constexpr ((I == 0 && K == 1) || (I == N - 1 && K == N - 1)) return 0.0f;
+			else if constexpr (K == I + 1) return dot(axis, vertex_x<I>(), vertex_y<I>());
+			else return dot(axis, vertex_x<K>(), vertex_y<K>());
+
+		}
+
+	};
+
+	//! The interval other, shifted by offset, does not overlap own (touching intervals overlap)
+
+	constexpr bool separated(const Interval& own, const Interval& other, float offset) {
+
+		return own.max < other.min + offset || other.max + offset < own.min;
+
+	}
+
+	template <class A, class B, std::size_t... I> constexpr bool separated_by_first(const A& a, const B& b, float dx, float dy, std::index_sequence<I...>) {
+
+		return (separated(a.template project_own<I>(), b.project(a.template axis<I>()), dot(a.template axis<I>(), dx, dy)) || ...);
+
+	}
+
+	template <class A, class B, std::size_t... I> constexpr bool separated_by_second(const A& a, const B& b, float dx, float dy, std::index_sequence<I...>) {
+
+		return (separated(a.project(b.template axis<I>()), b.template project_own<I>(), dot(b.template axis<I>(), dx, dy)) || ...);
+
+	}
+
+	template <class A, class B> constexpr bool collision(const A& a, const B& b) {
+
+		auto dx = b.x - a.x;
+		auto dy = b.y - a.y;
+
+		if (separated_by_first(a, b, dx, dy, std::make_index_sequence<A::axis_count>())) return false;
+
+		//! Two axis-aligned shapes share their axes
+
+		if constexpr (A::axis_aligned && B::axis_aligned) return true;
+		else return !separated_by_second(a, b, dx, dy, std::make_index_sequence<B::axis_count>());
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::SatAssertions {
+
+	using Triangle = Sat::Polygon<3>;
+
+	//! Regular-ish pentagon around (0|0), starting at (0|-2)
+
+	constexpr Sat::Polygon<5> pentagon = { 0.0f, -2.0f, { 2.0f, 1.0f, 1.25f, 3.5f, -1.25f, 3.5f, -2.0f, 1.0f } };
+
+}
+
+static_assert(true == Collishi::Sat::collision(Collishi::Sat::Box{ -5.0f, 2.0f, 4.0f, 2.0f }, Collishi::SatAssertions::Triangle{ 1.0f, 5.0f, { 0.0f, -4.0f, -3.0f, -4.0f } }));
+static_assert(false == Collishi::Sat::collision(Collishi::Sat::Box{ -5.0f, 2.0f, 3.0f, 2.0f }, Collishi::SatAssertions::Triangle{ 1.0f, 5.0f, { 0.0f, -4.0f, -3.0f, -4.0f } }));
+static_assert(false == Collishi::Sat::collision(Collishi::Sat::Box{ -1.0f, -1.0f, 1.0f, 1.0f }, Collishi::SatAssertions::Triangle{ 1.0f, 5.0f, { 0.0f, -4.0f, -3.0f, -4.0f } }));
+static_assert(true == Collishi::Sat::collision(Collishi::Sat::Box{ -1.0f, -1.0f, 1.0f, 2.5f }, Collishi::SatAssertions::Triangle{ 1.0f, 5.0f, { 0.0f, -4.0f, -3.0f, -4.0f } }));
+
+static_assert(true == Collishi::Sat::collision(Collishi::SatAssertions::Triangle{ 0.0f, 3.0f, { 1.0f, 2.0f, 3.0f, 2.0f } }, Collishi::SatAssertions::Triangle{ 2.0f, 2.0f, { 1.0f, 4.0f, 2.0f, 3.0f } }));
+static_assert(false == Collishi::Sat::collision(Collishi::SatAssertions::Triangle{ 0.0f, 3.0f, { 1.0f, 2.0f, 3.0f, 2.0f } }, Collishi::SatAssertions::Triangle{ 4.0f, 4.0f, { 1.0f, 0.0f, 1.0f, 1.0f } }));
+static_assert(false == Collishi::Sat::collision(Collishi::SatAssertions::Triangle{ 2.0f, 2.0f, { 1.0f, 4.0f, 2.0f, 3.0f } }, Collishi::SatAssertions::Triangle{ 3.0f, 1.0f, { 0.0f, 2.0f, 4.0f, 2.0f } }));
+
+static_assert(true == Collishi::Sat::collision(Collishi::Sat::Box{ -2.0f, -2.0f, 6.0f, 8.0f }, Collishi::Sat::Box{ 2.5f, 5.5f, 4.0f, 4.0f }));
+static_assert(false == Collishi::Sat::collision(Collishi::Sat::Box{ -2.0f, -2.0f, 6.0f, 8.0f }, Collishi::Sat::Box{ 3.1f, 6.1f, 2.8f, 2.8f }));
+
+//! The pentagon only reaches x = 2 at y = -1, and its corners are cut off
+
+static_assert(true == Collishi::Sat::collision(Collishi::SatAssertions::pentagon, Collishi::Sat::Box{ 1.5f, -1.5f, 1.0f, 1.0f }));
+static_assert(false == Collishi::Sat::collision(Collishi::SatAssertions::pentagon, Collishi::Sat::Box{ 1.5f, 1.1f, 1.0f, 1.0f }));
+static_assert(false == Collishi::Sat::collision(Collishi::SatAssertions::pentagon, Collishi::SatAssertions::Triangle{ 1.9f, -2.1f, { 1.0f, 0.0f, 0.0f, -1.0f } }));
+static_assert(true == Collishi::Sat::collision(Collishi::SatAssertions::Triangle{ 0.0f, 0.0f, { 1.0f, 0.0f, 0.0f, 1.0f } }, Collishi::SatAssertions::pentagon));
+
+#endif
@@ -0,0 +1,740 @@
+#pragma once
+
+//! Collision queries against one static world shared by several processes on the same machine
+//! The server places the shapes and their bounding volume hierarchy into a POSIX shared memory segment, so the clients
+//! need no copy of the world. Clients can query the mapped world directly, or submit batches of query shapes, which the
+//! server answers in an order that keeps consecutive traversals in the same part of the hierarchy:
+//!
+//! Server process:
+//! Collishi::WorldServer server;
+//! server.open("/collishi-world", level_shapes);
+//! server.serve(running); // or server.poll() from an own loop
+//!
+//! Client processes:
+//! Collishi::WorldClient client;
+//! client.open("/collishi-world");
+//! client.world().for_each_collision(shape, on_collision); // directly on the shared memory
+//! client.query(queries.data(), queries.size(), pairs);     // batch answered by the server, pairs (query index|shape index)
+//!
+//! Every client owns one channel of the segment with room for a batch of queries and its results
+//! A client submits a batch by writing its channel and pushing the channel id into a lock free ring, which the server
+//! pops; the server answers by writing the results and the number of the answered batch, so neither side takes a lock
+
+#include "CollisionsBatch.h"
+#include "CollisionsBvh.h"
+#include "CollisionsMemory.h"
+#include "CollisionsRoutines.h"
+#include "CollisionsShapes.h"
+#include "CollisionsSharedMemory.h"
+#include "CollisionsSharedWorld.h"
+#include "CollisionsTags.h"
+#include "CollisionsTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <signal.h>
+#include <unistd.h>
+
+namespace Collishi {
+
+	struct ServiceLimits {
+
+		//! Number of clients which can be connected at the same time
+
+		std::uint32_t channel_count = 16;
+
+		//! Maximum number of query shapes per batch and of pairs in its result
+
+		std::uint32_t max_queries = 1024;
+		std::uint32_t max_results = 16384;
+
+	};
+
+	namespace Service {
+
+		constexpr std::uint32_t segment_magic = 0x5753434c; // "CLSW"
+		constexpr std::uint32_t segment_version = 2;
+
+		//! Every array starts on its own cache line, so the channels of different clients do not share lines
+
+		constexpr std::size_t alignment = 64;
+
+		constexpr std::size_t align(std::size_t offset) {
+
+			return (offset + alignment - 1) / alignment * alignment;
+
+		}
+
+		struct SegmentHeader {
+
+			std::atomic<std::uint32_t> magic;
+			std::uint32_t version;
+
+			std::uint32_t shape_count;
+			std::uint32_t node_count;
+			std::uint32_t channel_count;
+			std::uint32_t ring_size;
+			std::uint32_t max_queries;
+			std::uint32_t max_results;
+
+			std::uint64_t shapes_offset;
+			std::uint64_t bounds_offset;
+			std::uint64_t nodes_offset;
+			std::uint64_t indices_offset;
+			std::uint64_t ring_offset;
+			std::uint64_t channels_offset;
+			std::uint64_t channel_stride;
+			std::uint64_t segment_size;
+
+			alignas(alignment) std::atomic<std::uint64_t> enqueue_position;
+			alignas(alignment) std::atomic<std::uint64_t> dequeue_position;
+
+		};
+
+		//! Cell of the bounded queue of channel ids: a cell can be written when its sequence equals the position of the writer,
+		//! and read when it equals the position of the reader + 1
+
+		struct RingCell {
+
+			std::atomic<std::uint64_t> sequence;
+			std::uint32_t channel;
+
+		};
+
+		//! Followed by max_queries shapes and max_results pairs
+
+		struct Channel {
+
+			//! Process id of the client, 0 if the channel is free
+
+			std::atomic<std::uint32_t> owner;
+			std::uint32_t query_count;
+
+			//! Number of the last submitted and the last answered batch
+
+			std::atomic<std::uint64_t> submitted;
+			std::atomic<std::uint64_t> completed;
+
+			std::uint32_t result_count;
+			std::uint32_t truncated;
+
+			//! Set by a client which closed while its batch was waiting, whoever sees both the answer and the flag frees the channel
+
+			std::atomic<std::uint32_t> abandoned;
+
+		};
+
+		//! Frees the channel if the client abandoned it, called by both sides after the answer or the flag is written
+		//! The answer and the flag are written and read in sequential consistency, so at least one side sees both, and the
+		//! exchange makes sure only one of them frees the channel
+
+		inline void free_abandoned(Channel& channel) {
+
+			if (channel.abandoned.load() != 0 && channel.abandoned.exchange(0) != 0) channel.owner.store(0, std::memory_order_release);
+
+		}
+
+		static_assert(std::is_trivially_copyable_v<Shape> && std::is_trivially_copyable_v<BvhNode> && std::is_trivially_copyable_v<Pair>);
+
+		inline std::uint32_t ring_size(std::uint32_t channel_count) {
+
+			//! Every channel has at most one batch in the ring, so the ring never runs full
+
+			std::uint32_t size = 1;
+			while (size < channel_count) size *= 2;
+
+			return size;
+
+		}
+
+		inline void layout(SegmentHeader& header) {
+
+			auto offset = align(sizeof(SegmentHeader));
+
+			auto place = [&](std::uint64_t& array_offset, std::size_t bytes) {
+
+				array_offset = offset;
+				offset = align(offset + bytes);
+
+			};
+
+			place(header.shapes_offset, header.shape_count * sizeof(Shape));
+			place(header.bounds_offset, header.shape_count * sizeof(Bounds));
+			place(header.nodes_offset, header.node_count * sizeof(BvhNode));
+			place(header.indices_offset, (header.shape_count > 0 ? header.shape_count : 1) * sizeof(std::uint32_t));
+			place(header.ring_offset, header.ring_size * sizeof(RingCell));
+
+			header.channel_stride = align(align(sizeof(Channel)) + header.max_queries * sizeof(Shape) + header.max_results * sizeof(Pair));
+			header.channels_offset = offset;
+			header.segment_size = offset + header.channel_count * header.channel_stride;
+
+		}
+
+		template <class T> T* array(void* segment, std::uint64_t offset) {
+
+			return reinterpret_cast<T*>(static_cast<char*>(segment) + offset);
+
+		}
+
+		inline Channel& channel(void* segment, const SegmentHeader& header, std::uint32_t index) {
+
+			return *array<Channel>(segment, header.channels_offset + index * header.channel_stride);
+
+		}
+
+		inline Shape* channel_queries(Channel& channel) {
+
+			return reinterpret_cast<Shape*>(reinterpret_cast<char*>(&channel) + align(sizeof(Channel)));
+
+		}
+
+		inline Pair* channel_results(Channel& channel, const SegmentHeader& header) {
+
+			return reinterpret_cast<Pair*>(reinterpret_cast<char*>(channel_queries(channel)) + header.max_queries * sizeof(Shape));
+
+		}
+
+		//! Multiple producers (the clients), returns false if the ring is full
+
+		inline bool push(void* segment, SegmentHeader& header, std::uint32_t channel) {
+
+			auto cells = array<RingCell>(segment, header.ring_offset);
+			auto position = header.enqueue_position.load(std::memory_order_relaxed);
+
+			while (true) {
+
+				auto& cell = cells[position & (header.ring_size - 1)];
+				auto difference = static_cast<std::int64_t>(cell.sequence.load(std::memory_order_acquire) - position);
+
+				if (difference < 0) return false;
+
+				if (difference == 0) {
+
+					if (header.enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+
+						cell.channel = channel;
+						cell.sequence.store(position + 1, std::memory_order_release);
+
+						return true;
+
+					}
+
+				}
+				else position = header.enqueue_position.load(std::memory_order_relaxed);
+
+			}
+
+		}
+
+		//! Single consumer (the server), returns false if the ring is empty
+
+		inline bool pop(void* segment, SegmentHeader& header, std::uint32_t& channel) {
+
+			auto cells = array<RingCell>(segment, header.ring_offset);
+			auto position = header.dequeue_position.load(std::memory_order_relaxed);
+			auto& cell = cells[position & (header.ring_size - 1)];
+
+			if (cell.sequence.load(std::memory_order_acquire) != position + 1) return false;
+
+			channel = cell.channel;
+			cell.sequence.store(position + header.ring_size, std::memory_order_release);
+			header.dequeue_position.store(position + 1, std::memory_order_relaxed);
+
+			return true;
+
+		}
+
+		//! Spreads the lower 16 bits to the even bits
+
+		constexpr std::uint32_t spread_bits(std::uint32_t value) {
+
+			value &= 0xffff;
+			value = (value | (value << 8)) & 0x00ff00ff;
+			value = (value | (value << 4)) & 0x0f0f0f0f;
+			value = (value | (value << 2)) & 0x33333333;
+			value = (value | (value << 1)) & 0x55555555;
+
+			return value;
+
+		}
+
+		//! Position of the point on a Z-order curve through the world bounds, nearby points mostly get nearby keys
+
+		constexpr std::uint32_t morton_key(float x, float y, const Bounds& world) {
+
+			auto cell = [](float value, float low, float high) {
+
+				auto relative = (high > low ? (value - low) / (high - low) : 0.0f);
+				relative = (relative < 0.0f ? 0.0f : (relative > 1.0f ? 1.0f : relative));
+
+				return static_cast<std::uint32_t>(relative * 65535.0f);
+
+			};
+
+			return spread_bits(cell(x, world.min_x, world.max_x)) | (spread_bits(cell(y, world.min_y, world.max_y)) << 1);
+
+		}
+
+	}
+
+	namespace Service {
+
+		inline SharedWorld world(void* segment, const SegmentHeader& header) {
+
+			return { array<Shape>(segment, header.shapes_offset), array<Bounds>(segment, header.bounds_offset), array<BvhNode>(segment, header.nodes_offset),
+				array<std::uint32_t>(segment, header.indices_offset), header.shape_count };
+
+		}
+
+	}
+
+	//! Owns the segment and answers the batches of the clients, all functions have to be called from the same thread
+
+	class WorldServer {
+
+	public:
+
+		WorldServer() = default;
+		WorldServer(const WorldServer& other) = delete;
+		WorldServer& operator=(const WorldServer& other) = delete;
+
+		//! Creates (or replaces) the segment with the shapes and their hierarchy, returns false if it could not be created
+
+		bool open(const char* name, const std::vector<Shape>& shapes, const ServiceLimits& limits = {}) {
+
+			close();
+
+			if (limits.channel_count == 0 || limits.max_queries == 0) return false;
+
+			std::vector<Bounds> shape_bounds(shapes.size());
+			for (std::size_t i = 0; i < shapes.size(); i++) shape_bounds[i] = bounds(shapes[i]);
+
+			std::vector<BvhNode> nodes(bvh_node_capacity(shapes.size()));
+			std::vector<std::uint32_t> indices(shapes.size() > 0 ? shapes.size() : 1);
+
+			auto node_count = (shapes.empty() ? 0 : build_bvh(shape_bounds.data(), shapes.size(), nodes.data(), indices.data()));
+
+			Service::SegmentHeader layout = {};
+
+			layout.shape_count = static_cast<std::uint32_t>(shapes.size());
+			layout.node_count = static_cast<std::uint32_t>(node_count);
+			layout.channel_count = limits.channel_count;
+			layout.ring_size = Service::ring_size(limits.channel_count);
+			layout.max_queries = limits.max_queries;
+			layout.max_results = limits.max_results;
+
+			Service::layout(layout);
+
+			if (!segment.create(name, layout.segment_size)) return false;
+
+			//! The segment is zero filled: all channels are free and no batch was submitted
+
+			auto memory = segment.data();
+
+			header = static_cast<Service::SegmentHeader*>(memory);
+
+			header->version = Service::segment_version;
+			header->shape_count = layout.shape_count;
+			header->node_count = layout.node_count;
+			header->channel_count = layout.channel_count;
+			header->ring_size = layout.ring_size;
+			header->max_queries = layout.max_queries;
+			header->max_results = layout.max_results;
+			header->shapes_offset = layout.shapes_offset;
+			header->bounds_offset = layout.bounds_offset;
+			header->nodes_offset = layout.nodes_offset;
+			header->indices_offset = layout.indices_offset;
+			header->ring_offset = layout.ring_offset;
+			header->channels_offset = layout.channels_offset;
+			header->channel_stride = layout.channel_stride;
+			header->segment_size = layout.segment_size;
+
+			std::copy(shapes.begin(), shapes.end(), Service::array<Shape>(memory, header->shapes_offset));
+			std::copy(shape_bounds.begin(), shape_bounds.end(), Service::array<Bounds>(memory, header->bounds_offset));
+			std::copy(nodes.begin(), nodes.begin() + node_count, Service::array<BvhNode>(memory, header->nodes_offset));
+			std::copy(indices.begin(), indices.end(), Service::array<std::uint32_t>(memory, header->indices_offset));
+
+			auto cells = Service::array<Service::RingCell>(memory, header->ring_offset);
+			for (std::uint32_t i = 0; i < header->ring_size; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+
+			shared_world = Service::world(memory, *header);
+
+			header->magic.store(Service::segment_magic, std::memory_order_release);
+
+			return true;
+
+		}
+
+		//! Removes the segment, connected clients keep their mapping, but their batches are not answered anymore
+
+		void close() {
+
+			segment.close();
+			header = nullptr;
+			shared_world = {};
+
+		}
+
+		bool is_open() const {
+
+			return header != nullptr;
+
+		}
+
+		const SharedWorld& world() const {
+
+			return shared_world;
+
+		}
+
+		//! Bytes of the world (shapes and hierarchy) in the segment, which the clients share instead of holding a copy each
+
+		std::size_t world_bytes() const {
+
+			return (header ? header->ring_offset : 0);
+
+		}
+
+		//! Answers all submitted batches without waiting for new ones, returns the number of answered batches
+
+		std::size_t poll(CostTag tag = {}) {
+
+			if (!header) return 0;
+
+			std::size_t answered = 0;
+			std::uint32_t index;
+
+			while (Service::pop(segment.data(), *header, index)) {
+
+				if (index < header->channel_count) answer(Service::channel(segment.data(), *header, index), tag);
+
+				answered++;
+
+			}
+
+			return answered;
+
+		}
+
+		//! Polls until running is false, sleeping for idle_sleep whenever there was nothing to answer
+
+		void serve(const std::atomic<bool>& running, std::chrono::microseconds idle_sleep = std::chrono::microseconds(50), CostTag tag = {}) {
+
+			while (running.load(std::memory_order_relaxed)) {
+
+				if (poll(tag) == 0) std::this_thread::sleep_for(idle_sleep);
+
+			}
+
+		}
+
+		//! Frees the channels of clients which exited without closing, returns the number of freed channels
+
+		std::size_t reclaim_channels() {
+
+			if (!header) return 0;
+
+			std::size_t reclaimed = 0;
+
+			for (std::uint32_t i = 0; i < header->channel_count; i++) {
+
+				auto& channel = Service::channel(segment.data(), *header, i);
+				auto owner = channel.owner.load(std::memory_order_acquire);
+
+				//! A channel with a batch in the ring is only freed after it was answered, so a new owner never sees stale results
+
+				if (owner == 0 || channel.submitted.load(std::memory_order_acquire) != channel.completed.load(std::memory_order_relaxed)) continue;
+				if (kill(static_cast<pid_t>(owner), 0) == 0 || errno != ESRCH) continue;
+
+				if (channel.owner.compare_exchange_strong(owner, 0, std::memory_order_acq_rel)) reclaimed++;
+
+			}
+
+			return reclaimed;
+
+		}
+
+		//! The segment (world, ring and channels) and the buffers for sorting the queries of a batch
+
+		MemoryStats memory_stats() const {
+
+			return segment.memory_stats() + Collishi::memory_stats(order) + Collishi::memory_stats(keys);
+
+		}
+
+	private:
+
+		void answer(Service::Channel& channel, CostTag tag) {
+
+			COLLISHI_TRACE_SCOPE("service", "answer batch");
+
+			Tags::Measurement measurement(tag);
+
+			auto batch = channel.submitted.load(std::memory_order_acquire);
+			auto count = std::min(channel.query_count, header->max_queries);
+			auto queries = Service::channel_queries(channel);
+			auto results = Service::channel_results(channel, *header);
+
+			//! Queries close to each other visit mostly the same nodes, so processing them in Z-order keeps those nodes in the cache
+
+			auto world_bounds = shared_world.bounds();
+
+			order.resize(count);
+			keys.resize(count);
+
+			for (std::uint32_t i = 0; i < count; i++) {
+
+				auto query_bounds = bounds(queries[i]);
+
+				order[i] = i;
+				keys[i] = Service::morton_key(query_bounds.center_x(), query_bounds.center_y(), world_bounds);
+
+			}
+
+			std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return keys[a] < keys[b]; });
+
+			std::uint32_t result_count = 0;
+			std::uint32_t truncated = 0;
+
+			for (auto i : order) {
+
+				shared_world.for_each_collision(queries[i], [&](std::uint32_t index) {
+
+					if (result_count < header->max_results) results[result_count++] = { i, index };
+					else truncated = 1;
+
+				});
+
+			}
+
+			channel.result_count = result_count;
+			channel.truncated = truncated;
+			channel.completed.store(batch);
+
+			Service::free_abandoned(channel);
+
+		}
+
+		SharedMemory segment;
+		Service::SegmentHeader* header = nullptr;
+		SharedWorld shared_world;
+
+		std::vector<std::uint32_t> order;
+		std::vector<std::uint32_t> keys;
+
+	};
+
+	//! Connection of one client, all functions of one client have to be called from the same thread
+
+	class WorldClient {
+
+	public:
+
+		WorldClient() = default;
+		WorldClient(const WorldClient& other) = delete;
+		WorldClient& operator=(const WorldClient& other) = delete;
+
+		~WorldClient() {
+
+			close();
+
+		}
+
+		//! Maps the segment and takes a free channel, returns false if there is no server or all channels are taken
+
+		bool open(const char* name) {
+
+			close();
+
+			if (!segment.open(name, true)) return false;
+
+			auto mapped = static_cast<Service::SegmentHeader*>(segment.data());
+
+			if (segment.size() < sizeof(Service::SegmentHeader) || mapped->magic.load(std::memory_order_acquire) != Service::segment_magic
+				|| mapped->version != Service::segment_version || mapped->segment_size > segment.size()) {
+
+				segment.close();
+				return false;
+
+			}
+
+			auto pid = static_cast<std::uint32_t>(getpid());
+
+			for (std::uint32_t i = 0; i < mapped->channel_count; i++) {
+
+				std::uint32_t free = 0;
+
+				if (!Service::channel(segment.data(), *mapped, i).owner.compare_exchange_strong(free, pid, std::memory_order_acq_rel)) continue;
+
+				header = mapped;
+				channel = &Service::channel(segment.data(), *header, i);
+				channel_index = i;
+				batch = channel->submitted.load(std::memory_order_relaxed);
+				shared_world = Service::world(segment.data(), *header);
+
+				return true;
+
+			}
+
+			segment.close();
+			return false;
+
+		}
+
+		//! Frees the channel, a batch which is still waiting for its answer keeps it until the server answered it
+
+		void close() {
+
+			if (!header) return;
+
+			if (ready()) channel->owner.store(0, std::memory_order_release);
+			else {
+
+				channel->abandoned.store(1);
+
+				if (channel->completed.load() == batch) Service::free_abandoned(*channel);
+
+			}
+
+			segment.close();
+			header = nullptr;
+			channel = nullptr;
+			shared_world = {};
+
+		}
+
+		bool is_open() const {
+
+			return header != nullptr;
+
+		}
+
+		//! The world in the segment, queries on it run in this process without the server
+
+		const SharedWorld& world() const {
+
+			return shared_world;
+
+		}
+
+		std::size_t max_queries() const {
+
+			return (header ? header->max_queries : 0);
+
+		}
+
+		//! Starts a batch, returns false if it is too large or the previous batch was not answered yet
+
+		bool submit(const Shape* queries, std::size_t count) {
+
+			if (!header || count > header->max_queries || !ready()) return false;
+
+			std::copy(queries, queries + count, Service::channel_queries(*channel));
+			channel->query_count = static_cast<std::uint32_t>(count);
+			channel->submitted.store(++batch, std::memory_order_release);
+
+			if (Service::push(segment.data(), *header, channel_index)) return true;
+
+			channel->submitted.store(--batch, std::memory_order_release);
+
+			return false;
+
+		}
+
+		//! Whether the last batch was answered
+
+		bool ready() const {
+
+			return header && channel->completed.load(std::memory_order_acquire) == batch;
+
+		}
+
+		//! Replaces pairs by the pairs (query index|shape index) of the answered batch, in no particular order
+		//! Returns false if the batch was not answered yet or had more than ServiceLimits::max_results pairs (then pairs has the first ones)
+
+		bool receive(std::vector<Pair>& pairs) const {
+
+			pairs.clear();
+
+			if (!ready()) return false;
+
+			auto results = Service::channel_results(*channel, *header);
+			pairs.assign(results, results + channel->result_count);
+
+			return channel->truncated == 0;
+
+		}
+
+		//! Submits the batch and waits for its answer, returns false if the batch could not be submitted,
+		//! was not answered within the timeout or its results did not fit
+
+		bool query(const Shape* queries, std::size_t count, std::vector<Pair>& pairs, std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) {
+
+			pairs.clear();
+
+			if (!submit(queries, count)) return false;
+
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+
+			while (!ready()) {
+
+				if (std::chrono::steady_clock::now() > deadline) return false;
+
+				std::this_thread::yield();
+
+			}
+
+			return receive(pairs);
+
+		}
+
+		//! The mapping of the segment, which the client shares with the server and the other clients
+
+		MemoryStats memory_stats() const {
+
+			return segment.memory_stats();
+
+		}
+
+	private:
+
+		SharedMemory segment;
+		Service::SegmentHeader* header = nullptr;
+		Service::Channel* channel = nullptr;
+		std::uint32_t channel_index = 0;
+		std::uint64_t batch = 0;
+		SharedWorld shared_world;
+
+	};
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::ServiceAssertions {
+
+	constexpr Bounds world = { 0.0f, 0.0f, 100.0f, 100.0f };
+
+	static_assert(Service::spread_bits(0xffff) == 0x55555555);
+	static_assert(Service::morton_key(0.0f, 0.0f, world) == 0);
+	static_assert(Service::morton_key(100.0f, 100.0f, world) == 0xffffffff);
+	static_assert(Service::morton_key(100.0f, 0.0f, world) == 0x55555555);
+
+	//! Nearby points in the same quadrant share the upper bits
+
+	static_assert((Service::morton_key(10.0f, 10.0f, world) >> 30) == (Service::morton_key(20.0f, 30.0f, world) >> 30));
+	static_assert((Service::morton_key(10.0f, 10.0f, world) >> 30) != (Service::morton_key(60.0f, 30.0f, world) >> 30));
+
+	static_assert(Service::align(1) == Service::alignment && Service::align(Service::alignment) == Service::alignment);
+
+}
+
+#endif
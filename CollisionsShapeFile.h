@@ -0,0 +1,234 @@
+#pragma once
+
+//! Binary shape files for large static levels, which are mapped into memory instead of parsed
+//! A file is a ShapeFileHeader followed by the Shape values exactly as they are laid out in memory, so the mapped file
+//! is used as an array of shapes without any copy, and only the pages which are touched are read from disk:
+//!
+//! Collishi::write_shape_file("level.shapes", shapes.data(), shapes.size());
+//!
+//! Collishi::MappedShapeFile level;
+//! level.open("level.shapes");
+//! Collishi::collide_all_parallel(level.shapes(), level.size(), pairs);
+//!
+//! The layout is the one of the machine writing the file (little endian on all supported targets), a file of another
+//! byte order or Shape layout is rejected by open
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "CollisionsShapeFile.h needs POSIX memory mapping"
+#endif
+
+#include "CollisionsMemory.h"
+#include "CollisionsShapes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Collishi {
+
+	static_assert(std::is_trivially_copyable_v<Shape> && alignof(Shape) <= 64, "Shapes are mapped from the file as they are");
+
+	constexpr char shape_file_magic[8] = { 'C', 'O', 'L', 'L', 'S', 'H', 'P', '\0' };
+	constexpr std::uint32_t shape_file_version = 1;
+
+	//! The shapes start at shape_offset, which is a multiple of the cache line size
+
+	struct ShapeFileHeader {
+
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t shape_size;
+		std::uint64_t shape_count;
+		std::uint64_t shape_offset;
+
+	};
+
+	constexpr std::uint64_t shape_file_offset = 64;
+
+	//! Writes the shapes with their padding bytes zeroed, so equal levels give equal files, returns false if the file could not be written
+
+	inline bool write_shape_file(const char* filename, const Shape* shapes, std::size_t count) {
+
+		auto file = std::fopen(filename, "wb");
+		if (!file) return false;
+
+		unsigned char header[shape_file_offset] = {};
+
+		ShapeFileHeader fields;
+		std::memcpy(fields.magic, shape_file_magic, sizeof(fields.magic));
+		fields.version = shape_file_version;
+		fields.shape_size = static_cast<std::uint32_t>(sizeof(Shape));
+		fields.shape_count = count;
+		fields.shape_offset = shape_file_offset;
+
+		std::memcpy(header, &fields, sizeof(fields));
+
+		auto written = (std::fwrite(header, sizeof(header), 1, file) == 1);
+
+		for (std::size_t i = 0; i < count && written; i++) {
+
+			unsigned char record[sizeof(Shape)] = {};
+
+			std::memcpy(record + offsetof(Shape, type), &shapes[i].type, sizeof(shapes[i].type));
+			std::memcpy(record + offsetof(Shape, values), shapes[i].values, sizeof(shapes[i].values));
+
+			written = (std::fwrite(record, sizeof(record), 1, file) == 1);
+
+		}
+
+		return (std::fclose(file) == 0) && written;
+
+	}
+
+	//! Read only mapping of a shape file, the shapes stay valid until the file is closed
+
+	class MappedShapeFile {
+
+	public:
+
+		MappedShapeFile() = default;
+		MappedShapeFile(const MappedShapeFile& other) = delete;
+		MappedShapeFile& operator=(const MappedShapeFile& other) = delete;
+
+		~MappedShapeFile() {
+
+			close();
+
+		}
+
+		//! Maps the file, returns false if it cannot be read or is no shape file of this layout
+		//! The shape types are not checked, since that would read the whole file (see first_unknown_type)
+
+		bool open(const char* filename) {
+
+			close();
+
+			auto descriptor = ::open(filename, O_RDONLY);
+			if (descriptor < 0) return false;
+
+			struct stat status;
+
+			auto size = (fstat(descriptor, &status) == 0 ? static_cast<std::uint64_t>(status.st_size) : 0);
+
+			void* mapped = MAP_FAILED;
+			if (size >= sizeof(ShapeFileHeader)) mapped = mmap(nullptr, static_cast<std::size_t>(size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+			::close(descriptor);
+
+			if (mapped == MAP_FAILED) return false;
+
+			memory = mapped;
+			mapped_size = static_cast<std::size_t>(size);
+
+			ShapeFileHeader header;
+			std::memcpy(&header, memory, sizeof(header));
+
+			auto valid = (std::memcmp(header.magic, shape_file_magic, sizeof(header.magic)) == 0 && header.version == shape_file_version && header.shape_size == sizeof(Shape)
+				&& header.shape_offset % alignof(Shape) == 0 && header.shape_offset <= size && header.shape_count <= (size - header.shape_offset) / sizeof(Shape));
+
+			if (!valid) {
+
+				close();
+				return false;
+
+			}
+
+			shape_count = static_cast<std::size_t>(header.shape_count);
+			first_shape = reinterpret_cast<const Shape*>(static_cast<const unsigned char*>(memory) + header.shape_offset);
+
+			return true;
+
+		}
+
+		void close() {
+
+			if (!memory) return;
+
+			munmap(memory, mapped_size);
+
+			memory = nullptr;
+			mapped_size = 0;
+			first_shape = nullptr;
+			shape_count = 0;
+
+		}
+
+		bool is_open() const {
+
+			return memory != nullptr;
+
+		}
+
+		const Shape* shapes() const {
+
+			return first_shape;
+
+		}
+
+		std::size_t size() const {
+
+			return shape_count;
+
+		}
+
+		//! The whole mapping, including the header
+
+		const void* data() const {
+
+			return memory;
+
+		}
+
+		std::size_t mapped_bytes() const {
+
+			return mapped_size;
+
+		}
+
+		//! The mapped bytes count as used and reserved, the kernel reads and drops their pages as needed
+
+		MemoryStats memory_stats() const {
+
+			return { mapped_size, mapped_size, 0 };
+
+		}
+
+		//! Index of the first shape with an unknown type, or size() if all types are known
+
+		std::size_t first_unknown_type() const {
+
+			for (std::size_t i = 0; i < shape_count; i++) {
+
+				if (static_cast<std::uint8_t>(first_shape[i].type) > static_cast<std::uint8_t>(ShapeType::triangle)) return i;
+
+			}
+
+			return shape_count;
+
+		}
+
+	private:
+
+		void* memory = nullptr;
+		std::size_t mapped_size = 0;
+
+		const Shape* first_shape = nullptr;
+		std::size_t shape_count = 0;
+
+	};
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+static_assert(sizeof(Collishi::ShapeFileHeader) <= Collishi::shape_file_offset);
+static_assert(Collishi::shape_file_offset % alignof(Collishi::Shape) == 0);
+
+#endif
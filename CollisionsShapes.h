@@ -0,0 +1,168 @@
+#pragma once
+
+//! Shapes as values, for code which handles shapes of different types in one container
+//! A Shape stores its type and its arguments in the same order as the collision routines take them,
+//! so collision(a, b) only has to select the routine and possibly swap both shapes
+//! Everything is constexpr, so shapes known at compile time can be tested at compile time
+
+#include "Collisions.h"
+#include "CollisionsRoutines.h"
+
+#include <cstddef>
+
+namespace Collishi {
+
+	//! Axis-aligned bounding box, touching bounds count as overlapping like in collision_box_box
+
+	struct Bounds {
+
+		float min_x;
+		float min_y;
+		float max_x;
+		float max_y;
+
+		constexpr bool overlaps(const Bounds& other) const {
+
+			return !(max_x < other.min_x || max_y < other.min_y || other.max_x < min_x || other.max_y < min_y);
+
+		}
+
+		constexpr Bounds merged(const Bounds& other) const {
+
+			return { (min_x < other.min_x ? min_x : other.min_x), (min_y < other.min_y ? min_y : other.min_y), (max_x > other.max_x ? max_x : other.max_x), (max_y > other.max_y ? max_y : other.max_y) };
+
+		}
+
+		constexpr float center_x() const {
+
+			return (min_x + max_x) * 0.5f;
+
+		}
+
+		constexpr float center_y() const {
+
+			return (min_y + max_y) * 0.5f;
+
+		}
+
+	};
+
+	struct Shape {
+
+		ShapeType type;
+		float values[6];
+
+		static constexpr Shape point(float x, float y) { return { ShapeType::point, { x, y, 0.0f, 0.0f, 0.0f, 0.0f } }; }
+		static constexpr Shape line(float x, float y, float dx, float dy) { return { ShapeType::line, { x, y, dx, dy, 0.0f, 0.0f } }; }
+		static constexpr Shape circle(float x, float y, float r) { return { ShapeType::circle, { x, y, r, 0.0f, 0.0f, 0.0f } }; }
+		static constexpr Shape box(float x, float y, float w, float h) { return { ShapeType::box, { x, y, w, h, 0.0f, 0.0f } }; }
+		static constexpr Shape triangle(float x, float y, float sxa, float sya, float sxb, float syb) { return { ShapeType::triangle, { x, y, sxa, sya, sxb, syb } }; }
+
+	};
+
+	//! The routine testing two shape types, with the information whether the shapes have to be swapped for it
+
+	struct RoutineSelection {
+
+		Routine routine;
+		bool swapped;
+
+	};
+
+	constexpr RoutineSelection select_routine(ShapeType first, ShapeType second) {
+
+		for (std::size_t r = 0; r < routine_count; r++) {
+
+			auto routine = static_cast<Routine>(r);
+
+			if (routine_first_shape(routine) == first && routine_second_shape(routine) == second) return { routine, false };
+			if (routine_first_shape(routine) == second && routine_second_shape(routine) == first) return { routine, true };
+
+		}
+
+		return { Routine::point_point, false };
+
+	}
+
+	constexpr bool collision(const Shape& a, const Shape& b) {
+
+		auto selection = select_routine(a.type, b.type);
+
+		auto& first = (selection.swapped ? b : a);
+		auto& second = (selection.swapped ? a : b);
+
+		auto first_arity = shape_arity(first.type);
+
+		float args[max_routine_arity] = {};
+
+		for (std::size_t i = 0; i < first_arity; i++) args[i] = first.values[i];
+		for (std::size_t i = 0; i < shape_arity(second.type); i++) args[first_arity + i] = second.values[i];
+
+		return invoke_routine(selection.routine, args);
+
+	}
+
+	//! Bounds of a shape, enlarged by a small margin, so rounding in the collision routines can never
+	//! produce a collision of two shapes whose bounds do not overlap
+
+	constexpr Bounds bounds(const Shape& shape) {
+
+		auto& v = shape.values;
+
+		float xs[3] = { v[0], v[0], v[0] };
+		float ys[3] = { v[1], v[1], v[1] };
+		float radius = 0.0f;
+
+		switch (shape.type) {
+
+			case ShapeType::point:
+				break;
+
+			case ShapeType::line:
+			case ShapeType::box:
+				xs[1] = v[0] + v[2];
+				ys[1] = v[1] + v[3];
+				break;
+
+			case ShapeType::circle:
+				radius = constexpr_abs(v[2]);
+				break;
+
+			case ShapeType::triangle:
+				xs[1] = v[0] + v[2];
+				ys[1] = v[1] + v[3];
+				xs[2] = v[0] + v[4];
+				ys[2] = v[1] + v[5];
+				break;
+
+		}
+
+		Bounds result = { xs[0], ys[0], xs[0], ys[0] };
+
+		for (int i = 1; i < 3; i++) result = result.merged({ xs[i], ys[i], xs[i], ys[i] });
+
+		auto magnitude = constexpr_abs(result.min_x);
+
+		for (auto value : { result.min_y, result.max_x, result.max_y, radius }) magnitude = (constexpr_abs(value) > magnitude ? constexpr_abs(value) : magnitude);
+
+		auto margin = radius + (magnitude + 1.0f) * 1e-5f;
+
+		return { result.min_x - margin, result.min_y - margin, result.max_x + margin, result.max_y + margin };
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+static_assert(Collishi::select_routine(Collishi::ShapeType::box, Collishi::ShapeType::circle).routine == Collishi::Routine::circle_box);
+static_assert(Collishi::select_routine(Collishi::ShapeType::box, Collishi::ShapeType::circle).swapped);
+
+static_assert(true == Collishi::collision(Collishi::Shape::box(-5.0f, -4.0f, 10.0f, 8.0f), Collishi::Shape::circle(1.0f, -3.0f, 4.0f)));
+static_assert(true == Collishi::collision(Collishi::Shape::circle(1.0f, -3.0f, 4.0f), Collishi::Shape::box(-5.0f, -4.0f, 10.0f, 8.0f)));
+static_assert(false == Collishi::collision(Collishi::Shape::triangle(4.0f, 4.0f, 1.0f, 0.0f, 1.0f, 1.0f), Collishi::Shape::triangle(0.0f, 3.0f, 1.0f, 2.0f, 3.0f, 2.0f)));
+
+static_assert(Collishi::bounds(Collishi::Shape::triangle(1.0f, 5.0f, 0.0f, -4.0f, -3.0f, -4.0f)).overlaps({ -2.0f, 1.0f, -2.0f, 1.0f }));
+static_assert(!Collishi::bounds(Collishi::Shape::circle(0.0f, 0.0f, 1.0f)).overlaps({ 1.1f, 0.0f, 2.0f, 1.0f }));
+
+#endif
@@ -0,0 +1,151 @@
+#pragma once
+
+//! Mapping of POSIX shared memory segments, used by the live metrics (CollisionsMetrics.h)
+//! and the query service (CollisionsService.h)
+//! The creator owns the segment and removes its name when it is closed, processes which still map it keep their mapping
+//!
+//! Everything placed in a segment has to be trivially copyable, and atomics in it have to be lock free,
+//! since they are shared between processes
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "CollisionsSharedMemory.h needs POSIX shared memory"
+#endif
+
+#include "CollisionsMemory.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Collishi {
+
+	static_assert(std::atomic<std::uint32_t>::is_always_lock_free && std::atomic<std::uint64_t>::is_always_lock_free, "Shared memory segments need lock free atomics");
+
+	class SharedMemory {
+
+	public:
+
+		SharedMemory() = default;
+		SharedMemory(const SharedMemory& other) = delete;
+		SharedMemory& operator=(const SharedMemory& other) = delete;
+
+		~SharedMemory() {
+
+			close();
+
+		}
+
+		//! Creates (or replaces) the segment, zero filled and mapped for reading and writing
+
+		bool create(const char* name, std::size_t size) {
+
+			close();
+
+			auto descriptor = shm_open(name, O_CREAT | O_RDWR, 0644);
+			if (descriptor < 0) return false;
+
+			//! Truncating to 0 first zeroes a replaced segment of an earlier run
+
+			if (ftruncate(descriptor, 0) != 0 || ftruncate(descriptor, static_cast<off_t>(size)) != 0 || !map(descriptor, size, true)) {
+
+				::close(descriptor);
+				shm_unlink(name);
+				return false;
+
+			}
+
+			::close(descriptor);
+
+			owned_name = name;
+
+			return true;
+
+		}
+
+		//! Maps the whole existing segment
+
+		bool open(const char* name, bool writable) {
+
+			close();
+
+			auto descriptor = shm_open(name, (writable ? O_RDWR : O_RDONLY), 0);
+			if (descriptor < 0) return false;
+
+			struct stat status;
+
+			auto mapped = (fstat(descriptor, &status) == 0 && status.st_size > 0 && map(descriptor, static_cast<std::size_t>(status.st_size), writable));
+
+			::close(descriptor);
+
+			return mapped;
+
+		}
+
+		//! Unmaps the segment and removes it if this object created it
+
+		void close() {
+
+			if (!memory) return;
+
+			munmap(memory, mapped_size);
+			if (!owned_name.empty()) shm_unlink(owned_name.c_str());
+
+			memory = nullptr;
+			mapped_size = 0;
+			owned_name.clear();
+
+		}
+
+		bool is_open() const {
+
+			return memory != nullptr;
+
+		}
+
+		void* data() const {
+
+			return memory;
+
+		}
+
+		std::size_t size() const {
+
+			return mapped_size;
+
+		}
+
+		//! The mapped bytes count as used and reserved, although the segment is shared with the other processes mapping it
+
+		MemoryStats memory_stats() const {
+
+			return { mapped_size, mapped_size, 0 };
+
+		}
+
+	private:
+
+		bool map(int descriptor, std::size_t size, bool writable) {
+
+			auto mapped = mmap(nullptr, size, (writable ? PROT_READ | PROT_WRITE : PROT_READ), MAP_SHARED, descriptor, 0);
+			if (mapped == MAP_FAILED) return false;
+
+			memory = mapped;
+			mapped_size = size;
+
+			return true;
+
+		}
+
+		void* memory = nullptr;
+		std::size_t mapped_size = 0;
+		std::string owned_name;
+
+	};
+
+}
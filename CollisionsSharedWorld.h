@@ -0,0 +1,107 @@
+#pragma once
+
+//! Queries of shapes and their bounding volume hierarchy which are stored in memory the world does not own
+//! SharedWorld only points to the arrays, e.g. in the shared memory segment of the query service (CollisionsService.h)
+//! or in a mapped world file (CollisionsWorldFile.h), so copies are cheap and the memory stays where it is
+
+#include "CollisionsBvh.h"
+#include "CollisionsShapes.h"
+#include "CollisionsTags.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Collishi {
+
+	//! The shapes and the hierarchy in memory owned by someone else, the same functions as StaticBvh
+
+	class SharedWorld {
+
+	public:
+
+		SharedWorld() = default;
+
+		SharedWorld(const Shape* shapes, const Bounds* shape_bounds, const BvhNode* nodes, const std::uint32_t* indices, std::size_t count)
+			: shapes(shapes), shape_bounds(shape_bounds), nodes(nodes), indices(indices), count(count) {}
+
+		std::size_t size() const {
+
+			return count;
+
+		}
+
+		const Shape& shape(std::uint32_t index) const {
+
+			return shapes[index];
+
+		}
+
+		//! Bounds of all shapes, empty bounds for an empty world
+
+		Bounds bounds() const {
+
+			return (count > 0 ? nodes[0].bounds : Bounds{});
+
+		}
+
+		//! Calls function(index) for every shape whose bounds overlap the given bounds
+
+		template <class F> void for_each_candidate(const Bounds& query, F&& function, CostTag tag = {}) const {
+
+			if (count == 0) return;
+
+			Tags::Measurement measurement(tag);
+
+			BvhQueryStats stats = {};
+
+			query_bvh(nodes, indices, shape_bounds, query, stats, function);
+
+			Tags::Measurement::add_nodes(stats.nodes_visited);
+
+		}
+
+		//! Calls function(index) for every shape which collides with the given shape
+
+		template <class F> void for_each_collision(const Shape& shape, F&& function, CostTag tag = {}) const {
+
+			Tags::Measurement measurement(tag);
+
+			std::size_t tests = 0;
+
+			for_each_candidate(Collishi::bounds(shape), [&](std::uint32_t index) {
+
+				tests++;
+
+				auto hit = collision(shapes[index], shape);
+
+				COLLISHI_METRICS_COUNT(select_routine(shapes[index].type, shape.type).routine, 1, hit);
+
+				if (hit) function(index);
+
+			});
+
+			Tags::Measurement::add_tests(tests);
+
+		}
+
+		bool any_collision(const Shape& shape) const {
+
+			bool found = false;
+
+			for_each_collision(shape, [&](std::uint32_t) { found = true; });
+
+			return found;
+
+		}
+
+	private:
+
+		const Shape* shapes = nullptr;
+		const Bounds* shape_bounds = nullptr;
+		const BvhNode* nodes = nullptr;
+		const std::uint32_t* indices = nullptr;
+		std::size_t count = 0;
+
+	};
+
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+//! Single pair variants of the SAT routines, which evaluate all separating axes at once in SIMD lanes
+//! The routines in Collisions.h test one axis after another and leave as soon as one axis separates the shapes,
+//! which is optimal for throughput on mostly separated pairs
+//! If only a single pair needs to be tested and its result is needed as soon as possible (e.g. the player against a boss hitbox),
+//! these variants avoid the chain of unpredictable branches: all projections are computed in parallel lanes
+//! and the separation flags of all axes are reduced with one movemask
+//!
+//! With AVX, the eight lanes are one register, with SSE they are two registers
+//! Without either, the variants simply call the routines in Collisions.h
+//! The results agree with the routines in Collisions.h up to rounding in touching configurations
+
+#include "Collisions.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define COLLISHI_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISHI_SIMD_SSE
+#endif
+
+namespace Collishi {
+
+#if defined(COLLISHI_SIMD_AVX) || defined(COLLISHI_SIMD_SSE)
+
+	namespace Simd {
+
+		//! Eight float lanes, each holding the value for one separating axis (or one shape in the batch kernels)
+
+		constexpr std::size_t lane_count = 8;
+
+#if defined(COLLISHI_SIMD_AVX)
+
+		struct Lanes {
+
+			__m256 v;
+
+		};
+
+		inline Lanes lanes(float a, float b, float c, float d, float e, float f, float g, float h) {
+
+			return { _mm256_setr_ps(a, b, c, d, e, f, g, h) };
+
+		}
+
+		inline Lanes broadcast(float value) {
+
+			return { _mm256_set1_ps(value) };
+
+		}
+
+		inline Lanes load(const float* values) {
+
+			return { _mm256_loadu_ps(values) };
+
+		}
+
+		//! Comparison results are lanes with all bits set (true) or cleared (false)
+
+		inline Lanes less(Lanes a, Lanes b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+		inline Lanes operator|(Lanes a, Lanes b) { return { _mm256_or_ps(a.v, b.v) }; }
+
+		//! Lanes of a where the mask is set, lanes of b elsewhere
+
+		inline Lanes select(Lanes mask, Lanes a, Lanes b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+
+		inline void store(float* values, Lanes a) {
+
+			_mm256_storeu_ps(values, a.v);
+
+		}
+
+		//! One bit per lane, lane 0 being the lowest bit
+
+		inline int movemask(Lanes mask) {
+
+			return _mm256_movemask_ps(mask.v);
+
+		}
+
+		inline Lanes operator+(Lanes a, Lanes b) { return { _mm256_add_ps(a.v, b.v) }; }
+		inline Lanes operator-(Lanes a, Lanes b) { return { _mm256_sub_ps(a.v, b.v) }; }
+		inline Lanes operator*(Lanes a, Lanes b) { return { _mm256_mul_ps(a.v, b.v) }; }
+		inline Lanes min(Lanes a, Lanes b) { return { _mm256_min_ps(a.v, b.v) }; }
+		inline Lanes max(Lanes a, Lanes b) { return { _mm256_max_ps(a.v, b.v) }; }
+		inline Lanes operator/(Lanes a, Lanes b) { return { _mm256_div_ps(a.v, b.v) }; }
+		inline Lanes sqrt(Lanes a) { return { _mm256_sqrt_ps(a.v) }; }
+
+		//! Lane mask of a < b or c < d, reduced to one bit per lane
+
+		inline int less_or_less(Lanes a, Lanes b, Lanes c, Lanes d) {
+
+			return _mm256_movemask_ps(_mm256_or_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ), _mm256_cmp_ps(c.v, d.v, _CMP_LT_OQ)));
+
+		}
+
+		//! sign_square from Collisions.h for all lanes: x * |x|
+
+		inline Lanes sign_square(Lanes x) {
+
+			auto absolute = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x.v);
+			return { _mm256_mul_ps(x.v, absolute) };
+
+		}
+
+#else
+
+		struct Lanes {
+
+			__m128 low;
+			__m128 high;
+
+		};
+
+		inline Lanes lanes(float a, float b, float c, float d, float e, float f, float g, float h) {
+
+			return { _mm_setr_ps(a, b, c, d), _mm_setr_ps(e, f, g, h) };
+
+		}
+
+		inline Lanes broadcast(float value) {
+
+			auto v = _mm_set1_ps(value);
+			return { v, v };
+
+		}
+
+		inline Lanes load(const float* values) {
+
+			return { _mm_loadu_ps(values), _mm_loadu_ps(values + 4) };
+
+		}
+
+		inline Lanes less(Lanes a, Lanes b) { return { _mm_cmplt_ps(a.low, b.low), _mm_cmplt_ps(a.high, b.high) }; }
+		inline Lanes operator|(Lanes a, Lanes b) { return { _mm_or_ps(a.low, b.low), _mm_or_ps(a.high, b.high) }; }
+
+		//! SSE2 has no blend instruction, so the selection is done with bit operations
+
+		inline Lanes select(Lanes mask, Lanes a, Lanes b) {
+
+			return { _mm_or_ps(_mm_and_ps(mask.low, a.low), _mm_andnot_ps(mask.low, b.low)), _mm_or_ps(_mm_and_ps(mask.high, a.high), _mm_andnot_ps(mask.high, b.high)) };
+
+		}
+
+		inline void store(float* values, Lanes a) {
+
+			_mm_storeu_ps(values, a.low);
+			_mm_storeu_ps(values + 4, a.high);
+
+		}
+
+		inline int movemask(Lanes mask) {
+
+			return _mm_movemask_ps(mask.low) | (_mm_movemask_ps(mask.high) << 4);
+
+		}
+
+		inline Lanes operator+(Lanes a, Lanes b) { return { _mm_add_ps(a.low, b.low), _mm_add_ps(a.high, b.high) }; }
+		inline Lanes operator-(Lanes a, Lanes b) { return { _mm_sub_ps(a.low, b.low), _mm_sub_ps(a.high, b.high) }; }
+		inline Lanes operator*(Lanes a, Lanes b) { return { _mm_mul_ps(a.low, b.low), _mm_mul_ps(a.high, b.high) }; }
+		inline Lanes min(Lanes a, Lanes b) { return { _mm_min_ps(a.low, b.low), _mm_min_ps(a.high, b.high) }; }
+		inline Lanes max(Lanes a, Lanes b) { return { _mm_max_ps(a.low, b.low), _mm_max_ps(a.high, b.high) }; }
+		inline Lanes operator/(Lanes a, Lanes b) { return { _mm_div_ps(a.low, b.low), _mm_div_ps(a.high, b.high) }; }
+		inline Lanes sqrt(Lanes a) { return { _mm_sqrt_ps(a.low), _mm_sqrt_ps(a.high) }; }
+
+		//! Both halves are combined before the single movemask, so the result only has the lower four bits
+
+		inline int less_or_less(Lanes a, Lanes b, Lanes c, Lanes d) {
+
+			auto low = _mm_or_ps(_mm_cmplt_ps(a.low, b.low), _mm_cmplt_ps(c.low, d.low));
+			auto high = _mm_or_ps(_mm_cmplt_ps(a.high, b.high), _mm_cmplt_ps(c.high, d.high));
+
+			return _mm_movemask_ps(_mm_or_ps(low, high));
+
+		}
+
+		inline Lanes sign_square(Lanes x) {
+
+			auto sign_mask = _mm_set1_ps(-0.0f);
+			return { _mm_mul_ps(x.low, _mm_andnot_ps(sign_mask, x.low)), _mm_mul_ps(x.high, _mm_andnot_ps(sign_mask, x.high)) };
+
+		}
+
+#endif
+
+		//! Projection of the point (x|y) on all axes
+
+		inline Lanes project(Lanes nx, Lanes ny, float x, float y) {
+
+			return nx * broadcast(x) + ny * broadcast(y);
+
+		}
+
+	}
+
+	inline bool collision_circle_box_simd(float x1, float y1, float r1, float x2, float y2, float w2, float h2) {
+
+		//! Box corners relative to the circle midpoint
+
+		auto dxm = x2 - x1;
+		auto dym = y2 - y1;
+		auto dxp = dxm + w2;
+		auto dyp = dym + h2;
+
+		//! Lanes 0 to 3: the directions to all four corners (one of them is the closest one used by the SAT)
+		//! Lanes 4 and 5: the cardinal axes, lanes 6 and 7 repeat the x axis
+		//! Testing the additional corner axes is harmless, since every axis that separates proves the separation
+
+		auto nx = Simd::lanes(dxm, dxm, dxp, dxp, 1.0f, 0.0f, 1.0f, 1.0f);
+		auto ny = Simd::lanes(dym, dyp, dym, dyp, 0.0f, 1.0f, 0.0f, 0.0f);
+
+		//! As in the scalar routine, the projections are squared (keeping their sign) to avoid the square root of |n|
+
+		auto p_mm = Simd::sign_square(Simd::project(nx, ny, dxm, dym));
+		auto p_mp = Simd::sign_square(Simd::project(nx, ny, dxm, dyp));
+		auto p_pm = Simd::sign_square(Simd::project(nx, ny, dxp, dym));
+		auto p_pp = Simd::sign_square(Simd::project(nx, ny, dxp, dyp));
+
+		auto box_min = Simd::min(Simd::min(p_mm, p_mp), Simd::min(p_pm, p_pp));
+		auto box_max = Simd::max(Simd::max(p_mm, p_mp), Simd::max(p_pm, p_pp));
+
+		auto radius_max = Simd::broadcast(r1 * r1) * (nx * nx + ny * ny);
+		auto radius_min = Simd::broadcast(0.0f) - radius_max;
+
+		return Simd::less_or_less(radius_max, box_min, box_max, radius_min) == 0;
+
+	}
+
+	inline bool collision_box_triangle_simd(float x1, float y1, float w1, float h1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		//! Triangle vertices relative to the box corner (x1|y1)
+
+		auto x21 = x2 - x1;
+		auto y21 = y2 - y1;
+
+		auto sxc2 = sxb2 - sxa2;
+		auto syc2 = syb2 - sya2;
+
+		//! Lanes 0 and 1: box normals, lanes 2 to 4: triangle edge normals, the remaining lanes repeat the x axis
+
+		auto nx = Simd::lanes(1.0f, 0.0f, -sya2, -syb2, -syc2, 1.0f, 1.0f, 1.0f);
+		auto ny = Simd::lanes(0.0f, 1.0f, sxa2, sxb2, sxc2, 0.0f, 0.0f, 0.0f);
+
+		//! The four box corners projected on all axes (the corner (0|0) projects to 0)
+
+		auto zero = Simd::broadcast(0.0f);
+
+		auto p_w = nx * Simd::broadcast(w1);
+		auto p_h = ny * Simd::broadcast(h1);
+		auto p_wh = p_w + p_h;
+
+		auto box_min = Simd::min(Simd::min(zero, p_w), Simd::min(p_h, p_wh));
+		auto box_max = Simd::max(Simd::max(zero, p_w), Simd::max(p_h, p_wh));
+
+		//! The three triangle vertices projected on all axes
+
+		auto t_0 = Simd::project(nx, ny, x21, y21);
+		auto t_a = t_0 + Simd::project(nx, ny, sxa2, sya2);
+		auto t_b = t_0 + Simd::project(nx, ny, sxb2, syb2);
+
+		auto triangle_min = Simd::min(t_0, Simd::min(t_a, t_b));
+		auto triangle_max = Simd::max(t_0, Simd::max(t_a, t_b));
+
+		return Simd::less_or_less(box_max, triangle_min, triangle_max, box_min) == 0;
+
+	}
+
+	inline bool collision_triangle_triangle_simd(float x1, float y1, float sxa1, float sya1, float sxb1, float syb1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		auto x21 = x2 - x1;
+		auto y21 = y2 - y1;
+
+		auto sxc1 = sxb1 - sxa1;
+		auto syc1 = syb1 - sya1;
+		auto sxc2 = sxb2 - sxa2;
+		auto syc2 = syb2 - sya2;
+
+		//! Lanes 0 to 5: the edge normals of both triangles, lanes 6 and 7 repeat the first normal
+
+		auto nx = Simd::lanes(-sya1, -syb1, -syc1, -sya2, -syb2, -syc2, -sya1, -sya1);
+		auto ny = Simd::lanes(sxa1, sxb1, sxc1, sxa2, sxb2, sxc2, sxa1, sxa1);
+
+		//! The first triangle relative to its own first vertex
+
+		auto zero = Simd::broadcast(0.0f);
+
+		auto p1_a = Simd::project(nx, ny, sxa1, sya1);
+		auto p1_b = Simd::project(nx, ny, sxb1, syb1);
+
+		auto min_1 = Simd::min(zero, Simd::min(p1_a, p1_b));
+		auto max_1 = Simd::max(zero, Simd::max(p1_a, p1_b));
+
+		//! The second triangle relative to the first vertex of the first triangle
+
+		auto p2_0 = Simd::project(nx, ny, x21, y21);
+		auto p2_a = p2_0 + Simd::project(nx, ny, sxa2, sya2);
+		auto p2_b = p2_0 + Simd::project(nx, ny, sxb2, syb2);
+
+		auto min_2 = Simd::min(p2_0, Simd::min(p2_a, p2_b));
+		auto max_2 = Simd::max(p2_0, Simd::max(p2_a, p2_b));
+
+		return Simd::less_or_less(max_1, min_2, max_2, min_1) == 0;
+
+	}
+
+#else
+
+	inline bool collision_circle_box_simd(float x1, float y1, float r1, float x2, float y2, float w2, float h2) {
+
+		return collision_circle_box(x1, y1, r1, x2, y2, w2, h2);
+
+	}
+
+	inline bool collision_box_triangle_simd(float x1, float y1, float w1, float h1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		return collision_box_triangle(x1, y1, w1, h1, x2, y2, sxa2, sya2, sxb2, syb2);
+
+	}
+
+	inline bool collision_triangle_triangle_simd(float x1, float y1, float sxa1, float sya1, float sxb1, float syb1, float x2, float y2, float sxa2, float sya2, float sxb2, float syb2) {
+
+		return collision_triangle_triangle(x1, y1, sxa1, sya1, sxb1, syb1, x2, y2, sxa2, sya2, sxb2, syb2);
+
+	}
+
+#endif
+
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+//! Collision data for static geometry known at compile time, e.g. menus or fixed arenas
+//! Since all collision routines are constexpr, both the table of overlapping shape pairs and the bounding volume
+//! hierarchy can be computed by the compiler, so there is nothing left to build at startup:
+//!
+//! constexpr std::array<Collishi::Shape, 3> arena = { Collishi::Shape::box(0, 0, 640, 16), ... };
+//! constexpr auto arena_table = Collishi::make_overlap_table(arena);
+//! constexpr auto arena_bvh = Collishi::make_static_bvh(arena);
+//!
+//! bool blocked = arena_bvh.any_collision(Collishi::Shape::circle(player_x, player_y, 8.0f));
+//!
+//! Large arrays may need a higher constexpr limit of the compiler (e.g. -fconstexpr-ops-limit for GCC)
+
+#include "CollisionsBvh.h"
+#include "CollisionsShapes.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Collishi {
+
+	//! Symmetric table with one bit for every pair of shapes, set if the shapes collide
+
+	template <std::size_t N> class OverlapTable {
+
+	public:
+
+		constexpr bool operator()(std::size_t i, std::size_t j) const {
+
+			auto bit = i * N + j;
+			return (words[bit / 64] >> (bit % 64)) & 1u;
+
+		}
+
+		constexpr void set(std::size_t i, std::size_t j) {
+
+			auto bit = i * N + j;
+			words[bit / 64] |= std::uint64_t(1) << (bit % 64);
+
+		}
+
+		//! Number of pairs (i|j) with i < j which collide
+
+		constexpr std::size_t pair_count() const {
+
+			std::size_t count = 0;
+
+			for (std::size_t i = 0; i < N; i++) {
+
+				for (std::size_t j = i + 1; j < N; j++) count += (*this)(i, j);
+
+			}
+
+			return count;
+
+		}
+
+	private:
+
+		std::array<std::uint64_t, (N * N + 63) / 64 + 1> words = {};
+
+	};
+
+	template <std::size_t N> constexpr OverlapTable<N> make_overlap_table(const std::array<Shape, N>& shapes) {
+
+		OverlapTable<N> table;
+
+		for (std::size_t i = 0; i < N; i++) {
+
+			for (std::size_t j = i; j < N; j++) {
+
+				if (!collision(shapes[i], shapes[j])) continue;
+
+				table.set(i, j);
+				table.set(j, i);
+
+			}
+
+		}
+
+		return table;
+
+	}
+
+	//! Bounding volume hierarchy over N shapes, with the shapes stored inside
+
+	template <std::size_t N> class StaticBvh {
+
+	public:
+
+		std::array<Shape, N> shapes = {};
+		std::array<Bounds, N> shape_bounds = {};
+		std::array<BvhNode, bvh_node_capacity(N)> nodes = {};
+		std::array<std::uint32_t, (N > 0 ? N : 1)> indices = {};
+		std::size_t node_count = 0;
+
+		//! Calls function(index) for every shape whose bounds overlap the given bounds
+
+		template <class F> constexpr void for_each_candidate(const Bounds& query, F&& function) const {
+
+			query_bvh(nodes.data(), indices.data(), shape_bounds.data(), query, function);
+
+		}
+
+		//! Calls function(index) for every shape which collides with the given shape
+
+		template <class F> constexpr void for_each_collision(const Shape& shape, F&& function) const {
+
+			for_each_candidate(bounds(shape), [&](std::uint32_t index) {
+
+				if (collision(shapes[index], shape)) function(index);
+
+			});
+
+		}
+
+		constexpr bool any_collision(const Shape& shape) const {
+
+			bool found = false;
+
+			for_each_collision(shape, [&](std::uint32_t) { found = true; });
+
+			return found;
+
+		}
+
+		constexpr BvhQuality quality() const {
+
+			return bvh_quality(nodes.data());
+
+		}
+
+	};
+
+	template <std::size_t N> constexpr StaticBvh<N> make_static_bvh(const std::array<Shape, N>& shapes) {
+
+		StaticBvh<N> bvh;
+
+		bvh.shapes = shapes;
+
+		for (std::size_t i = 0; i < N; i++) bvh.shape_bounds[i] = bounds(shapes[i]);
+
+		bvh.node_count = build_bvh(bvh.shape_bounds.data(), N, bvh.nodes.data(), bvh.indices.data());
+
+		return bvh;
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::StaticAssertions {
+
+	//! Walls of an arena with two pillars and a ramp
+
+	constexpr std::array<Shape, 7> arena = {
+
+		Shape::box(0.0f, 0.0f, 100.0f, 4.0f),
+		Shape::box(0.0f, 96.0f, 100.0f, 4.0f),
+		Shape::box(0.0f, 0.0f, 4.0f, 100.0f),
+		Shape::box(96.0f, 0.0f, 4.0f, 100.0f),
+		Shape::circle(30.0f, 50.0f, 6.0f),
+		Shape::circle(70.0f, 50.0f, 6.0f),
+		Shape::triangle(4.0f, 96.0f, 20.0f, 0.0f, 0.0f, -20.0f)
+
+	};
+
+	constexpr auto arena_table = make_overlap_table(arena);
+	constexpr auto arena_bvh = make_static_bvh(arena);
+
+	constexpr std::size_t collision_count(const Shape& shape) {
+
+		std::size_t count = 0;
+
+		arena_bvh.for_each_collision(shape, [&](std::uint32_t) { count++; });
+
+		return count;
+
+	}
+
+}
+
+static_assert(Collishi::StaticAssertions::arena_table(0, 2));
+static_assert(Collishi::StaticAssertions::arena_table(6, 1));
+static_assert(!Collishi::StaticAssertions::arena_table(4, 5));
+static_assert(Collishi::StaticAssertions::arena_table.pair_count() == 6);
+
+static_assert(Collishi::StaticAssertions::arena_bvh.node_count == 7);
+static_assert(Collishi::StaticAssertions::arena_bvh.quality().leaf_count == 4);
+static_assert(Collishi::StaticAssertions::arena_bvh.quality().max_depth == 2);
+static_assert(Collishi::StaticAssertions::arena_bvh.any_collision(Collishi::Shape::point(30.0f, 55.0f)));
+static_assert(!Collishi::StaticAssertions::arena_bvh.any_collision(Collishi::Shape::circle(50.0f, 50.0f, 10.0f)));
+static_assert(Collishi::StaticAssertions::collision_count(Collishi::Shape::line(2.0f, 50.0f, 96.0f, 0.0f)) == 4);
+static_assert(Collishi::StaticAssertions::collision_count(Collishi::Shape::box(-1.0f, -1.0f, 8.0f, 8.0f)) == 2);
+
+#endif
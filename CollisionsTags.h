@@ -0,0 +1,410 @@
+#pragma once
+
+//! Attribution of the collision costs to the calling systems (AI, weapons, triggers, physics, ...)
+//! A CostTag is a small id for a name. Batch calls and queries take a tag as their last argument, or use the tag of the
+//! enclosing CostScope; for each tag, the calls, the narrowphase tests, the visited hierarchy nodes and the time are summed
+//!
+//! auto weapons = Collishi::cost_tag("weapons");
+//! Collishi::invoke_routine_batch(Collishi::Routine::line_circle, args, count, results, weapons);
+//!
+//! {
+//!     Collishi::CostScope scope(Collishi::cost_tag("ai"));
+//!     tree.for_each_collision(sight_line, on_seen);
+//! }
+//!
+//! for (auto& entry : Collishi::end_cost_frame()) std::printf("%s %f ms\n", entry.name, entry.costs.nanoseconds * 1e-6);
+//!
+//! Untagged calls are not measured, so they only cost a check of a thread local variable
+//! Nested calls (e.g. the narrowphase of a broadphase) count into the outermost measured call
+
+#include "CollisionsMemory.h"
+#include "CollisionsThreadSlots.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Collishi {
+
+	//! Id 0 means no tag, i.e. the tag of the enclosing CostScope
+
+	struct CostTag {
+
+		std::uint16_t id = 0;
+
+		constexpr bool valid() const {
+
+			return id != 0;
+
+		}
+
+	};
+
+	struct TagCosts {
+
+		std::uint64_t calls = 0;
+		std::uint64_t tests = 0;
+		std::uint64_t nodes_visited = 0;
+		std::uint64_t nanoseconds = 0;
+
+		constexpr TagCosts& operator+=(const TagCosts& other) {
+
+			calls += other.calls;
+			tests += other.tests;
+			nodes_visited += other.nodes_visited;
+			nanoseconds += other.nanoseconds;
+
+			return *this;
+
+		}
+
+	};
+
+	struct TagFrameCosts {
+
+		const char* name;
+		CostTag tag;
+		TagCosts costs;
+
+	};
+
+	namespace Tags {
+
+		//! Tag names are registered once and never removed, further tags are all mapped to the last one ("other")
+
+		constexpr std::size_t max_tags = 256;
+
+		//! Costs of one thread since it took the slot, only the owning thread writes the counters
+		//! A frame reports the difference to the values of the last reset, so the reader never writes the counters and
+		//! a reset cannot be lost between the load and the store of the owner
+
+		class ThreadCosts {
+
+		public:
+
+			void add(CostTag tag, const TagCosts& costs) {
+
+				auto& counters = tags[tag.id];
+
+				increment(counters[0], costs.calls);
+				increment(counters[1], costs.tests);
+				increment(counters[2], costs.nodes_visited);
+				increment(counters[3], costs.nanoseconds);
+
+			}
+
+			TagCosts get(CostTag tag) const {
+
+				auto& counters = tags[tag.id];
+
+				return { counters[0].load(std::memory_order_relaxed), counters[1].load(std::memory_order_relaxed), counters[2].load(std::memory_order_relaxed), counters[3].load(std::memory_order_relaxed) };
+
+			}
+
+			//! Costs since the last reset, and with reset, starts the next frame at the current values
+			//! Only called by the registry under its lock
+
+			TagCosts unreported(CostTag tag, bool reset) {
+
+				auto current = get(tag);
+				auto& last = reported[tag.id];
+
+				TagCosts difference = { current.calls - last.calls, current.tests - last.tests, current.nodes_visited - last.nodes_visited, current.nanoseconds - last.nanoseconds };
+
+				if (reset) last = current;
+
+				return difference;
+
+			}
+
+			//! Only called by the owning thread when it exits, under the lock of the registry
+
+			void clear() {
+
+				for (auto& counters : tags) {
+
+					for (auto& counter : counters) counter.store(0, std::memory_order_relaxed);
+
+				}
+
+				reported = {};
+
+			}
+
+		private:
+
+			static void increment(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+
+				counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+
+			}
+
+			std::array<std::array<std::atomic<std::uint64_t>, 4>, max_tags> tags{};
+			std::array<TagCosts, max_tags> reported{};
+
+		};
+
+		class Registry {
+
+		public:
+
+			Registry() {
+
+				names.push_back("untagged");
+
+			}
+
+			//! When a thread exits, the costs it did not report yet are kept for the next frame and its slot is reused
+
+			ThreadSlots<ThreadCosts> costs{ [this](ThreadCosts& exited) {
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				for (std::size_t i = 1; i < names.size(); i++) retired[i] += exited.unreported({ static_cast<std::uint16_t>(i) }, true);
+
+				exited.clear();
+
+			} };
+
+			CostTag tag(const char* name) {
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				for (std::size_t i = 1; i < names.size(); i++) {
+
+					if (std::strcmp(names[i].c_str(), name) == 0) return { static_cast<std::uint16_t>(i) };
+
+				}
+
+				if (names.size() == max_tags - 1) names.push_back("other");
+				if (names.size() == max_tags) return { static_cast<std::uint16_t>(max_tags - 1) };
+
+				names.push_back(name);
+
+				return { static_cast<std::uint16_t>(names.size() - 1) };
+
+			}
+
+			//! Sums the costs of all threads per tag since the last reset, optionally starting the next frame
+
+			std::vector<TagFrameCosts> frame(bool reset) {
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				std::vector<TagCosts> sums(retired.begin(), retired.begin() + static_cast<std::ptrdiff_t>(names.size()));
+
+				costs.for_each([&](ThreadCosts& thread_costs) {
+
+					for (std::size_t i = 1; i < names.size(); i++) sums[i] += thread_costs.unreported({ static_cast<std::uint16_t>(i) }, reset);
+
+				});
+
+				if (reset) retired = {};
+
+				std::vector<TagFrameCosts> result;
+
+				for (std::size_t i = 1; i < names.size(); i++) {
+
+					if (sums[i].calls > 0) result.push_back({ names[i].c_str(), { static_cast<std::uint16_t>(i) }, sums[i] });
+
+				}
+
+				return result;
+
+			}
+
+			MemoryStats memory_stats() {
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				auto names_size = names.size() * sizeof(std::string);
+				auto costs_size = costs.size() * sizeof(ThreadCosts);
+
+				return costs.memory_stats() + MemoryStats{ names_size + costs_size, names_size + costs_size, 0 };
+
+			}
+
+		private:
+
+			std::mutex mutex;
+
+			//! The names are never removed and a deque does not move them, so TagFrameCosts can point to them
+
+			std::deque<std::string> names;
+
+			//! Costs which threads did not report before they exited
+
+			std::array<TagCosts, max_tags> retired{};
+
+		};
+
+		inline Registry& registry() {
+
+			static Registry instance;
+			return instance;
+
+		}
+
+		inline ThreadCosts& thread_costs() {
+
+			thread_local ThreadSlot<ThreadCosts> costs(registry().costs);
+			return *costs;
+
+		}
+
+		class Measurement;
+
+		//! Trivial thread locals, so the check of an untagged call needs no initialization guard
+
+		inline thread_local std::uint16_t scope_tag;
+		inline thread_local Measurement* active;
+
+		//! Measures one call of a batch function or query, if it has a tag and no outer call on this thread is measured
+
+		class Measurement {
+
+		public:
+
+			explicit Measurement(CostTag tag) {
+
+				if (active || (!tag.valid() && scope_tag == 0)) return;
+
+				this->tag = (tag.valid() ? tag : CostTag{ scope_tag });
+				active = this;
+				begin = std::chrono::steady_clock::now();
+
+			}
+
+			Measurement(const Measurement& other) = delete;
+			Measurement& operator=(const Measurement& other) = delete;
+
+			~Measurement() {
+
+				if (active != this) return;
+
+				active = nullptr;
+
+				costs.calls = 1;
+				costs.nanoseconds = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+
+				thread_costs().add(tag, costs);
+
+			}
+
+			//! These count into the measured call of this thread, if there is one
+
+			static void add_tests(std::uint64_t tests) {
+
+				if (active) active->costs.tests += tests;
+
+			}
+
+			static void add_nodes(std::uint64_t nodes) {
+
+				if (active) active->costs.nodes_visited += nodes;
+
+			}
+
+		private:
+
+			CostTag tag;
+			TagCosts costs;
+			std::chrono::steady_clock::time_point begin;
+
+		};
+
+	}
+
+	//! Returns the tag of the name, registering it on the first call
+	//! This takes a lock, so the tags should be looked up once and stored
+
+	inline CostTag cost_tag(const char* name) {
+
+		return Tags::registry().tag(name);
+
+	}
+
+	//! Untagged calls inside the scope (on the same thread) are attributed to its tag
+
+	class CostScope {
+
+	public:
+
+		explicit CostScope(CostTag tag) : previous(Tags::scope_tag) {
+
+			Tags::scope_tag = tag.id;
+
+		}
+
+		CostScope(const CostScope& other) = delete;
+		CostScope& operator=(const CostScope& other) = delete;
+
+		~CostScope() {
+
+			Tags::scope_tag = previous;
+
+		}
+
+	private:
+
+		std::uint16_t previous;
+
+	};
+
+	//! Tag names and the costs of all threads
+
+	inline MemoryStats cost_tags_memory_stats() {
+
+		return Tags::registry().memory_stats();
+
+	}
+
+	//! Costs per tag since the last end_cost_frame, summed over all threads, only tags with calls are listed
+
+	inline std::vector<TagFrameCosts> cost_frame() {
+
+		return Tags::registry().frame(false);
+
+	}
+
+	//! Same as cost_frame, and starts the next frame
+	//! Tagged calls which end on other threads meanwhile are counted in exactly one of the two frames
+
+	inline std::vector<TagFrameCosts> end_cost_frame() {
+
+		return Tags::registry().frame(true);
+
+	}
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::TagsAssertions {
+
+	constexpr TagCosts sum() {
+
+		TagCosts costs = { 1, 10, 4, 500 };
+		costs += TagCosts{ 2, 5, 0, 100 };
+
+		return costs;
+
+	}
+
+	static_assert(sum().calls == 3);
+	static_assert(sum().tests == 15);
+	static_assert(sum().nodes_visited == 4);
+	static_assert(sum().nanoseconds == 600);
+
+	static_assert(!CostTag{}.valid());
+	static_assert(CostTag{ 1 }.valid());
+
+}
+
+#endif
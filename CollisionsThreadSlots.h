@@ -0,0 +1,154 @@
+#pragma once
+
+//! Per-thread state of the instrumentation (trace buffers, profile histograms, metrics counters and tag costs)
+//! Each thread writes into its own slot without locks, and readers walk all slots. The batch kernels start new threads
+//! on every call, so a slot is handed back when its thread exits and reused by the next thread which needs one:
+//! the number of slots is the largest number of threads which used them at the same time, not the number of threads ever started
+//!
+//! ThreadSlots<T> owns the slots, ThreadSlot<T> is the thread local handle which takes a slot and returns it:
+//!
+//! thread_local ThreadSlot<ThreadBuffer> buffer(registry());
+//! buffer->push(event);
+//!
+//! When a thread exits, the retire function is called on that thread before its slot is freed, so the owner of the slots
+//! can fold the values into a total (and has to synchronize this with its readers)
+
+#include "CollisionsMemory.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Collishi {
+
+	template <class T> class ThreadSlots {
+
+	public:
+
+		using Retire = std::function<void(T&)>;
+
+		explicit ThreadSlots(Retire retire = {}) : retire(std::move(retire)) {}
+
+		ThreadSlots(const ThreadSlots& other) = delete;
+		ThreadSlots& operator=(const ThreadSlots& other) = delete;
+
+		//! Index of a free slot, a new slot is only created if all slots are taken
+
+		std::size_t acquire() {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (!free.empty()) {
+
+				auto index = free.back();
+				free.pop_back();
+
+				return index;
+
+			}
+
+			slots.push_back(std::make_unique<T>());
+
+			return slots.size() - 1;
+
+		}
+
+		//! The slots are allocated separately, so the reference stays valid while other threads create slots
+
+		T& operator[](std::size_t index) {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			return *slots[index];
+
+		}
+
+		void release(std::size_t index) {
+
+			auto& object = (*this)[index];
+
+			if (retire) retire(object);
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			free.push_back(index);
+
+		}
+
+		//! Calls function for every slot in the order of creation, including the free ones
+
+		template <class F> void for_each(F&& function) {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			for (auto& slot : slots) function(*slot);
+
+		}
+
+		std::size_t size() {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			return slots.size();
+
+		}
+
+		//! Memory of the list of slots, the owner adds the memory of the objects
+
+		MemoryStats memory_stats() {
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			return Collishi::memory_stats(slots) + Collishi::memory_stats(free);
+
+		}
+
+	private:
+
+		Retire retire;
+
+		std::mutex mutex;
+		std::vector<std::unique_ptr<T>> slots;
+		std::vector<std::size_t> free;
+
+	};
+
+	template <class T> class ThreadSlot {
+
+	public:
+
+		explicit ThreadSlot(ThreadSlots<T>& slots) : slots(slots), index(slots.acquire()), object(&slots[index]) {}
+
+		ThreadSlot(const ThreadSlot& other) = delete;
+		ThreadSlot& operator=(const ThreadSlot& other) = delete;
+
+		~ThreadSlot() {
+
+			slots.release(index);
+
+		}
+
+		T& operator*() const {
+
+			return *object;
+
+		}
+
+		T* operator->() const {
+
+			return object;
+
+		}
+
+	private:
+
+		ThreadSlots<T>& slots;
+		std::size_t index;
+		T* object;
+
+	};
+
+}
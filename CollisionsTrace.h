@@ -0,0 +1,227 @@
+#pragma once
+
+//! Optional timeline tracing of the Collishi phases and batch calls
+//! If COLLISHI_TRACE is defined before including any Collishi header, scoped trace markers record
+//! the begin and duration of each phase into a ring buffer per thread
+//! Trace::write_chrome_json writes them in the Chrome trace event format, which can be opened in
+//! chrome://tracing or ui.perfetto.dev
+//! The buffer of a thread is handed back when the thread exits and reused by the next thread, so the threads which the
+//! batch kernels start on every call share a few buffers. Every event keeps the number of its thread, so each thread
+//! is still one row of the timeline
+//!
+//! Without COLLISHI_TRACE, the markers expand to nothing, so tracing has no cost at all
+//!
+//! Own code can be marked the same way, for example to separate the phases of a frame:
+//! COLLISHI_TRACE_SCOPE("phase", "broadphase");
+
+#define COLLISHI_TRACE_CONCAT_INNER(a, b) a##b
+#define COLLISHI_TRACE_CONCAT(a, b) COLLISHI_TRACE_CONCAT_INNER(a, b)
+
+#ifdef COLLISHI_TRACE
+
+#include "CollisionsMemory.h"
+#include "CollisionsThreadSlots.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+//! Number of events each thread keeps, older events are overwritten
+
+#ifndef COLLISHI_TRACE_EVENTS_PER_THREAD
+#define COLLISHI_TRACE_EVENTS_PER_THREAD (1 << 16)
+#endif
+
+namespace Collishi::Trace {
+
+	struct Event {
+
+		const char* category;
+		const char* name;
+		std::uint64_t begin_ns;
+		std::uint64_t duration_ns;
+
+		//! Number of the thread, counted from 1 in the order in which the threads recorded their first event
+
+		std::uint32_t thread;
+
+	};
+
+	class ThreadBuffer {
+
+	public:
+
+		ThreadBuffer() : events(COLLISHI_TRACE_EVENTS_PER_THREAD) {}
+
+		void push(const Event& event) {
+
+			auto index = written.load(std::memory_order_relaxed);
+
+			events[index % events.size()] = event;
+			written.store(index + 1, std::memory_order_release);
+
+		}
+
+		//! Calls function for each stored event, from the oldest to the newest
+
+		template <class F> void for_each(F&& function) const {
+
+			auto end = written.load(std::memory_order_acquire);
+			auto begin = (end > events.size() ? end - events.size() : 0);
+
+			for (auto i = begin; i < end; i++) function(events[i % events.size()]);
+
+		}
+
+		void clear() {
+
+			written.store(0, std::memory_order_release);
+
+		}
+
+		//! The ring buffer is allocated completely when a thread records its first event
+
+		MemoryStats memory_stats() const {
+
+			auto stored = std::min(written.load(std::memory_order_acquire), events.size());
+
+			return { stored * sizeof(Event), events.capacity() * sizeof(Event), 0 };
+
+		}
+
+	private:
+
+		std::vector<Event> events;
+		std::atomic<std::size_t> written{ 0 };
+
+	};
+
+	inline ThreadSlots<ThreadBuffer>& registry() {
+
+		static ThreadSlots<ThreadBuffer> instance;
+		return instance;
+
+	}
+
+	inline ThreadBuffer& thread_buffer() {
+
+		thread_local ThreadSlot<ThreadBuffer> buffer(registry());
+		return *buffer;
+
+	}
+
+	inline std::uint32_t thread_number() {
+
+		static std::atomic<std::uint32_t> threads{ 0 };
+		thread_local const std::uint32_t number = ++threads;
+
+		return number;
+
+	}
+
+	inline std::uint64_t now_ns() {
+
+		static const auto epoch = std::chrono::steady_clock::now();
+
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+
+	}
+
+	class Scope {
+
+	public:
+
+		Scope(const char* category, const char* name) : category(category), name(name), begin(now_ns()) {}
+
+		Scope(const Scope& other) = delete;
+		Scope& operator=(const Scope& other) = delete;
+
+		~Scope() {
+
+			thread_buffer().push({ category, name, begin, now_ns() - begin, thread_number() });
+
+		}
+
+	private:
+
+		const char* category;
+		const char* name;
+		std::uint64_t begin;
+
+	};
+
+	//! Writes all recorded events of all threads as Chrome trace JSON
+	//! This should be called while no traced code is running, e.g. at the end of a frame
+
+	inline bool write_chrome_json(const char* filename) {
+
+		auto file = std::fopen(filename, "w");
+		if (!file) return false;
+
+		std::fprintf(file, "{\"traceEvents\":[");
+
+		const char* separator = "\n";
+		std::vector<std::uint32_t> threads;
+
+		registry().for_each([&](const ThreadBuffer& buffer) {
+
+			buffer.for_each([&](const Event& event) {
+
+				std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					separator, event.name, event.category, event.thread, event.begin_ns * 1e-3, event.duration_ns * 1e-3);
+
+				separator = ",\n";
+				threads.push_back(event.thread);
+
+			});
+
+		});
+
+		std::sort(threads.begin(), threads.end());
+		threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+		for (auto thread : threads) {
+
+			std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Collishi thread %u\"}}", separator, thread, thread);
+			separator = ",\n";
+
+		}
+
+		std::fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+		return std::fclose(file) == 0;
+
+	}
+
+	//! Discards all recorded events
+
+	inline void clear() {
+
+		registry().for_each([](ThreadBuffer& buffer) { buffer.clear(); });
+
+	}
+
+	//! Memory of the buffers, including the free ones which keep the events of exited threads
+
+	inline MemoryStats memory_stats() {
+
+		auto stats = registry().memory_stats();
+
+		registry().for_each([&](const ThreadBuffer& buffer) { stats += buffer.memory_stats(); });
+
+		return stats;
+
+	}
+
+}
+
+#define COLLISHI_TRACE_SCOPE(category, name) ::Collishi::Trace::Scope COLLISHI_TRACE_CONCAT(collishi_trace_scope_, __LINE__)(category, name)
+
+#else
+
+#define COLLISHI_TRACE_SCOPE(category, name) ((void) 0)
+
+#endif
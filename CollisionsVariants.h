@@ -0,0 +1,390 @@
+#pragma once
+
+//! Registry of interchangeable implementations (variants) of the collision routines
+//! Which implementation is the fastest depends on the machine and on the data, e.g. the SIMD variants win on pairs
+//! which are rarely separated early, the routines in Collisions.h win on mostly separated pairs
+//!
+//! Every routine has the variant "original" (the routine in Collisions.h), which is selected by default
+//! The autotuner verifies all variants of a routine against the reference routines on representative data,
+//! measures the verified ones and selects the fastest; the selection can be saved and loaded again at startup:
+//!
+//! auto& registry = Collishi::variant_registry();
+//! if (!registry.load("collishi_variants.txt")) { /* run tools/autotune.cpp or call autotune() */ }
+//! bool hit = registry.invoke(Collishi::Routine::circle_box, args);
+//!
+//! Calls through the registry are indirect calls, so it pays off for the more expensive routines and for batches
+
+#include "Collisions.h"
+#include "CollisionsMemory.h"
+#include "CollisionsReference.h"
+#include "CollisionsRoutines.h"
+#include "CollisionsSat.h"
+#include "CollisionsSimd.h"
+#include "CollisionsTags.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Collishi {
+
+	//! Implementation of a routine, called with its arguments taken from a flat array like invoke_routine
+
+	using RoutineImplementation = bool (*)(const float* args);
+
+	struct RoutineVariant {
+
+		std::string name;
+		Routine routine;
+		RoutineImplementation implementation;
+
+	};
+
+	namespace Variants {
+
+		template <Routine R> bool original(const float* a) {
+
+			return invoke_routine(R, a);
+
+		}
+
+		//! Edge functions: the point is inside if it is not on different sides of two edges
+
+		inline bool point_triangle_edges(const float* a) {
+
+			auto px = a[0] - a[2];
+			auto py = a[1] - a[3];
+			auto sxa = a[4];
+			auto sya = a[5];
+			auto sxb = a[6];
+			auto syb = a[7];
+
+			auto side_0a = sxa * py - sya * px;
+			auto side_ab = (sxb - sxa) * (py - sya) - (syb - sya) * (px - sxa);
+			auto side_b0 = syb * (px - sxb) - sxb * (py - syb);
+
+			auto negative = (side_0a < 0.0f) | (side_ab < 0.0f) | (side_b0 < 0.0f);
+			auto positive = (side_0a > 0.0f) | (side_ab > 0.0f) | (side_b0 > 0.0f);
+
+			return !(negative && positive);
+
+		}
+
+		//! Closest point of the box to the circle midpoint by clamping, instead of the SAT
+
+		inline bool circle_box_clamp(const float* a) {
+
+			auto closest_x = (a[0] < a[3] ? a[3] : (a[0] > a[3] + a[5] ? a[3] + a[5] : a[0]));
+			auto closest_y = (a[1] < a[4] ? a[4] : (a[1] > a[4] + a[6] ? a[4] + a[6] : a[1]));
+
+			auto dx = a[0] - closest_x;
+			auto dy = a[1] - closest_y;
+
+			return dx * dx + dy * dy <= a[2] * a[2];
+
+		}
+
+		inline bool box_box_branchless(const float* a) {
+
+			return !((a[0] + a[2] < a[4]) | (a[1] + a[3] < a[5]) | (a[4] + a[6] < a[0]) | (a[5] + a[7] < a[1]));
+
+		}
+
+		inline bool circle_box_simd(const float* a) {
+
+			return collision_circle_box_simd(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+
+		}
+
+		inline bool box_triangle_simd(const float* a) {
+
+			return collision_box_triangle_simd(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+
+		}
+
+		inline bool triangle_triangle_simd(const float* a) {
+
+			return collision_triangle_triangle_simd(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]);
+
+		}
+
+		inline bool box_box_sat(const float* a) {
+
+			return Sat::collision(Sat::Box{ a[0], a[1], a[2], a[3] }, Sat::Box{ a[4], a[5], a[6], a[7] });
+
+		}
+
+		inline bool box_triangle_sat(const float* a) {
+
+			return Sat::collision(Sat::Box{ a[0], a[1], a[2], a[3] }, Sat::Polygon<3>{ a[4], a[5], { a[6], a[7], a[8], a[9] } });
+
+		}
+
+		inline bool triangle_triangle_sat(const float* a) {
+
+			return Sat::collision(Sat::Polygon<3>{ a[0], a[1], { a[2], a[3], a[4], a[5] } }, Sat::Polygon<3>{ a[6], a[7], { a[8], a[9], a[10], a[11] } });
+
+		}
+
+	}
+
+	class VariantRegistry {
+
+	public:
+
+		//! Registers the original routines and all alternative implementations in this header
+
+		VariantRegistry() {
+
+#define COLLISHI_ADD_ORIGINAL_VARIANT(name, arity, first, second) add({ "original", Routine::name, Variants::original<Routine::name> });
+			COLLISHI_ROUTINE_LIST(COLLISHI_ADD_ORIGINAL_VARIANT)
+#undef COLLISHI_ADD_ORIGINAL_VARIANT
+
+			add({ "edges", Routine::point_triangle, Variants::point_triangle_edges });
+			add({ "clamp", Routine::circle_box, Variants::circle_box_clamp });
+			add({ "simd", Routine::circle_box, Variants::circle_box_simd });
+			add({ "branchless", Routine::box_box, Variants::box_box_branchless });
+			add({ "sat", Routine::box_box, Variants::box_box_sat });
+			add({ "simd", Routine::box_triangle, Variants::box_triangle_simd });
+			add({ "sat", Routine::box_triangle, Variants::box_triangle_sat });
+			add({ "simd", Routine::triangle_triangle, Variants::triangle_triangle_simd });
+			add({ "sat", Routine::triangle_triangle, Variants::triangle_triangle_sat });
+
+		}
+
+		//! Adds a variant, or replaces the variant of the routine with the same name
+
+		void add(const RoutineVariant& variant) {
+
+			auto& list = lists[static_cast<std::size_t>(variant.routine)];
+
+			for (auto& existing : list) {
+
+				if (existing.name != variant.name) continue;
+
+				existing = variant;
+				return;
+
+			}
+
+			list.push_back(variant);
+
+		}
+
+		const std::vector<RoutineVariant>& variants(Routine routine) const {
+
+			return lists[static_cast<std::size_t>(routine)];
+
+		}
+
+		//! Returns false (and keeps the current selection) if the routine has no variant with this name
+
+		bool select(Routine routine, const std::string& name) {
+
+			auto& list = lists[static_cast<std::size_t>(routine)];
+
+			for (std::size_t i = 0; i < list.size(); i++) {
+
+				if (list[i].name != name) continue;
+
+				selection[static_cast<std::size_t>(routine)] = i;
+				return true;
+
+			}
+
+			return false;
+
+		}
+
+		const RoutineVariant& selected(Routine routine) const {
+
+			return lists[static_cast<std::size_t>(routine)][selection[static_cast<std::size_t>(routine)]];
+
+		}
+
+		bool invoke(Routine routine, const float* args) const {
+
+			return selected(routine).implementation(args);
+
+		}
+
+		void invoke_batch(Routine routine, const float* args, std::size_t count, bool* results, CostTag tag = {}) const {
+
+			Tags::Measurement measurement(tag);
+			Tags::Measurement::add_tests(count);
+
+			auto implementation = selected(routine).implementation;
+			auto arity = routine_arity(routine);
+
+			for (std::size_t i = 0; i < count; i++) results[i] = implementation(args + i * arity);
+
+			COLLISHI_METRICS_COUNT_RESULTS(routine, results, count);
+
+		}
+
+		//! Writes one line "<routine name> <variant name>" per routine
+
+		bool save(const char* filename) const {
+
+			auto file = std::fopen(filename, "w");
+			if (!file) return false;
+
+			std::fprintf(file, "# Collishi variant selection\n");
+
+			for (std::size_t r = 0; r < routine_count; r++) {
+
+				auto routine = static_cast<Routine>(r);
+				std::fprintf(file, "%s %s\n", routine_name(routine), selected(routine).name.c_str());
+
+			}
+
+			return std::fclose(file) == 0;
+
+		}
+
+		//! Returns false if the file cannot be read
+		//! Entries of unknown routines or variants (e.g. written by a newer version) keep the current selection
+
+		bool load(const char* filename) {
+
+			auto file = std::fopen(filename, "r");
+			if (!file) return false;
+
+			char line[256];
+
+			while (std::fgets(line, sizeof(line), file)) {
+
+				char routine[128];
+				char variant[128];
+
+				if (line[0] == '#') continue;
+				if (std::sscanf(line, "%127s %127s", routine, variant) != 2) continue;
+
+				for (std::size_t r = 0; r < routine_count; r++) {
+
+					if (std::string(routine_name(static_cast<Routine>(r))) == routine) select(static_cast<Routine>(r), variant);
+
+				}
+
+			}
+
+			std::fclose(file);
+
+			return true;
+
+		}
+
+		//! The variant names are not counted, they are short enough to be stored in the strings themselves
+
+		MemoryStats memory_stats() const {
+
+			MemoryStats stats;
+
+			for (auto& list : lists) stats += Collishi::memory_stats(list);
+
+			return stats;
+
+		}
+
+	private:
+
+		std::array<std::vector<RoutineVariant>, routine_count> lists;
+		std::array<std::size_t, routine_count> selection = {};
+
+	};
+
+	//! The registry used by the application, e.g. loaded once at startup
+
+	inline VariantRegistry& variant_registry() {
+
+		static VariantRegistry registry;
+		return registry;
+
+	}
+
+	//! Number of cases among count argument sets where the variant differs from the reference routine,
+	//! not counting cases within the rounding error of single precision (like test_differential.cpp)
+
+	inline std::size_t variant_mismatches(const RoutineVariant& variant, const float* args, std::size_t count) {
+
+		auto arity = routine_arity(variant.routine);
+
+		std::size_t mismatches = 0;
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			auto case_args = args + i * arity;
+
+			if (variant.implementation(case_args) == Reference::invoke_routine(variant.routine, case_args)) continue;
+			if (!Reference::ambiguous(variant.routine, case_args)) mismatches++;
+
+		}
+
+		return mismatches;
+
+	}
+
+	struct VariantTiming {
+
+		std::string name;
+		std::size_t mismatches;
+		std::size_t hits;
+		double nanoseconds;
+
+	};
+
+	//! Verifies and measures every variant of the routine on count argument sets (best of the repetitions, hits of one pass)
+	//! and selects the fastest variant without mismatches; variants with mismatches are not measured (nanoseconds is 0)
+
+	inline std::vector<VariantTiming> autotune(VariantRegistry& registry, Routine routine, const float* args, std::size_t count, int repetitions = 5) {
+
+		using Clock = std::chrono::steady_clock;
+
+		auto arity = routine_arity(routine);
+
+		std::vector<VariantTiming> timings;
+		std::string fastest = "original";
+		double fastest_nanoseconds = 0.0;
+
+		for (auto& variant : registry.variants(routine)) {
+
+			VariantTiming timing = { variant.name, variant_mismatches(variant, args, count), 0, 0.0 };
+
+			for (int repetition = 0; repetition < repetitions && timing.mismatches == 0 && count > 0; repetition++) {
+
+				std::size_t hits = 0;
+
+				auto begin = Clock::now();
+
+				for (std::size_t i = 0; i < count; i++) hits += variant.implementation(args + i * arity);
+
+				auto nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / static_cast<double>(count);
+
+				//! The hits are returned, so the loop cannot be removed
+
+				timing.hits = hits;
+
+				if (repetition == 0 || nanoseconds < timing.nanoseconds) timing.nanoseconds = nanoseconds;
+
+			}
+
+			if (timing.mismatches == 0 && timing.nanoseconds > 0.0 && (fastest_nanoseconds == 0.0 || timing.nanoseconds < fastest_nanoseconds)) {
+
+				fastest = timing.name;
+				fastest_nanoseconds = timing.nanoseconds;
+
+			}
+
+			timings.push_back(timing);
+
+		}
+
+		registry.select(routine, fastest);
+
+		return timings;
+
+	}
+
+}
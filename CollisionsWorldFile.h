@@ -0,0 +1,817 @@
+#pragma once
+
+//! Static worlds stored as files which are mapped into memory, with a prefetcher which reads the pages of the regions
+//! players are about to query before the queries touch them
+//!
+//! write_world_file stores the shapes, their bounds and their bounding volume hierarchy, laid out in blocks: every block is a
+//! subtree of at most block_shapes shapes whose nodes, shapes and bounds are each contiguous in the file. The nodes above the blocks
+//! come first, they are visited by most queries and read when the file is opened. The shapes are stored in the order of the
+//! leaves, so queries report positions in the file, which original_index maps back to the index passed to write_world_file:
+//!
+//! Collishi::write_world_file("level.world", shapes.data(), shapes.size());
+//!
+//! Collishi::MappedWorld level;
+//! level.open("level.world");
+//!
+//! Collishi::WorldPrefetcher prefetcher(level);
+//!
+//! // every frame
+//! for (auto& player : players) prefetcher.prefetch_motion(player.x, player.y, player.velocity_x, player.velocity_y, query_radius);
+//! prefetcher.tick();
+//!
+//! level.world().for_each_collision(shape, on_collision); // positions, level.original_index(position) is the original index
+//!
+//! The prefetcher advises the kernel with madvise(MADV_WILLNEED), which starts reading the pages in the background,
+//! so the queries of the next frames find them in memory instead of stalling on a page fault
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "CollisionsWorldFile.h needs POSIX memory mapping"
+#endif
+
+#include "CollisionsBvh.h"
+#include "CollisionsMemory.h"
+#include "CollisionsShapes.h"
+#include "CollisionsSharedWorld.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Collishi {
+
+	static_assert(std::is_trivially_copyable_v<Shape> && std::is_trivially_copyable_v<Bounds> && std::is_trivially_copyable_v<BvhNode>, "The world is mapped from the file as it is");
+
+	constexpr char world_file_magic[8] = { 'C', 'O', 'L', 'L', 'W', 'L', 'D', '\0' };
+	constexpr std::uint32_t world_file_version = 1;
+
+	//! Every section starts on a new page (16 KiB covers the largest common page size), so advising one section never reads another
+
+	constexpr std::uint64_t world_file_alignment = 16384;
+
+	//! Shapes per block, a block of 256 shapes takes a few pages of nodes, shapes and bounds
+
+	constexpr std::size_t default_block_shapes = 256;
+
+	struct WorldFileHeader {
+
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t shape_size;
+		std::uint32_t node_size;
+		std::uint32_t block_shapes;
+
+		std::uint64_t shape_count;
+		std::uint64_t node_count;
+		std::uint64_t upper_node_count;
+		std::uint64_t block_count;
+
+		std::uint64_t shapes_offset;
+		std::uint64_t bounds_offset;
+		std::uint64_t nodes_offset;
+		std::uint64_t indices_offset;
+		std::uint64_t ids_offset;
+		std::uint64_t blocks_offset;
+		std::uint64_t file_size;
+
+	};
+
+	//! Subtree whose root is one of the upper nodes, its other nodes are [first_node, end_node) and its shapes [first_shape, end_shape)
+
+	struct WorldBlock {
+
+		Bounds bounds;
+		std::uint32_t first_node;
+		std::uint32_t end_node;
+		std::uint32_t first_shape;
+		std::uint32_t end_shape;
+
+	};
+
+	namespace WorldFile {
+
+		constexpr std::uint64_t align(std::uint64_t offset) {
+
+			return (offset + world_file_alignment - 1) / world_file_alignment * world_file_alignment;
+
+		}
+
+		//! Nodes of a subtree in the order of the file: both children of a node are placed next to each other,
+		//! then the subtree of the first child, then the subtree of the second child
+
+		inline void place_subtree(const BvhNode* nodes, std::uint32_t root, std::uint32_t position, std::vector<BvhNode>& placed) {
+
+			struct Task {
+
+				std::uint32_t node;
+				std::uint32_t position;
+
+			};
+
+			std::vector<Task> stack = { { root, position } };
+
+			while (!stack.empty()) {
+
+				auto task = stack.back();
+				stack.pop_back();
+
+				auto node = nodes[task.node];
+
+				if (node.leaf()) {
+
+					placed[task.position] = node;
+					continue;
+
+				}
+
+				auto children = static_cast<std::uint32_t>(placed.size());
+				placed.resize(placed.size() + 2);
+
+				placed[task.position] = { node.bounds, children, 0 };
+
+				stack.push_back({ node.first + 1, children + 1 });
+				stack.push_back({ node.first, children });
+
+			}
+
+		}
+
+		inline bool write_section(std::FILE* file, std::uint64_t offset, const void* data, std::size_t bytes) {
+
+			static const unsigned char zeros[64] = {};
+
+			auto position = static_cast<std::uint64_t>(std::ftell(file));
+
+			for (; position < offset; position += std::min<std::uint64_t>(sizeof(zeros), offset - position)) {
+
+				if (std::fwrite(zeros, std::min<std::uint64_t>(sizeof(zeros), offset - position), 1, file) != 1) return false;
+
+			}
+
+			return bytes == 0 || std::fwrite(data, bytes, 1, file) == 1;
+
+		}
+
+	}
+
+	//! Writes the world with its hierarchy, returns false if the file could not be written or has more than 2^32 - 1 shapes
+
+	inline bool write_world_file(const char* filename, const Shape* shapes, std::size_t count, std::size_t block_shapes = default_block_shapes) {
+
+		if (count >= std::numeric_limits<std::uint32_t>::max() || block_shapes == 0) return false;
+
+		std::vector<Bounds> shape_bounds(count);
+		for (std::size_t i = 0; i < count; i++) shape_bounds[i] = bounds(shapes[i]);
+
+		std::vector<BvhNode> nodes(bvh_node_capacity(count));
+		std::vector<std::uint32_t> indices(count > 0 ? count : 1);
+
+		auto node_count = build_bvh(shape_bounds.data(), count, nodes.data(), indices.data());
+
+		//! Shapes and first position in the index array of every subtree, the children of a node always come after it
+
+		std::vector<std::uint32_t> subtree_shapes(node_count);
+		std::vector<std::uint32_t> subtree_first(node_count);
+
+		for (auto n = (count > 0 ? node_count : 0); n-- > 0; ) {
+
+			auto& node = nodes[n];
+
+			subtree_shapes[n] = (node.leaf() ? node.count : subtree_shapes[node.first] + subtree_shapes[node.first + 1]);
+			subtree_first[n] = (node.leaf() ? node.first : subtree_first[node.first]);
+
+		}
+
+		//! The upper nodes are placed first, the subtrees with at most block_shapes shapes become blocks
+
+		std::vector<BvhNode> placed(1, nodes[0]);
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> block_roots;
+
+		//! An empty world only has the empty root
+
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+		if (count > 0) stack.push_back({ 0u, 0u });
+
+		while (!stack.empty()) {
+
+			auto task = stack.back();
+			stack.pop_back();
+
+			auto& node = nodes[task.first];
+
+			if (node.leaf() || subtree_shapes[task.first] <= block_shapes) {
+
+				placed[task.second] = node;
+				block_roots.push_back(task);
+				continue;
+
+			}
+
+			auto children = static_cast<std::uint32_t>(placed.size());
+			placed.resize(placed.size() + 2);
+
+			placed[task.second] = { node.bounds, children, 0 };
+
+			stack.push_back({ node.first + 1, children + 1 });
+			stack.push_back({ node.first, children });
+
+		}
+
+		auto upper_node_count = placed.size();
+
+		std::vector<WorldBlock> blocks;
+
+		for (auto& root : block_roots) {
+
+			auto first_node = static_cast<std::uint32_t>(placed.size());
+
+			if (!nodes[root.first].leaf()) WorldFile::place_subtree(nodes.data(), root.first, root.second, placed);
+
+			auto first_shape = subtree_first[root.first];
+
+			blocks.push_back({ nodes[root.first].bounds, first_node, static_cast<std::uint32_t>(placed.size()), first_shape, first_shape + subtree_shapes[root.first] });
+
+		}
+
+		//! The shapes in the order of the leaves, so the leaves refer to their own positions
+
+		std::vector<Shape> ordered_shapes(count);
+		std::vector<Bounds> ordered_bounds(count);
+		std::vector<std::uint32_t> positions(count);
+
+		for (std::size_t p = 0; p < count; p++) {
+
+			std::memset(&ordered_shapes[p], 0, sizeof(Shape));
+			ordered_shapes[p].type = shapes[indices[p]].type;
+			std::memcpy(ordered_shapes[p].values, shapes[indices[p]].values, sizeof(ordered_shapes[p].values));
+
+			ordered_bounds[p] = shape_bounds[indices[p]];
+			positions[p] = static_cast<std::uint32_t>(p);
+
+		}
+
+		WorldFileHeader header = {};
+		std::memcpy(header.magic, world_file_magic, sizeof(header.magic));
+		header.version = world_file_version;
+		header.shape_size = sizeof(Shape);
+		header.node_size = sizeof(BvhNode);
+		header.block_shapes = static_cast<std::uint32_t>(block_shapes);
+
+		header.shape_count = count;
+		header.node_count = placed.size();
+		header.upper_node_count = upper_node_count;
+		header.block_count = blocks.size();
+
+		header.nodes_offset = WorldFile::align(sizeof(header));
+		header.blocks_offset = WorldFile::align(header.nodes_offset + placed.size() * sizeof(BvhNode));
+		header.shapes_offset = WorldFile::align(header.blocks_offset + blocks.size() * sizeof(WorldBlock));
+		header.bounds_offset = WorldFile::align(header.shapes_offset + count * sizeof(Shape));
+		header.indices_offset = WorldFile::align(header.bounds_offset + count * sizeof(Bounds));
+		header.ids_offset = WorldFile::align(header.indices_offset + count * sizeof(std::uint32_t));
+		header.file_size = header.ids_offset + count * sizeof(std::uint32_t);
+
+		auto file = std::fopen(filename, "wb");
+		if (!file) return false;
+
+		auto written = WorldFile::write_section(file, 0, &header, sizeof(header))
+			&& WorldFile::write_section(file, header.nodes_offset, placed.data(), placed.size() * sizeof(BvhNode))
+			&& WorldFile::write_section(file, header.blocks_offset, blocks.data(), blocks.size() * sizeof(WorldBlock))
+			&& WorldFile::write_section(file, header.shapes_offset, ordered_shapes.data(), count * sizeof(Shape))
+			&& WorldFile::write_section(file, header.bounds_offset, ordered_bounds.data(), count * sizeof(Bounds))
+			&& WorldFile::write_section(file, header.indices_offset, positions.data(), count * sizeof(std::uint32_t))
+			&& WorldFile::write_section(file, header.ids_offset, indices.data(), count * sizeof(std::uint32_t));
+
+		return (std::fclose(file) == 0) && written;
+
+	}
+
+	//! Read only mapping of a world file, shared with all processes mapping the same file
+	//! The upper nodes and the blocks are checked when the file is opened, the nodes within the blocks and the shapes are not,
+	//! since that would read the whole file
+
+	class MappedWorld {
+
+	public:
+
+		MappedWorld() = default;
+		MappedWorld(const MappedWorld& other) = delete;
+		MappedWorld& operator=(const MappedWorld& other) = delete;
+
+		~MappedWorld() {
+
+			close();
+
+		}
+
+		//! Maps the file, returns false if it cannot be read or is no world file of this layout
+		//! The header, the upper nodes and the blocks are read right away
+
+		bool open(const char* filename) {
+
+			close();
+
+			auto descriptor = ::open(filename, O_RDONLY);
+			if (descriptor < 0) return false;
+
+			struct stat status;
+
+			auto size = (fstat(descriptor, &status) == 0 ? static_cast<std::uint64_t>(status.st_size) : 0);
+
+			void* mapped = MAP_FAILED;
+			if (size >= sizeof(WorldFileHeader)) mapped = mmap(nullptr, static_cast<std::size_t>(size), PROT_READ, MAP_SHARED, descriptor, 0);
+
+			::close(descriptor);
+
+			if (mapped == MAP_FAILED) return false;
+
+			memory = mapped;
+			mapped_size = static_cast<std::size_t>(size);
+
+			std::memcpy(&header, memory, sizeof(header));
+
+			if (!valid_header(size)) {
+
+				close();
+				return false;
+
+			}
+
+			auto base = static_cast<const unsigned char*>(memory);
+
+			file_nodes = reinterpret_cast<const BvhNode*>(base + header.nodes_offset);
+			file_blocks = reinterpret_cast<const WorldBlock*>(base + header.blocks_offset);
+			file_shapes = reinterpret_cast<const Shape*>(base + header.shapes_offset);
+			file_bounds = reinterpret_cast<const Bounds*>(base + header.bounds_offset);
+			file_indices = reinterpret_cast<const std::uint32_t*>(base + header.indices_offset);
+			file_ids = reinterpret_cast<const std::uint32_t*>(base + header.ids_offset);
+
+			if (!valid_upper_nodes()) {
+
+				close();
+				return false;
+
+			}
+
+			for (std::size_t b = 0; b < header.block_count; b++) {
+
+				auto& block = file_blocks[b];
+
+				if (block.first_node < header.upper_node_count || block.first_node > block.end_node || block.end_node > header.node_count
+					|| block.first_shape > block.end_shape || block.end_shape > header.shape_count) {
+
+					close();
+					return false;
+
+				}
+
+			}
+
+			madvise(memory, static_cast<std::size_t>(header.nodes_offset + header.upper_node_count * sizeof(BvhNode)), MADV_WILLNEED);
+
+			return true;
+
+		}
+
+		void close() {
+
+			if (!memory) return;
+
+			munmap(memory, mapped_size);
+
+			memory = nullptr;
+			mapped_size = 0;
+			header = {};
+
+		}
+
+		bool is_open() const {
+
+			return memory != nullptr;
+
+		}
+
+		//! Queries of the world, they report positions in the file
+
+		SharedWorld world() const {
+
+			if (!memory) return {};
+
+			return { file_shapes, file_bounds, file_nodes, file_indices, static_cast<std::size_t>(header.shape_count) };
+
+		}
+
+		std::size_t size() const {
+
+			return static_cast<std::size_t>(header.shape_count);
+
+		}
+
+		//! Index of the shape at the given position in the array passed to write_world_file
+
+		std::uint32_t original_index(std::uint32_t position) const {
+
+			return file_ids[position];
+
+		}
+
+		std::size_t block_count() const {
+
+			return static_cast<std::size_t>(header.block_count);
+
+		}
+
+		const WorldBlock& block(std::size_t index) const {
+
+			return file_blocks[index];
+
+		}
+
+		//! The sections, for advising their pages
+
+		const BvhNode* nodes() const { return file_nodes; }
+		const Shape* shapes() const { return file_shapes; }
+		const Bounds* shape_bounds() const { return file_bounds; }
+		const std::uint32_t* indices() const { return file_indices; }
+		const std::uint32_t* ids() const { return file_ids; }
+
+		std::size_t mapped_bytes() const {
+
+			return mapped_size;
+
+		}
+
+		//! The mapped bytes count as used and reserved, the kernel reads and drops their pages as needed
+
+		MemoryStats memory_stats() const {
+
+			return { mapped_size, mapped_size, 0 };
+
+		}
+
+	private:
+
+		bool valid_header(std::uint64_t size) const {
+
+			if (std::memcmp(header.magic, world_file_magic, sizeof(header.magic)) != 0 || header.version != world_file_version) return false;
+			if (header.shape_size != sizeof(Shape) || header.node_size != sizeof(BvhNode) || header.file_size != size) return false;
+			if (header.shape_count >= std::numeric_limits<std::uint32_t>::max() || header.node_count == 0 || header.upper_node_count > header.node_count) return false;
+
+			auto section = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t element_size) {
+
+				return offset % world_file_alignment == 0 && offset <= size && count <= (size - offset) / element_size;
+
+			};
+
+			return section(header.nodes_offset, header.node_count, sizeof(BvhNode)) && section(header.blocks_offset, header.block_count, sizeof(WorldBlock))
+				&& section(header.shapes_offset, header.shape_count, sizeof(Shape)) && section(header.bounds_offset, header.shape_count, sizeof(Bounds))
+				&& section(header.indices_offset, header.shape_count, sizeof(std::uint32_t)) && section(header.ids_offset, header.shape_count, sizeof(std::uint32_t));
+
+		}
+
+		//! Children come after their parent (so queries end) and within the nodes, leaves refer to shapes within the file
+		//! The root of an empty world is the only node, whose empty bounds no query overlaps
+
+		bool valid_upper_nodes() const {
+
+			if (header.shape_count == 0) return header.node_count == 1 && file_nodes[0].bounds.min_x > file_nodes[0].bounds.max_x;
+
+			for (std::uint64_t n = 0; n < header.upper_node_count; n++) {
+
+				auto& node = file_nodes[n];
+
+				if (node.leaf()) {
+
+					if (node.first + static_cast<std::uint64_t>(node.count) > header.shape_count) return false;
+
+				}
+				else if (node.first <= n || node.first + 1ull >= header.node_count) return false;
+
+			}
+
+			return true;
+
+		}
+
+		void* memory = nullptr;
+		std::size_t mapped_size = 0;
+
+		WorldFileHeader header = {};
+
+		const BvhNode* file_nodes = nullptr;
+		const WorldBlock* file_blocks = nullptr;
+		const Shape* file_shapes = nullptr;
+		const Bounds* file_bounds = nullptr;
+		const std::uint32_t* file_indices = nullptr;
+		const std::uint32_t* file_ids = nullptr;
+
+	};
+
+	struct PrefetchSettings {
+
+		//! Seconds of motion ahead of the players which are prefetched
+
+		float lookahead = 0.5f;
+
+		//! Blocks advised within this many ticks are not advised again
+
+		std::uint64_t refresh_ticks = 30;
+
+		//! Checks which advised pages were not resident yet (one mincore call per advised range)
+
+		bool count_cold_pages = true;
+
+	};
+
+	//! Counters of the prefetcher, the query counters are only collected by record_query
+
+	struct PrefetchStats {
+
+		std::uint64_t predictions = 0;
+		std::uint64_t blocks_advised = 0;
+		std::uint64_t blocks_skipped = 0;
+		std::uint64_t pages_advised = 0;
+
+		//! Advised pages which were not resident, the page faults the prefetcher can avoid if the pages arrive in time
+
+		std::uint64_t pages_cold = 0;
+
+		//! Pages of the blocks overlapping the recorded queries, which were resident when queried or had to be read
+
+		std::uint64_t queries_recorded = 0;
+		std::uint64_t query_pages_resident = 0;
+		std::uint64_t query_pages_cold = 0;
+
+		//! Pages whose residency could not be checked because mincore failed, they are in neither of the counts above
+
+		std::uint64_t pages_unknown = 0;
+
+		//! Fraction of the queried pages which were resident, 1 if no queries were recorded
+
+		constexpr double resident_fraction() const {
+
+			auto pages = query_pages_resident + query_pages_cold;
+
+			return (pages > 0 ? static_cast<double>(query_pages_resident) / static_cast<double>(pages) : 1.0);
+
+		}
+
+	};
+
+	//! Region which a circle of the given radius sweeps from its position along its velocity in lookahead seconds
+
+	constexpr Bounds predicted_bounds(float x, float y, float velocity_x, float velocity_y, float radius, float lookahead) {
+
+		auto end_x = x + velocity_x * lookahead;
+		auto end_y = y + velocity_y * lookahead;
+
+		return { std::min(x, end_x) - radius, std::min(y, end_y) - radius, std::max(x, end_x) + radius, std::max(y, end_y) + radius };
+
+	}
+
+	//! Major page faults of the process so far (faults which had to read from disk)
+
+	inline std::uint64_t major_page_faults() {
+
+		struct rusage usage;
+
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+		return static_cast<std::uint64_t>(usage.ru_majflt);
+
+	}
+
+	//! Advises the pages of the blocks which upcoming queries will visit, the world has to stay open while the prefetcher is used
+	//! All functions have to be called from the same thread
+
+	class WorldPrefetcher {
+
+	public:
+
+		explicit WorldPrefetcher(const MappedWorld& world, const PrefetchSettings& settings = {}) : world(&world), settings(settings) {
+
+			page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+			//! A small hierarchy over the blocks finds the blocks of a region without reading the file
+
+			auto count = world.block_count();
+
+			block_bounds.resize(count);
+			for (std::size_t b = 0; b < count; b++) block_bounds[b] = world.block(b).bounds;
+
+			block_nodes.resize(bvh_node_capacity(count));
+			block_indices.resize(count > 0 ? count : 1);
+			block_nodes.resize(build_bvh(block_bounds.data(), count, block_nodes.data(), block_indices.data()));
+
+			last_advised.assign(count, never);
+
+		}
+
+		//! Advises the pages of all blocks overlapping the region which were not advised in the last refresh_ticks ticks
+
+		void prefetch(const Bounds& region) {
+
+			statistics.predictions++;
+
+			if (block_bounds.empty()) return;
+
+			query_bvh(block_nodes.data(), block_indices.data(), block_bounds.data(), region, [&](std::uint32_t b) {
+
+				if (last_advised[b] != never && ticks - last_advised[b] < settings.refresh_ticks) {
+
+					statistics.blocks_skipped++;
+					return;
+
+				}
+
+				last_advised[b] = ticks;
+				statistics.blocks_advised++;
+
+				for_each_range(world->block(b), [&](const void* address, std::size_t bytes) {
+
+					auto pages = page_range(address, bytes);
+
+					if (pages.second == 0) return;
+
+					if (settings.count_cold_pages) {
+
+						std::size_t resident = 0;
+
+						if (resident_pages(pages, resident)) statistics.pages_cold += pages.second - resident;
+						else statistics.pages_unknown += pages.second;
+
+					}
+
+					madvise(pages.first, pages.second * page_size, MADV_WILLNEED);
+
+					statistics.pages_advised += pages.second;
+
+				});
+
+			});
+
+		}
+
+		//! Prefetches the region a query circle sweeps in settings.lookahead seconds
+
+		void prefetch_motion(float x, float y, float velocity_x, float velocity_y, float radius) {
+
+			prefetch(predicted_bounds(x, y, velocity_x, velocity_y, radius, settings.lookahead));
+
+		}
+
+		//! Starts the next frame
+
+		void tick() {
+
+			ticks++;
+
+		}
+
+		//! Counts the pages of the blocks overlapping the query as resident or cold, call it before the query
+		//! It costs a mincore call per page range, so it is meant for measuring the prefetcher, not for every query
+
+		void record_query(const Bounds& query) {
+
+			statistics.queries_recorded++;
+
+			if (block_bounds.empty()) return;
+
+			query_bvh(block_nodes.data(), block_indices.data(), block_bounds.data(), query, [&](std::uint32_t b) {
+
+				for_each_range(world->block(b), [&](const void* address, std::size_t bytes) {
+
+					auto pages = page_range(address, bytes);
+
+					std::size_t resident = 0;
+
+					if (!resident_pages(pages, resident)) {
+
+						statistics.pages_unknown += pages.second;
+
+						return;
+
+					}
+
+					statistics.query_pages_resident += resident;
+					statistics.query_pages_cold += pages.second - resident;
+
+				});
+
+			});
+
+		}
+
+		const PrefetchStats& stats() const {
+
+			return statistics;
+
+		}
+
+		void reset_stats() {
+
+			statistics = {};
+
+		}
+
+		MemoryStats memory_stats() const {
+
+			return Collishi::memory_stats(block_bounds) + Collishi::memory_stats(block_nodes) + Collishi::memory_stats(block_indices)
+				+ Collishi::memory_stats(last_advised) + Collishi::memory_stats(residency);
+
+		}
+
+	private:
+
+		static constexpr std::uint64_t never = std::numeric_limits<std::uint64_t>::max();
+
+		//! Calls function(address, bytes) for the nodes, shapes, bounds, indices and original indices of a block
+
+		template <class F> void for_each_range(const WorldBlock& block, F&& function) const {
+
+			auto shapes = block.end_shape - block.first_shape;
+
+			function(world->nodes() + block.first_node, (block.end_node - block.first_node) * sizeof(BvhNode));
+			function(world->shapes() + block.first_shape, shapes * sizeof(Shape));
+			function(world->shape_bounds() + block.first_shape, shapes * sizeof(Bounds));
+			function(world->indices() + block.first_shape, shapes * sizeof(std::uint32_t));
+			function(world->ids() + block.first_shape, shapes * sizeof(std::uint32_t));
+
+		}
+
+		//! First page and number of pages of a byte range
+
+		std::pair<void*, std::size_t> page_range(const void* address, std::size_t bytes) const {
+
+			if (bytes == 0) return { nullptr, 0 };
+
+			auto begin = reinterpret_cast<std::uintptr_t>(address) / page_size * page_size;
+			auto end = reinterpret_cast<std::uintptr_t>(address) + bytes;
+
+			return { reinterpret_cast<void*>(begin), (end - begin + page_size - 1) / page_size };
+
+		}
+
+		//! False if mincore failed, then the residency of the pages is unknown
+
+		bool resident_pages(const std::pair<void*, std::size_t>& pages, std::size_t& resident) {
+
+			residency.resize(pages.second);
+
+			if (mincore(pages.first, pages.second * page_size, residency.data()) != 0) return false;
+
+			resident = static_cast<std::size_t>(std::count_if(residency.begin(), residency.end(), [](auto flag) { return (flag & 1) != 0; }));
+
+			return true;
+
+		}
+
+		const MappedWorld* world;
+		PrefetchSettings settings;
+
+		std::size_t page_size = 4096;
+		std::uint64_t ticks = 0;
+
+		std::vector<Bounds> block_bounds;
+		std::vector<BvhNode> block_nodes;
+		std::vector<std::uint32_t> block_indices;
+		std::vector<std::uint64_t> last_advised;
+
+		//! mincore takes unsigned char on Linux and char on macOS
+
+#ifdef __APPLE__
+		std::vector<char> residency;
+#else
+		std::vector<unsigned char> residency;
+#endif
+
+		PrefetchStats statistics;
+
+	};
+
+}
+
+#ifndef COLLISHI_IGNORE_STATIC_ASSERTIONS
+
+namespace Collishi::WorldFileAssertions {
+
+	constexpr Bounds moving_right = predicted_bounds(10.0f, 20.0f, 8.0f, -4.0f, 1.0f, 0.5f);
+
+}
+
+static_assert(Collishi::WorldFile::align(1) == Collishi::world_file_alignment && Collishi::WorldFile::align(Collishi::world_file_alignment) == Collishi::world_file_alignment);
+static_assert(Collishi::WorldFileAssertions::moving_right.min_x == 9.0f && Collishi::WorldFileAssertions::moving_right.max_x == 15.0f);
+static_assert(Collishi::WorldFileAssertions::moving_right.min_y == 17.0f && Collishi::WorldFileAssertions::moving_right.max_y == 21.0f);
+static_assert(sizeof(Collishi::WorldFileHeader) <= Collishi::world_file_alignment);
+
+#endif
@@ -0,0 +1,389 @@
+#pragma once
+
+//! Small benchmark harness shared by the benchmark programs in this directory
+//! It only depends on the standard library (and the Linux kernel headers for hardware counters),
+//! so every benchmark can be compiled with a single command
+
+#include "../CollisionsRoutines.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Collishi::Benchmark {
+
+	using Clock = std::chrono::steady_clock;
+
+	//! Prevents the compiler from removing a computation whose result is otherwise unused
+
+	template <class T> inline void do_not_optimize(const T& value) {
+
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "g"(value) : "memory");
+#else
+		static volatile T sink;
+		sink = value;
+#endif
+
+	}
+
+	class Timer {
+
+	public:
+
+		void start() {
+
+			begin = Clock::now();
+
+		}
+
+		//! Returns the time since start() in milliseconds and adds it to the accumulated total
+
+		double stop() {
+
+			auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+			total += elapsed;
+
+			return elapsed;
+
+		}
+
+		double total_milliseconds() const {
+
+			return total;
+
+		}
+
+	private:
+
+		Clock::time_point begin;
+		double total = 0.0;
+
+	};
+
+	//! Deterministic random numbers, so each run of a benchmark sees the same input
+
+	class Random {
+
+	public:
+
+		explicit Random(unsigned seed = 12345) : engine(seed) {}
+
+		float uniform(float min, float max) {
+
+			return std::uniform_real_distribution<float>(min, max)(engine);
+
+		}
+
+		int integer(int min, int max) {
+
+			return std::uniform_int_distribution<int>(min, max)(engine);
+
+		}
+
+		float normal(float mean, float deviation) {
+
+			return std::normal_distribution<float>(mean, deviation)(engine);
+
+		}
+
+	private:
+
+		std::mt19937 engine;
+
+	};
+
+	//! Writes the arguments of a random shape into out, with coordinates in [0, extent]
+	//! Sizes are chosen such that random pairs collide in a fair fraction of all cases
+
+	inline void random_shape(Collishi::ShapeType type, Random& random, float* out, float extent = 100.0f) {
+
+		auto size = extent * 0.5f;
+
+		out[0] = random.uniform(0.0f, extent);
+		out[1] = random.uniform(0.0f, extent);
+
+		switch (type) {
+
+			case Collishi::ShapeType::point:
+				break;
+
+			case Collishi::ShapeType::line:
+				out[2] = random.uniform(-size, size);
+				out[3] = random.uniform(-size, size);
+				break;
+
+			case Collishi::ShapeType::circle:
+				out[2] = random.uniform(1.0f, size * 0.5f);
+				break;
+
+			case Collishi::ShapeType::box:
+				out[2] = random.uniform(1.0f, size);
+				out[3] = random.uniform(1.0f, size);
+				break;
+
+			case Collishi::ShapeType::triangle:
+				for (int i = 2; i < 6; i++) out[i] = random.uniform(-size, size);
+				break;
+
+		}
+
+	}
+
+	//! Writes the arguments of a random pair of shapes for the given routine into out
+
+	inline void random_arguments(Collishi::Routine routine, Random& random, float* out, float extent = 100.0f) {
+
+		auto first = Collishi::routine_first_shape(routine);
+
+		random_shape(first, random, out, extent);
+		random_shape(Collishi::routine_second_shape(routine), random, out + Collishi::shape_arity(first), extent);
+
+	}
+
+	//! Hardware performance counters via the Linux perf_event interface
+	//! Each counter is opened separately, so the other counters still work if one of them is not supported
+	//! If perf_event is not available (other platforms, containers, perf_event_paranoid too high), all counters report as unavailable
+
+	enum class Counter {
+
+		cycles,
+		instructions,
+		branch_misses,
+		l1d_misses,
+		llc_misses
+
+	};
+
+	constexpr std::size_t counter_count = 5;
+
+	constexpr const char* counter_name(Counter counter) {
+
+		switch (counter) {
+
+			case Counter::cycles: return "cycles";
+			case Counter::instructions: return "instructions";
+			case Counter::branch_misses: return "branch-misses";
+			case Counter::l1d_misses: return "L1d-misses";
+			case Counter::llc_misses: return "LLC-misses";
+
+		}
+
+		return "unknown";
+
+	}
+
+	struct CounterValues {
+
+		bool available[counter_count] = {};
+		double values[counter_count] = {};
+
+		bool has(Counter counter) const {
+
+			return available[static_cast<std::size_t>(counter)];
+
+		}
+
+		double operator[](Counter counter) const {
+
+			return values[static_cast<std::size_t>(counter)];
+
+		}
+
+	};
+
+	class PerfCounters {
+
+	public:
+
+		PerfCounters() {
+
+#if defined(__linux__)
+			std::uint64_t configs[counter_count][2] = {
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+				{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }
+			};
+
+			for (std::size_t i = 0; i < counter_count; i++) {
+
+				perf_event_attr attributes;
+				std::memset(&attributes, 0, sizeof(attributes));
+
+				attributes.size = sizeof(attributes);
+				attributes.type = static_cast<std::uint32_t>(configs[i][0]);
+				attributes.config = configs[i][1];
+				attributes.disabled = 1;
+				attributes.exclude_kernel = 1;
+				attributes.exclude_hv = 1;
+				attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+				descriptors[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+
+			}
+#endif
+
+		}
+
+		PerfCounters(const PerfCounters& other) = delete;
+		PerfCounters& operator=(const PerfCounters& other) = delete;
+
+		~PerfCounters() {
+
+#if defined(__linux__)
+			for (auto descriptor : descriptors) {
+
+				if (descriptor >= 0) close(descriptor);
+
+			}
+#endif
+
+		}
+
+		bool any_available() const {
+
+			for (auto descriptor : descriptors) {
+
+				if (descriptor >= 0) return true;
+
+			}
+
+			return false;
+
+		}
+
+		void start() {
+
+#if defined(__linux__)
+			for (auto descriptor : descriptors) {
+
+				if (descriptor < 0) continue;
+
+				ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+				ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+
+			}
+#endif
+
+		}
+
+		//! Stops counting and returns the counts since start()
+		//! If the kernel had to multiplex the counters, the values are scaled to the full time
+
+		CounterValues stop() {
+
+			CounterValues result;
+
+#if defined(__linux__)
+			for (std::size_t i = 0; i < counter_count; i++) {
+
+				if (descriptors[i] < 0) continue;
+
+				ioctl(descriptors[i], PERF_EVENT_IOC_DISABLE, 0);
+
+				std::uint64_t data[3];
+
+				if (read(descriptors[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+				if (data[2] == 0) continue;
+
+				result.available[i] = true;
+				result.values[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+
+			}
+#endif
+
+			return result;
+
+		}
+
+	private:
+
+		int descriptors[counter_count] = { -1, -1, -1, -1, -1 };
+
+	};
+
+	//! Prints the counters divided by the number of operations, or "n/a" for unavailable counters
+
+	inline void print_counters_per_operation(const CounterValues& counters, double operations) {
+
+		for (std::size_t i = 0; i < counter_count; i++) {
+
+			if (counters.available[i]) std::printf(" %12.3f", counters.values[i] / operations);
+			else std::printf(" %12s", "n/a");
+
+		}
+
+		if (counters.has(Counter::cycles) && counters.has(Counter::instructions) && counters[Counter::cycles] > 0.0) {
+
+			std::printf(" %6.2f", counters[Counter::instructions] / counters[Counter::cycles]);
+
+		}
+		else {
+
+			std::printf(" %6s", "n/a");
+
+		}
+
+	}
+
+	inline void print_counter_header() {
+
+		for (std::size_t i = 0; i < counter_count; i++) std::printf(" %12s", counter_name(static_cast<Counter>(i)));
+
+		std::printf(" %6s", "IPC");
+
+	}
+
+	//! Returns the value of "--name=value" from the command line or the fallback value
+
+	inline const char* option(int argc, char** argv, const char* name, const char* fallback) {
+
+		auto length = std::strlen(name);
+
+		for (int i = 1; i < argc; i++) {
+
+			if (std::strncmp(argv[i], "--", 2) != 0) continue;
+			if (std::strncmp(argv[i] + 2, name, length) != 0) continue;
+			if (argv[i][2 + length] != '=') continue;
+
+			return argv[i] + 3 + length;
+
+		}
+
+		return fallback;
+
+	}
+
+	inline long option(int argc, char** argv, const char* name, long fallback) {
+
+		auto value = option(argc, argv, name, static_cast<const char*>(nullptr));
+
+		return (value ? std::strtol(value, nullptr, 10) : fallback);
+
+	}
+
+	inline bool flag(int argc, char** argv, const char* name) {
+
+		for (int i = 1; i < argc; i++) {
+
+			if (std::strncmp(argv[i], "--", 2) == 0 && std::strcmp(argv[i] + 2, name) == 0) return true;
+
+		}
+
+		return false;
+
+	}
+
+}
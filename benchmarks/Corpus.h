@@ -0,0 +1,143 @@
+#pragma once
+
+//! Regression corpus of worst-case inputs, written by tools/perf_fuzz.cpp and used by the benchmarks
+//! The worst arguments of every routine are stored as a capture log (see CollisionsCapture.h), so they can also be replayed
+//! with tools/replay.cpp; the worst scenes of each broadphase strategy are stored as text files with one shape per line
+
+#include "../CollisionsBroadphase.h"
+#include "../CollisionsCapture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Collishi::Benchmark {
+
+	constexpr const char* default_corpus_directory = "benchmarks/corpus";
+
+	inline std::string corpus_routines_file(const std::string& directory) {
+
+		return directory + "/routines.clog";
+
+	}
+
+	inline std::string corpus_scene_file(const std::string& directory, BroadphaseStrategy strategy) {
+
+		return directory + "/" + broadphase_name(strategy) + ".scene";
+
+	}
+
+	constexpr const char* shape_type_name(ShapeType type) {
+
+		switch (type) {
+
+			case ShapeType::point: return "point";
+			case ShapeType::line: return "line";
+			case ShapeType::circle: return "circle";
+			case ShapeType::box: return "box";
+			case ShapeType::triangle: return "triangle";
+
+		}
+
+		return "unknown";
+
+	}
+
+	//! Arguments of every routine from a capture log, grouped by routine, returns false if the log cannot be read completely
+
+	inline bool read_corpus_routines(const char* filename, std::vector<float> (&args)[routine_count]) {
+
+		Capture::Reader reader;
+
+		if (!reader.open(filename)) return false;
+
+		Capture::Record record;
+		Capture::ReadResult result;
+
+		while ((result = reader.next(record)) == Capture::ReadResult::record) {
+
+			auto& routine_args = args[static_cast<std::size_t>(record.routine)];
+			routine_args.insert(routine_args.end(), record.args.begin(), record.args.end());
+
+		}
+
+		return result == Capture::ReadResult::end;
+
+	}
+
+	//! Scene file: "# comment" lines and one line "<shape type> <arguments>" per shape
+
+	inline bool write_scene(const char* filename, const std::vector<Shape>& shapes, const char* comment) {
+
+		auto file = std::fopen(filename, "w");
+		if (!file) return false;
+
+		std::fprintf(file, "# %s\n", comment);
+
+		for (auto& shape : shapes) {
+
+			std::fprintf(file, "%s", shape_type_name(shape.type));
+
+			for (std::size_t i = 0; i < shape_arity(shape.type); i++) std::fprintf(file, " %.9g", shape.values[i]);
+
+			std::fprintf(file, "\n");
+
+		}
+
+		return std::fclose(file) == 0;
+
+	}
+
+	inline bool read_scene(const char* filename, std::vector<Shape>& shapes) {
+
+		auto file = std::fopen(filename, "r");
+		if (!file) return false;
+
+		char line[512];
+
+		while (std::fgets(line, sizeof(line), file)) {
+
+			char type_name[32];
+			Shape shape = { ShapeType::point, {} };
+
+			if (line[0] == '#') continue;
+
+			int consumed = 0;
+			if (std::sscanf(line, "%31s%n", type_name, &consumed) != 1) continue;
+
+			bool known = false;
+
+			for (int t = 0; t <= static_cast<int>(ShapeType::triangle); t++) {
+
+				if (std::strcmp(type_name, shape_type_name(static_cast<ShapeType>(t))) != 0) continue;
+
+				shape.type = static_cast<ShapeType>(t);
+				known = true;
+
+			}
+
+			if (!known) continue;
+
+			auto position = line + consumed;
+			std::size_t values = 0;
+
+			for (; values < shape_arity(shape.type); values++) {
+
+				int length = 0;
+				if (std::sscanf(position, "%f%n", &shape.values[values], &length) != 1) break;
+				position += length;
+
+			}
+
+			if (values == shape_arity(shape.type)) shapes.push_back(shape);
+
+		}
+
+		std::fclose(file);
+
+		return true;
+
+	}
+
+}
@@ -0,0 +1,133 @@
+//! Benchmark of the many-vs-many box kernel against a plain double loop over collision_box_box
+//! Two groups of N boxes each are placed in a square so that about the given share of all pairs collide
+//!
+//! Build: g++ -std=c++17 -O2 -march=native -pthread benchmarks/all_pairs.cpp -o all_pairs
+//! Usage: all_pairs [--sizes=256,512,1024,2048] [--hit-rate=fraction] [--threads=N] [--repetitions=N] [--seed=N]
+
+#include "../CollisionsBatch.h"
+#include "Benchmark.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	struct Group {
+
+		std::vector<float> x, y, w, h;
+
+		Collishi::BoxArrays arrays() const {
+
+			return { x.data(), y.data(), w.data(), h.data(), x.size() };
+
+		}
+
+	};
+
+	//! Boxes of size 1 to 3 in a square, whose side is chosen for the requested share of colliding pairs
+	//! (two boxes with an average size of 2 collide if their positions differ by less than 2 on both axes)
+
+	Group random_group(Random& random, std::size_t count, double hit_rate) {
+
+		auto side = static_cast<float>(4.0 / std::sqrt(hit_rate));
+
+		Group group;
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			group.x.push_back(random.uniform(0.0f, side));
+			group.y.push_back(random.uniform(0.0f, side));
+			group.w.push_back(random.uniform(1.0f, 3.0f));
+			group.h.push_back(random.uniform(1.0f, 3.0f));
+
+		}
+
+		return group;
+
+	}
+
+	std::size_t brute_force(const Group& first, const Group& second, std::vector<Collishi::Pair>& pairs) {
+
+		for (std::uint32_t i = 0; i < first.x.size(); i++) {
+
+			for (std::uint32_t j = 0; j < second.x.size(); j++) {
+
+				if (Collishi::collision_box_box(first.x[i], first.y[i], first.w[i], first.h[i], second.x[j], second.y[j], second.w[j], second.h[j])) pairs.push_back({ i, j });
+
+			}
+
+		}
+
+		return pairs.size();
+
+	}
+
+	template <class F> double best_milliseconds(long repetitions, F&& function) {
+
+		double best = 1e30;
+
+		for (long r = 0; r < repetitions; r++) {
+
+			Timer timer;
+			timer.start();
+
+			do_not_optimize(function());
+
+			timer.stop();
+
+			best = std::min(best, timer.total_milliseconds());
+
+		}
+
+		return best;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	std::string sizes = option(argc, argv, "sizes", "256,512,1024,2048");
+
+	auto hit_rate = std::strtod(option(argc, argv, "hit-rate", "0.01"), nullptr);
+	auto threads = static_cast<unsigned>(option(argc, argv, "threads", 0l));
+	auto repetitions = option(argc, argv, "repetitions", 5l);
+	auto seed = option(argc, argv, "seed", 12345l);
+
+	std::printf("%-8s %10s %14s %14s %14s %10s\n", "N x N", "Pairs", "Loop (ms)", "Tiles 1T (ms)", "Tiles MT (ms)", "Speedup");
+
+	for (auto begin = sizes.c_str(); *begin; ) {
+
+		char* end;
+		auto count = static_cast<std::size_t>(std::strtoul(begin, &end, 10));
+
+		begin = (*end == ',' ? end + 1 : end);
+
+		if (count == 0) continue;
+
+		Random random(static_cast<unsigned>(seed));
+
+		auto first = random_group(random, count, hit_rate);
+		auto second = random_group(random, count, hit_rate);
+
+		std::vector<Collishi::Pair> pairs;
+		pairs.reserve(count * count);
+
+		auto loop = best_milliseconds(repetitions, [&]() { pairs.clear(); return brute_force(first, second, pairs); });
+
+		auto expected = pairs.size();
+
+		auto single = best_milliseconds(repetitions, [&]() { pairs.clear(); Collishi::collision_box_box_all_pairs(first.arrays(), second.arrays(), pairs, 1); return pairs.size(); });
+		auto multi = best_milliseconds(repetitions, [&]() { pairs.clear(); Collishi::collision_box_box_all_pairs(first.arrays(), second.arrays(), pairs, threads); return pairs.size(); });
+
+		std::printf("%-8zu %10zu %14.3f %14.3f %14.3f %9.1fx%s\n", count, expected, loop, single, multi, loop / multi, (pairs.size() != expected ? " MISMATCH" : ""));
+
+	}
+
+	return 0;
+
+}
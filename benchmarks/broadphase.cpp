@@ -0,0 +1,240 @@
+//! Benchmark of the broadphase strategies in CollisionsBroadphase.h on scenes with different shape distributions
+//! Every strategy runs on the same frames, the fastest one is compared with the recommendation of the cost model
+//! and AdaptiveBroadphase is run on the same frames as well
+//! The constants in Collishi::BroadphaseCosts were chosen with this benchmark
+//! The scenes "worst-<strategy>" are the static worst cases of each strategy found by tools/perf_fuzz.cpp (see Corpus.h)
+//!
+//! Build: g++ -std=c++17 -O2 benchmarks/broadphase.cpp -o broadphase
+//! Usage: broadphase [--scene=name] [--frames=N] [--scale=N] [--seed=N] [--corpus=directory]
+
+#include "../CollisionsBroadphase.h"
+#include "Benchmark.h"
+#include "Corpus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+	using Collishi::Benchmark::Random;
+
+	struct Body {
+
+		Collishi::Shape shape;
+		float vx, vy;
+
+	};
+
+	struct Scene {
+
+		std::string name;
+		std::string description;
+		float width;
+		float height;
+		std::vector<Body> bodies;
+
+	};
+
+	Collishi::Shape random_body_shape(Random& random, float x, float y, float size) {
+
+		if (random.integer(0, 1)) return Collishi::Shape::circle(x, y, 0.5f * size);
+
+		return Collishi::Shape::box(x - 0.5f * size, y - 0.5f * size, size, size * random.uniform(0.5f, 1.5f));
+
+	}
+
+	void add_bodies(Scene& scene, Random& random, int count, float min_size, float max_size, float speed) {
+
+		for (int i = 0; i < count; i++) {
+
+			auto shape = random_body_shape(random, random.uniform(0.0f, scene.width), random.uniform(0.0f, scene.height), random.uniform(min_size, max_size));
+			scene.bodies.push_back({ shape, random.uniform(-speed, speed), random.uniform(-speed, speed) });
+
+		}
+
+	}
+
+	std::vector<Scene> scenes(int scale, Random& random) {
+
+		std::vector<Scene> result;
+
+		result.push_back({ "uniform", "many small shapes of similar size", 2048.0f, 2048.0f, {} });
+		add_bodies(result.back(), random, 4000 * scale, 4.0f, 8.0f, 2.0f);
+
+		result.push_back({ "mixed", "small shapes and a few very large ones", 2048.0f, 2048.0f, {} });
+		add_bodies(result.back(), random, 3000 * scale, 2.0f, 6.0f, 2.0f);
+		add_bodies(result.back(), random, 60 * scale, 100.0f, 400.0f, 0.5f);
+
+		result.push_back({ "corridor", "shapes spread along a long side-scrolling level", 65536.0f, 64.0f, {} });
+		add_bodies(result.back(), random, 2000 * scale, 8.0f, 24.0f, 1.0f);
+
+		result.push_back({ "few", "a few shapes", 1024.0f, 1024.0f, {} });
+		add_bodies(result.back(), random, 64 * scale, 10.0f, 40.0f, 2.0f);
+
+		result.push_back({ "scattered", "shapes of very different sizes, from debris to buildings", 8192.0f, 8192.0f, {} });
+
+		for (int i = 0; i < 3000 * scale; i++) {
+
+			auto size = std::exp2(random.uniform(0.0f, 9.0f));
+			auto shape = random_body_shape(random, random.uniform(0.0f, 8192.0f), random.uniform(0.0f, 8192.0f), size);
+
+			result.back().bodies.push_back({ shape, random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f) });
+
+		}
+
+		result.push_back({ "crowd", "dense crowd of medium shapes", 512.0f, 512.0f, {} });
+		add_bodies(result.back(), random, 3000 * scale, 8.0f, 16.0f, 1.0f);
+
+		return result;
+
+	}
+
+	//! The corpus scenes do not move, missing files are skipped
+
+	void add_corpus_scenes(std::vector<Scene>& result, const std::string& directory) {
+
+		for (std::size_t s = 0; s < Collishi::broadphase_strategy_count; s++) {
+
+			auto strategy = static_cast<Collishi::BroadphaseStrategy>(s);
+
+			std::vector<Collishi::Shape> shapes;
+			if (!Collishi::Benchmark::read_scene(Collishi::Benchmark::corpus_scene_file(directory, strategy).c_str(), shapes) || shapes.empty()) continue;
+
+			result.push_back({ std::string("worst-") + Collishi::broadphase_name(strategy), "worst case of the strategy", 0.0f, 0.0f, {} });
+
+			for (auto& shape : shapes) result.back().bodies.push_back({ shape, 0.0f, 0.0f });
+
+		}
+
+	}
+
+	void step(Scene& scene) {
+
+		for (auto& body : scene.bodies) {
+
+			auto& values = body.shape.values;
+
+			values[0] += body.vx;
+			values[1] += body.vy;
+
+			if (values[0] < 0.0f || values[0] > scene.width) body.vx = -body.vx;
+			if (values[1] < 0.0f || values[1] > scene.height) body.vy = -body.vy;
+
+		}
+
+	}
+
+	std::vector<Collishi::Shape> shapes_of(const Scene& scene) {
+
+		std::vector<Collishi::Shape> shapes;
+
+		for (auto& body : scene.bodies) shapes.push_back(body.shape);
+
+		return shapes;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	std::string selected = Collishi::Benchmark::option(argc, argv, "scene", "all");
+
+	auto frames = Collishi::Benchmark::option(argc, argv, "frames", 30l);
+	auto scale = static_cast<int>(Collishi::Benchmark::option(argc, argv, "scale", 1l));
+	auto seed = Collishi::Benchmark::option(argc, argv, "seed", 12345l);
+
+	std::string corpus_directory = Collishi::Benchmark::option(argc, argv, "corpus", Collishi::Benchmark::default_corpus_directory);
+
+	Random random(static_cast<unsigned>(seed));
+
+	auto all_scenes = scenes(scale, random);
+	add_corpus_scenes(all_scenes, corpus_directory);
+
+	std::printf("%-12s %7s %10s %10s %10s %10s %12s %12s %9s\n", "Scene", "Shapes", "grid ms", "tree ms", "sweep ms", "adapt ms", "Fastest", "Recommended", "Switches");
+
+	bool failed = false;
+
+	for (auto& scene : all_scenes) {
+
+		if (selected != "all" && selected != scene.name) continue;
+
+		Collishi::BroadphaseRunner runners[Collishi::broadphase_strategy_count];
+		Collishi::AdaptiveBroadphase adaptive;
+		Collishi::Benchmark::Timer timers[Collishi::broadphase_strategy_count + 1];
+
+		std::vector<Collishi::Bounds> previous;
+		Collishi::BroadphaseEstimate recommended = {};
+
+		for (long frame = 0; frame < frames; frame++) {
+
+			step(scene);
+
+			auto shapes = shapes_of(scene);
+
+			//! The statistics are computed outside of the timed section, only the broadphases are compared
+
+			auto shape_bounds = runners[0].update_bounds(shapes);
+			auto statistics = Collishi::scene_statistics(shape_bounds.data(), shape_bounds.size(), previous.size() == shapes.size() ? previous.data() : nullptr);
+			previous = shape_bounds;
+
+			recommended = Collishi::recommend_broadphase(statistics);
+
+			std::vector<Collishi::Pair> results[Collishi::broadphase_strategy_count + 1];
+
+			for (std::size_t s = 0; s < Collishi::broadphase_strategy_count; s++) {
+
+				auto strategy = static_cast<Collishi::BroadphaseStrategy>(s);
+
+				runners[s].update_bounds(shapes);
+
+				timers[s].start();
+				runners[s].collide(strategy, recommended.cell_size, Collishi::Broadphase::sweep_along_y(statistics), shapes, results[s]);
+				timers[s].stop();
+
+			}
+
+			timers[Collishi::broadphase_strategy_count].start();
+			adaptive.collide(shapes, results[Collishi::broadphase_strategy_count]);
+			timers[Collishi::broadphase_strategy_count].stop();
+
+			//! All strategies have to find the same pairs
+
+			for (auto& result : results) {
+
+				std::sort(result.begin(), result.end(), [](const Collishi::Pair& a, const Collishi::Pair& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); });
+
+				if (result != results[0]) failed = true;
+
+			}
+
+		}
+
+		double milliseconds[Collishi::broadphase_strategy_count + 1];
+		std::size_t fastest = 0;
+
+		for (std::size_t s = 0; s <= Collishi::broadphase_strategy_count; s++) {
+
+			milliseconds[s] = timers[s].total_milliseconds() / frames;
+
+			if (s < Collishi::broadphase_strategy_count && milliseconds[s] < milliseconds[fastest]) fastest = s;
+
+		}
+
+		std::printf("%-12s %7zu %10.3f %10.3f %10.3f %10.3f %12s %12s %9zu\n", scene.name.c_str(), scene.bodies.size(), milliseconds[0], milliseconds[1], milliseconds[2], milliseconds[3],
+			Collishi::broadphase_name(static_cast<Collishi::BroadphaseStrategy>(fastest)), Collishi::broadphase_name(recommended.strategy), adaptive.switches());
+
+	}
+
+	if (failed) {
+
+		std::printf("\nThe strategies found different pairs\n");
+		return 1;
+
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,210 @@
+//! Benchmark of the EditableBvh in CollisionsEditableBvh.h
+//! Edits a large static level like a level editor does: a wall is dragged across the map in small steps, props are moved
+//! to other places, inserted and deleted. Every edit is compared with rebuilding the whole hierarchy, and the query cost
+//! after the edits is compared with a freshly built hierarchy, before and after the background rebuild
+//!
+//! Build: g++ -std=c++17 -O2 -pthread benchmarks/editing.cpp -o editing
+//! Usage: editing [--shapes=N] [--edits=N] [--seed=N]
+
+#include "../CollisionsEditableBvh.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	constexpr int query_count = 20000;
+	constexpr float query_radius = 20.0f;
+
+	struct EditResult {
+
+		double average_us = 0.0;
+		double worst_us = 0.0;
+
+	};
+
+	Collishi::Shape random_prop(Random& random, float extent) {
+
+		float args[Collishi::max_routine_arity];
+
+		auto type = static_cast<Collishi::ShapeType>(random.integer(1, 4));
+
+		random_shape(type, random, args, 10.0f);
+
+		Collishi::Shape shape;
+		shape.type = type;
+		for (std::size_t i = 0; i < Collishi::shape_arity(type); i++) shape.values[i] = args[i];
+
+		shape.values[0] = random.uniform(-extent, extent);
+		shape.values[1] = random.uniform(-extent, extent);
+
+		return shape;
+
+	}
+
+	//! Times every call of edit(step) separately
+
+	template <class F> EditResult time_edits(long edits, F&& edit) {
+
+		EditResult result;
+
+		Timer timer;
+
+		for (long step = 0; step < edits; step++) {
+
+			timer.start();
+			edit(step);
+
+			result.worst_us = std::max(result.worst_us, 1000.0 * timer.stop());
+
+		}
+
+		result.average_us = 1000.0 * timer.total_milliseconds() / static_cast<double>(std::max(1l, edits));
+
+		return result;
+
+	}
+
+	//! Average number of nodes visited per query
+
+	double query_nodes(Collishi::EditableBvh& level, Random& random, float extent) {
+
+		level.reset_query_stats();
+
+		for (int q = 0; q < query_count; q++) {
+
+			auto x = random.uniform(-extent, extent);
+			auto y = random.uniform(-extent, extent);
+
+			level.for_each_candidate({ x - query_radius, y - query_radius, x + query_radius, y + query_radius }, [](std::uint32_t) {});
+
+		}
+
+		return static_cast<double>(level.query_stats().nodes_visited) / query_count;
+
+	}
+
+	void print_edits(const char* name, const EditResult& result, double rebuild_ms) {
+
+		std::printf("%-24s %14.2f %14.2f %14.0fx\n", name, result.average_us, result.worst_us, 1000.0 * rebuild_ms / std::max(result.average_us, 1e-3));
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto shape_count = static_cast<std::size_t>(option(argc, argv, "shapes", 1000000l));
+	auto edits = option(argc, argv, "edits", 2000l);
+	auto seed = static_cast<unsigned>(option(argc, argv, "seed", 12345l));
+
+	Random random(seed);
+
+	auto extent = 6.0f * std::sqrt(static_cast<float>(shape_count));
+
+	std::vector<Collishi::Shape> shapes(shape_count);
+	for (auto& shape : shapes) shape = random_prop(random, extent);
+
+	//! The automatic rebuild is disabled, so the degradation by the edits can be measured
+
+	Collishi::EditableBvh::Policy policy;
+	policy.optimize_after_edits = 0.0;
+
+	Collishi::EditableBvh level(policy);
+
+	Timer timer;
+	timer.start();
+
+	level.build(shapes);
+
+	auto rebuild_ms = timer.stop();
+	auto built_nodes = query_nodes(level, random, extent);
+
+	std::printf("%zu shapes, full rebuild %.1f ms, %ld edits of every kind\n\n", shape_count, rebuild_ms, edits);
+	std::printf("%-24s %14s %14s %15s\n", "Edit", "Average us", "Worst us", "vs rebuild");
+
+	//! A wall is dragged across the map in steps of a unit, as the mouse moves it
+
+	auto wall = random_prop(random, extent);
+	auto wall_id = level.insert(wall);
+
+	print_edits("drag", time_edits(edits, [&](long) {
+
+		wall.values[0] += 1.0f;
+		level.modify(wall_id, wall);
+
+	}), rebuild_ms);
+
+	print_edits("move anywhere", time_edits(edits, [&](long) {
+
+		auto id = static_cast<std::uint32_t>(random.integer(0, static_cast<int>(shape_count) - 1));
+		level.modify(id, random_prop(random, extent));
+
+	}), rebuild_ms);
+
+	std::vector<std::uint32_t> inserted;
+
+	print_edits("insert", time_edits(edits, [&](long) {
+
+		inserted.push_back(level.insert(random_prop(random, extent)));
+
+	}), rebuild_ms);
+
+	print_edits("remove", time_edits(edits, [&](long step) {
+
+		level.remove(inserted[static_cast<std::size_t>(step)]);
+
+	}), rebuild_ms);
+
+	auto edited_nodes = query_nodes(level, random, extent);
+
+	//! The background rebuild runs while the editor keeps dragging the wall, once per frame
+
+	timer.start();
+
+	level.start_optimization();
+
+	long background_edits = 0;
+	EditResult frame_edits;
+
+	while (!level.finish_optimization()) {
+
+		auto frame_start = std::chrono::steady_clock::now();
+
+		Timer edit_timer;
+		edit_timer.start();
+
+		wall.values[0] += 1.0f;
+		level.modify(wall_id, wall);
+
+		frame_edits.worst_us = std::max(frame_edits.worst_us, 1000.0 * edit_timer.stop());
+		background_edits++;
+
+		std::this_thread::sleep_until(frame_start + std::chrono::microseconds(static_cast<long>(1e6 / 60.0)));
+
+	}
+
+	auto background_ms = timer.stop();
+	auto optimized_nodes = query_nodes(level, random, extent);
+
+	auto& stats = level.edits();
+
+	std::printf("\n%zu local rebuilds of %.1f shapes on average, %zu of %zu modifies only refitted\n", stats.local_rebuilds,
+		static_cast<double>(stats.rebuilt_shapes) / static_cast<double>(std::max<std::size_t>(1, stats.local_rebuilds)), stats.refits, stats.modifies);
+	std::printf("Background rebuild took %.1f ms while dragging for %ld frames (slowest edit %.2f us)\n\n", background_ms, background_edits, frame_edits.worst_us);
+
+	std::printf("%-24s %14s\n", "Hierarchy", "Nodes/query");
+	std::printf("%-24s %14.1f\n", "built", built_nodes);
+	std::printf("%-24s %14.1f\n", "after edits", edited_nodes);
+	std::printf("%-24s %14.1f\n", "after background rebuild", optimized_nodes);
+
+	return 0;
+
+}
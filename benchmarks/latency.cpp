@@ -0,0 +1,162 @@
+//! Latency benchmark of single pair tests
+//! Each call selects its input depending on the result of the previous call, so calls cannot overlap
+//! and the measured time per call is the latency including branch mispredictions
+//! Half of the inputs collide, in random order, so the result of a call is not predictable
+//! For comparison, the throughput with independent inputs is measured as well
+//!
+//! Build: g++ -std=c++17 -O2 -march=native benchmarks/latency.cpp -o latency
+//! Usage: latency [--calls=N] [--seed=N]
+
+#include "../CollisionsRoutines.h"
+#include "../CollisionsSimd.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	using Implementation = bool (*)(const float* args);
+
+	struct Candidate {
+
+		const char* name;
+		Collishi::Routine routine;
+		Implementation implementation;
+
+	};
+
+	const Candidate candidates[] = {
+
+		{ "collision_circle_box", Collishi::Routine::circle_box, [](const float* a) {
+			return Collishi::collision_circle_box(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+		} },
+		{ "collision_circle_box_simd", Collishi::Routine::circle_box, [](const float* a) {
+			return Collishi::collision_circle_box_simd(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+		} },
+		{ "collision_box_triangle", Collishi::Routine::box_triangle, [](const float* a) {
+			return Collishi::collision_box_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+		} },
+		{ "collision_box_triangle_simd", Collishi::Routine::box_triangle, [](const float* a) {
+			return Collishi::collision_box_triangle_simd(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+		} },
+		{ "collision_triangle_triangle", Collishi::Routine::triangle_triangle, [](const float* a) {
+			return Collishi::collision_triangle_triangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]);
+		} },
+		{ "collision_triangle_triangle_simd", Collishi::Routine::triangle_triangle, [](const float* a) {
+			return Collishi::collision_triangle_triangle_simd(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]);
+		} }
+
+	};
+
+	//! Number of input sets, a power of two
+
+	constexpr std::size_t input_count = 1024;
+
+	double dependent_nanoseconds(const Candidate& candidate, const std::vector<float>& args, long calls) {
+
+		auto arity = Collishi::routine_arity(candidate.routine);
+
+		std::size_t index = 0;
+
+		Timer timer;
+		timer.start();
+
+		for (long i = 0; i < calls; i++) {
+
+			auto result = candidate.implementation(args.data() + index * arity);
+
+			//! The next input depends on the result, which serializes the calls
+
+			index = (index * 5 + 1 + static_cast<std::size_t>(result)) & (input_count - 1);
+
+		}
+
+		timer.stop();
+		do_not_optimize(index);
+
+		return timer.total_milliseconds() * 1e6 / calls;
+
+	}
+
+	double independent_nanoseconds(const Candidate& candidate, const std::vector<float>& args, long calls) {
+
+		auto arity = Collishi::routine_arity(candidate.routine);
+
+		std::size_t hits = 0;
+
+		Timer timer;
+		timer.start();
+
+		for (long i = 0; i < calls; i++) hits += candidate.implementation(args.data() + (i & (input_count - 1)) * arity);
+
+		timer.stop();
+		do_not_optimize(hits);
+
+		return timer.total_milliseconds() * 1e6 / calls;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto calls = option(argc, argv, "calls", 2000000l);
+	auto seed = option(argc, argv, "seed", 12345l);
+
+#if defined(COLLISHI_SIMD_AVX)
+	std::printf("SIMD variants use AVX\n\n");
+#elif defined(COLLISHI_SIMD_SSE)
+	std::printf("SIMD variants use SSE\n\n");
+#else
+	std::printf("SIMD is not available, the SIMD variants call the scalar routines\n\n");
+#endif
+
+	std::printf("%-36s %16s %16s\n", "Routine", "Latency (ns)", "Throughput (ns)");
+
+	for (auto& candidate : candidates) {
+
+		Random random(static_cast<unsigned>(seed));
+
+		auto arity = Collishi::routine_arity(candidate.routine);
+
+		std::vector<float> args(input_count * arity);
+
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+
+		while (hits + misses < input_count) {
+
+			float candidate_args[Collishi::max_routine_arity];
+			random_arguments(candidate.routine, random, candidate_args);
+
+			auto result = Collishi::invoke_routine(candidate.routine, candidate_args);
+
+			if (result && hits >= input_count / 2) continue;
+			if (!result && misses >= input_count / 2) continue;
+
+			//! Swap the new input with a random earlier one, which shuffles hits and misses
+
+			std::copy(candidate_args, candidate_args + arity, args.begin() + (hits + misses) * arity);
+
+			auto swap_with = static_cast<std::size_t>(random.integer(0, static_cast<int>(hits + misses)));
+			std::swap_ranges(args.begin() + swap_with * arity, args.begin() + (swap_with + 1) * arity, args.begin() + (hits + misses) * arity);
+
+			(result ? hits : misses)++;
+
+		}
+
+		dependent_nanoseconds(candidate, args, calls / 10);
+
+		auto latency = dependent_nanoseconds(candidate, args, calls);
+		auto throughput = independent_nanoseconds(candidate, args, calls);
+
+		std::printf("%-36s %16.3f %16.3f\n", candidate.name, latency, throughput);
+
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,218 @@
+//! Benchmark of the WorldPrefetcher in CollisionsWorldFile.h
+//! Players move quickly through a large world file whose pages are dropped from the page cache before each run,
+//! and query the shapes around them every frame, once without and once with prefetching along their motion
+//! Reports the query time, the slowest frame, the major page faults and the fraction of the queried pages which were resident
+//!
+//! Build: g++ -std=c++17 -O2 benchmarks/prefetch.cpp -o prefetch
+//! Usage: prefetch [--shapes=N] [--players=N] [--frames=N] [--speed=units per second] [--file=path] [--seed=N]
+
+#include "../CollisionsWorldFile.h"
+#include "Benchmark.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	constexpr float frame_seconds = 1.0f / 60.0f;
+	constexpr float query_radius = 40.0f;
+	constexpr int queries_per_player = 16;
+
+	struct Player {
+
+		float x;
+		float y;
+		float velocity_x;
+		float velocity_y;
+
+	};
+
+	struct RunResult {
+
+		double query_ms = 0.0;
+		double worst_frame_ms = 0.0;
+		std::uint64_t major_faults = 0;
+		std::size_t hits = 0;
+		Collishi::PrefetchStats stats;
+
+	};
+
+	std::vector<Collishi::Shape> random_world(Random& random, std::size_t count, float extent) {
+
+		std::vector<Collishi::Shape> shapes(count);
+
+		float args[Collishi::max_routine_arity];
+
+		for (auto& shape : shapes) {
+
+			auto type = static_cast<Collishi::ShapeType>(random.integer(1, 4));
+
+			random_shape(type, random, args, 10.0f);
+
+			shape.type = type;
+			for (std::size_t i = 0; i < Collishi::shape_arity(type); i++) shape.values[i] = args[i];
+
+			shape.values[0] = random.uniform(-extent, extent);
+			shape.values[1] = random.uniform(-extent, extent);
+
+		}
+
+		return shapes;
+
+	}
+
+	//! Drops the clean pages of the file from the page cache, the file must not be mapped
+
+	void drop_cached_pages(const char* filename) {
+
+		auto descriptor = open(filename, O_RDONLY);
+		if (descriptor < 0) return;
+
+		fdatasync(descriptor);
+		posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED);
+
+		close(descriptor);
+
+	}
+
+	RunResult run(const char* filename, std::vector<Player> players, long frames, float extent, unsigned seed, bool prefetch) {
+
+		RunResult result;
+
+		drop_cached_pages(filename);
+
+		Collishi::MappedWorld world;
+		if (!world.open(filename)) return result;
+
+		Collishi::WorldPrefetcher prefetcher(world);
+		Random random(seed);
+
+		auto faults_before = Collishi::major_page_faults();
+
+		for (long frame = 0; frame < frames; frame++) {
+
+			auto frame_start = std::chrono::steady_clock::now();
+
+			if (prefetch) {
+
+				for (auto& player : players) prefetcher.prefetch_motion(player.x, player.y, player.velocity_x, player.velocity_y, query_radius);
+
+			}
+
+			prefetcher.tick();
+
+			//! The residency is checked before the timed queries, since it costs system calls
+
+			for (auto& player : players) prefetcher.record_query({ player.x - query_radius, player.y - query_radius, player.x + query_radius, player.y + query_radius });
+
+			Timer timer;
+			timer.start();
+
+			for (auto& player : players) {
+
+				for (int q = 0; q < queries_per_player; q++) {
+
+					auto query = Collishi::Shape::circle(player.x + random.uniform(-query_radius, query_radius), player.y + random.uniform(-query_radius, query_radius), 2.0f);
+
+					world.world().for_each_collision(query, [&](std::uint32_t) { result.hits++; });
+
+				}
+
+			}
+
+			auto frame_ms = timer.stop();
+
+			result.query_ms += frame_ms;
+			result.worst_frame_ms = std::max(result.worst_frame_ms, frame_ms);
+
+			//! Players bounce off the borders of the world
+
+			for (auto& player : players) {
+
+				player.x += player.velocity_x * frame_seconds;
+				player.y += player.velocity_y * frame_seconds;
+
+				if (std::abs(player.x) > extent) player.velocity_x = -player.velocity_x;
+				if (std::abs(player.y) > extent) player.velocity_y = -player.velocity_y;
+
+			}
+
+			std::this_thread::sleep_until(frame_start + std::chrono::microseconds(static_cast<long>(frame_seconds * 1e6f)));
+
+		}
+
+		result.major_faults = Collishi::major_page_faults() - faults_before;
+		result.stats = prefetcher.stats();
+
+		return result;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto shape_count = static_cast<std::size_t>(option(argc, argv, "shapes", 2000000l));
+	auto player_count = static_cast<std::size_t>(option(argc, argv, "players", 8l));
+	auto frames = option(argc, argv, "frames", 120l);
+	auto speed = static_cast<float>(option(argc, argv, "speed", 1500l));
+	auto seed = static_cast<unsigned>(option(argc, argv, "seed", 12345l));
+
+	auto default_file = "/tmp/collishi-prefetch-" + std::to_string(getpid()) + ".world";
+	auto own_file = (option(argc, argv, "file", static_cast<const char*>(nullptr)) == nullptr);
+	auto filename = option(argc, argv, "file", default_file.c_str());
+
+	Random random(seed);
+
+	auto extent = 6.0f * std::sqrt(static_cast<float>(shape_count));
+
+	{
+
+		auto shapes = random_world(random, shape_count, extent);
+
+		if (!Collishi::write_world_file(filename, shapes.data(), shapes.size())) {
+
+			std::fprintf(stderr, "Could not write %s\n", filename);
+			return 1;
+
+		}
+
+	}
+
+	std::vector<Player> players(player_count);
+
+	for (auto& player : players) {
+
+		auto angle = random.uniform(0.0f, 6.2831853f);
+
+		player = { random.uniform(-extent, extent), random.uniform(-extent, extent), speed * std::cos(angle), speed * std::sin(angle) };
+
+	}
+
+	std::printf("%zu shapes, %zu players at %.0f units/s, %ld frames\n\n", shape_count, player_count, speed, frames);
+	std::printf("%-12s %12s %14s %14s %12s %14s %14s\n", "Mode", "Query ms", "Worst frame ms", "Major faults", "Resident", "Pages advised", "Pages cold");
+
+	for (auto prefetch : { false, true }) {
+
+		auto result = run(filename, players, frames, extent, seed, prefetch);
+
+		std::printf("%-12s %12.2f %14.3f %14llu %11.1f%% %14llu %14llu\n", (prefetch ? "prefetch" : "on demand"), result.query_ms, result.worst_frame_ms,
+			static_cast<unsigned long long>(result.major_faults), 100.0 * result.stats.resident_fraction(),
+			static_cast<unsigned long long>(result.stats.pages_advised), static_cast<unsigned long long>(result.stats.pages_cold));
+
+	}
+
+	if (own_file) std::remove(filename);
+
+	return 0;
+
+}
@@ -0,0 +1,411 @@
+//! Benchmark of the single collision routines and the batch kernels
+//! Besides the time per call, hardware counters (cycles, instructions, branch and cache misses) are reported per call
+//! where the platform allows it, which shows whether a routine is limited by branches or by memory
+//!
+//! Build: g++ -std=c++17 -O2 -pthread benchmarks/routines.cpp -o routines
+//! Usage: routines [--filter=substring] [--count=N] [--repetitions=N] [--seed=N] [--corpus=directory]
+//!
+//! The "corpus" kernels run every routine on its worst cases found by tools/perf_fuzz.cpp (see Corpus.h)
+
+#include "../CollisionsBatch.h"
+#include "../CollisionsFixed.h"
+#include "../CollisionsRoutines.h"
+#include "../CollisionsSat.h"
+#include "Benchmark.h"
+#include "Corpus.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	//! A kernel performs a number of collision tests per run and returns the number of hits
+
+	struct Kernel {
+
+		std::string name;
+		std::size_t operations;
+		std::function<std::size_t()> run;
+
+	};
+
+	struct Inputs {
+
+		std::vector<float> args[Collishi::routine_count];
+
+	};
+
+	//! The routine is a template argument, so the dispatch in invoke_routine is resolved at compile time
+
+	template <Collishi::Routine R> std::size_t run_routine(const std::vector<float>& args) {
+
+		constexpr auto arity = Collishi::routine_arity(R);
+
+		std::size_t hits = 0;
+
+		for (std::size_t i = 0; i + arity <= args.size(); i += arity) {
+
+			hits += Collishi::invoke_routine(R, args.data() + i);
+
+		}
+
+		return hits;
+
+	}
+
+	//! Runs the worst cases of the corpus, so slow paths of the routine show up like the average cost
+
+	template <Collishi::Routine R> void add_corpus_kernel(std::vector<Kernel>& kernels, const Inputs& corpus) {
+
+		auto& args = corpus.args[static_cast<std::size_t>(R)];
+		auto count = args.size() / Collishi::routine_arity(R);
+
+		if (count == 0) return;
+
+		kernels.push_back({ std::string("corpus ") + Collishi::routine_name(R), count, [&args]() { return run_routine<R>(args); } });
+
+	}
+
+	template <Collishi::Routine R> void add_routine_kernel(std::vector<Kernel>& kernels, const Inputs& inputs, std::size_t count) {
+
+		auto& args = inputs.args[static_cast<std::size_t>(R)];
+
+		kernels.push_back({ Collishi::routine_name(R), count, [&args]() { return run_routine<R>(args); } });
+
+	}
+
+	void add_batch_kernel(std::vector<Kernel>& kernels, const Inputs& inputs, Collishi::Routine routine, std::size_t count) {
+
+		auto& args = inputs.args[static_cast<std::size_t>(routine)];
+
+		std::shared_ptr<bool[]> results(new bool[count]);
+
+		kernels.push_back({ std::string("batch ") + Collishi::routine_name(routine), count, [&args, routine, count, results]() {
+
+			Collishi::invoke_routine_batch(routine, args.data(), count, results.get());
+
+			std::size_t hits = 0;
+			for (std::size_t i = 0; i < count; i++) hits += results[i];
+
+			return hits;
+
+		} });
+
+	}
+
+	//! The segment/circle kernels of CollisionsBatch.h, with the shapes of the line_circle inputs as separate arrays
+
+	void add_line_circle_kernels(std::vector<Kernel>& kernels, const Inputs& inputs, std::size_t count) {
+
+		auto& args = inputs.args[static_cast<std::size_t>(Collishi::Routine::line_circle)];
+
+		auto arrays = std::make_shared<std::vector<float>>(7 * count);
+		auto results = std::shared_ptr<bool[]>(new bool[count]);
+		auto entry_times = std::shared_ptr<float[]>(new float[count]);
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			for (std::size_t a = 0; a < 7; a++) (*arrays)[a * count + i] = args[i * 7 + a];
+
+		}
+
+		auto values = arrays->data();
+
+		Collishi::LineArrays lines = { values, values + count, values + 2 * count, values + 3 * count, count };
+		Collishi::CircleArrays circles = { values + 4 * count, values + 5 * count, values + 6 * count, count };
+
+		//! The single segment is the first one of the arrays, like the single circle below
+
+		kernels.push_back({ "collision_line_circles", count, [arrays, results, entry_times, lines, circles]() {
+
+			return Collishi::collision_line_circles(lines.x[0], lines.y[0], lines.dx[0], lines.dy[0], circles, results.get(), entry_times.get());
+
+		} });
+
+		kernels.push_back({ "collision_lines_circle", count, [arrays, results, entry_times, lines, circles]() {
+
+			return Collishi::collision_lines_circle(lines, circles.x[0], circles.y[0], circles.r[0], results.get(), entry_times.get());
+
+		} });
+
+	}
+
+	//! Particles against a small triangle set, with the shapes of the circle_triangle inputs
+
+	void add_circles_triangles_kernel(std::vector<Kernel>& kernels, const Inputs& inputs, std::size_t count) {
+
+		constexpr std::size_t triangle_count = 64;
+
+		auto& args = inputs.args[static_cast<std::size_t>(Collishi::Routine::circle_triangle)];
+
+		auto circles = std::make_shared<std::vector<float>>(3 * count);
+		auto triangles = std::make_shared<std::vector<float>>(6 * triangle_count);
+		auto pairs = std::make_shared<std::vector<Collishi::Pair>>();
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			for (std::size_t a = 0; a < 3; a++) (*circles)[a * count + i] = args[i * 9 + a];
+
+		}
+
+		for (std::size_t j = 0; j < triangle_count && j < count; j++) {
+
+			for (std::size_t a = 0; a < 6; a++) (*triangles)[a * triangle_count + j] = args[j * 9 + 3 + a];
+
+		}
+
+		auto c = circles->data();
+		auto t = triangles->data();
+
+		Collishi::CircleArrays circle_arrays = { c, c + count, c + 2 * count, count };
+		Collishi::TriangleArrays triangle_arrays = { t, t + triangle_count, t + 2 * triangle_count, t + 3 * triangle_count, t + 4 * triangle_count, t + 5 * triangle_count, std::min(triangle_count, count) };
+
+		kernels.push_back({ "collision_circles_triangles", count * triangle_arrays.count, [circles, triangles, pairs, circle_arrays, triangle_arrays]() {
+
+			pairs->clear();
+			Collishi::collision_circles_triangles(circle_arrays, triangle_arrays, *pairs);
+
+			return pairs->size();
+
+		} });
+
+	}
+
+	//! The generated tests of CollisionsSat.h on the inputs of the hand-written routines
+
+	template <Collishi::Routine R, class F> void add_sat_kernel(std::vector<Kernel>& kernels, const Inputs& inputs, std::size_t count, const char* name, F test) {
+
+		auto& args = inputs.args[static_cast<std::size_t>(R)];
+
+		kernels.push_back({ name, count, [&args, test]() {
+
+			constexpr auto arity = Collishi::routine_arity(R);
+
+			std::size_t hits = 0;
+
+			for (std::size_t i = 0; i + arity <= args.size(); i += arity) hits += test(args.data() + i);
+
+			return hits;
+
+		} });
+
+	}
+
+	void add_sat_kernels(std::vector<Kernel>& kernels, const Inputs& inputs, std::size_t count) {
+
+		using Collishi::Sat::Box;
+		using Triangle = Collishi::Sat::Polygon<3>;
+
+		add_sat_kernel<Collishi::Routine::box_box>(kernels, inputs, count, "Sat::collision (box, box)", [](const float* a) {
+			return Collishi::Sat::collision(Box{ a[0], a[1], a[2], a[3] }, Box{ a[4], a[5], a[6], a[7] });
+		});
+
+		add_sat_kernel<Collishi::Routine::box_triangle>(kernels, inputs, count, "Sat::collision (box, triangle)", [](const float* a) {
+			return Collishi::Sat::collision(Box{ a[0], a[1], a[2], a[3] }, Triangle{ a[4], a[5], { a[6], a[7], a[8], a[9] } });
+		});
+
+		add_sat_kernel<Collishi::Routine::triangle_triangle>(kernels, inputs, count, "Sat::collision (triangle, triangle)", [](const float* a) {
+			return Collishi::Sat::collision(Triangle{ a[0], a[1], { a[2], a[3], a[4], a[5] } }, Triangle{ a[6], a[7], { a[8], a[9], a[10], a[11] } });
+		});
+
+	}
+
+	//! Routines with dimensions known at compile time (CollisionsFixed.h), on the positions of the regular inputs
+	//! For comparison, the same positions are tested with the same dimensions passed at runtime
+
+	using FixedTile = Collishi::FixedBox<16>;
+	using FixedBullet = Collishi::FixedCircle<8>;
+
+	void add_fixed_kernels(std::vector<Kernel>& kernels, const Inputs& inputs, std::size_t count) {
+
+		auto positions = [&](Collishi::Routine routine) {
+
+			auto& args = inputs.args[static_cast<std::size_t>(routine)];
+			auto arity = Collishi::routine_arity(routine);
+			auto offset = Collishi::shape_arity(Collishi::routine_first_shape(routine));
+
+			auto result = std::make_shared<std::vector<float>>(4 * count);
+
+			for (std::size_t i = 0; i < count; i++) {
+
+				(*result)[4 * i] = args[i * arity];
+				(*result)[4 * i + 1] = args[i * arity + 1];
+				(*result)[4 * i + 2] = args[i * arity + offset];
+				(*result)[4 * i + 3] = args[i * arity + offset + 1];
+
+			}
+
+			return result;
+
+		};
+
+		auto box_positions = positions(Collishi::Routine::box_box);
+		auto circle_positions = positions(Collishi::Routine::circle_circle);
+
+		std::shared_ptr<bool[]> results(new bool[count]);
+
+		//! The runtime dimensions are read through a volatile, so the compiler cannot fold them
+
+		static volatile float tile_size = FixedTile::w;
+		static volatile float bullet_radius = FixedBullet::r;
+
+		kernels.push_back({ "collision_box_box (runtime 16 x 16)", count, [box_positions, count]() {
+
+			float w = tile_size;
+			auto p = box_positions->data();
+
+			std::size_t hits = 0;
+			for (std::size_t i = 0; i < count; i++) hits += Collishi::collision_box_box(p[4 * i], p[4 * i + 1], w, w, p[4 * i + 2], p[4 * i + 3], w, w);
+
+			return hits;
+
+		} });
+
+		kernels.push_back({ "collision_box_box (fixed 16 x 16)", count, [box_positions, count]() {
+
+			auto p = box_positions->data();
+
+			std::size_t hits = 0;
+			for (std::size_t i = 0; i < count; i++) hits += Collishi::collision_box_box<FixedTile, FixedTile>(p[4 * i], p[4 * i + 1], p[4 * i + 2], p[4 * i + 3]);
+
+			return hits;
+
+		} });
+
+		kernels.push_back({ "batch collision_box_box (fixed 16 x 16)", count, [box_positions, results, count]() {
+
+			Collishi::collision_box_box_batch<FixedTile, FixedTile>(box_positions->data(), count, results.get());
+
+			std::size_t hits = 0;
+			for (std::size_t i = 0; i < count; i++) hits += results[i];
+
+			return hits;
+
+		} });
+
+		kernels.push_back({ "collision_circle_circle (runtime r = 8)", count, [circle_positions, count]() {
+
+			float r = bullet_radius;
+			auto p = circle_positions->data();
+
+			std::size_t hits = 0;
+			for (std::size_t i = 0; i < count; i++) hits += Collishi::collision_circle_circle(p[4 * i], p[4 * i + 1], r, p[4 * i + 2], p[4 * i + 3], r);
+
+			return hits;
+
+		} });
+
+		kernels.push_back({ "collision_circle_circle (fixed r = 8)", count, [circle_positions, count]() {
+
+			auto p = circle_positions->data();
+
+			std::size_t hits = 0;
+			for (std::size_t i = 0; i < count; i++) hits += Collishi::collision_circle_circle<FixedBullet, FixedBullet>(p[4 * i], p[4 * i + 1], p[4 * i + 2], p[4 * i + 3]);
+
+			return hits;
+
+		} });
+
+		kernels.push_back({ "batch collision_circle_circle (fixed r = 8)", count, [circle_positions, results, count]() {
+
+			Collishi::collision_circle_circle_batch<FixedBullet, FixedBullet>(circle_positions->data(), count, results.get());
+
+			std::size_t hits = 0;
+			for (std::size_t i = 0; i < count; i++) hits += results[i];
+
+			return hits;
+
+		} });
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	std::string filter = option(argc, argv, "filter", "");
+
+	auto count = static_cast<std::size_t>(option(argc, argv, "count", 4096l));
+	auto repetitions = option(argc, argv, "repetitions", 200l);
+	auto seed = option(argc, argv, "seed", 12345l);
+
+	std::string corpus_directory = option(argc, argv, "corpus", default_corpus_directory);
+
+	Random random(static_cast<unsigned>(seed));
+	Inputs inputs;
+
+	for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+		auto routine = static_cast<Collishi::Routine>(r);
+		auto arity = Collishi::routine_arity(routine);
+
+		inputs.args[r].resize(count * arity);
+
+		for (std::size_t i = 0; i < count; i++) random_arguments(routine, random, inputs.args[r].data() + i * arity);
+
+	}
+
+	//! The corpus is optional, without it only the kernels on random inputs are run
+
+	Inputs corpus;
+	read_corpus_routines(corpus_routines_file(corpus_directory).c_str(), corpus.args);
+
+	std::vector<Kernel> kernels;
+
+#define COLLISHI_ADD_ROUTINE_KERNEL(name, arity, first, second) add_routine_kernel<Collishi::Routine::name>(kernels, inputs, count);
+	COLLISHI_ROUTINE_LIST(COLLISHI_ADD_ROUTINE_KERNEL)
+#undef COLLISHI_ADD_ROUTINE_KERNEL
+
+	for (std::size_t r = 0; r < Collishi::routine_count; r++) add_batch_kernel(kernels, inputs, static_cast<Collishi::Routine>(r), count);
+
+	add_line_circle_kernels(kernels, inputs, count);
+	add_circles_triangles_kernel(kernels, inputs, count);
+	add_fixed_kernels(kernels, inputs, count);
+	add_sat_kernels(kernels, inputs, count);
+
+#define COLLISHI_ADD_CORPUS_KERNEL(name, arity, first, second) add_corpus_kernel<Collishi::Routine::name>(kernels, corpus);
+	COLLISHI_ROUTINE_LIST(COLLISHI_ADD_CORPUS_KERNEL)
+#undef COLLISHI_ADD_CORPUS_KERNEL
+
+	PerfCounters counters;
+
+	if (!counters.any_available()) std::printf("Hardware counters are not available, only timings are reported\n\n");
+
+	std::printf("%-40s %10s %7s", "Kernel (per call)", "ns", "Hit %");
+	print_counter_header();
+	std::printf("\n");
+
+	for (auto& kernel : kernels) {
+
+		if (kernel.name.find(filter) == std::string::npos) continue;
+
+		//! Warm up caches and branch predictors once before measuring
+
+		auto hits = kernel.run();
+
+		Timer timer;
+
+		timer.start();
+		counters.start();
+
+		for (long i = 0; i < repetitions; i++) do_not_optimize(kernel.run());
+
+		auto values = counters.stop();
+		timer.stop();
+
+		auto operations = static_cast<double>(kernel.operations) * repetitions;
+
+		std::printf("%-40s %10.3f %7.2f", kernel.name.c_str(), timer.total_milliseconds() * 1e6 / operations, 100.0 * hits / kernel.operations);
+		print_counters_per_operation(values, operations);
+		std::printf("\n");
+
+	}
+
+	return 0;
+
+}
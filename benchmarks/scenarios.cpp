@@ -0,0 +1,616 @@
+//! Benchmark with generated scenarios resembling typical game workloads
+//! Each scenario is simulated for a number of frames; only the collision phase of a frame is timed
+//! Every scenario is run at several scales to show how the cost grows with the number of objects
+//! Scenarios where every object can touch every other one find their pairs with AdaptiveBroadphase, so the growth is the one
+//! of the library and not of testing all pairs; the pairs per frame are the narrowphase tests of the broadphase
+//!
+//! Build: g++ -std=c++17 -O2 -pthread benchmarks/scenarios.cpp -o scenarios
+//! Usage: scenarios [--scenario=name] [--frames=N] [--scales=N] [--seed=N] [--counters] [--trace=file]
+//! With --counters, hardware counters per tested pair are printed as well (if available)
+//! If compiled with -DCOLLISHI_TRACE, --trace=file writes a Chrome trace of all frames
+
+#include "../Collisions.h"
+#include "../CollisionsBroadphase.h"
+#include "../CollisionsTrace.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+	using Collishi::Benchmark::Random;
+
+	struct FrameStatistics {
+
+		std::size_t pairs = 0;
+		std::size_t hits = 0;
+
+	};
+
+	class Scenario {
+
+	public:
+
+		virtual ~Scenario() = default;
+
+		virtual const char* name() const = 0;
+		virtual const char* description() const = 0;
+
+		//! Generates the objects, scale 1 being a moderately sized scene
+
+		virtual void setup(int scale, Random& random) = 0;
+
+		//! Moves the objects (not timed)
+
+		virtual void step(Random& random) = 0;
+
+		//! Runs all collision tests of one frame (timed)
+
+		virtual FrameStatistics collide() = 0;
+
+	};
+
+	//! Finds the colliding pairs of shapes with AdaptiveBroadphase, the shapes are the same objects every frame
+
+	class BroadphaseFrame {
+
+	public:
+
+		FrameStatistics collide(const std::vector<Collishi::Shape>& shapes) {
+
+			auto tests_before = broadphase.tests();
+
+			pairs.clear();
+			broadphase.collide(shapes, pairs);
+
+			return { broadphase.tests() - tests_before, pairs.size() };
+
+		}
+
+	private:
+
+		Collishi::AdaptiveBroadphase broadphase;
+		std::vector<Collishi::Pair> pairs;
+
+	};
+
+	struct Circle {
+
+		float x, y, r;
+		float vx, vy;
+
+	};
+
+	struct Box {
+
+		float x, y, w, h;
+		float vx, vy;
+
+	};
+
+	//! Movement of a projectile in one frame, from (x, y) to (x + dx, y + dy)
+
+	struct Segment {
+
+		float x, y, dx, dy;
+
+	};
+
+	struct Triangle {
+
+		float x, y, sxa, sya, sxb, syb;
+
+	};
+
+	constexpr float world_size = 1024.0f;
+
+	inline float wrap(float value) {
+
+		if (value < 0.0f) return value + world_size;
+		if (value > world_size) return value - world_size;
+
+		return value;
+
+	}
+
+	//! Many small bullets (circles) against a few hitboxes
+
+	class BulletHell : public Scenario {
+
+	public:
+
+		const char* name() const override { return "bullet_hell"; }
+		const char* description() const override { return "many small circles vs few boxes (circle_box)"; }
+
+		void setup(int scale, Random& random) override {
+
+			bullets.clear();
+			hitboxes.clear();
+
+			for (int i = 0; i < 2000 * scale; i++) {
+
+				auto angle = random.uniform(0.0f, 6.2831853f);
+				auto speed = random.uniform(1.0f, 4.0f);
+
+				bullets.push_back({ random.uniform(0.0f, world_size), random.uniform(0.0f, world_size), random.uniform(2.0f, 4.0f), speed * std::cos(angle), speed * std::sin(angle) });
+
+			}
+
+			for (int i = 0; i < 8; i++) {
+
+				hitboxes.push_back({ random.uniform(0.0f, world_size), random.uniform(0.0f, world_size), 12.0f, 20.0f, random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f) });
+
+			}
+
+		}
+
+		void step(Random&) override {
+
+			for (auto& b : bullets) {
+
+				b.x = wrap(b.x + b.vx);
+				b.y = wrap(b.y + b.vy);
+
+			}
+
+			for (auto& h : hitboxes) {
+
+				h.x = wrap(h.x + h.vx);
+				h.y = wrap(h.y + h.vy);
+
+			}
+
+		}
+
+		FrameStatistics collide() override {
+
+			FrameStatistics statistics;
+
+			for (auto& h : hitboxes) {
+
+				for (auto& b : bullets) {
+
+					statistics.hits += Collishi::collision_circle_box(b.x, b.y, b.r, h.x, h.y, h.w, h.h);
+
+				}
+
+				statistics.pairs += bullets.size();
+
+			}
+
+			return statistics;
+
+		}
+
+	private:
+
+		std::vector<Circle> bullets;
+		std::vector<Box> hitboxes;
+
+	};
+
+	//! Entities (boxes) walking on a tilemap of 16x16 tiles
+	//! The tilemap itself serves as the broadphase, since only the tiles covered by an entity are tested
+
+	class Platformer : public Scenario {
+
+	public:
+
+		const char* name() const override { return "platformer"; }
+		const char* description() const override { return "boxes vs tilemap (box_box, tile lookup)"; }
+
+		void setup(int scale, Random& random) override {
+
+			columns = static_cast<int>(world_size / tile_size);
+			rows = columns;
+
+			solid.assign(columns * rows, false);
+
+			//! Ground, platforms and a few walls
+
+			for (int x = 0; x < columns; x++) solid[(rows - 1) * columns + x] = true;
+
+			for (int platform = 0; platform < 200; platform++) {
+
+				auto px = random.integer(0, columns - 8);
+				auto py = random.integer(2, rows - 2);
+				auto length = random.integer(3, 8);
+
+				for (int x = px; x < px + length; x++) solid[py * columns + x] = true;
+
+			}
+
+			entities.clear();
+
+			for (int i = 0; i < 500 * scale; i++) {
+
+				entities.push_back({ random.uniform(0.0f, world_size - 32.0f), random.uniform(0.0f, world_size - 48.0f), 14.0f, 30.0f, random.uniform(-2.0f, 2.0f), random.uniform(0.0f, 3.0f) });
+
+			}
+
+		}
+
+		void step(Random& random) override {
+
+			for (auto& e : entities) {
+
+				e.x += e.vx;
+				e.y += e.vy;
+
+				if (e.x < 0.0f || e.x > world_size - e.w - 1.0f) e.vx = -e.vx;
+				if (e.y > world_size - e.h - 1.0f || e.y < 0.0f) e.vy = -random.uniform(0.0f, 3.0f) * (e.vy > 0.0f ? 1.0f : -1.0f);
+
+			}
+
+		}
+
+		FrameStatistics collide() override {
+
+			FrameStatistics statistics;
+
+			for (auto& e : entities) {
+
+				auto first_column = std::max(0, static_cast<int>(e.x / tile_size));
+				auto last_column = std::min(columns - 1, static_cast<int>((e.x + e.w) / tile_size));
+				auto first_row = std::max(0, static_cast<int>(e.y / tile_size));
+				auto last_row = std::min(rows - 1, static_cast<int>((e.y + e.h) / tile_size));
+
+				for (int row = first_row; row <= last_row; row++) {
+
+					for (int column = first_column; column <= last_column; column++) {
+
+						if (!solid[row * columns + column]) continue;
+
+						statistics.pairs++;
+						statistics.hits += Collishi::collision_box_box(e.x, e.y, e.w, e.h, column * tile_size, row * tile_size, tile_size, tile_size);
+
+					}
+
+				}
+
+			}
+
+			return statistics;
+
+		}
+
+	private:
+
+		static constexpr float tile_size = 16.0f;
+
+		int columns = 0;
+		int rows = 0;
+
+		std::vector<bool> solid;
+		std::vector<Box> entities;
+
+	};
+
+	//! Crowds of units (circles) in clusters, all tested against each other
+
+	class RtsCrowds : public Scenario {
+
+	public:
+
+		const char* name() const override { return "rts_crowds"; }
+		const char* description() const override { return "clustered circles vs circles (circle_circle, AdaptiveBroadphase)"; }
+
+		void setup(int scale, Random& random) override {
+
+			units.clear();
+
+			auto clusters = 4 * scale;
+
+			for (int c = 0; c < clusters; c++) {
+
+				auto cx = random.uniform(100.0f, world_size - 100.0f);
+				auto cy = random.uniform(100.0f, world_size - 100.0f);
+				auto vx = random.uniform(-1.0f, 1.0f);
+				auto vy = random.uniform(-1.0f, 1.0f);
+
+				for (int i = 0; i < 100; i++) {
+
+					units.push_back({ cx + random.normal(0.0f, 30.0f), cy + random.normal(0.0f, 30.0f), random.uniform(4.0f, 7.0f), vx, vy });
+
+				}
+
+			}
+
+			shapes.resize(units.size());
+
+		}
+
+		void step(Random& random) override {
+
+			for (std::size_t i = 0; i < units.size(); i++) {
+
+				auto& u = units[i];
+
+				u.x = wrap(u.x + u.vx + random.uniform(-0.5f, 0.5f));
+				u.y = wrap(u.y + u.vy + random.uniform(-0.5f, 0.5f));
+
+				shapes[i] = Collishi::Shape::circle(u.x, u.y, u.r);
+
+			}
+
+		}
+
+		FrameStatistics collide() override {
+
+			return broadphase.collide(shapes);
+
+		}
+
+	private:
+
+		std::vector<Circle> units;
+		std::vector<Collishi::Shape> shapes;
+		BroadphaseFrame broadphase;
+
+	};
+
+	//! Projectile movement per frame (segments) against triangular level geometry
+
+	class TopDownShooter : public Scenario {
+
+	public:
+
+		const char* name() const override { return "top_down_shooter"; }
+		const char* description() const override { return "segments vs triangles (line_triangle)"; }
+
+		void setup(int scale, Random& random) override {
+
+			projectiles.clear();
+			walls.clear();
+
+			for (int i = 0; i < 200 * scale; i++) {
+
+				auto angle = random.uniform(0.0f, 6.2831853f);
+
+				projectiles.push_back({ random.uniform(0.0f, world_size), random.uniform(0.0f, world_size), 12.0f * std::cos(angle), 12.0f * std::sin(angle) });
+
+			}
+
+			for (int i = 0; i < 100; i++) {
+
+				auto x = random.uniform(0.0f, world_size);
+				auto y = random.uniform(0.0f, world_size);
+
+				walls.push_back({ x, y, random.uniform(-60.0f, 60.0f), random.uniform(-60.0f, 60.0f), random.uniform(-60.0f, 60.0f), random.uniform(-60.0f, 60.0f) });
+
+			}
+
+		}
+
+		void step(Random&) override {
+
+			for (auto& p : projectiles) {
+
+				p.x = wrap(p.x + p.dx);
+				p.y = wrap(p.y + p.dy);
+
+			}
+
+		}
+
+		FrameStatistics collide() override {
+
+			FrameStatistics statistics;
+
+			for (auto& p : projectiles) {
+
+				for (auto& w : walls) {
+
+					statistics.hits += Collishi::collision_line_triangle(p.x, p.y, p.dx, p.dy, w.x, w.y, w.sxa, w.sya, w.sxb, w.syb);
+
+				}
+
+				statistics.pairs += walls.size();
+
+			}
+
+			return statistics;
+
+		}
+
+	private:
+
+		std::vector<Segment> projectiles;
+		std::vector<Triangle> walls;
+
+	};
+
+	//! Boxes resting on each other in piles, so most neighbouring pairs touch
+
+	class PhysicsPile : public Scenario {
+
+	public:
+
+		const char* name() const override { return "physics_pile"; }
+		const char* description() const override { return "stacked resting boxes (box_box, AdaptiveBroadphase)"; }
+
+		void setup(int scale, Random& random) override {
+
+			boxes.clear();
+
+			auto piles = 2 * scale;
+
+			for (int p = 0; p < piles; p++) {
+
+				auto base_x = p * 60.0f;
+
+				for (int level = 0; level < 25; level++) {
+
+					auto x = base_x;
+
+					for (int i = 0; i < 4; i++) {
+
+						auto w = random.uniform(8.0f, 14.0f);
+
+						boxes.push_back({ x, level * 10.0f, w, 10.0f, 0.0f, 0.0f });
+						x += w;
+
+					}
+
+				}
+
+			}
+
+			shapes.resize(boxes.size());
+
+		}
+
+		void step(Random& random) override {
+
+			//! Resting boxes only jitter a tiny bit
+
+			for (std::size_t i = 0; i < boxes.size(); i++) {
+
+				auto& b = boxes[i];
+
+				b.x += random.uniform(-0.01f, 0.01f);
+
+				shapes[i] = Collishi::Shape::box(b.x, b.y, b.w, b.h);
+
+			}
+
+		}
+
+		FrameStatistics collide() override {
+
+			return broadphase.collide(shapes);
+
+		}
+
+	private:
+
+		std::vector<Box> boxes;
+		std::vector<Collishi::Shape> shapes;
+		BroadphaseFrame broadphase;
+
+	};
+
+}
+
+int main(int argc, char** argv) {
+
+	std::string selected = Collishi::Benchmark::option(argc, argv, "scenario", "all");
+
+	auto frames = Collishi::Benchmark::option(argc, argv, "frames", 60l);
+	auto scales = Collishi::Benchmark::option(argc, argv, "scales", 4l);
+	auto seed = Collishi::Benchmark::option(argc, argv, "seed", 12345l);
+	auto show_counters = Collishi::Benchmark::flag(argc, argv, "counters");
+
+	if (frames < 1) {
+
+		std::fprintf(stderr, "--frames has to be at least 1\n");
+		return 1;
+
+	}
+
+	Collishi::Benchmark::PerfCounters counters;
+
+	std::vector<std::unique_ptr<Scenario>> scenarios;
+
+	scenarios.emplace_back(new BulletHell);
+	scenarios.emplace_back(new Platformer);
+	scenarios.emplace_back(new RtsCrowds);
+	scenarios.emplace_back(new TopDownShooter);
+	scenarios.emplace_back(new PhysicsPile);
+
+	std::printf("%-18s %6s %12s %12s %14s %10s %9s", "Scenario", "Scale", "Pairs/frame", "ms/frame", "Pairs/s", "Hit %", "Exponent");
+	if (show_counters) Collishi::Benchmark::print_counter_header();
+	std::printf("\n");
+
+	for (auto& scenario : scenarios) {
+
+		if (selected != "all" && selected != scenario->name()) continue;
+
+		double previous_ms = 0.0;
+
+		for (int scale = 1; scale <= scales; scale *= 2) {
+
+			Random random(static_cast<unsigned>(seed));
+			Collishi::Benchmark::Timer timer;
+
+			FrameStatistics total;
+			Collishi::Benchmark::CounterValues counter_total;
+
+			scenario->setup(scale, random);
+
+			for (long frame = 0; frame < frames; frame++) {
+
+				COLLISHI_TRACE_SCOPE("frame", scenario->name());
+
+				{
+
+					COLLISHI_TRACE_SCOPE("phase", "simulation");
+					scenario->step(random);
+
+				}
+
+				COLLISHI_TRACE_SCOPE("phase", "collision");
+
+				timer.start();
+				counters.start();
+
+				auto statistics = scenario->collide();
+
+				auto counter_values = counters.stop();
+				timer.stop();
+
+				for (std::size_t i = 0; i < Collishi::Benchmark::counter_count; i++) {
+
+					counter_total.available[i] = counter_values.available[i];
+					counter_total.values[i] += counter_values.values[i];
+
+				}
+
+				total.pairs += statistics.pairs;
+				total.hits += statistics.hits;
+
+			}
+
+			auto ms_per_frame = timer.total_milliseconds() / frames;
+			auto pairs_per_second = total.pairs / (timer.total_milliseconds() * 1e-3);
+			auto pairs_per_frame = total.pairs / frames;
+
+			//! Growth of the frame time relative to the growth of the number of objects (1 = linear, 2 = quadratic)
+
+			std::printf("%-18s %6d %12zu %12.4f %14.4g %10.3f", scenario->name(), scale, static_cast<std::size_t>(pairs_per_frame), ms_per_frame, pairs_per_second, 100.0 * total.hits / (total.pairs ? total.pairs : 1));
+
+			if (previous_ms > 0.0) std::printf(" %9.2f", std::log2(ms_per_frame / previous_ms));
+			else std::printf(" %9s", "-");
+
+			if (show_counters) Collishi::Benchmark::print_counters_per_operation(counter_total, static_cast<double>(total.pairs ? total.pairs : 1));
+			std::printf("\n");
+
+			previous_ms = ms_per_frame;
+
+		}
+
+	}
+
+	auto trace_file = Collishi::Benchmark::option(argc, argv, "trace", static_cast<const char*>(nullptr));
+
+	if (trace_file) {
+
+#ifdef COLLISHI_TRACE
+		Collishi::Trace::write_chrome_json(trace_file);
+#else
+		std::printf("\nTracing is disabled, compile with -DCOLLISHI_TRACE to write %s\n", trace_file);
+#endif
+
+	}
+
+	std::printf("\nScenarios:\n");
+
+	for (auto& scenario : scenarios) std::printf("  %-18s %s\n", scenario->name(), scenario->description());
+
+	return 0;
+
+}
@@ -0,0 +1,201 @@
+//! Benchmark of the query service in CollisionsService.h
+//! Compares the time per query of a hierarchy owned by the process (each process holding its own copy of the world),
+//! direct queries of the world in the shared memory segment, and batches answered by a server in another process
+//! The service pays a round trip per batch, which larger batches amortize
+//!
+//! Build: g++ -std=c++17 -O2 benchmarks/service.cpp -o service (older glibc versions also need -lrt)
+//! Usage: service [--shapes=N] [--queries=N] [--repetitions=N] [--seed=N]
+
+#include "../CollisionsDynamicBvh.h"
+#include "../CollisionsService.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	//! Shapes of about the same size in an area growing with their number, so every query finds a few shapes
+
+	std::vector<Collishi::Shape> random_world(Random& random, std::size_t count, float extent) {
+
+		std::vector<Collishi::Shape> shapes(count);
+
+		float args[Collishi::max_routine_arity];
+
+		for (auto& shape : shapes) {
+
+			auto type = static_cast<Collishi::ShapeType>(random.integer(1, 4));
+
+			random_shape(type, random, args, 10.0f);
+
+			shape.type = type;
+			for (std::size_t i = 0; i < Collishi::shape_arity(type); i++) shape.values[i] = args[i];
+
+			shape.values[0] = random.uniform(-extent, extent);
+			shape.values[1] = random.uniform(-extent, extent);
+
+		}
+
+		return shapes;
+
+	}
+
+	template <class F> double nanoseconds_per_query(long repetitions, std::size_t queries, F&& run) {
+
+		double best = 1e30;
+
+		for (long r = 0; r < repetitions; r++) {
+
+			Timer timer;
+			timer.start();
+
+			run();
+
+			best = std::min(best, timer.stop());
+
+		}
+
+		return best * 1e6 / static_cast<double>(queries);
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto shape_count = static_cast<std::size_t>(option(argc, argv, "shapes", 20000l));
+	auto query_count = static_cast<std::size_t>(option(argc, argv, "queries", 4096l));
+	auto repetitions = option(argc, argv, "repetitions", 5l);
+	auto seed = static_cast<unsigned>(option(argc, argv, "seed", 12345l));
+
+	Random random(seed);
+
+	auto extent = 10.0f * std::sqrt(static_cast<float>(shape_count));
+	auto shapes = random_world(random, shape_count, extent);
+	auto queries = random_world(random, query_count, extent);
+
+	auto name = "/collishi-benchmark-" + std::to_string(getpid());
+
+	Collishi::ServiceLimits limits;
+	limits.max_queries = 256;
+	limits.max_results = 256 * 64;
+
+	Collishi::WorldServer server;
+
+	if (!server.open(name.c_str(), shapes, limits)) {
+
+		std::fprintf(stderr, "Could not create the shared memory segment %s\n", name.c_str());
+		return 1;
+
+	}
+
+	//! The server answers in a child process, which inherits the mapping of the segment
+
+	std::atomic<bool> running{ true };
+
+	auto child = fork();
+
+	if (child < 0) {
+
+		std::fprintf(stderr, "Could not start the server process\n");
+		return 1;
+
+	}
+
+	if (child == 0) {
+
+		server.serve(running);
+		_exit(0);
+
+	}
+
+	Collishi::WorldClient client;
+
+	if (!client.open(name.c_str())) {
+
+		std::fprintf(stderr, "Could not connect to the server\n");
+		kill(child, SIGKILL);
+		return 1;
+
+	}
+
+	Collishi::DynamicBvh local;
+	local.build(shapes);
+
+	std::size_t hits = 0;
+	auto count_hit = [&](std::uint32_t) { hits++; };
+
+	std::printf("%zu shapes, %zu queries\n\n", shape_count, query_count);
+	std::printf("%-24s %12s %12s\n", "Mode", "ns/query", "Hits");
+
+	auto local_ns = nanoseconds_per_query(repetitions, query_count, [&]() {
+
+		hits = 0;
+		for (auto& query : queries) local.for_each_collision(query, count_hit);
+
+	});
+
+	std::printf("%-24s %12.1f %12zu\n", "local copy", local_ns, hits);
+
+	auto shared_ns = nanoseconds_per_query(repetitions, query_count, [&]() {
+
+		hits = 0;
+		for (auto& query : queries) client.world().for_each_collision(query, count_hit);
+
+	});
+
+	std::printf("%-24s %12.1f %12zu\n", "shared world", shared_ns, hits);
+
+	std::vector<Collishi::Pair> pairs;
+	bool failed = false;
+
+	for (std::size_t batch_size : { 1, 16, 256 }) {
+
+		auto ns = nanoseconds_per_query(repetitions, query_count, [&]() {
+
+			hits = 0;
+
+			for (std::size_t begin = 0; begin < query_count; begin += batch_size) {
+
+				auto count = std::min(batch_size, query_count - begin);
+
+				if (!client.query(queries.data() + begin, count, pairs)) failed = true;
+				hits += pairs.size();
+
+			}
+
+		});
+
+		auto mode = "service, batch " + std::to_string(batch_size);
+
+		std::printf("%-24s %12.1f %12zu\n", mode.c_str(), ns, hits);
+
+	}
+
+	std::printf("\nWorld in the segment: %zu bytes, local copy per process: %zu bytes\n", server.world_bytes(), local.memory_stats().reserved);
+
+	client.close();
+
+	kill(child, SIGKILL);
+	waitpid(child, nullptr, 0);
+
+	if (failed) {
+
+		std::fprintf(stderr, "Some batches were not answered or did not fit\n");
+		return 1;
+
+	}
+
+	return 0;
+
+}
@@ -1,7 +1,43 @@
-//! Dummy program to check the assertions in the header file
+//! Dummy program to check the assertions in the header files
 
 #include "Collisions.h"
 
+//! Collisions.h itself only needs C++14, the other headers need C++17
+
+#if __cplusplus >= 201703L
+
+#include "CollisionsRoutines.h"
+#include "CollisionsCapture.h"
+#include "CollisionsTrace.h"
+#include "CollisionsProfile.h"
+#include "CollisionsReference.h"
+#include "CollisionsSimd.h"
+#include "CollisionsBatch.h"
+#include "CollisionsFixed.h"
+#include "CollisionsShapes.h"
+#include "CollisionsBvh.h"
+#include "CollisionsDynamicBvh.h"
+#include "CollisionsSharedWorld.h"
+#include "CollisionsEditableBvh.h"
+#include "CollisionsStatic.h"
+#include "CollisionsSat.h"
+#include "CollisionsVariants.h"
+#include "CollisionsBroadphase.h"
+#include "CollisionsMemory.h"
+#include "CollisionsThreadSlots.h"
+#include "CollisionsTags.h"
+#include "CollisionsPartition.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include "CollisionsSharedMemory.h"
+#include "CollisionsMetrics.h"
+#include "CollisionsService.h"
+#include "CollisionsShapeFile.h"
+#include "CollisionsWorldFile.h"
+#endif
+
+#endif
+
 int main() {
 
 	return 0;
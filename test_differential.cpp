@@ -0,0 +1,1068 @@
+//! Differential test of the routines in Collisions.h against the reference routines in CollisionsReference.h
+//! Random cases as well as cases close to the touching configuration are generated for every routine
+//! A different result only counts as failure if the reference result does not change under a tiny
+//! perturbation of the input, since such cases are within the rounding error of single precision
+//!
+//! The many-vs-many kernels in CollisionsBatch.h are compared against the single pair routines, which they have to match exactly
+//! and queries of the bounding volume hierarchy and the broadphases have to find exactly the shapes found by testing all of them
+//!
+//! Afterwards, the throughput of every routine is compared against a baseline file
+//! Every timing is divided by the time of the reference routine on the same inputs, measured right before it, so the baseline
+//! is less dependent on the clock speed and the load of the machine, and the median over several rounds is compared
+//! The program fails if any routine got slower than the baseline by more than the threshold, or if the baseline file is missing
+//!
+//! Build: g++ -std=c++17 -O2 -pthread test_differential.cpp -o test_differential
+//! Usage: test_differential [--cases=N] [--seed=N] [--baseline=file] [--threshold=fraction] [--update-baseline] [--skip-performance]
+
+#include "Collisions.h"
+#include "CollisionsBatch.h"
+#include "CollisionsBroadphase.h"
+#include "CollisionsDynamicBvh.h"
+#include "CollisionsReference.h"
+#include "CollisionsStatic.h"
+#include "CollisionsSimd.h"
+#include "CollisionsVariants.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Testing;
+
+	//! Position of the second shape in the argument list
+
+	std::size_t second_offset(Collishi::Routine routine) {
+
+		return Collishi::shape_arity(Collishi::routine_first_shape(routine));
+
+	}
+
+	//! Moves the second shape along a random direction to the position where the reference result changes,
+	//! then places it at a small random distance from that position on either side
+
+	void near_boundary_arguments(Collishi::Routine routine, Random& random, float* args) {
+
+		random_arguments(routine, random, args, extent);
+
+		auto offset = second_offset(routine);
+
+		//! Exact touching cases for the routines which only collide on sets of measure zero
+
+		if (routine == Collishi::Routine::point_point) {
+
+			if (random.integer(0, 1)) {
+
+				args[2] = args[0];
+				args[3] = args[1];
+
+			}
+
+			return;
+
+		}
+
+		if (routine == Collishi::Routine::point_line) {
+
+			//! Small integers keep all values exactly representable, so the point lies exactly on the line
+
+			for (int i = 0; i < 6; i++) args[i] = static_cast<float>(random.integer(-16, 16));
+
+			auto step = static_cast<float>(random.integer(-1, 5)) * 0.25f;
+
+			args[0] = args[2] + step * args[4];
+			args[1] = args[3] + step * args[5];
+
+			return;
+
+		}
+
+		auto angle = random.uniform(0.0f, 6.2831853f);
+		auto direction_x = std::cos(angle);
+		auto direction_y = std::sin(angle);
+
+		auto base_x = args[offset];
+		auto base_y = args[offset + 1];
+
+		auto result_at = [&](double t) {
+
+			return Collishi::Reference::invoke_shifted(routine, args, t * direction_x, t * direction_y);
+
+		};
+
+		//! Far away, the shapes never collide
+
+		double inside = 0.0;
+		double outside = 8.0 * extent;
+
+		if (!result_at(inside)) {
+
+			//! Move towards the first shape until they collide; give up if they do not collide on this line
+
+			inside = -8.0 * extent;
+			outside = 0.0;
+
+			for (int i = 0; i < 64 && !result_at(inside); i++) inside *= 0.5;
+
+			if (!result_at(inside)) return;
+
+		}
+
+		for (int i = 0; i < 64; i++) {
+
+			auto middle = 0.5 * (inside + outside);
+
+			if (result_at(middle)) inside = middle;
+			else outside = middle;
+
+		}
+
+		auto distance = extent * std::pow(10.0f, -static_cast<float>(random.integer(1, 7))) * (random.integer(0, 1) ? 1.0f : -1.0f);
+		auto t = 0.5 * (inside + outside) + distance;
+
+		args[offset] = static_cast<float>(base_x + t * direction_x);
+		args[offset + 1] = static_cast<float>(base_y + t * direction_y);
+
+	}
+
+	struct DifferentialResult {
+
+		std::size_t cases = 0;
+		std::size_t ambiguous = 0;
+		std::size_t mismatches = 0;
+
+	};
+
+	//! Every implementation of a routine in the variant registry is tested against the reference
+
+	struct Variant {
+
+		std::string name;
+		Collishi::Routine routine;
+		Collishi::RoutineImplementation implementation;
+
+	};
+
+	std::vector<Variant> variants() {
+
+		std::vector<Variant> result;
+
+		Collishi::VariantRegistry registry;
+
+		for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+			auto routine = static_cast<Collishi::Routine>(r);
+
+			for (auto& variant : registry.variants(routine)) {
+
+				auto name = std::string(Collishi::routine_name(routine));
+				if (variant.name != "original") name += " (" + variant.name + ")";
+
+				result.push_back({ name, routine, variant.implementation });
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	DifferentialResult test_variant(const Variant& variant, Random& random, long cases) {
+
+		auto routine = variant.routine;
+
+		DifferentialResult result;
+
+		float args[Collishi::max_routine_arity];
+
+		for (long i = 0; i < cases; i++) {
+
+			if (i % 2 == 0) random_arguments(routine, random, args, extent);
+			else near_boundary_arguments(routine, random, args);
+
+			result.cases++;
+
+			auto expected = Collishi::Reference::invoke_routine(routine, args);
+
+			if (variant.implementation(args) == expected) continue;
+
+			if (Collishi::Reference::ambiguous(routine, args)) {
+
+				result.ambiguous++;
+				continue;
+
+			}
+
+			if (result.mismatches++ < 5) {
+
+				std::printf("  Mismatch in %s (reference: %d), arguments:", variant.name.c_str(), static_cast<int>(expected));
+
+				for (std::size_t a = 0; a < Collishi::routine_arity(routine); a++) std::printf(" %a", args[a]);
+
+				std::printf("\n");
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	//! Random groups of boxes, sizes which are no multiple of the tile size and coordinates on a coarse grid,
+	//! so many boxes touch exactly
+
+	std::vector<float> random_box_group(Random& random, std::size_t count) {
+
+		std::vector<float> values(4 * count);
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			values[i] = static_cast<float>(random.integer(-64, 64)) * 0.5f;
+			values[count + i] = static_cast<float>(random.integer(-64, 64)) * 0.5f;
+			values[2 * count + i] = static_cast<float>(random.integer(0, 16)) * 0.5f;
+			values[3 * count + i] = static_cast<float>(random.integer(0, 16)) * 0.5f;
+
+		}
+
+		return values;
+
+	}
+
+	Collishi::BoxArrays box_arrays(const std::vector<float>& values) {
+
+		auto count = values.size() / 4;
+
+		return { values.data(), values.data() + count, values.data() + 2 * count, values.data() + 3 * count, count };
+
+	}
+
+	std::size_t count_pair_mismatches(const char* name, std::vector<Collishi::Pair> actual, std::vector<Collishi::Pair> expected) {
+
+		auto order = [](const Collishi::Pair& a, const Collishi::Pair& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); };
+
+		std::sort(actual.begin(), actual.end(), order);
+		std::sort(expected.begin(), expected.end(), order);
+
+		std::vector<Collishi::Pair> difference;
+		std::set_symmetric_difference(actual.begin(), actual.end(), expected.begin(), expected.end(), std::back_inserter(difference), order);
+
+		for (std::size_t i = 0; i < difference.size() && i < 5; i++) std::printf("  Mismatch in %s: pair (%u|%u)\n", name, difference[i].first, difference[i].second);
+
+		return difference.size();
+
+	}
+
+	DifferentialResult test_box_box_all_pairs(Random& random, long cases) {
+
+		DifferentialResult result;
+
+		while (result.cases < static_cast<std::size_t>(cases)) {
+
+			//! Some groups are large enough to be split over several threads
+
+			auto max_count = (random.integer(0, 3) == 0 ? 1000 : 300);
+
+			auto first = random_box_group(random, static_cast<std::size_t>(random.integer(0, max_count)));
+			auto second = random_box_group(random, static_cast<std::size_t>(random.integer(0, max_count)));
+
+			auto first_boxes = box_arrays(first);
+			auto second_boxes = box_arrays(second);
+
+			std::vector<Collishi::Pair> expected;
+			std::vector<Collishi::Pair> expected_within;
+
+			for (std::uint32_t i = 0; i < first_boxes.count; i++) {
+
+				for (std::uint32_t j = 0; j < second_boxes.count; j++) {
+
+					if (Collishi::collision_box_box(first_boxes.x[i], first_boxes.y[i], first_boxes.w[i], first_boxes.h[i], second_boxes.x[j], second_boxes.y[j], second_boxes.w[j], second_boxes.h[j])) expected.push_back({ i, j });
+
+				}
+
+				for (std::uint32_t j = i + 1; j < first_boxes.count; j++) {
+
+					if (Collishi::collision_box_box(first_boxes.x[i], first_boxes.y[i], first_boxes.w[i], first_boxes.h[i], first_boxes.x[j], first_boxes.y[j], first_boxes.w[j], first_boxes.h[j])) expected_within.push_back({ i, j });
+
+				}
+
+			}
+
+			std::vector<Collishi::Pair> single;
+			Collishi::collision_box_box_all_pairs(first_boxes, second_boxes, single, 1);
+
+			std::vector<Collishi::Pair> single_within;
+			Collishi::collision_box_box_all_pairs(first_boxes, single_within, 1);
+
+			result.mismatches += count_pair_mismatches("collision_box_box_all_pairs", single, expected);
+			result.mismatches += count_pair_mismatches("collision_box_box_all_pairs (one group)", single_within, expected_within);
+
+			result.cases += first_boxes.count * second_boxes.count + first_boxes.count * (first_boxes.count - (first_boxes.count > 0)) / 2;
+
+			//! Several threads must give exactly the same list as one thread, in the same order
+
+			std::vector<Collishi::Pair> parallel;
+			Collishi::collision_box_box_all_pairs(first_boxes, second_boxes, parallel, 3);
+
+			std::vector<Collishi::Pair> parallel_within;
+			Collishi::collision_box_box_all_pairs(first_boxes, parallel_within, 3);
+
+			if (parallel != single || parallel_within != single_within) {
+
+				if (result.mismatches++ < 5) std::printf("  collision_box_box_all_pairs on 3 threads differs from one thread for groups of %zu and %zu boxes\n", first_boxes.count, second_boxes.count);
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	//! Checks the results of the segment/circle kernels against collision_line_circle and the entry times against the geometry:
+	//! the entry point has to be on the circle (or inside, if the segment starts inside)
+
+	//! Results which differ in touching configurations count as ambiguous, since the compiler may contract the
+	//! multiplications and additions of the kernel and of the scalar routine differently (e.g. into FMA with -march=native)
+
+	void check_line_circle_results(const char* name, const float* segment, const float* circle, bool result, float entry_time, DifferentialResult& differential) {
+
+		auto expected = Collishi::collision_line_circle(segment[0], segment[1], segment[2], segment[3], circle[0], circle[1], circle[2]);
+
+		auto entry_x = static_cast<double>(segment[0]) + entry_time * static_cast<double>(segment[2]);
+		auto entry_y = static_cast<double>(segment[1]) + entry_time * static_cast<double>(segment[3]);
+		auto distance = std::hypot(entry_x - circle[0], entry_y - circle[1]);
+
+		auto tolerance = 1e-3 * (1.0 + std::fabs(circle[0] - segment[0]) + std::fabs(circle[1] - segment[1]) + std::fabs(segment[2]) + std::fabs(segment[3]) + circle[2]);
+
+		differential.cases++;
+
+		float args[7] = { segment[0], segment[1], segment[2], segment[3], circle[0], circle[1], circle[2] };
+
+		if (result != expected && Collishi::Reference::ambiguous(Collishi::Routine::line_circle, args)) {
+
+			differential.ambiguous++;
+			return;
+
+		}
+
+		bool mismatch = (result != expected);
+
+		if (!mismatch && !result) mismatch = !std::isinf(entry_time);
+		if (!mismatch && result) mismatch = (entry_time < 0.0f || entry_time > 1.0f || distance > circle[2] + tolerance || (entry_time > 0.0f && distance < circle[2] - tolerance));
+
+		if (mismatch && differential.mismatches++ < 5) {
+
+			std::printf("  Mismatch in %s (expected: %d, result: %d, entry time %a), arguments: %a %a %a %a %a %a %a\n", name, static_cast<int>(expected), static_cast<int>(result), entry_time,
+				segment[0], segment[1], segment[2], segment[3], circle[0], circle[1], circle[2]);
+
+		}
+
+	}
+
+	//! Random segments, circles whose radius is close to (or exactly) their distance from the segment, so the results are hard to get right
+
+	DifferentialResult test_line_circle_batch(Random& random, long cases) {
+
+		DifferentialResult result;
+
+		while (result.cases < static_cast<std::size_t>(cases)) {
+
+			auto count = static_cast<std::size_t>(random.integer(0, 100));
+
+			float segment[4];
+			random_shape(Collishi::ShapeType::line, random, segment, extent);
+
+			std::vector<float> circles(3 * count);
+
+			for (std::size_t i = 0; i < count; i++) {
+
+				circles[i] = random.uniform(0.0f, extent);
+				circles[count + i] = random.uniform(0.0f, extent);
+
+				auto distance = std::sqrt(Collishi::Reference::distance_squared_to_segment({ circles[i], circles[count + i] }, { segment[0], segment[1] }, { segment[0] + segment[2], segment[1] + segment[3] }));
+				auto factor = (random.integer(0, 3) == 0 ? 1.0 : 1.0 + random.normal(0.0f, 0.01f));
+
+				circles[2 * count + i] = static_cast<float>(distance * factor);
+
+			}
+
+			std::unique_ptr<bool[]> results(new bool[count]);
+			std::vector<float> entry_times(count);
+
+			Collishi::CircleArrays circle_arrays = { circles.data(), circles.data() + count, circles.data() + 2 * count, count };
+			Collishi::collision_line_circles(segment[0], segment[1], segment[2], segment[3], circle_arrays, results.get(), entry_times.data());
+
+			for (std::size_t i = 0; i < count; i++) {
+
+				float circle[3] = { circles[i], circles[count + i], circles[2 * count + i] };
+
+				check_line_circle_results("collision_line_circles", segment, circle, results[i], entry_times[i], result);
+
+			}
+
+			//! Some of the circles against copies of the segment, placed relative to the circle like the segment is placed relative to the other circles
+
+			for (std::size_t c = 0; c < count; c += 7) {
+
+				float circle[3] = { circles[c], circles[count + c], circles[2 * count + c] };
+
+				std::vector<float> lines(4 * count);
+
+				for (std::size_t i = 0; i < count; i++) {
+
+					lines[i] = segment[0] + circles[i] - circle[0];
+					lines[count + i] = segment[1] + circles[count + i] - circle[1];
+					lines[2 * count + i] = segment[2];
+					lines[3 * count + i] = segment[3];
+
+				}
+
+				Collishi::LineArrays line_arrays = { lines.data(), lines.data() + count, lines.data() + 2 * count, lines.data() + 3 * count, count };
+				Collishi::collision_lines_circle(line_arrays, circle[0], circle[1], circle[2], results.get(), entry_times.data());
+
+				for (std::size_t i = 0; i < count; i++) {
+
+					float line[4] = { lines[i], lines[count + i], lines[2 * count + i], lines[3 * count + i] };
+
+					check_line_circle_results("collision_lines_circle", line, circle, results[i], entry_times[i], result);
+
+				}
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	//! Every circle is generated close to the touching configuration with one of the triangles and tested against all of them
+
+	DifferentialResult test_circles_triangles(Random& random, long cases) {
+
+		DifferentialResult result;
+
+		while (result.cases < static_cast<std::size_t>(cases)) {
+
+			auto count = static_cast<std::size_t>(random.integer(0, 300));
+
+			std::vector<float> circles(3 * count);
+			std::vector<float> triangles(6 * count);
+
+			for (std::size_t i = 0; i < count; i++) {
+
+				float args[Collishi::max_routine_arity];
+				near_boundary_arguments(Collishi::Routine::circle_triangle, random, args);
+
+				for (std::size_t a = 0; a < 3; a++) circles[a * count + i] = args[a];
+				for (std::size_t a = 0; a < 6; a++) triangles[a * count + i] = args[3 + a];
+
+			}
+
+			Collishi::CircleArrays circle_arrays = { circles.data(), circles.data() + count, circles.data() + 2 * count, count };
+			Collishi::TriangleArrays triangle_arrays = { triangles.data(), triangles.data() + count, triangles.data() + 2 * count, triangles.data() + 3 * count, triangles.data() + 4 * count, triangles.data() + 5 * count, count };
+
+			std::vector<Collishi::Pair> actual;
+			Collishi::collision_circles_triangles(circle_arrays, triangle_arrays, actual);
+
+			std::sort(actual.begin(), actual.end(), [](const Collishi::Pair& a, const Collishi::Pair& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); });
+
+			std::size_t next = 0;
+
+			for (std::uint32_t i = 0; i < count; i++) {
+
+				for (std::uint32_t j = 0; j < count; j++) {
+
+					float args[9] = { circles[i], circles[count + i], circles[2 * count + i] };
+					for (std::size_t a = 0; a < 6; a++) args[3 + a] = triangles[a * count + j];
+
+					auto expected = Collishi::collision_circle_triangle(args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7], args[8]);
+					auto reported = (next < actual.size() && actual[next] == Collishi::Pair{ i, j });
+
+					if (reported) next++;
+
+					result.cases++;
+
+					if (reported == expected) continue;
+
+					if (Collishi::Reference::ambiguous(Collishi::Routine::circle_triangle, args)) {
+
+						result.ambiguous++;
+						continue;
+
+					}
+
+					if (result.mismatches++ < 5) {
+
+						std::printf("  Mismatch in collision_circles_triangles (expected: %d), arguments:", static_cast<int>(expected));
+
+						for (auto value : args) std::printf(" %a", value);
+
+						std::printf("\n");
+
+					}
+
+				}
+
+			}
+
+			//! Pairs which were reported more than once or out of range
+
+			result.mismatches += actual.size() - next;
+
+		}
+
+		return result;
+
+	}
+
+	//! Queries of the hierarchy (built at runtime here, with the same code as at compile time) against testing all shapes
+
+	DifferentialResult test_static_bvh(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 64;
+
+		DifferentialResult result;
+
+		while (result.cases < static_cast<std::size_t>(cases)) {
+
+			std::array<Collishi::Shape, shape_count> shapes;
+			for (auto& shape : shapes) shape = random_shape_value(random);
+
+			auto table = Collishi::make_overlap_table(shapes);
+			auto bvh = Collishi::make_static_bvh(shapes);
+
+			for (std::size_t i = 0; i < shape_count; i++) {
+
+				for (std::size_t j = 0; j < shape_count; j++) {
+
+					result.cases++;
+					if (table(i, j) != Collishi::collision(shapes[i], shapes[j])) result.mismatches++;
+
+				}
+
+			}
+
+			for (int q = 0; q < 64; q++) {
+
+				auto query = random_shape_value(random);
+
+				std::vector<bool> found(shape_count, false);
+				bvh.for_each_collision(query, [&](std::uint32_t index) { found[index] = true; });
+
+				for (std::size_t i = 0; i < shape_count; i++) {
+
+					result.cases++;
+
+					if (found[i] == Collishi::collision(shapes[i], query)) continue;
+
+					if (result.mismatches++ < 5) std::printf("  Mismatch in StaticBvh for shape %zu (expected: %d)\n", i, static_cast<int>(!found[i]));
+
+				}
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	//! Colliding pairs found by the broadphases against testing all pairs
+	//! The small cell sizes make most shapes too large for the grid, so the path for oversized shapes is tested as well
+
+	std::size_t count_broadphase_mismatches(const std::vector<Collishi::Pair>& expected, std::vector<Collishi::Pair> pairs, const char* name) {
+
+		std::sort(pairs.begin(), pairs.end(), [](const Collishi::Pair& a, const Collishi::Pair& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); });
+
+		std::size_t mismatches = 0;
+
+		std::vector<Collishi::Pair> difference;
+		std::set_symmetric_difference(expected.begin(), expected.end(), pairs.begin(), pairs.end(), std::back_inserter(difference), [](const Collishi::Pair& a, const Collishi::Pair& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); });
+
+		for (auto& pair : difference) {
+
+			if (mismatches++ < 5) std::printf("  Mismatch in broadphase %s for pair (%u|%u)\n", name, pair.first, pair.second);
+
+		}
+
+		return mismatches;
+
+	}
+
+	DifferentialResult test_broadphase(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 200;
+
+		DifferentialResult result;
+
+		while (result.cases < static_cast<std::size_t>(cases)) {
+
+			std::vector<Collishi::Shape> shapes(shape_count);
+			for (auto& shape : shapes) shape = random_shape_value(random);
+
+			Collishi::BroadphaseRunner runner;
+			Collishi::AdaptiveBroadphase adaptive;
+
+			for (int frame = 0; frame < 4; frame++) {
+
+				std::vector<Collishi::Pair> expected;
+
+				for (std::uint32_t i = 0; i < shape_count; i++) {
+
+					for (std::uint32_t j = i + 1; j < shape_count; j++) {
+
+						if (Collishi::collision(shapes[i], shapes[j])) expected.push_back({ i, j });
+
+					}
+
+				}
+
+				result.cases += shape_count * (shape_count - 1) / 2;
+
+				runner.update_bounds(shapes);
+
+				for (auto cell_size : { 0.5f, 5.0f, 40.0f }) {
+
+					std::vector<Collishi::Pair> pairs;
+					runner.grid(cell_size, shapes, pairs);
+
+					result.mismatches += count_broadphase_mismatches(expected, pairs, "grid");
+
+				}
+
+				std::vector<Collishi::Pair> tree_pairs;
+				runner.tree(shapes, tree_pairs);
+
+				result.mismatches += count_broadphase_mismatches(expected, tree_pairs, "tree");
+
+				for (auto along_y : { false, true }) {
+
+					std::vector<Collishi::Pair> pairs;
+					runner.sweep(along_y, shapes, pairs);
+
+					result.mismatches += count_broadphase_mismatches(expected, pairs, "sweep");
+
+				}
+
+				std::vector<Collishi::Pair> adaptive_pairs;
+				adaptive.collide(shapes, adaptive_pairs);
+
+				result.mismatches += count_broadphase_mismatches(expected, adaptive_pairs, "AdaptiveBroadphase");
+
+				//! Small movements, so the sweep reuses its order
+
+				for (auto& shape : shapes) {
+
+					shape.values[0] += random.uniform(-2.0f, 2.0f);
+					shape.values[1] += random.uniform(-2.0f, 2.0f);
+
+				}
+
+			}
+
+			//! The sweep ran last, so the grid and tree buffers are wasted until they are released
+
+			auto memory = runner.memory_stats();
+			runner.release_unused();
+			auto released = runner.memory_stats();
+
+			if (memory.used > memory.reserved || memory.wasted == 0 || released.wasted != 0 || released.reserved != memory.reserved - memory.wasted) {
+
+				std::printf("Inconsistent memory stats of BroadphaseRunner: used %zu, reserved %zu, wasted %zu, after release_unused reserved %zu, wasted %zu\n",
+					memory.used, memory.reserved, memory.wasted, released.reserved, released.wasted);
+
+				result.mismatches++;
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	//! Pairs of collide_all_parallel against the tree strategy, which test_broadphase compares to testing all pairs
+	//! The scenes are large enough for the parallel build of the hierarchy
+
+	DifferentialResult test_collide_all_parallel(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 40000;
+
+		DifferentialResult result;
+
+		while (result.cases < static_cast<std::size_t>(cases)) {
+
+			auto spread = random.uniform(500.0f, 4000.0f);
+
+			std::vector<Collishi::Shape> shapes(shape_count);
+
+			for (auto& shape : shapes) {
+
+				shape = random_shape_value(random);
+
+				shape.values[0] += random.uniform(-spread, spread);
+				shape.values[1] += random.uniform(-spread, spread);
+
+			}
+
+			result.cases += shape_count * (shape_count - 1) / 2;
+
+			Collishi::BroadphaseRunner runner;
+			runner.update_bounds(shapes);
+
+			std::vector<Collishi::Pair> expected;
+			runner.tree(shapes, expected);
+
+			std::sort(expected.begin(), expected.end(), [](const Collishi::Pair& a, const Collishi::Pair& b) { return a.first < b.first || (a.first == b.first && a.second < b.second); });
+
+			//! The pairs have to be sorted, so they are compared directly instead of as sets
+
+			for (auto threads : { 1u, 3u }) {
+
+				std::vector<Collishi::Pair> pairs;
+				auto used = Collishi::collide_all_parallel(shapes.data(), shapes.size(), pairs, threads);
+
+				//! Every thread needs a chunk of shapes
+
+				auto chunk_count = (shape_count + Collishi::Broadphase::parallel_chunk_size - 1) / Collishi::Broadphase::parallel_chunk_size;
+
+				if (used != std::min<std::size_t>(threads, chunk_count)) {
+
+					std::printf("  collide_all_parallel reported %u threads for %u requested and %zu chunks\n", used, threads, chunk_count);
+					result.mismatches++;
+
+				}
+
+				if (pairs == expected) continue;
+
+				result.mismatches += std::max<std::size_t>(1, count_broadphase_mismatches(expected, pairs, "collide_all_parallel"));
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	//! The refitted hierarchy has to find the same collisions as testing all shapes, before and after rebuilds
+
+	DifferentialResult test_dynamic_bvh(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 64;
+
+		DifferentialResult result;
+
+		while (result.cases < static_cast<std::size_t>(cases)) {
+
+			std::vector<Collishi::Shape> shapes(shape_count);
+			for (auto& shape : shapes) shape = random_shape_value(random);
+
+			Collishi::DynamicBvh tree;
+			std::size_t rebuilds = 0;
+
+			for (int frame = 0; frame < 16; frame++) {
+
+				rebuilds += tree.update(shapes);
+
+				for (int q = 0; q < 8; q++) {
+
+					auto query = random_shape_value(random);
+
+					std::vector<bool> found(shape_count, false);
+					tree.for_each_collision(query, [&](std::uint32_t index) { found[index] = true; });
+
+					for (std::size_t i = 0; i < shape_count; i++) {
+
+						result.cases++;
+
+						if (found[i] != Collishi::collision(shapes[i], query)) result.mismatches++;
+
+					}
+
+				}
+
+				//! After the update, the hierarchy is either rebuilt or within the limits of the policy
+
+				if (tree.rebuild_needed()) result.mismatches++;
+
+				//! Every shape jumps to a random position, so the refitted structure gets much worse than a rebuilt one
+
+				for (auto& shape : shapes) {
+
+					shape.values[0] = random.uniform(-extent, extent);
+					shape.values[1] = random.uniform(-extent, extent);
+
+				}
+
+			}
+
+			if (rebuilds < 2 || tree.query_stats().queries != 16 * 8) {
+
+				std::printf("DynamicBvh was rebuilt %zu times and counted %zu queries\n", rebuilds, tree.query_stats().queries);
+				result.mismatches++;
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	template <class T> T median(std::vector<T> values) {
+
+		std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+
+		return values[values.size() / 2];
+
+	}
+
+	//! Time per call of count calls of the routine in nanoseconds
+
+	template <class F> double nanoseconds_per_call(F&& invoke, const float* args, std::size_t arity, std::size_t count) {
+
+		Timer timer;
+		timer.start();
+
+		std::size_t hits = 0;
+
+		for (std::size_t i = 0; i < count; i++) hits += invoke(args + i * arity);
+
+		timer.stop();
+		do_not_optimize(hits);
+
+		return timer.total_milliseconds() * 1e6 / static_cast<double>(count);
+
+	}
+
+	//! Cost per call of every routine on fixed random inputs, relative to its reference routine in CollisionsReference.h
+	//! on the same inputs. The reference routines are never optimized, and both are measured right after each other, so they
+	//! see the same clock speed and load; the median of the ratios over the rounds ignores the rounds in which another process
+	//! interrupted either of them. Each measurement takes well below a millisecond, shorter than a time slice of the scheduler,
+	//! so most of them run uninterrupted even on a busy machine
+
+	std::vector<double> relative_costs() {
+
+		constexpr std::size_t count = 1024;
+		constexpr int rounds = 41;
+
+		std::vector<std::vector<float>> args(Collishi::routine_count);
+		std::vector<std::vector<double>> ratios(Collishi::routine_count);
+
+		Random random(777);
+
+		for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+			auto routine = static_cast<Collishi::Routine>(r);
+			auto arity = Collishi::routine_arity(routine);
+
+			args[r].resize(count * arity);
+
+			for (std::size_t i = 0; i < count; i++) random_arguments(routine, random, args[r].data() + i * arity, extent);
+
+		}
+
+		for (int round = 0; round < rounds; round++) {
+
+			for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+				auto routine = static_cast<Collishi::Routine>(r);
+				auto arity = Collishi::routine_arity(routine);
+
+				auto reference = nanoseconds_per_call([&](const float* a) { return Collishi::Reference::invoke_routine(routine, a); }, args[r].data(), arity, count);
+				auto optimized = nanoseconds_per_call([&](const float* a) { return Collishi::invoke_routine(routine, a); }, args[r].data(), arity, count);
+
+				ratios[r].push_back(optimized / reference);
+
+			}
+
+		}
+
+		std::vector<double> costs(Collishi::routine_count);
+		for (std::size_t r = 0; r < Collishi::routine_count; r++) costs[r] = median(ratios[r]);
+
+		return costs;
+
+	}
+
+	std::map<std::string, double> read_baseline(const char* filename) {
+
+		std::map<std::string, double> baseline;
+
+		auto file = std::fopen(filename, "r");
+		if (!file) return baseline;
+
+		char line[256];
+
+		while (std::fgets(line, sizeof(line), file)) {
+
+			char name[128];
+			double value;
+
+			if (line[0] == '#') continue;
+			if (std::sscanf(line, "%127s %lf", name, &value) == 2) baseline[name] = value;
+
+		}
+
+		std::fclose(file);
+
+		return baseline;
+
+	}
+
+	bool regressed(const std::vector<double>& costs, const std::map<std::string, double>& baseline, double threshold) {
+
+		for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+			auto entry = baseline.find(Collishi::routine_name(static_cast<Collishi::Routine>(r)));
+
+			if (entry != baseline.end() && costs[r] > entry->second * (1.0 + threshold)) return true;
+
+		}
+
+		return false;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto cases = option(argc, argv, "cases", 200000l);
+	auto seed = option(argc, argv, "seed", 4242l);
+	auto baseline_file = option(argc, argv, "baseline", "benchmarks/baseline.txt");
+	auto threshold = std::strtod(option(argc, argv, "threshold", "0.5"), nullptr);
+
+	bool failed = false;
+
+	std::printf("Differential test with %ld cases per routine\n\n", cases);
+	std::printf("%-36s %10s %10s %10s\n", "Routine", "Cases", "Ambiguous", "Mismatches");
+
+	for (auto& variant : variants()) {
+
+		Random random(static_cast<unsigned>(seed) + static_cast<unsigned>(variant.routine));
+
+		auto result = test_variant(variant, random, cases);
+
+		std::printf("%-36s %10zu %10zu %10zu\n", variant.name.c_str(), result.cases, result.ambiguous, result.mismatches);
+
+		if (result.mismatches > 0) failed = true;
+
+	}
+
+	//! The batch kernels and the broadphases perform many tests per call, so most of them get more cases
+
+	std::vector<Test<DifferentialResult>> tests = {
+
+		{ "collision_box_box_all_pairs", test_box_box_all_pairs, 10 },
+		{ "collision_line_circles", test_line_circle_batch, 1 },
+		{ "collision_circles_triangles", test_circles_triangles, 1 },
+		{ "StaticBvh", test_static_bvh, 1 },
+		{ "DynamicBvh", test_dynamic_bvh, 1 },
+		{ "Broadphase", test_broadphase, 10 },
+		{ "collide_all_parallel", test_collide_all_parallel, 10 },
+
+	};
+
+	for (std::size_t t = 0; t < tests.size(); t++) {
+
+		Random random(static_cast<unsigned>(seed) + 1000u + static_cast<unsigned>(t));
+
+		auto result = tests[t].run(random, cases * tests[t].scale);
+
+		std::printf("%-36s %10zu %10zu %10zu\n", tests[t].name, result.cases, result.ambiguous, result.mismatches);
+
+		if (result.mismatches > 0) failed = true;
+
+	}
+
+	if (flag(argc, argv, "skip-performance")) return (failed ? 1 : 0);
+
+	auto baseline = read_baseline(baseline_file);
+	auto update = flag(argc, argv, "update-baseline");
+
+	//! Without a baseline nothing would be compared, which must not pass as a successful check
+
+	if (baseline.empty() && !update) {
+
+		std::fprintf(stderr, "\nBaseline %s is missing or empty (run from the repository root, or create it with --update-baseline)\n", baseline_file);
+		return 1;
+
+	}
+
+	auto costs = relative_costs();
+
+	//! A regression needs to be confirmed by repeated measurements, since a single measurement can always be disturbed
+
+	for (int attempt = 0; attempt < 2 && !update && regressed(costs, baseline, threshold); attempt++) {
+
+		auto repeated = relative_costs();
+
+		for (std::size_t r = 0; r < Collishi::routine_count; r++) costs[r] = std::min(costs[r], repeated[r]);
+
+	}
+
+	std::printf("\nPerformance relative to baseline %s (costs relative to the reference routines, threshold: %.0f%%)\n\n", baseline_file, threshold * 100.0);
+	std::printf("%-36s %10s %10s %10s\n", "Routine", "Cost", "Baseline", "Change");
+
+	std::string updated = "# Collishi performance baseline\n# Cost per call relative to the reference routine in CollisionsReference.h, as measured by test_differential.cpp\n";
+
+	for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+		auto routine = static_cast<Collishi::Routine>(r);
+		auto name = Collishi::routine_name(routine);
+		auto cost = costs[r];
+
+		updated += std::string(name) + " " + std::to_string(cost) + "\n";
+
+		auto entry = baseline.find(name);
+
+		if (entry == baseline.end()) {
+
+			std::printf("%-36s %10.3f %10s %10s\n", name, cost, "-", "-");
+			continue;
+
+		}
+
+		auto change = cost / entry->second - 1.0;
+
+		std::printf("%-36s %10.3f %10.3f %+9.1f%%%s\n", name, cost, entry->second, change * 100.0, (change > threshold ? " REGRESSION" : ""));
+
+		if (change > threshold && !update) failed = true;
+
+	}
+
+	if (update) {
+
+		auto file = std::fopen(baseline_file, "w");
+
+		if (!file || std::fputs(updated.c_str(), file) < 0) {
+
+			std::printf("\nCould not write baseline %s\n", baseline_file);
+			failed = true;
+
+		}
+		else {
+
+			std::printf("\nBaseline %s updated\n", baseline_file);
+
+		}
+
+		if (file) std::fclose(file);
+
+	}
+
+	return (failed ? 1 : 0);
+
+}
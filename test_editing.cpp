@@ -0,0 +1,141 @@
+//! Test of the EditableBvh of CollisionsEditableBvh.h
+//! Random edits are applied to the hierarchy and to a list of shapes, and queries are compared with testing all live shapes
+//!
+//! Build: g++ -std=c++17 -O2 -pthread test_editing.cpp -o test_editing
+//! Usage: test_editing [--cases=N] [--seed=N]
+
+#include "CollisionsEditableBvh.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Testing;
+
+	//! Random inserts, removes and moves against testing all live shapes, including edits while a background rebuild runs,
+	//! which have to be applied to the rebuilt hierarchy before it replaces the edited one
+
+	TestResult test_editable_bvh(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 64;
+
+		TestResult result;
+
+		while (result.checks < static_cast<std::size_t>(cases)) {
+
+			std::vector<Collishi::Shape> shapes(shape_count);
+			for (auto& shape : shapes) shape = random_shape_value(random);
+
+			Collishi::EditableBvh::Policy policy;
+			policy.local_levels = static_cast<std::size_t>(random.integer(0, 4));
+			policy.optimize_after_edits = (random.integer(0, 1) == 0 ? 0.0 : 0.2);
+			policy.background = (random.integer(0, 1) == 0);
+
+			Collishi::EditableBvh level(policy);
+			level.build(shapes);
+
+			std::vector<bool> live(shape_count, true);
+
+			for (int step = 0; step < 64; step++) {
+
+				auto id = static_cast<std::uint32_t>(random.integer(0, static_cast<int>(shapes.size()) - 1));
+				auto action = random.integer(0, 9);
+
+				if (action < 5) {
+
+					//! Small moves mostly stay within the parent, jumps do not
+
+					auto& shape = shapes[id];
+
+					if (action < 3) {
+
+						shape.values[0] += random.uniform(-1.0f, 1.0f);
+						shape.values[1] += random.uniform(-1.0f, 1.0f);
+
+					}
+					else {
+
+						shape = random_shape_value(random);
+
+					}
+
+					if (level.modify(id, shape) != live[id]) result.failures++;
+
+				}
+				else if (action < 8) {
+
+					if (level.remove(id) != live[id]) result.failures++;
+
+					live[id] = false;
+
+				}
+				else {
+
+					auto inserted = level.insert(random_shape_value(random));
+
+					if (inserted >= shapes.size()) {
+
+						shapes.resize(inserted + 1);
+						live.resize(inserted + 1, false);
+
+					}
+
+					if (live[inserted]) result.failures++;
+
+					shapes[inserted] = level.shape(inserted);
+					live[inserted] = true;
+
+				}
+
+				if (step == 16 && !level.optimizing()) level.start_optimization();
+				if (step == 48) level.finish_optimization(true);
+
+				auto query = random_shape_value(random);
+
+				std::vector<bool> found(shapes.size(), false);
+				level.for_each_collision(query, [&](std::uint32_t index) { found[index] = true; });
+
+				for (std::size_t i = 0; i < shapes.size(); i++) {
+
+					result.checks++;
+
+					if (found[i] != (live[i] && Collishi::collision(shapes[i], query))) result.failures++;
+
+				}
+
+			}
+
+			//! Every live shape is in exactly one leaf of a tree with one shape per leaf
+
+			auto live_count = static_cast<std::size_t>(std::count(live.begin(), live.end(), true));
+			auto quality = level.measure_quality();
+
+			if (level.size() != live_count || quality.leaf_count != live_count || (live_count > 0 && quality.node_count != 2 * live_count - 1)
+				|| quality.max_depth > Collishi::EditableTree::max_depth || level.edits().background_rebuilds == 0) {
+
+				std::printf("EditableBvh has %zu shapes (%zu expected) in %zu leaves and %zu nodes of depth %zu after %zu background rebuilds\n", level.size(), live_count,
+					quality.leaf_count, quality.node_count, quality.max_depth, level.edits().background_rebuilds);
+				result.failures++;
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	return run_tests("Editing test", {
+
+		{ "EditableBvh", test_editable_bvh, 1 },
+
+	}, argc, argv);
+
+}
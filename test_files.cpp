@@ -0,0 +1,452 @@
+//! Tests of the file formats: mapped shape files, capture logs and mapped world files with their prefetcher
+//! Every file is written with random content, read back and compared, and damaged files have to be rejected
+//!
+//! Build: g++ -std=c++17 -O2 test_files.cpp -o test_files
+//! Usage: test_files [--cases=N] [--seed=N]
+
+#include "CollisionsCapture.h"
+#include "CollisionsShapeFile.h"
+#include "CollisionsWorldFile.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Testing;
+
+	//! Shapes of a mapped shape file are the written ones, and a file which lost its shapes is rejected
+
+	TestResult test_shape_file(Random& random, long cases) {
+
+		TestResult result;
+
+		auto filename = "/tmp/collishi-test-level-" + std::to_string(getpid()) + ".shapes";
+
+		while (result.checks < static_cast<std::size_t>(cases)) {
+
+			std::vector<Collishi::Shape> shapes(static_cast<std::size_t>(random.integer(1, 5000)));
+			for (auto& shape : shapes) shape = random_shape_value(random);
+
+			Collishi::MappedShapeFile level;
+
+			if (!Collishi::write_shape_file(filename.c_str(), shapes.data(), shapes.size()) || !level.open(filename.c_str()) || level.size() != shapes.size()) {
+
+				std::printf("  Could not write and map the shape file %s\n", filename.c_str());
+				result.failures++;
+				break;
+
+			}
+
+			for (std::size_t i = 0; i < shapes.size(); i++) {
+
+				auto& mapped = level.shapes()[i];
+
+				result.checks++;
+
+				if (mapped.type == shapes[i].type && std::equal(mapped.values, mapped.values + 6, shapes[i].values)) continue;
+
+				if (result.failures++ < 5) std::printf("  Mismatch in the shape file for shape %zu\n", i);
+
+			}
+
+		}
+
+		std::remove(filename.c_str());
+
+		//! A truncated file is rejected
+
+		auto file = std::fopen(filename.c_str(), "wb");
+
+		if (file) {
+
+			Collishi::ShapeFileHeader header = {};
+			std::memcpy(header.magic, Collishi::shape_file_magic, sizeof(header.magic));
+			header.version = Collishi::shape_file_version;
+			header.shape_size = sizeof(Collishi::Shape);
+			header.shape_count = 1000;
+			header.shape_offset = Collishi::shape_file_offset;
+
+			std::fwrite(&header, sizeof(header), 1, file);
+			std::fclose(file);
+
+			Collishi::MappedShapeFile level;
+
+			result.checks++;
+
+			if (level.open(filename.c_str())) {
+
+				std::printf("  A truncated shape file was mapped\n");
+				result.failures++;
+
+			}
+
+			std::remove(filename.c_str());
+
+		}
+
+		return result;
+
+	}
+
+	//! Capture logs read back the recorded calls, a log cut at a record boundary ends cleanly and a log cut within a record is an error
+
+	TestResult test_capture_log(Random& random, long cases) {
+
+		TestResult result;
+
+		auto filename = "/tmp/collishi-test-capture-" + std::to_string(getpid()) + ".clog";
+		auto cut_filename = filename + ".cut";
+
+		while (result.checks < static_cast<std::size_t>(cases)) {
+
+			std::vector<Collishi::Capture::Record> written(static_cast<std::size_t>(random.integer(1, 8)));
+			std::vector<std::size_t> ends;
+
+			Collishi::Capture::Log log;
+			if (!log.open(filename.c_str())) break;
+
+			std::size_t size = sizeof(Collishi::Capture::log_magic) + 2 * sizeof(std::uint32_t);
+
+			for (auto& record : written) {
+
+				record.kind = (random.integer(0, 1) == 0 ? Collishi::Capture::RecordKind::call : Collishi::Capture::RecordKind::batch);
+				record.routine = static_cast<Collishi::Routine>(random.integer(0, static_cast<int>(Collishi::routine_count) - 1));
+				record.count = (record.kind == Collishi::Capture::RecordKind::call ? 1 : static_cast<std::size_t>(random.integer(0, 4)));
+
+				auto arity = Collishi::routine_arity(record.routine);
+
+				record.args.resize(arity * record.count);
+				record.results.resize(record.count);
+
+				std::unique_ptr<bool[]> results(new bool[record.count + 1]);
+
+				for (std::size_t i = 0; i < record.count; i++) {
+
+					random_arguments(record.routine, random, record.args.data() + i * arity, extent);
+					results[i] = Collishi::invoke_routine(record.routine, record.args.data() + i * arity);
+					record.results[i] = results[i];
+
+				}
+
+				if (record.kind == Collishi::Capture::RecordKind::call) {
+
+					log.record_call(record.routine, record.args.data(), results[0]);
+					size += 3 + arity * sizeof(float);
+
+				}
+				else {
+
+					log.record_batch(record.routine, record.args.data(), record.count, results.get());
+					size += 6 + record.count * (arity * sizeof(float) + 1);
+
+				}
+
+				ends.push_back(size);
+
+			}
+
+			if (!log.close()) result.failures++;
+
+			//! The complete log
+
+			Collishi::Capture::Reader reader;
+			Collishi::Capture::Record record;
+
+			if (!reader.open(filename.c_str())) result.failures++;
+
+			for (auto& expected : written) {
+
+				result.checks++;
+
+				if (reader.next(record) != Collishi::Capture::ReadResult::record || record.kind != expected.kind || record.routine != expected.routine
+					|| record.count != expected.count || record.args != expected.args || record.results != expected.results) result.failures++;
+
+			}
+
+			if (reader.next(record) != Collishi::Capture::ReadResult::end) result.failures++;
+
+			//! A copy cut at a random byte after the header
+
+			std::vector<char> bytes(size);
+
+			auto file = std::fopen(filename.c_str(), "rb");
+			if (!file || std::fread(bytes.data(), 1, size, file) != size) result.failures++;
+			if (file) std::fclose(file);
+
+			auto cut = static_cast<std::size_t>(random.integer(static_cast<int>(sizeof(Collishi::Capture::log_magic) + 2 * sizeof(std::uint32_t)), static_cast<int>(size)));
+
+			file = std::fopen(cut_filename.c_str(), "wb");
+			if (file) {
+
+				std::fwrite(bytes.data(), 1, cut, file);
+				std::fclose(file);
+
+			}
+
+			Collishi::Capture::Reader cut_reader;
+
+			if (!cut_reader.open(cut_filename.c_str())) result.failures++;
+
+			auto complete = static_cast<std::size_t>(std::count_if(ends.begin(), ends.end(), [&](std::size_t end) { return end <= cut; }));
+			auto at_boundary = (complete == 0 ? cut == sizeof(Collishi::Capture::log_magic) + 2 * sizeof(std::uint32_t) : ends[complete - 1] == cut);
+
+			for (std::size_t i = 0; i < complete; i++) {
+
+				if (cut_reader.next(record) != Collishi::Capture::ReadResult::record) result.failures++;
+
+			}
+
+			result.checks++;
+
+			if (cut_reader.next(record) != (at_boundary ? Collishi::Capture::ReadResult::end : Collishi::Capture::ReadResult::error)) {
+
+				std::printf("  Capture log cut at byte %zu of %zu was not read as %s\n", cut, size, (at_boundary ? "complete" : "truncated"));
+				result.failures++;
+
+			}
+
+		}
+
+		//! A batch whose count exceeds the rest of the file is an error, and nothing of that size is allocated
+
+		if (auto file = std::fopen(filename.c_str(), "wb")) {
+
+			std::uint32_t header[2] = { Collishi::Capture::log_version, 0 };
+			std::uint8_t prefix[2] = { static_cast<std::uint8_t>(Collishi::Capture::RecordKind::batch), static_cast<std::uint8_t>(Collishi::Routine::triangle_triangle) };
+			std::uint32_t count = std::numeric_limits<std::uint32_t>::max();
+
+			std::fwrite(Collishi::Capture::log_magic, 1, sizeof(Collishi::Capture::log_magic), file);
+			std::fwrite(header, 1, sizeof(header), file);
+			std::fwrite(prefix, 1, sizeof(prefix), file);
+			std::fwrite(&count, 1, sizeof(count), file);
+			std::fwrite(header, 1, sizeof(header), file);
+			std::fclose(file);
+
+			Collishi::Capture::Reader reader;
+			Collishi::Capture::Record record;
+
+			result.checks++;
+
+			if (!reader.open(filename.c_str()) || reader.next(record) != Collishi::Capture::ReadResult::error || record.args.capacity() > 0) {
+
+				std::printf("  A capture log with a corrupt batch count was not rejected\n");
+				result.failures++;
+
+			}
+
+		}
+
+		//! A log which cannot be written (the disk is full) is reported when it is closed
+
+		Collishi::Capture::Log full;
+
+		if (full.open("/dev/full")) {
+
+			float args[Collishi::max_routine_arity] = {};
+
+			for (int i = 0; i < 100000; i++) full.record_call(Collishi::Routine::point_point, args, false);
+
+			result.checks++;
+
+			if (!full.failed() || full.close()) {
+
+				std::printf("  Writing a capture log to a full disk did not fail\n");
+				result.failures++;
+
+			}
+
+		}
+
+		std::remove(filename.c_str());
+		std::remove(cut_filename.c_str());
+
+		return result;
+
+	}
+
+	//! Queries of a mapped world file against testing all shapes, the layout of its blocks and the block counters of the prefetcher
+
+	TestResult test_world_file(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 5000;
+
+		TestResult result;
+
+		auto filename = "/tmp/collishi-test-world-" + std::to_string(getpid()) + ".world";
+
+		while (result.checks < static_cast<std::size_t>(cases)) {
+
+			auto spread = random.uniform(100.0f, 2000.0f);
+			auto block_shapes = static_cast<std::size_t>(random.integer(1, 64));
+
+			std::vector<Collishi::Shape> shapes(shape_count);
+
+			for (auto& shape : shapes) {
+
+				shape = random_shape_value(random);
+
+				shape.values[0] += random.uniform(-spread, spread);
+				shape.values[1] += random.uniform(-spread, spread);
+
+			}
+
+			Collishi::MappedWorld world;
+
+			if (!Collishi::write_world_file(filename.c_str(), shapes.data(), shapes.size(), block_shapes) || !world.open(filename.c_str()) || world.size() != shape_count
+				|| world.memory_stats().reserved != world.mapped_bytes()) {
+
+				std::printf("  Could not write and map the world file %s\n", filename.c_str());
+				result.failures++;
+				break;
+
+			}
+
+			//! The blocks cover every position once and their bounds contain the bounds of their shapes
+
+			std::vector<int> covered(shape_count);
+
+			for (std::size_t b = 0; b < world.block_count(); b++) {
+
+				auto& block = world.block(b);
+
+				for (auto p = block.first_shape; p < block.end_shape; p++) {
+
+					covered[p]++;
+
+					auto merged = block.bounds.merged(world.shape_bounds()[p]);
+					auto contained = (merged.min_x == block.bounds.min_x && merged.min_y == block.bounds.min_y && merged.max_x == block.bounds.max_x && merged.max_y == block.bounds.max_y);
+
+					if (block.end_shape - block.first_shape > block_shapes || !contained) {
+
+						if (result.failures++ < 5) std::printf("  Block %zu of the world file does not contain its shape at position %u\n", b, p);
+
+					}
+
+				}
+
+			}
+
+			if (std::count(covered.begin(), covered.end(), 1) != static_cast<std::ptrdiff_t>(shape_count)) {
+
+				std::printf("  The blocks of the world file do not cover every shape once\n");
+				result.failures++;
+
+			}
+
+			for (int q = 0; q < 200; q++) {
+
+				auto query = shapes[static_cast<std::size_t>(random.integer(0, static_cast<int>(shape_count) - 1))];
+				query.values[0] += random.uniform(-20.0f, 20.0f);
+
+				std::vector<std::uint32_t> found;
+				world.world().for_each_collision(query, [&](std::uint32_t position) { found.push_back(world.original_index(position)); });
+
+				std::sort(found.begin(), found.end());
+
+				for (std::uint32_t i = 0; i < shape_count; i++) {
+
+					result.checks++;
+
+					if (std::binary_search(found.begin(), found.end(), i) == Collishi::collision(shapes[i], query)) continue;
+
+					if (result.failures++ < 5) std::printf("  Mismatch in MappedWorld for shape %u\n", i);
+
+				}
+
+			}
+
+			//! Every block overlapping the region is advised once and skipped within the refresh interval
+
+			Collishi::WorldPrefetcher prefetcher(world);
+
+			auto x = random.uniform(-spread, spread);
+			auto y = random.uniform(-spread, spread);
+			auto region = Collishi::predicted_bounds(x, y, random.uniform(-200.0f, 200.0f), random.uniform(-200.0f, 200.0f), 30.0f, 0.5f);
+
+			std::uint64_t overlapping = 0;
+			for (std::size_t b = 0; b < world.block_count(); b++) overlapping += world.block(b).bounds.overlaps(region);
+
+			prefetcher.prefetch(region);
+			prefetcher.prefetch(region);
+			prefetcher.record_query(region);
+
+			auto& stats = prefetcher.stats();
+
+			if (stats.predictions != 2 || stats.blocks_advised != overlapping || stats.blocks_skipped != overlapping || stats.pages_cold > stats.pages_advised
+				|| (overlapping > 0 && (stats.pages_advised == 0 || stats.query_pages_resident + stats.query_pages_cold == 0))) {
+
+				std::printf("  Inconsistent prefetch counters: %llu blocks overlap, %llu advised, %llu skipped, %llu pages advised, %llu cold\n", static_cast<unsigned long long>(overlapping),
+					static_cast<unsigned long long>(stats.blocks_advised), static_cast<unsigned long long>(stats.blocks_skipped),
+					static_cast<unsigned long long>(stats.pages_advised), static_cast<unsigned long long>(stats.pages_cold));
+
+				result.failures++;
+
+			}
+
+		}
+
+		//! A root whose children lie outside the nodes is rejected, queries of it would read past the mapping
+
+		if (auto file = std::fopen(filename.c_str(), "r+b")) {
+
+			std::uint32_t first = std::numeric_limits<std::uint32_t>::max() - 1;
+
+			auto written = std::fseek(file, static_cast<long>(Collishi::world_file_alignment + offsetof(Collishi::BvhNode, first)), SEEK_SET) == 0
+				&& std::fwrite(&first, sizeof(first), 1, file) == 1;
+
+			std::fclose(file);
+
+			Collishi::MappedWorld world;
+
+			if (written && world.open(filename.c_str())) {
+
+				std::printf("  A world file with a corrupt root node was mapped\n");
+				result.failures++;
+
+			}
+
+		}
+
+		//! A file which lost its end is rejected
+
+		if (truncate(filename.c_str(), static_cast<off_t>(Collishi::world_file_alignment + 8)) == 0) {
+
+			Collishi::MappedWorld world;
+
+			if (world.open(filename.c_str())) {
+
+				std::printf("  A truncated world file was mapped\n");
+				result.failures++;
+
+			}
+
+		}
+
+		std::remove(filename.c_str());
+
+		return result;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	return run_tests("File format test", {
+
+		{ "MappedShapeFile", test_shape_file, 10 },
+		{ "Capture log", test_capture_log, 1 },
+		{ "MappedWorld", test_world_file, 10 },
+
+	}, argc, argv);
+
+}
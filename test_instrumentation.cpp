@@ -0,0 +1,631 @@
+//! Tests of the instrumentation: cost tags of CollisionsTags.h, the live metrics of CollisionsMetrics.h and the per-thread slots
+//! of CollisionsThreadSlots.h which the instrumentation shares
+//! Build with -DCOLLISHI_METRICS to test the routine counters as well, with -DCOLLISHI_TRACE to test the trace buffers
+//! and with -DCOLLISHI_PROFILE to test the profile histograms
+//!
+//! Build: g++ -std=c++17 -O2 -pthread test_instrumentation.cpp -o test_instrumentation -lrt
+//! Usage: test_instrumentation [--cases=N] [--seed=N]
+
+#include "CollisionsBatch.h"
+#include "CollisionsBroadphase.h"
+#include "CollisionsDynamicBvh.h"
+#include "CollisionsFixed.h"
+#include "CollisionsMetrics.h"
+#include "CollisionsTags.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Testing;
+
+	//! Tagged and scoped queries have to be counted once per call with their candidates and visited nodes, untagged calls not at all
+
+	TestResult test_cost_tags(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 64;
+
+		TestResult result;
+
+		auto queries = Collishi::cost_tag("test queries");
+		auto broadphase = Collishi::cost_tag("test broadphase");
+
+		Collishi::end_cost_frame();
+
+		while (result.checks < static_cast<std::size_t>(cases)) {
+
+			std::vector<Collishi::Shape> shapes(shape_count);
+			for (auto& shape : shapes) shape = random_shape_value(random);
+
+			Collishi::DynamicBvh tree;
+			tree.update(shapes);
+
+			std::uint64_t candidates = 0;
+
+			for (int q = 0; q < 8; q++) {
+
+				auto query = random_shape_value(random);
+
+				tree.for_each_collision(query, [](std::uint32_t) {}, queries);
+				tree.for_each_candidate(Collishi::bounds(query), [&](std::uint32_t) { candidates++; });
+				tree.for_each_collision(query, [](std::uint32_t) {});
+
+			}
+
+			//! The two untagged queries visit the same nodes as the tagged one, so only a third of them is attributed
+
+			Collishi::BroadphaseRunner runner;
+			std::vector<Collishi::Pair> pairs;
+
+			runner.update_bounds(shapes);
+
+			{
+
+				Collishi::CostScope scope(broadphase);
+				runner.tree(shapes, pairs);
+
+			}
+
+			auto frame = Collishi::end_cost_frame();
+
+			Collishi::TagCosts query_costs, broadphase_costs;
+			std::size_t other_tags = 0;
+
+			for (auto& entry : frame) {
+
+				if (entry.tag.id == queries.id) query_costs = entry.costs;
+				else if (entry.tag.id == broadphase.id) broadphase_costs = entry.costs;
+				else other_tags++;
+
+			}
+
+			result.checks += shape_count * 8;
+
+			if (query_costs.calls != 8 || query_costs.tests != candidates || query_costs.nodes_visited * 3 != tree.query_stats().nodes_visited
+				|| broadphase_costs.calls != 1 || broadphase_costs.tests < pairs.size() || broadphase_costs.nodes_visited < shape_count || other_tags > 0) {
+
+				std::printf("Cost tags counted %llu queries with %llu tests and %llu nodes (expected 8, %llu, %llu), %llu broadphase calls with %llu tests for %zu pairs and %zu other tags\n",
+					static_cast<unsigned long long>(query_costs.calls), static_cast<unsigned long long>(query_costs.tests), static_cast<unsigned long long>(query_costs.nodes_visited),
+					static_cast<unsigned long long>(candidates), static_cast<unsigned long long>(tree.query_stats().nodes_visited / 3),
+					static_cast<unsigned long long>(broadphase_costs.calls), static_cast<unsigned long long>(broadphase_costs.tests), pairs.size(), other_tags);
+
+				result.failures++;
+
+			}
+
+		}
+
+		//! Frames which end while other threads keep adding costs count every call exactly once, also after the threads exited
+
+		auto concurrent = Collishi::cost_tag("test concurrent frames");
+
+		constexpr int thread_count = 3;
+		constexpr int calls = 2000;
+
+		float args[] = { 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, 1.0f, 1.0f, 5.0f, 5.0f, 1.0f, 0.5f, 0.5f, 1.0f, 1.0f };
+		bool results[2];
+
+		std::atomic<int> running{ thread_count };
+		std::vector<std::thread> threads;
+
+		for (int t = 0; t < thread_count; t++) {
+
+			threads.emplace_back([&]() {
+
+				for (int c = 0; c < calls; c++) Collishi::invoke_routine_batch(Collishi::Routine::circle_box, args, 2, results, concurrent);
+
+				running--;
+
+			});
+
+		}
+
+		Collishi::TagCosts reported;
+
+		auto end_frame = [&]() {
+
+			for (auto& entry : Collishi::end_cost_frame()) {
+
+				if (entry.tag.id == concurrent.id) reported += entry.costs;
+
+			}
+
+		};
+
+		while (running > 0) end_frame();
+
+		for (auto& thread : threads) thread.join();
+
+		end_frame();
+
+		result.checks++;
+
+		if (reported.calls != thread_count * calls || reported.tests != 2 * thread_count * calls) {
+
+			std::printf("Frames ending during tagged calls on other threads counted %llu calls with %llu tests (expected %d with %d)\n", static_cast<unsigned long long>(reported.calls),
+				static_cast<unsigned long long>(reported.tests), thread_count * calls, 2 * thread_count * calls);
+
+			result.failures++;
+
+		}
+
+		return result;
+
+	}
+
+	//! A reader must only accept complete samples while the exporter keeps overwriting the ring, every field of a
+	//! published sample is derived from its frame number, so a sample mixing two frames is detected
+	//! With COLLISHI_METRICS, the routine counters have to match the results of the batch calls
+
+	TestResult test_metrics(Random& random, long cases) {
+
+		constexpr std::uint32_t slot_count = 4;
+
+		TestResult result;
+
+		auto name = "/collishi-test-" + std::to_string(getpid());
+
+		Collishi::MetricsExporter exporter;
+		Collishi::MetricsReader reader;
+
+		if (!exporter.open(name.c_str(), slot_count) || !reader.open(name.c_str())) {
+
+			std::printf("Could not create the shared memory segment %s\n", name.c_str());
+			result.failures++;
+			return result;
+
+		}
+
+		auto make_sample = [](std::uint64_t frame) {
+
+			Collishi::MetricsSample sample = {};
+
+			sample.frame = frame;
+			sample.steady_nanoseconds = frame * 3;
+
+			for (std::size_t r = 0; r < Collishi::routine_count; r++) sample.routines[r] = { frame + r, frame ^ r };
+
+			sample.phase_count = static_cast<std::uint32_t>(frame % Collishi::max_metrics_phases);
+			for (auto& phase : sample.phases) phase.costs = { frame, frame * 2, frame * 5, frame * 7 };
+
+			sample.memory_used = sample.memory_reserved = sample.memory_wasted = ~frame;
+
+			return sample;
+
+		};
+
+		auto consistent = [&](const Collishi::MetricsSample& sample) {
+
+			auto expected = make_sample(sample.frame);
+
+			return std::memcmp(&sample, &expected, sizeof(Collishi::MetricsSample)) == 0;
+
+		};
+
+		auto frames = static_cast<std::uint64_t>(cases) * 4;
+
+		std::thread writer([&]() {
+
+			for (std::uint64_t frame = 0; frame < frames; frame++) exporter.publish(make_sample(frame));
+
+		});
+
+		std::uint64_t last_frame = 0;
+
+		while (reader.published() < frames) {
+
+			Collishi::MetricsSample sample;
+
+			if (!reader.latest(sample)) continue;
+
+			result.checks++;
+
+			if (!consistent(sample) || sample.frame < last_frame) result.failures++;
+
+			last_frame = sample.frame;
+
+		}
+
+		writer.join();
+
+		//! The newest slot_count samples are readable, older ones were overwritten
+
+		Collishi::MetricsSample sample;
+
+		for (std::uint64_t index = 0; index < frames; index++) {
+
+			auto readable = reader.read(index, sample);
+
+			result.checks++;
+
+			if (readable != (index + slot_count >= frames) || (readable && (!consistent(sample) || sample.frame != index))) result.failures++;
+
+		}
+
+#ifdef COLLISHI_METRICS
+
+		auto before = Collishi::Metrics::totals();
+
+		constexpr std::size_t count = 256;
+
+		std::vector<float> args(count * Collishi::max_routine_arity);
+		bool results[count];
+
+		for (std::size_t i = 0; i < count; i++) random_arguments(Collishi::Routine::circle_box, random, args.data() + i * Collishi::routine_arity(Collishi::Routine::circle_box), extent);
+
+		Collishi::invoke_routine_batch(Collishi::Routine::circle_box, args.data(), count, results);
+
+		auto hits = static_cast<std::uint64_t>(std::count(results, results + count, true));
+		auto after = Collishi::Metrics::totals();
+
+		auto& counted = after[static_cast<std::size_t>(Collishi::Routine::circle_box)];
+		auto& counted_before = before[static_cast<std::size_t>(Collishi::Routine::circle_box)];
+
+		result.checks++;
+
+		if (counted.tests - counted_before.tests != count || counted.hits - counted_before.hits != hits) {
+
+			std::printf("Metrics counted %llu tests with %llu hits (expected %zu with %llu)\n", static_cast<unsigned long long>(counted.tests - counted_before.tests),
+				static_cast<unsigned long long>(counted.hits - counted_before.hits), count, static_cast<unsigned long long>(hits));
+
+			result.failures++;
+
+		}
+
+#else
+
+		(void) random;
+
+#endif
+
+		return result;
+
+	}
+
+	//! The overloads for fixed sizes of CollisionsFixed.h are measured and counted like the regular batch kernels
+
+	TestResult test_fixed_kernels(Random& random, long cases) {
+
+		using Tile = Collishi::FixedBox<4>;
+		using Bullet = Collishi::FixedCircle<3, 2>;
+
+		TestResult result;
+
+		auto tag = Collishi::cost_tag("test fixed kernels");
+
+		Collishi::end_cost_frame();
+
+		while (result.checks < static_cast<std::size_t>(cases)) {
+
+			auto count = static_cast<std::size_t>(random.integer(0, 300));
+
+			std::vector<float> positions(4 * count);
+			for (auto& value : positions) value = random.uniform(-20.0f, 20.0f);
+
+			std::unique_ptr<bool[]> results(new bool[count + 1]);
+
+			Collishi::PointArrays points = { positions.data(), positions.data() + count, count };
+
+			auto before = Collishi::Metrics::totals();
+
+			std::vector<Collishi::Pair> pairs;
+
+			Collishi::collision_box_box_batch<Tile, Tile>(positions.data(), count, results.get(), tag);
+			auto box_hits = static_cast<std::uint64_t>(std::count(results.get(), results.get() + count, true));
+
+			Collishi::collision_circle_circle_batch<Bullet, Bullet>(positions.data(), count, results.get(), tag);
+			auto circle_hits = static_cast<std::uint64_t>(std::count(results.get(), results.get() + count, true));
+
+			Collishi::collision_box_box_all_pairs<Tile>(points, pairs, 1, tag);
+			Collishi::collision_box_box_all_pairs<Tile, Tile>(points, points, pairs, 1, tag);
+
+			auto after = Collishi::Metrics::totals();
+			auto all_pairs_tests = count * (count > 0 ? count - 1 : 0) / 2 + count * count;
+
+			Collishi::TagCosts costs;
+
+			for (auto& entry : Collishi::end_cost_frame()) {
+
+				if (entry.tag.id == tag.id) costs = entry.costs;
+
+			}
+
+			result.checks += 2 * count + all_pairs_tests;
+
+			if (costs.calls != 4 || costs.tests != 2 * count + all_pairs_tests) {
+
+				std::printf("  Cost tags counted %llu calls with %llu tests of the fixed kernels (expected 4 with %zu)\n", static_cast<unsigned long long>(costs.calls),
+					static_cast<unsigned long long>(costs.tests), 2 * count + all_pairs_tests);
+
+				result.failures++;
+
+			}
+
+#ifdef COLLISHI_METRICS
+			auto counted = [&](Collishi::Routine routine) {
+
+				auto r = static_cast<std::size_t>(routine);
+
+				return Collishi::RoutineMetrics{ after[r].tests - before[r].tests, after[r].hits - before[r].hits };
+
+			};
+
+			auto boxes = counted(Collishi::Routine::box_box);
+			auto circles = counted(Collishi::Routine::circle_circle);
+
+			if (boxes.tests != count + all_pairs_tests || boxes.hits != box_hits + pairs.size() || circles.tests != count || circles.hits != circle_hits) {
+
+				std::printf("  Metrics counted %llu box tests with %llu hits and %llu circle tests with %llu hits of the fixed kernels\n", static_cast<unsigned long long>(boxes.tests),
+					static_cast<unsigned long long>(boxes.hits), static_cast<unsigned long long>(circles.tests), static_cast<unsigned long long>(circles.hits));
+
+				result.failures++;
+
+			}
+#else
+			(void) before;
+			(void) after;
+			(void) box_hits;
+			(void) circle_hits;
+#endif
+
+		}
+
+		return result;
+
+	}
+
+	//! Threads hand back their slots of the instrumentation when they exit, so calling threaded kernels again and again must not grow the memory
+
+	TestResult test_thread_slots(Random& random, long cases) {
+
+		constexpr std::size_t box_count = 2000;
+		constexpr std::size_t shape_count = 20000;
+		constexpr unsigned threads = 4;
+
+		TestResult result;
+
+		std::vector<float> values(4 * box_count);
+
+		for (std::size_t i = 0; i < box_count; i++) {
+
+			values[i] = random.uniform(-1000.0f, 1000.0f);
+			values[box_count + i] = random.uniform(-1000.0f, 1000.0f);
+			values[2 * box_count + i] = random.uniform(0.0f, 20.0f);
+			values[3 * box_count + i] = random.uniform(0.0f, 20.0f);
+
+		}
+
+		Collishi::BoxArrays boxes = { values.data(), values.data() + box_count, values.data() + 2 * box_count, values.data() + 3 * box_count, box_count };
+
+		std::vector<Collishi::Shape> shapes(shape_count);
+
+		for (auto& shape : shapes) {
+
+			shape = random_shape_value(random);
+
+			shape.values[0] += random.uniform(-2000.0f, 2000.0f);
+			shape.values[1] += random.uniform(-2000.0f, 2000.0f);
+
+		}
+
+		auto reserved = []() {
+
+			auto stats = Collishi::Metrics::memory_stats();
+
+			stats += Collishi::cost_tags_memory_stats();
+
+#ifdef COLLISHI_TRACE
+			stats += Collishi::Trace::memory_stats();
+#endif
+
+#ifdef COLLISHI_PROFILE
+			stats += Collishi::Profile::memory_stats();
+#endif
+
+			return stats.reserved;
+
+		};
+
+		//! The number of slots is the largest number of threads which were alive at the same time, so first the calling thread
+		//! and as many other threads as the kernels use wait for each other after taking their slots
+
+		auto tag = Collishi::cost_tag("test thread slots");
+
+		auto instrumented_call = [&]() {
+
+			float args[] = { 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, 1.0f, 1.0f };
+			bool results[1];
+
+			Collishi::invoke_routine_batch(Collishi::Routine::circle_box, args, 1, results, tag);
+
+		};
+
+		//! The kernels only measure tagged calls on the calling thread, so tagged calls on new threads are added
+
+		auto round = [&]() {
+
+			std::vector<Collishi::Pair> pairs;
+
+			Collishi::collision_box_box_all_pairs(boxes, pairs, threads);
+			Collishi::collide_all_parallel(shapes.data(), shapes.size(), pairs, threads);
+
+			std::vector<std::thread> callers;
+
+			for (unsigned t = 1; t < threads; t++) callers.emplace_back(instrumented_call);
+
+			instrumented_call();
+
+			for (auto& caller : callers) caller.join();
+
+		};
+
+		auto totals_before = Collishi::Metrics::totals();
+
+		instrumented_call();
+
+		std::atomic<unsigned> waiting{ 0 };
+		std::vector<std::thread> workers;
+
+		for (unsigned t = 0; t < threads; t++) {
+
+			workers.emplace_back([&]() {
+
+				instrumented_call();
+
+				for (waiting++; waiting < threads;) std::this_thread::yield();
+
+			});
+
+		}
+
+		for (auto& worker : workers) worker.join();
+
+		//! The counters of the exited threads are kept in the totals
+
+#ifdef COLLISHI_METRICS
+		auto counted = Collishi::Metrics::totals()[static_cast<std::size_t>(Collishi::Routine::circle_box)].tests - totals_before[static_cast<std::size_t>(Collishi::Routine::circle_box)].tests;
+
+		result.checks++;
+
+		if (counted != threads + 1) {
+
+			std::printf("  Metrics counted %llu calls of %u threads which exited and the calling thread (expected %u)\n", static_cast<unsigned long long>(counted), threads, threads + 1);
+			result.failures++;
+
+		}
+#else
+		(void) totals_before;
+#endif
+
+		round();
+
+		auto before = reserved();
+		auto rounds = std::max(10l, cases / 10000);
+
+#ifdef COLLISHI_PROFILE
+		auto samples = [](const Collishi::Profile::Summary& summary) {
+
+			std::uint64_t total = 0;
+			for (auto& routine : summary.routines) total += routine.samples;
+
+			return total;
+
+		};
+
+		auto samples_before = samples(Collishi::Profile::snapshot());
+#endif
+
+		for (long r = 0; r < rounds; r++) round();
+
+		result.checks++;
+
+		if (reserved() != before) {
+
+			std::printf("  The instrumentation reserved %zu bytes before and %zu bytes after %ld rounds of threaded kernels\n", before, reserved(), rounds);
+			result.failures++;
+
+		}
+
+		//! The samples of the exited worker threads are kept
+
+#ifdef COLLISHI_PROFILE
+		result.checks++;
+
+		if (samples(Collishi::Profile::snapshot()) <= samples_before) {
+
+			std::printf("  The profile lost the samples of exited threads\n");
+			result.failures++;
+
+		}
+#endif
+
+		return result;
+
+	}
+
+	//! Threads which run one after the other record into the same trace buffer, but are still written as different threads
+
+	TestResult test_trace_threads(Random&, long) {
+
+		TestResult result;
+
+#ifdef COLLISHI_TRACE
+		constexpr int threads = 3;
+
+		for (int t = 0; t < threads; t++) {
+
+			std::thread([]() { COLLISHI_TRACE_SCOPE("test", "trace thread"); }).join();
+
+		}
+
+		auto filename = "/tmp/collishi-test-trace-" + std::to_string(getpid()) + ".json";
+
+		std::string json;
+
+		if (Collishi::Trace::write_chrome_json(filename.c_str())) {
+
+			if (auto file = std::fopen(filename.c_str(), "r")) {
+
+				char chunk[4096];
+
+				for (std::size_t read; (read = std::fread(chunk, 1, sizeof(chunk), file)) > 0;) json.append(chunk, read);
+
+				std::fclose(file);
+
+			}
+
+		}
+
+		std::remove(filename.c_str());
+
+		//! The thread of every event of the test
+
+		std::vector<std::string> tids;
+
+		for (auto position = json.find("\"name\":\"trace thread\""); position != std::string::npos; position = json.find("\"name\":\"trace thread\"", position + 1)) {
+
+			auto tid = json.find("\"tid\":", position);
+			if (tid != std::string::npos) tids.push_back(json.substr(tid, json.find(',', tid) - tid));
+
+		}
+
+		std::sort(tids.begin(), tids.end());
+
+		result.checks++;
+
+		if (tids.size() != threads || std::unique(tids.begin(), tids.end()) != tids.end()) {
+
+			std::printf("  The events of %d threads were written as %zu events of fewer threads\n", threads, tids.size());
+			result.failures++;
+
+		}
+#endif
+
+		return result;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	return run_tests("Instrumentation test", {
+
+		{ "Cost tags", test_cost_tags, 1 },
+		{ "Metrics", test_metrics, 1 },
+		{ "Fixed size kernels", test_fixed_kernels, 1 },
+		{ "Thread slots", test_thread_slots, 1 },
+		{ "Trace threads", test_trace_threads, 1 },
+
+	}, argc, argv);
+
+}
@@ -0,0 +1,423 @@
+//! Tests of the multi-process components: the query service of CollisionsService.h and the partitioned world of CollisionsPartition.h
+//! Clients and region workers run on their own threads and are connected by shared memory, and their answers are compared with testing all shapes
+//!
+//! Build: g++ -std=c++17 -O2 -pthread test_service.cpp -o test_service -lrt
+//! Usage: test_service [--cases=N] [--seed=N]
+
+#include "CollisionsPartition.h"
+#include "CollisionsService.h"
+#include "test_support.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Testing;
+
+	//! Batches answered by the query service and direct queries of the shared world have to find exactly the shapes found by testing all of them
+	//! Several clients submit at the same time, so the ring of submissions is used concurrently
+
+	TestResult test_service(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 256;
+		constexpr std::size_t client_count = 3;
+
+		TestResult result;
+
+		auto name = "/collishi-test-world-" + std::to_string(getpid());
+
+		std::vector<Collishi::Shape> shapes(shape_count);
+		for (auto& shape : shapes) shape = random_shape_value(random);
+
+		Collishi::ServiceLimits limits;
+		limits.channel_count = client_count;
+		limits.max_queries = 64;
+
+		Collishi::WorldServer server;
+
+		if (!server.open(name.c_str(), shapes, limits)) {
+
+			std::printf("Could not create the shared memory segment %s\n", name.c_str());
+			result.failures++;
+			return result;
+
+		}
+
+		struct ClientResult {
+
+			std::size_t checks = 0;
+			std::size_t failures = 0;
+
+		};
+
+		std::array<ClientResult, client_count> client_results;
+		std::atomic<std::size_t> connected{ 0 };
+		std::atomic<std::size_t> finished{ 0 };
+
+		auto batches = static_cast<std::size_t>(cases) / (limits.max_queries * client_count) + 1;
+
+		std::vector<std::thread> clients;
+
+		for (std::size_t c = 0; c < client_count; c++) {
+
+			clients.emplace_back([&, c, seed = static_cast<unsigned>(random.integer(0, 1 << 30))]() {
+
+				Random client_random(seed);
+				Collishi::WorldClient client;
+				auto& client_result = client_results[c];
+
+				if (!client.open(name.c_str())) {
+
+					client_result.failures++;
+					finished++;
+					return;
+
+				}
+
+				connected++;
+
+				std::vector<Collishi::Shape> queries(limits.max_queries);
+				std::vector<Collishi::Pair> pairs;
+
+				for (std::size_t b = 0; b < batches; b++) {
+
+					auto count = static_cast<std::size_t>(client_random.integer(1, static_cast<int>(limits.max_queries)));
+					for (std::size_t q = 0; q < count; q++) queries[q] = random_shape_value(client_random);
+
+					std::vector<std::vector<bool>> found(count, std::vector<bool>(shape_count, false));
+
+					if (!client.query(queries.data(), count, pairs, std::chrono::milliseconds(10000))) client_result.failures++;
+
+					for (auto& pair : pairs) {
+
+						if (pair.first >= count || found[pair.first][pair.second]) client_result.failures++;
+						else found[pair.first][pair.second] = true;
+
+					}
+
+					//! The world in the segment is also queried directly
+
+					for (std::size_t q = 0; q < count; q++) {
+
+						std::vector<bool> direct(shape_count, false);
+						client.world().for_each_collision(queries[q], [&](std::uint32_t index) { direct[index] = true; });
+
+						for (std::size_t i = 0; i < shape_count; i++) {
+
+							auto expected = Collishi::collision(shapes[i], queries[q]);
+
+							client_result.checks++;
+
+							if (found[q][i] != expected || direct[i] != expected) client_result.failures++;
+
+						}
+
+					}
+
+				}
+
+				finished++;
+
+			});
+
+		}
+
+		while (finished < client_count) {
+
+			if (server.poll() == 0) std::this_thread::yield();
+
+		}
+
+		for (auto& client : clients) client.join();
+
+		for (auto& client_result : client_results) {
+
+			result.checks += client_result.checks;
+			result.failures += client_result.failures;
+
+		}
+
+		//! All channels are taken while the clients are connected, and free again after they closed
+
+		Collishi::WorldClient again;
+
+		result.checks++;
+
+		if (connected != client_count || !again.open(name.c_str()) || again.max_queries() != limits.max_queries) result.failures++;
+
+		std::vector<Collishi::Pair> pairs;
+		std::vector<Collishi::Shape> too_many(limits.max_queries + 1, shapes[0]);
+
+		result.checks++;
+
+		if (again.submit(too_many.data(), too_many.size()) || again.query(too_many.data(), too_many.size(), pairs)) result.failures++;
+
+		//! A client which closes before its batch was answered (after a timeout, say) gets its channel back once the server answers,
+		//! so reconnecting more often than there are channels still works
+
+		again.close();
+
+		for (std::size_t round = 0; round <= client_count; round++) {
+
+			Collishi::WorldClient impatient;
+
+			result.checks++;
+
+			if (!impatient.open(name.c_str()) || !impatient.submit(shapes.data(), 1)) {
+
+				std::printf("  No free channel after %zu clients closed before their answer\n", round);
+				result.failures++;
+				break;
+
+			}
+
+			impatient.close();
+			server.poll();
+
+		}
+
+		return result;
+
+	}
+
+	//! Workers of a partitioned world, each on its own thread and connected by the shared memory transport, have to report
+	//! every colliding pair exactly once and answer the queries within their regions exactly, although the shapes jump
+	//! to random positions every tick, so most of them migrate to another region
+
+	TestResult test_partition(Random& random, long cases) {
+
+		constexpr std::size_t shape_count = 200;
+		constexpr std::size_t query_count = 64;
+		constexpr std::size_t ticks = 6;
+		constexpr float world_size = 100.0f;
+
+		TestResult result;
+
+		auto name = "/collishi-test-partition-" + std::to_string(getpid());
+
+		//! Sizes up to a fifth of the world, so some shapes are larger than the margin and sent to all regions
+
+		auto small_shape = [&]() {
+
+			auto shape = random_shape_value(random);
+
+			random_shape(shape.type, random, shape.values, world_size * 0.2f);
+
+			shape.values[0] = random.uniform(0.0f, world_size);
+			shape.values[1] = random.uniform(0.0f, world_size);
+
+			return shape;
+
+		};
+
+		Collishi::PartitionLayout layout({ 0.0f, 0.0f, world_size, world_size }, 3, 3, 8.0f);
+
+		while (result.checks < static_cast<std::size_t>(cases)) {
+
+			std::vector<std::vector<Collishi::Shape>> truth(ticks, std::vector<Collishi::Shape>(shape_count));
+			std::vector<std::vector<Collishi::Shape>> queries(ticks, std::vector<Collishi::Shape>(query_count));
+
+			for (std::size_t t = 0; t < ticks; t++) {
+
+				for (auto& shape : truth[t]) shape = small_shape();
+				for (auto& query : queries[t]) query = small_shape();
+
+			}
+
+			Collishi::SharedMemoryTransport creator;
+
+			if (!creator.create(name.c_str(), layout.region_count(), static_cast<std::uint32_t>(shape_count * layout.region_count()))) {
+
+				std::printf("Could not create the shared memory segment %s\n", name.c_str());
+				result.failures++;
+				return result;
+
+			}
+
+			//! Per tick: the pairs reported by all regions, and the shapes found for every query by the region owning it (if it covers the query)
+
+			std::vector<std::vector<std::vector<Collishi::Pair>>> pairs(ticks, std::vector<std::vector<Collishi::Pair>>(layout.region_count()));
+			std::vector<std::vector<std::vector<std::uint32_t>>> found(ticks, std::vector<std::vector<std::uint32_t>>(query_count));
+			std::vector<std::vector<char>> covered(ticks, std::vector<char>(query_count, 0));
+			std::atomic<std::size_t> failures{ 0 };
+
+			std::vector<std::thread> workers;
+
+			for (std::uint32_t region = 0; region < layout.region_count(); region++) {
+
+				workers.emplace_back([&, region]() {
+
+					Collishi::SharedMemoryTransport transport;
+					Collishi::RegionWorker worker(layout, region);
+
+					if (!transport.open(name.c_str())) {
+
+						failures++;
+						return;
+
+					}
+
+					//! All shapes start in region 0 and migrate with the first exchange
+
+					if (region == 0) {
+
+						for (std::uint32_t id = 0; id < shape_count; id++) worker.set_shape(id, truth[0][id]);
+
+					}
+
+					for (std::size_t t = 0; t < ticks; t++) {
+
+						std::vector<std::uint32_t> owned;
+						worker.for_each_owned([&](std::uint32_t id, const Collishi::Shape&) { owned.push_back(id); });
+
+						for (auto id : owned) worker.set_shape(id, truth[t][id]);
+
+						if (!worker.exchange(transport)) failures++;
+
+						worker.collide(pairs[t][region]);
+
+						for (std::size_t q = 0; q < query_count; q++) {
+
+							if (layout.owner(queries[t][q]) != region) continue;
+
+							covered[t][q] = worker.for_each_collision(queries[t][q], [&](std::uint32_t id, const Collishi::Shape&, bool) { found[t][q].push_back(id); });
+
+						}
+
+					}
+
+				});
+
+			}
+
+			for (auto& worker : workers) worker.join();
+
+			result.failures += failures;
+
+			for (std::size_t t = 0; t < ticks; t++) {
+
+				std::set<std::pair<std::uint32_t, std::uint32_t>> reported;
+
+				for (auto& region_pairs : pairs[t]) {
+
+					for (auto& pair : region_pairs) {
+
+						auto key = std::make_pair(std::min(pair.first, pair.second), std::max(pair.first, pair.second));
+
+						if (!reported.insert(key).second) result.failures++;
+
+					}
+
+				}
+
+				for (std::uint32_t i = 0; i < shape_count; i++) {
+
+					for (std::uint32_t j = i + 1; j < shape_count; j++) {
+
+						result.checks++;
+
+						if (Collishi::collision(truth[t][i], truth[t][j]) != (reported.count({ i, j }) > 0)) result.failures++;
+
+					}
+
+				}
+
+				for (std::size_t q = 0; q < query_count; q++) {
+
+					//! A query reaching beyond the expanded region of its owner has no exact answer
+
+					if (!covered[t][q]) continue;
+
+					std::set<std::uint32_t> ids(found[t][q].begin(), found[t][q].end());
+
+					if (ids.size() != found[t][q].size()) result.failures++;
+
+					for (std::uint32_t i = 0; i < shape_count; i++) {
+
+						result.checks++;
+
+						if (Collishi::collision(truth[t][i], queries[t][q]) != (ids.count(i) > 0)) result.failures++;
+
+					}
+
+				}
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+	//! A region which times out fails the partition: it closes its transport, and the other regions fail their next exchange
+	//! and close theirs, even though they could complete the tick the failed region sent its messages for
+
+	TestResult test_partition_timeout(Random&, long cases) {
+
+		TestResult result;
+
+		auto name = "/collishi-test-partition-timeout-" + std::to_string(getpid());
+
+		for (long c = 0; c < std::max(1l, cases / 10000); c++) {
+
+			Collishi::SharedMemoryTransport creator;
+			Collishi::SharedMemoryTransport first, second;
+
+			if (!creator.create(name.c_str(), 2, 16) || !first.open(name.c_str()) || !second.open(name.c_str())) {
+
+				std::printf("Could not create the shared memory segment %s\n", name.c_str());
+				result.failures++;
+				return result;
+
+			}
+
+			std::vector<Collishi::PartitionMessage> outgoing(1, { 1, Collishi::PartitionMessage::Kind::ghost, 7, {} });
+			std::vector<Collishi::PartitionMessage> incoming;
+
+			first.set_timeout(std::chrono::milliseconds(10));
+
+			result.checks += 2;
+
+			if (first.exchange(0, outgoing, incoming) || first.is_open()) {
+
+				std::printf("  The exchange of a region without its neighbour did not time out and close the transport\n");
+				result.failures++;
+
+			}
+
+			if (second.exchange(1, {}, incoming) || second.is_open()) {
+
+				std::printf("  A region exchanged after its neighbour timed out\n");
+				result.failures++;
+
+			}
+
+		}
+
+		return result;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	return run_tests("Service test", {
+
+		{ "Service", test_service, 1 },
+		{ "Partition", test_partition, 10 },
+		{ "Partition timeout", test_partition_timeout, 1 },
+
+	}, argc, argv);
+
+}
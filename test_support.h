@@ -0,0 +1,83 @@
+#pragma once
+
+//! Helpers shared by the test programs in this directory
+//! Every program has a table of tests, which are run with their own random sequence and reported in one loop
+
+#include "CollisionsShapes.h"
+#include "benchmarks/Benchmark.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace Collishi::Testing {
+
+	using namespace Collishi::Benchmark;
+
+	//! Size of the region in which random shapes are placed
+
+	constexpr float extent = 100.0f;
+
+	//! Shape of a random type within the extent
+
+	inline Shape random_shape_value(Random& random) {
+
+		auto type = static_cast<ShapeType>(random.integer(0, 4));
+
+		Shape shape = { type, {} };
+		random_shape(type, random, shape.values, extent);
+
+		return shape;
+
+	}
+
+	//! Result of a test which checks a component against its specification instead of an oracle
+
+	struct TestResult {
+
+		std::size_t checks = 0;
+		std::size_t failures = 0;
+
+	};
+
+	//! Entry of the table of tests; the number of cases given on the command line is multiplied by the scale
+
+	template <class Result> struct Test {
+
+		const char* name;
+		Result (*run)(Random& random, long cases);
+		long scale;
+
+	};
+
+	//! Runs the component tests of the table and prints one row per test, returns the exit code of the program
+	//! Usage of the program: [--cases=N] [--seed=N]
+
+	inline int run_tests(const char* title, const std::vector<Test<TestResult>>& tests, int argc, char** argv) {
+
+		auto cases = option(argc, argv, "cases", 200000l);
+		auto seed = option(argc, argv, "seed", 4242l);
+
+		bool failed = false;
+
+		std::printf("%s with %ld cases\n\n", title, cases);
+		std::printf("%-36s %10s %10s\n", "Test", "Checks", "Failures");
+
+		for (std::size_t t = 0; t < tests.size(); t++) {
+
+			auto& test = tests[t];
+
+			Random random(static_cast<unsigned>(seed) + static_cast<unsigned>(t));
+
+			auto result = test.run(random, cases * test.scale);
+
+			std::printf("%-36s %10zu %10zu\n", test.name, result.checks, result.failures);
+
+			if (result.failures > 0) failed = true;
+
+		}
+
+		return (failed ? 1 : 0);
+
+	}
+
+}
@@ -0,0 +1,129 @@
+//! Selects the fastest verified variant of every routine on this machine (see CollisionsVariants.h)
+//! The representative data is either taken from a capture log of the application (see CollisionsCapture.h)
+//! or generated randomly like in the benchmarks; the selection is written to a file which the application loads at startup
+//!
+//! Build (with the same flags as the application, e.g. -march=native):
+//! g++ -std=c++17 -O2 tools/autotune.cpp -o autotune
+//!
+//! Usage: autotune [--capture=log file] [--cases=N] [--repetitions=N] [--seed=N] [--output=collishi_variants.txt]
+
+#include "../CollisionsCapture.h"
+#include "../CollisionsVariants.h"
+#include "../benchmarks/Benchmark.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace Collishi::Benchmark;
+
+int main(int argc, char** argv) {
+
+	auto capture = option(argc, argv, "capture", "");
+	auto cases = static_cast<std::size_t>(option(argc, argv, "cases", 20000l));
+	auto repetitions = static_cast<int>(option(argc, argv, "repetitions", 5l));
+	auto seed = option(argc, argv, "seed", 12345l);
+	auto output = option(argc, argv, "output", "collishi_variants.txt");
+
+	std::vector<float> args[Collishi::routine_count];
+
+	if (capture[0] != '\0') {
+
+		Collishi::Capture::Reader reader;
+
+		if (!reader.open(capture)) {
+
+			std::fprintf(stderr, "Could not open capture log %s\n", capture);
+			return 2;
+
+		}
+
+		Collishi::Capture::Record record;
+		Collishi::Capture::ReadResult result;
+
+		while ((result = reader.next(record)) == Collishi::Capture::ReadResult::record) {
+
+			auto& routine_args = args[static_cast<std::size_t>(record.routine)];
+			routine_args.insert(routine_args.end(), record.args.begin(), record.args.end());
+
+		}
+
+		if (result == Collishi::Capture::ReadResult::error) {
+
+			std::fprintf(stderr, "Capture log %s is truncated or corrupted\n", capture);
+			return 2;
+
+		}
+
+	}
+	else {
+
+		Random random(static_cast<unsigned>(seed));
+
+		for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+			auto routine = static_cast<Collishi::Routine>(r);
+			auto arity = Collishi::routine_arity(routine);
+
+			args[r].resize(cases * arity);
+
+			for (std::size_t i = 0; i < cases; i++) random_arguments(routine, random, args[r].data() + i * arity);
+
+		}
+
+	}
+
+	Collishi::VariantRegistry registry;
+
+	std::printf("%-36s %-12s %10s %10s\n", "Routine", "Variant", "Mismatches", "ns");
+
+	for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+		auto routine = static_cast<Collishi::Routine>(r);
+		auto count = args[r].size() / Collishi::routine_arity(routine);
+
+		auto timings = Collishi::autotune(registry, routine, args[r].data(), count, repetitions);
+
+		for (auto& timing : timings) {
+
+			auto marker = (timing.name == registry.selected(routine).name ? " *" : "");
+
+			std::printf("%-36s %-12s %10zu %10.3f%s\n", Collishi::routine_name(routine), timing.name.c_str(), timing.mismatches, timing.nanoseconds, marker);
+
+		}
+
+	}
+
+	if (!registry.save(output)) {
+
+		std::fprintf(stderr, "Could not write %s\n", output);
+		return 2;
+
+	}
+
+	//! The saved selection has to be restored exactly by a fresh registry
+
+	Collishi::VariantRegistry loaded;
+
+	if (!loaded.load(output)) {
+
+		std::fprintf(stderr, "Could not read %s\n", output);
+		return 1;
+
+	}
+
+	for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+		auto routine = static_cast<Collishi::Routine>(r);
+
+		if (loaded.selected(routine).name == registry.selected(routine).name) continue;
+
+		std::fprintf(stderr, "Selection of %s was not restored from %s\n", Collishi::routine_name(routine), output);
+		return 1;
+
+	}
+
+	std::printf("\nSelection written to %s (marked with *)\n", output);
+
+	return 0;
+
+}
@@ -0,0 +1,105 @@
+//! Prints the live metrics which a program publishes with a MetricsExporter (see CollisionsMetrics.h)
+//! Every interval, the tests per second and the hit rate of each routine since the last print, the costs of the phases
+//! (cost tags) in the newest frame and the memory total are printed
+//!
+//! Build: g++ -std=c++17 -O2 tools/metrics_reader.cpp -o metrics_reader (older glibc versions also need -lrt)
+//! Usage: metrics_reader [--name=/collishi-metrics] [--interval=milliseconds] [--count=N]
+
+#include "../CollisionsMetrics.h"
+#include "../benchmarks/Benchmark.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	void print_sample(const Collishi::MetricsSample& sample, const Collishi::MetricsSample* previous) {
+
+		auto seconds = (previous ? (sample.steady_nanoseconds - previous->steady_nanoseconds) * 1e-9 : 0.0);
+
+		std::printf("Frame %llu", static_cast<unsigned long long>(sample.frame));
+		if (previous) std::printf(", %llu frames in %.2f s", static_cast<unsigned long long>(sample.frame - previous->frame), seconds);
+		std::printf("\n\n%-20s %14s %14s %10s\n", "Routine", "Tests", "Tests/s", "Hit rate");
+
+		for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+			auto& routine = sample.routines[r];
+			if (routine.tests == 0) continue;
+
+			//! Without a previous sample, the rates are over the whole run
+
+			auto tests = routine.tests - (previous ? previous->routines[r].tests : 0);
+			auto hits = routine.hits - (previous ? previous->routines[r].hits : 0);
+
+			std::printf("%-20s %14llu ", Collishi::routine_name(static_cast<Collishi::Routine>(r)), static_cast<unsigned long long>(routine.tests));
+
+			if (seconds > 0.0) std::printf("%14.0f ", tests / seconds);
+			else std::printf("%14s ", "-");
+
+			if (tests > 0) std::printf("%9.2f%%\n", 100.0 * hits / tests);
+			else std::printf("%10s\n", "-");
+
+		}
+
+		std::printf("\n%-32s %10s %12s %12s %10s\n", "Phase (last frame)", "Calls", "Tests", "Nodes", "ms");
+
+		for (std::uint32_t p = 0; p < sample.phase_count; p++) {
+
+			auto& phase = sample.phases[p];
+
+			std::printf("%-32s %10llu %12llu %12llu %10.3f\n", phase.name, static_cast<unsigned long long>(phase.costs.calls), static_cast<unsigned long long>(phase.costs.tests),
+				static_cast<unsigned long long>(phase.costs.nodes_visited), phase.costs.nanoseconds * 1e-6);
+
+		}
+
+		std::printf("\nMemory: %llu bytes used, %llu reserved, %llu wasted\n\n", static_cast<unsigned long long>(sample.memory_used),
+			static_cast<unsigned long long>(sample.memory_reserved), static_cast<unsigned long long>(sample.memory_wasted));
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto name = option(argc, argv, "name", Collishi::default_metrics_name);
+	auto interval = option(argc, argv, "interval", 1000l);
+	auto count = option(argc, argv, "count", 0l);
+
+	Collishi::MetricsReader reader;
+
+	if (!reader.open(name)) {
+
+		std::fprintf(stderr, "Could not open the metrics segment %s (is the program running with a MetricsExporter?)\n", name);
+		return 1;
+
+	}
+
+	Collishi::MetricsSample previous = {};
+	bool has_previous = false;
+
+	for (long printed = 0; count == 0 || printed < count; printed++) {
+
+		if (printed > 0) std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+
+		Collishi::MetricsSample sample;
+
+		if (!reader.latest(sample)) {
+
+			std::printf("No samples published yet\n");
+			continue;
+
+		}
+
+		print_sample(sample, has_previous ? &previous : nullptr);
+
+		previous = sample;
+		has_previous = true;
+
+	}
+
+	return 0;
+
+}
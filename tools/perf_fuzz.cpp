@@ -0,0 +1,460 @@
+//! Searches for inputs which make the routines and the broadphases slow, and writes the worst cases into a regression corpus
+//! Average timings on random inputs hide pathological cases (e.g. degenerate triangles which pass all early outs,
+//! denormal values, clusters of shapes in one grid cell), so this tool mutates the slowest inputs found so far
+//! and keeps the mutations which are even slower
+//!
+//! Every routine is searched twice: once with normal float values only, which finds slow paths through the routine
+//! (e.g. degenerate shapes passing all early outs), and once allowing denormal values, which are slow on many processors
+//! and would otherwise hide all other cases
+//!
+//! The cost is measured in cycles if hardware counters are available, otherwise in nanoseconds
+//! Each input is timed on repeated calls, so the cost of an input is the cost of its path through the routine,
+//! without the branch mispredictions of changing inputs
+//! The broadphase cost is normalized by the number of shapes and colliding pairs, since every broadphase needs
+//! to report all colliding pairs and scenes where everything collides are not interesting
+//!
+//! The corpus (see benchmarks/Corpus.h) is used by benchmarks/routines.cpp and benchmarks/broadphase.cpp,
+//! the routine corpus is a capture log and can also be replayed with tools/replay.cpp
+//!
+//! Build: g++ -std=c++17 -O2 tools/perf_fuzz.cpp -o perf_fuzz
+//! Usage: perf_fuzz [--iterations=N] [--scene-iterations=N] [--scene-size=N] [--keep=N] [--seed=N] [--output=directory]
+
+#include "../CollisionsBroadphase.h"
+#include "../CollisionsCapture.h"
+#include "../benchmarks/Benchmark.h"
+#include "../benchmarks/Corpus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace Collishi::Benchmark;
+
+namespace {
+
+	//! Calls per measurement of a routine and number of measurements of which the cheapest counts
+
+	constexpr int calls_per_measurement = 64;
+	constexpr int trials = 3;
+
+	class CostMeter {
+
+	public:
+
+		CostMeter() {
+
+			counters.start();
+			cycles = counters.stop().has(Counter::cycles);
+
+		}
+
+		const char* unit() const {
+
+			return (cycles ? "cycles" : "ns");
+
+		}
+
+		//! Cost of one run divided by operations, the cheapest of several runs
+
+		template <class F> double measure(F&& run, double operations, int runs = trials) {
+
+			double best = 0.0;
+
+			for (int r = 0; r < runs; r++) {
+
+				Timer timer;
+
+				counters.start();
+				timer.start();
+
+				run();
+
+				auto elapsed = timer.stop();
+				auto values = counters.stop();
+
+				auto cost = (cycles ? values[Counter::cycles] : elapsed * 1e6) / operations;
+
+				if (r == 0 || cost < best) best = cost;
+
+			}
+
+			return best;
+
+		}
+
+	private:
+
+		PerfCounters counters;
+		bool cycles = false;
+
+	};
+
+	struct RoutineCase {
+
+		float args[Collishi::max_routine_arity];
+		double cost;
+
+	};
+
+	double routine_cost(CostMeter& meter, Collishi::Routine routine, const float* args, int runs = trials) {
+
+		return meter.measure([&]() {
+
+			std::size_t hits = 0;
+
+			for (int i = 0; i < calls_per_measurement; i++) {
+
+				hits += Collishi::invoke_routine(routine, args);
+
+				//! The memory clobber forces the arguments to be loaded again, so the calls cannot be merged
+
+				do_not_optimize(hits);
+
+			}
+
+		}, calls_per_measurement, runs);
+
+	}
+
+	void mutate_arguments(Collishi::Routine routine, Random& random, float* args, bool denormals) {
+
+		auto arity = static_cast<int>(Collishi::routine_arity(routine));
+		auto first_arity = static_cast<int>(Collishi::shape_arity(Collishi::routine_first_shape(routine)));
+
+		auto i = random.integer(0, arity - 1);
+		auto j = random.integer(0, arity - 1);
+
+		switch (random.integer(0, denormals ? 7 : 6)) {
+
+			case 0:
+				args[i] += random.normal(0.0f, std::max(std::fabs(args[i]), 1.0f) * 0.1f);
+				break;
+
+			case 1:
+				args[i] = 0.0f;
+				break;
+
+			case 2:
+				args[j] = args[i];
+				break;
+
+			//! Second shape at the position of the first
+
+			case 3:
+				args[first_arity] = args[0] + random.normal(0.0f, 0.01f);
+				args[first_arity + 1] = args[1] + random.normal(0.0f, 0.01f);
+				break;
+
+			//! Degenerate shapes: collinear triangles and lines of length zero
+
+			case 4: {
+
+				auto shape = (random.integer(0, 1) ? Collishi::routine_first_shape(routine) : Collishi::routine_second_shape(routine));
+				auto offset = (shape == Collishi::routine_first_shape(routine) ? 0 : first_arity);
+
+				if (shape == Collishi::ShapeType::triangle) {
+
+					auto t = random.uniform(-2.0f, 2.0f);
+
+					args[offset + 4] = t * args[offset + 2];
+					args[offset + 5] = t * args[offset + 3];
+
+				}
+				else if (shape == Collishi::ShapeType::line) {
+
+					args[offset + 2] = 0.0f;
+					args[offset + 3] = 0.0f;
+
+				}
+
+				break;
+
+			}
+
+			case 5: {
+
+				auto factor = std::exp2(static_cast<float>(random.integer(-20, 20)));
+
+				for (int a = 0; a < arity; a++) args[a] *= factor;
+
+				break;
+
+			}
+
+			case 6:
+				args[i] = -args[i];
+				break;
+
+			case 7:
+				args[i] = random.uniform(-1.0f, 1.0f) * 1e-39f;
+				break;
+
+		}
+
+	}
+
+	bool valid(const float* args, std::size_t count, bool denormals) {
+
+		for (std::size_t i = 0; i < count; i++) {
+
+			if (!std::isfinite(args[i])) return false;
+			if (!denormals && std::fpclassify(args[i]) == FP_SUBNORMAL) return false;
+
+		}
+
+		return true;
+
+	}
+
+	//! Returns the worst cases sorted by decreasing cost and writes the median cost of random inputs into random_cost
+
+	std::vector<RoutineCase> fuzz_routine(CostMeter& meter, Collishi::Routine routine, Random& random, long iterations, std::size_t keep, bool denormals, double& random_cost) {
+
+		auto arity = Collishi::routine_arity(routine);
+		auto by_cost = [](const RoutineCase& a, const RoutineCase& b) { return a.cost > b.cost; };
+
+		std::vector<RoutineCase> population;
+		std::vector<double> random_costs;
+
+		for (int i = 0; i < 64; i++) {
+
+			RoutineCase candidate = {};
+			random_arguments(routine, random, candidate.args);
+			candidate.cost = routine_cost(meter, routine, candidate.args);
+
+			random_costs.push_back(candidate.cost);
+			population.push_back(candidate);
+
+		}
+
+		std::sort(random_costs.begin(), random_costs.end());
+		random_cost = random_costs[random_costs.size() / 2];
+
+		std::sort(population.begin(), population.end(), by_cost);
+		population.resize(keep);
+
+		for (long iteration = 0; iteration < iterations; iteration++) {
+
+			auto child = population[random.integer(0, static_cast<int>(population.size()) - 1)];
+
+			for (int m = random.integer(1, 3); m > 0; m--) mutate_arguments(routine, random, child.args, denormals);
+
+			if (!valid(child.args, arity, denormals)) continue;
+
+			child.cost = routine_cost(meter, routine, child.args);
+
+			if (child.cost <= population.back().cost) continue;
+
+			population.back() = child;
+			std::sort(population.begin(), population.end(), by_cost);
+
+		}
+
+		//! A single measurement may have been disturbed, so the survivors are measured again more carefully
+
+		for (auto& survivor : population) survivor.cost = routine_cost(meter, routine, survivor.args, 4 * trials);
+
+		std::sort(population.begin(), population.end(), by_cost);
+
+		return population;
+
+	}
+
+	//! Cost of the strategy per shape and colliding pair, with the cell size and sweep axis the statistics recommend
+
+	double scene_cost(CostMeter& meter, Collishi::BroadphaseRunner& runner, Collishi::BroadphaseStrategy strategy, const std::vector<Collishi::Shape>& shapes) {
+
+		auto& shape_bounds = runner.update_bounds(shapes);
+		auto statistics = Collishi::scene_statistics(shape_bounds.data(), shape_bounds.size());
+		auto cell_size = Collishi::Broadphase::estimate_grid(statistics).cell_size;
+		auto along_y = Collishi::Broadphase::sweep_along_y(statistics);
+
+		std::vector<Collishi::Pair> pairs;
+		pairs.reserve(shapes.size() * shapes.size() / 2);
+
+		runner.collide(strategy, cell_size, along_y, shapes, pairs);
+
+		auto operations = static_cast<double>(shapes.size() + pairs.size());
+
+		return meter.measure([&]() {
+
+			pairs.clear();
+			runner.collide(strategy, cell_size, along_y, shapes, pairs);
+
+		}, operations);
+
+	}
+
+	Collishi::Shape random_scene_shape(Random& random) {
+
+		auto type = static_cast<Collishi::ShapeType>(random.integer(0, 4));
+
+		Collishi::Shape shape = { type, {} };
+		random_shape(type, random, shape.values, 1000.0f);
+
+		//! Smaller shapes than random_shape generates for pairs, so random scenes are sparse
+
+		for (std::size_t i = 2; i < Collishi::shape_arity(type); i++) shape.values[i] *= 0.02f;
+
+		return shape;
+
+	}
+
+	void mutate_scene(Random& random, std::vector<Collishi::Shape>& shapes) {
+
+		auto count = static_cast<int>(shapes.size());
+		auto subset = std::max(1, count / 10);
+
+		switch (random.integer(0, 3)) {
+
+			//! Cluster: a subset of shapes moves close to one point
+
+			case 0: {
+
+				auto& center = shapes[random.integer(0, count - 1)];
+
+				for (int s = 0; s < subset; s++) {
+
+					auto& shape = shapes[random.integer(0, count - 1)];
+
+					shape.values[0] = center.values[0] + random.normal(0.0f, 1.0f);
+					shape.values[1] = center.values[1] + random.normal(0.0f, 1.0f);
+
+				}
+
+				break;
+
+			}
+
+			//! One shape grows
+
+			case 1: {
+
+				auto& shape = shapes[random.integer(0, count - 1)];
+
+				for (std::size_t i = 2; i < Collishi::shape_arity(shape.type); i++) shape.values[i] *= 8.0f;
+
+				break;
+
+			}
+
+			//! A subset of shapes is lined up on one coordinate
+
+			case 2: {
+
+				auto axis = random.integer(0, 1);
+				auto value = shapes[random.integer(0, count - 1)].values[axis];
+
+				for (int s = 0; s < subset; s++) shapes[random.integer(0, count - 1)].values[axis] = value;
+
+				break;
+
+			}
+
+			case 3:
+				shapes[random.integer(0, count - 1)] = random_scene_shape(random);
+				break;
+
+		}
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto iterations = option(argc, argv, "iterations", 2000l);
+	auto scene_iterations = option(argc, argv, "scene-iterations", 200l);
+	auto scene_size = static_cast<std::size_t>(option(argc, argv, "scene-size", 256l));
+	auto keep = static_cast<std::size_t>(option(argc, argv, "keep", 8l));
+	auto seed = option(argc, argv, "seed", 12345l);
+	std::string output = option(argc, argv, "output", default_corpus_directory);
+
+	Random random(static_cast<unsigned>(seed));
+	CostMeter meter;
+
+	Collishi::Capture::Log log;
+
+	if (!log.open(corpus_routines_file(output).c_str())) {
+
+		std::fprintf(stderr, "Could not write %s (does the directory exist?)\n", corpus_routines_file(output).c_str());
+		return 2;
+
+	}
+
+	std::printf("Cost in %s per call\n\n", meter.unit());
+	std::printf("%-36s %12s %12s %8s %12s %8s\n", "Routine", "Random", "Worst", "Ratio", "Denormal", "Ratio");
+
+	for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+		auto routine = static_cast<Collishi::Routine>(r);
+
+		double random_cost = 0.0;
+		auto worst = fuzz_routine(meter, routine, random, iterations, keep, false, random_cost);
+		auto worst_denormal = fuzz_routine(meter, routine, random, iterations, keep, true, random_cost);
+
+		std::printf("%-36s %12.2f %12.2f %8.2f %12.2f %8.2f\n", Collishi::routine_name(routine), random_cost, worst.front().cost, worst.front().cost / random_cost, worst_denormal.front().cost, worst_denormal.front().cost / random_cost);
+
+		worst.insert(worst.end(), worst_denormal.begin(), worst_denormal.end());
+
+		for (auto& worst_case : worst) log.record_call(routine, worst_case.args, Collishi::invoke_routine(routine, worst_case.args));
+
+	}
+
+	if (!log.close()) {
+
+		std::fprintf(stderr, "Could not write %s\n", corpus_routines_file(output).c_str());
+		return 2;
+
+	}
+
+	std::printf("\nCost in %s per shape and colliding pair, scenes of %zu shapes\n\n", meter.unit(), scene_size);
+	std::printf("%-36s %12s %12s %8s\n", "Broadphase", "Random", "Worst", "Ratio");
+
+	for (std::size_t s = 0; s < Collishi::broadphase_strategy_count; s++) {
+
+		auto strategy = static_cast<Collishi::BroadphaseStrategy>(s);
+
+		Collishi::BroadphaseRunner runner;
+
+		std::vector<Collishi::Shape> worst(scene_size);
+		for (auto& shape : worst) shape = random_scene_shape(random);
+
+		auto random_cost = scene_cost(meter, runner, strategy, worst);
+		auto worst_cost = random_cost;
+
+		for (long iteration = 0; iteration < scene_iterations; iteration++) {
+
+			auto scene = worst;
+			mutate_scene(random, scene);
+
+			auto cost = scene_cost(meter, runner, strategy, scene);
+
+			if (cost <= worst_cost) continue;
+
+			worst = scene;
+			worst_cost = cost;
+
+		}
+
+		std::printf("%-36s %12.2f %12.2f %8.2f\n", Collishi::broadphase_name(strategy), random_cost, worst_cost, worst_cost / random_cost);
+
+		auto filename = corpus_scene_file(output, strategy);
+		auto comment = std::string("Worst scene found by tools/perf_fuzz.cpp for the broadphase ") + Collishi::broadphase_name(strategy);
+
+		if (!write_scene(filename.c_str(), worst, comment.c_str())) {
+
+			std::fprintf(stderr, "Could not write %s\n", filename.c_str());
+			return 2;
+
+		}
+
+	}
+
+	std::printf("\nCorpus written to %s\n", output.c_str());
+
+	return 0;
+
+}
@@ -0,0 +1,179 @@
+//! Replays a capture log (see CollisionsCapture.h) against the Collisions.h this tool was compiled with
+//! Reports the time per routine and every call whose result differs from the recorded one
+//!
+//! Build (choose the ISA or configuration to compare, e.g. -march=native):
+//! g++ -std=c++17 -O2 tools/replay.cpp -o replay
+//!
+//! Usage: replay --log=file [--repetitions=N] [--max-printed=N]
+//!
+//! The exit code is 0 if all results match, 1 if results differ and 2 if the log cannot be read or is truncated or corrupted
+
+#include "../CollisionsCapture.h"
+#include "../benchmarks/Benchmark.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	struct RoutineReport {
+
+		std::size_t calls = 0;
+		std::size_t hits = 0;
+		std::size_t differences = 0;
+		double nanoseconds = 0.0;
+
+	};
+
+	const char* compiled_isa() {
+
+#if defined(__AVX512F__)
+		return "AVX-512";
+#elif defined(__AVX2__)
+		return "AVX2";
+#elif defined(__AVX__)
+		return "AVX";
+#elif defined(__SSE4_2__)
+		return "SSE4.2";
+#elif defined(__SSE2__) || defined(_M_X64)
+		return "SSE2";
+#elif defined(__ARM_NEON)
+		return "NEON";
+#else
+		return "generic";
+#endif
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto log_file = option(argc, argv, "log", static_cast<const char*>(nullptr));
+	auto repetitions = option(argc, argv, "repetitions", 10l);
+	auto max_printed = static_cast<std::size_t>(option(argc, argv, "max-printed", 20l));
+
+	if (!log_file) {
+
+		std::fprintf(stderr, "Usage: %s --log=file [--repetitions=N] [--max-printed=N]\n", argv[0]);
+		return 2;
+
+	}
+
+	if (repetitions < 1) repetitions = 1;
+
+	Collishi::Capture::Reader reader;
+
+	if (!reader.open(log_file)) {
+
+		std::fprintf(stderr, "Could not open capture log %s\n", log_file);
+		return 2;
+
+	}
+
+	//! Load the whole log first and group the calls by routine, so file access and clock overhead do not distort the timings
+
+	struct RoutineCalls {
+
+		std::vector<float> args;
+		std::vector<bool> recorded;
+
+	};
+
+	RoutineCalls calls[Collishi::routine_count];
+	std::size_t record_count = 0;
+
+	Collishi::Capture::Record record;
+	Collishi::Capture::ReadResult result;
+
+	while ((result = reader.next(record)) == Collishi::Capture::ReadResult::record) {
+
+		auto& group = calls[static_cast<std::size_t>(record.routine)];
+
+		group.args.insert(group.args.end(), record.args.begin(), record.args.end());
+		group.recorded.insert(group.recorded.end(), record.results.begin(), record.results.end());
+
+		record_count++;
+
+	}
+
+	if (result == Collishi::Capture::ReadResult::error) {
+
+		std::fprintf(stderr, "Capture log %s is truncated or corrupted after %zu records\n", log_file, record_count);
+		return 2;
+
+	}
+
+	RoutineReport reports[Collishi::routine_count];
+	std::size_t printed = 0;
+
+	for (std::size_t r = 0; r < Collishi::routine_count; r++) {
+
+		auto routine = static_cast<Collishi::Routine>(r);
+		auto arity = Collishi::routine_arity(routine);
+
+		auto& group = calls[r];
+		auto& report = reports[r];
+
+		report.calls = group.recorded.size();
+
+		if (report.calls == 0) continue;
+
+		std::unique_ptr<bool[]> results(new bool[report.calls]);
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (long i = 0; i < repetitions; i++) {
+
+			Collishi::invoke_routine_batch(routine, group.args.data(), report.calls, results.get());
+
+		}
+
+		auto end = std::chrono::steady_clock::now();
+
+		report.nanoseconds = std::chrono::duration<double, std::nano>(end - start).count() / repetitions;
+
+		for (std::size_t i = 0; i < report.calls; i++) {
+
+			if (results[i]) report.hits++;
+			if (results[i] == group.recorded[i]) continue;
+
+			report.differences++;
+
+			if (printed++ >= max_printed) continue;
+
+			std::printf("Difference in %s: recorded %d, replayed %d, arguments", Collishi::routine_name(routine), static_cast<int>(group.recorded[i]), static_cast<int>(results[i]));
+
+			for (std::size_t a = 0; a < arity; a++) std::printf(" %.9g", group.args[i * arity + a]);
+
+			std::printf("\n");
+
+		}
+
+	}
+
+	std::printf("Replayed %zu records from %s (compiled for %s, %ld repetitions)\n\n", record_count, log_file, compiled_isa(), repetitions);
+	std::printf("%-36s %12s %8s %12s %12s\n", "Routine", "Calls", "Hit %", "ns/call", "Differences");
+
+	std::size_t total_differences = 0;
+
+	for (std::size_t i = 0; i < Collishi::routine_count; i++) {
+
+		auto& report = reports[i];
+
+		if (report.calls == 0) continue;
+
+		std::printf("%-36s %12zu %8.2f %12.3f %12zu\n", Collishi::routine_name(static_cast<Collishi::Routine>(i)), report.calls,
+			100.0 * report.hits / report.calls, report.nanoseconds / report.calls, report.differences);
+
+		total_differences += report.differences;
+
+	}
+
+	return (total_differences == 0 ? 0 : 1);
+
+}
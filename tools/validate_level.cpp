@@ -0,0 +1,230 @@
+//! Finds every pair of overlapping shapes in a static level, for example to report misplaced geometry in a level pipeline
+//! The level is a binary shape file (see CollisionsShapeFile.h), which is mapped instead of parsed, and the pairs are found
+//! with collide_all_parallel on all cores, so maps with millions of shapes take seconds
+//!
+//! The pairs are written one per line as "<first index> <second index> <first type> <second type>", sorted by the indices
+//! The exit code is 0 for a level without overlaps, 2 if overlaps were found and 1 on errors
+//!
+//! Build: g++ -std=c++17 -O2 -pthread tools/validate_level.cpp -o validate_level
+//! Usage: validate_level --level=file [--pairs=file] [--threads=N] [--verify]
+//!        validate_level --scene=file --write=file    converts a text scene (see benchmarks/Corpus.h) into a shape file
+//!        validate_level --generate=N --write=file [--seed=N]    writes a random level of N shapes for trials
+
+#include "../CollisionsBroadphase.h"
+#include "../CollisionsShapeFile.h"
+#include "../benchmarks/Benchmark.h"
+#include "../benchmarks/Corpus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+	using namespace Collishi::Benchmark;
+
+	//! Above this number of shapes, --verify would take too long
+
+	constexpr std::size_t max_verified_shapes = 50000;
+
+	//! Walls and props of about the same size in an area growing with their number, with a few overlaps per shape
+
+	std::vector<Collishi::Shape> random_level(Random& random, std::size_t count) {
+
+		auto extent = 6.0f * std::sqrt(static_cast<float>(count));
+
+		std::vector<Collishi::Shape> shapes(count);
+
+		float args[Collishi::max_routine_arity];
+
+		for (auto& shape : shapes) {
+
+			auto type = static_cast<Collishi::ShapeType>(random.integer(1, 4));
+
+			random_shape(type, random, args, 10.0f);
+
+			shape.type = type;
+			for (std::size_t i = 0; i < Collishi::shape_arity(type); i++) shape.values[i] = args[i];
+
+			shape.values[0] = random.uniform(-extent, extent);
+			shape.values[1] = random.uniform(-extent, extent);
+
+		}
+
+		return shapes;
+
+	}
+
+	bool write_level(const char* filename, const std::vector<Collishi::Shape>& shapes) {
+
+		if (!Collishi::write_shape_file(filename, shapes.data(), shapes.size())) {
+
+			std::fprintf(stderr, "Could not write %s\n", filename);
+			return false;
+
+		}
+
+		std::printf("Wrote %zu shapes to %s\n", shapes.size(), filename);
+
+		return true;
+
+	}
+
+	bool write_pairs(const char* filename, const Collishi::Shape* shapes, const std::vector<Collishi::Pair>& pairs) {
+
+		auto file = std::fopen(filename, "w");
+		if (!file) return false;
+
+		for (auto& pair : pairs) {
+
+			std::fprintf(file, "%u %u %s %s\n", pair.first, pair.second, shape_type_name(shapes[pair.first].type), shape_type_name(shapes[pair.second].type));
+
+		}
+
+		return std::fclose(file) == 0;
+
+	}
+
+	//! Number of pairs which differ from testing all pairs
+
+	std::size_t verify(const Collishi::Shape* shapes, std::size_t count, const std::vector<Collishi::Pair>& pairs) {
+
+		std::vector<Collishi::Pair> expected;
+
+		for (std::uint32_t i = 0; i < count; i++) {
+
+			for (std::uint32_t j = i + 1; j < count; j++) {
+
+				if (Collishi::collision(shapes[i], shapes[j])) expected.push_back({ i, j });
+
+			}
+
+		}
+
+		std::size_t differences = 0;
+
+		for (std::size_t e = 0, p = 0; e < expected.size() || p < pairs.size(); ) {
+
+			if (e < expected.size() && p < pairs.size() && expected[e] == pairs[p]) {
+
+				e++;
+				p++;
+				continue;
+
+			}
+
+			auto missing = (p == pairs.size() || (e < expected.size() && (expected[e].first < pairs[p].first || (expected[e].first == pairs[p].first && expected[e].second < pairs[p].second))));
+			auto& pair = (missing ? expected[e++] : pairs[p++]);
+
+			if (differences++ < 10) std::printf("  %s pair (%u|%u)\n", (missing ? "Missing" : "Wrong"), pair.first, pair.second);
+
+		}
+
+		return differences;
+
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	auto level_file = option(argc, argv, "level", static_cast<const char*>(nullptr));
+	auto pairs_file = option(argc, argv, "pairs", static_cast<const char*>(nullptr));
+	auto scene_file = option(argc, argv, "scene", static_cast<const char*>(nullptr));
+	auto output_file = option(argc, argv, "write", static_cast<const char*>(nullptr));
+	auto generate = option(argc, argv, "generate", 0l);
+	auto threads = static_cast<unsigned>(option(argc, argv, "threads", 0l));
+	auto seed = static_cast<unsigned>(option(argc, argv, "seed", 12345l));
+
+	if (output_file && scene_file) {
+
+		std::vector<Collishi::Shape> shapes;
+
+		if (!read_scene(scene_file, shapes)) {
+
+			std::fprintf(stderr, "Could not read the scene %s\n", scene_file);
+			return 1;
+
+		}
+
+		return (write_level(output_file, shapes) ? 0 : 1);
+
+	}
+
+	if (output_file && generate > 0) {
+
+		Random random(seed);
+
+		return (write_level(output_file, random_level(random, static_cast<std::size_t>(generate))) ? 0 : 1);
+
+	}
+
+	if (!level_file) {
+
+		std::fprintf(stderr, "Usage: %s --level=file [--pairs=file] [--threads=N] [--verify]\n", argv[0]);
+		std::fprintf(stderr, "       %s --scene=file --write=file\n", argv[0]);
+		std::fprintf(stderr, "       %s --generate=N --write=file [--seed=N]\n", argv[0]);
+		return 1;
+
+	}
+
+	Timer timer;
+	timer.start();
+
+	Collishi::MappedShapeFile level;
+
+	if (!level.open(level_file)) {
+
+		std::fprintf(stderr, "Could not map %s, or it is no shape file written on this platform\n", level_file);
+		return 1;
+
+	}
+
+	auto unknown = level.first_unknown_type();
+
+	if (unknown < level.size()) {
+
+		std::fprintf(stderr, "Shape %zu of %s has an unknown type\n", unknown, level_file);
+		return 1;
+
+	}
+
+	auto map_ms = timer.stop();
+
+	timer.start();
+
+	std::vector<Collishi::Pair> pairs;
+	auto used_threads = Collishi::collide_all_parallel(level.shapes(), level.size(), pairs, threads);
+
+	auto collide_ms = timer.stop();
+
+	std::printf("%zu shapes, %zu overlapping pairs (mapped in %.1f ms, collided in %.1f ms on %u threads)\n", level.size(), pairs.size(), map_ms, collide_ms, used_threads);
+
+	if (pairs_file && !write_pairs(pairs_file, level.shapes(), pairs)) {
+
+		std::fprintf(stderr, "Could not write the pairs to %s\n", pairs_file);
+		return 1;
+
+	}
+
+	if (flag(argc, argv, "verify")) {
+
+		if (level.size() > max_verified_shapes) {
+
+			std::fprintf(stderr, "--verify tests all pairs and is limited to %zu shapes\n", max_verified_shapes);
+			return 1;
+
+		}
+
+		auto differences = verify(level.shapes(), level.size(), pairs);
+
+		std::printf("Verified against all pairs: %zu differences\n", differences);
+
+		if (differences > 0) return 1;
+
+	}
+
+	return (pairs.empty() ? 0 : 2);
+
+}